@@ -8,8 +8,42 @@
 echo Building main...
 g++ -o run src/main.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
 
+g++ -o run_replay src/replay.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_trace_decode src/trace_decode.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_loadgen src/loadgen.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+
 echo Building tests...
 g++ -o run_test_async tests/test_async.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
 g++ -o run_test_lib tests/test_lib.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_containers tests/test_containers.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_orders tests/test_orders.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_scheduler tests/test_scheduler.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_risk tests/test_risk.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_fix tests/test_fix.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_binary tests/test_binary.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_stream tests/test_stream.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_stats tests/test_stats.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_trace tests/test_trace.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_auction tests/test_auction.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_masscancel tests/test_masscancel.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_expiry tests/test_expiry.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_prorata tests/test_prorata.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_hugepages tests/test_hugepages.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_marketdata tests/test_marketdata.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_ingress tests/test_ingress.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_implied tests/test_implied.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_compact tests/test_compact.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_replica tests/test_replica.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_queuerank tests/test_queuerank.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_analytics tests/test_analytics.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+g++ -o run_test_fixed tests/test_fixed.cpp src/lib.cpp -I include -std=c++20 -fcoroutines
+
+echo Building benchmarks...
+g++ -o run_bench_fix src/bench_fix.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_bench_binary src/bench_binary.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_bench_ingress src/bench_ingress.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_bench_memory src/bench_memory.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_bench_replica src/bench_replica.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
+g++ -o run_bench_risk src/bench_risk.cpp src/lib.cpp -I include -std=c++20 -fcoroutines -O2
 
 echo Done.
@@ -0,0 +1,489 @@
+#ifndef INCLUDED_CODEC_BINARY_HPP
+#define INCLUDED_CODEC_BINARY_HPP
+
+//
+// Compact binary order entry protocol in the style of SBE (Simple Binary
+// Encoding).
+//
+// Every message is a fixed 8 byte header followed by a fixed layout block of
+// little-endian fields:
+//
+//      Header          block_length:u16 template_id:u16 schema_id:u16 version:u16
+//
+//      NewOrder (1)    order_id:u64 price:i64 quantity:i64 stop_price:i64
+//                      display_quantity:i64 account:u32 side:u8 order_type:u8
+//                      (2 bytes padding)                                  48 bytes
+//      Cancel (2)      order_id:u64 account:u32 side:u8 (3 bytes padding)   16 bytes
+//      Amend (3)       order_id:u64 price:i64 quantity:i64 account:u32
+//                      side:u8 (3 bytes padding)                            32 bytes
+//      Execution (101) exec_id:u64 price:i64 quantity:i64 account:u32
+//                      side:u8 (3 bytes padding)                            32 bytes
+//
+// Decoding doesn't parse nor copy anything. Message views are flyweights
+// over the wire buffer, which read fields at fixed offsets on access, and
+// `to_order()` maps them into any `OrderConcept` type to feed `OrderBook`.
+//
+// Prices are integer ticks on the wire, and `ticks_per_unit` converts them
+// to and from floating point price types. Receiver uses `block_length` from
+// the header to skip fields appended by newer versions of the schema, and
+// rejects messages of other schema, or of version older than it knows.
+//
+// New order is rejected, as by FIX parser, when its quantity isn't positive,
+// and `to_order()` rejects StopLimit for order type without stop price.
+//
+
+#include "orderbook/enums.hpp"
+#include "orderbook/concepts.hpp"
+#include "orderbook/traits.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+
+namespace sadhbhcraft::codec
+{
+    namespace detail
+    {
+        template<typename T>
+        T load_le(const char *p)
+        {
+            T x;
+            std::memcpy(&x, p, sizeof(T));
+            if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1)
+            {
+                auto *b = reinterpret_cast<unsigned char *>(&x);
+                std::reverse(b, b + sizeof(T));
+            }
+            return x;
+        }
+
+        template<typename T>
+        void store_le(char *p, T x)
+        {
+            if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1)
+            {
+                auto *b = reinterpret_cast<unsigned char *>(&x);
+                std::reverse(b, b + sizeof(T));
+            }
+            std::memcpy(p, &x, sizeof(T));
+        }
+
+        template<util::NumberConcept T>
+        T from_ticks(std::int64_t ticks, std::int64_t ticks_per_unit)
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                return static_cast<T>(ticks) / static_cast<T>(ticks_per_unit);
+            }
+            else
+            {
+                return static_cast<T>(ticks / ticks_per_unit);
+            }
+        }
+
+        template<util::NumberConcept T>
+        std::int64_t to_ticks(T x, std::int64_t ticks_per_unit)
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                return std::llround(x * static_cast<T>(ticks_per_unit));
+            }
+            else
+            {
+                return static_cast<std::int64_t>(x) * ticks_per_unit;
+            }
+        }
+
+        template<typename OrderType>
+        std::uint32_t account_of(const OrderType &order)
+        {
+            if constexpr (orderbook::OwnerMemberConcept<OrderType>)
+            {
+                if constexpr (std::is_integral_v<decltype(order.owner)>)
+                {
+                    return static_cast<std::uint32_t>(order.owner);
+                }
+            }
+            return 0;
+        }
+    }
+
+    enum class BinaryTemplate : std::uint16_t
+    {
+        NewOrder = 1,
+        Cancel = 2,
+        Amend = 3,
+        Execution = 101
+    };
+
+    enum class BinaryError
+    {
+        None,
+        Incomplete,         // Buffer ends before the end of the message
+        BadBlockLength,     // Block is shorter than the schema requires
+        UnknownTemplate,
+        UnsupportedSchema,  // Other schema id, or version older than ours
+        BadValue            // Field out of range, or order type can't hold it
+    };
+
+    struct BinaryDecodeResult
+    {
+        BinaryError error;
+        // Length of the message including header, and it is zero when the
+        // header itself is incomplete
+        std::size_t consumed;
+
+        explicit operator bool() const { return error == BinaryError::None; }
+    };
+
+    constexpr std::uint16_t binary_schema_id = 1;
+    constexpr std::uint16_t binary_schema_version = 1;
+
+    class BinaryHeaderView
+    {
+    public:
+        static constexpr std::size_t size = 8;
+
+        explicit BinaryHeaderView(const char *p): m_p(p)
+        {}
+
+        std::uint16_t block_length() const { return detail::load_le<std::uint16_t>(m_p); }
+        std::uint16_t template_id() const { return detail::load_le<std::uint16_t>(m_p + 2); }
+        std::uint16_t schema_id() const { return detail::load_le<std::uint16_t>(m_p + 4); }
+        std::uint16_t version() const { return detail::load_le<std::uint16_t>(m_p + 6); }
+
+        static void write(char *p, BinaryTemplate template_id, std::uint16_t block_length)
+        {
+            detail::store_le<std::uint16_t>(p, block_length);
+            detail::store_le<std::uint16_t>(p + 2, static_cast<std::uint16_t>(template_id));
+            detail::store_le<std::uint16_t>(p + 4, binary_schema_id);
+            detail::store_le<std::uint16_t>(p + 6, binary_schema_version);
+        }
+
+    private:
+        const char *m_p;
+    };
+
+    // Flyweight over NewOrder block
+    class NewOrderView
+    {
+    public:
+        static constexpr BinaryTemplate template_id = BinaryTemplate::NewOrder;
+        static constexpr std::uint16_t block_length = 48;
+
+        explicit NewOrderView(const char *p): m_p(p)
+        {}
+
+        std::uint64_t order_id() const { return detail::load_le<std::uint64_t>(m_p); }
+        std::int64_t price() const { return detail::load_le<std::int64_t>(m_p + 8); }
+        std::int64_t quantity() const { return detail::load_le<std::int64_t>(m_p + 16); }
+        std::int64_t stop_price() const { return detail::load_le<std::int64_t>(m_p + 24); }
+        std::int64_t display_quantity() const { return detail::load_le<std::int64_t>(m_p + 32); }
+        std::uint32_t account() const { return detail::load_le<std::uint32_t>(m_p + 40); }
+        orderbook::Side side() const { return static_cast<orderbook::Side>(m_p[44]); }
+        orderbook::OrderType order_type() const { return static_cast<orderbook::OrderType>(m_p[45]); }
+
+        bool is_valid() const
+        {
+            return static_cast<unsigned char>(m_p[44]) <= 1 && static_cast<unsigned char>(m_p[45]) <= 5
+                && 0 < quantity() && 0 <= display_quantity() && display_quantity() <= quantity();
+        }
+
+        // Map fields into the order, including optional parts the order type
+        // has. Returns `BadValue`, and leaves order untouched, if ticks per
+        // unit isn't positive, or if order is StopLimit and order type has
+        // no stop price to hold it.
+        template<orderbook::OrderConcept OrderType>
+        BinaryError to_order(OrderType &order, std::int64_t ticks_per_unit = 1) const
+        {
+            using PriceType = typename OrderType::PriceType;
+            using QuantityType = typename OrderType::QuantityType;
+
+            if (ticks_per_unit <= 0)
+            {
+                return BinaryError::BadValue;
+            }
+            if constexpr (!orderbook::StopOrderConcept<OrderType>)
+            {
+                if (order_type() == orderbook::OrderType::StopLimit)
+                {
+                    return BinaryError::BadValue;
+                }
+            }
+
+            order.side = side();
+            order.order_type = order_type();
+            order.price = detail::from_ticks<PriceType>(price(), ticks_per_unit);
+            order.quantity = static_cast<QuantityType>(quantity());
+            if constexpr (orderbook::StopOrderConcept<OrderType>)
+            {
+                order.stop_price = detail::from_ticks<PriceType>(stop_price(), ticks_per_unit);
+            }
+            else if (order_type() == orderbook::OrderType::Stop)
+            {
+                order.price = detail::from_ticks<PriceType>(stop_price(), ticks_per_unit);
+            }
+            if constexpr (orderbook::IcebergOrderConcept<OrderType>)
+            {
+                order.display_quantity = static_cast<QuantityType>(display_quantity());
+            }
+            if constexpr (orderbook::OwnerMemberConcept<OrderType>)
+            {
+                if constexpr (std::is_integral_v<decltype(order.owner)>)
+                {
+                    order.owner = static_cast<decltype(order.owner)>(account());
+                }
+            }
+            return BinaryError::None;
+        }
+
+    private:
+        const char *m_p;
+    };
+
+    class CancelView
+    {
+    public:
+        static constexpr BinaryTemplate template_id = BinaryTemplate::Cancel;
+        static constexpr std::uint16_t block_length = 16;
+
+        explicit CancelView(const char *p): m_p(p)
+        {}
+
+        std::uint64_t order_id() const { return detail::load_le<std::uint64_t>(m_p); }
+        std::uint32_t account() const { return detail::load_le<std::uint32_t>(m_p + 8); }
+        orderbook::Side side() const { return static_cast<orderbook::Side>(m_p[12]); }
+
+        bool is_valid() const { return static_cast<unsigned char>(m_p[12]) <= 1; }
+
+    private:
+        const char *m_p;
+    };
+
+    class AmendView
+    {
+    public:
+        static constexpr BinaryTemplate template_id = BinaryTemplate::Amend;
+        static constexpr std::uint16_t block_length = 32;
+
+        explicit AmendView(const char *p): m_p(p)
+        {}
+
+        std::uint64_t order_id() const { return detail::load_le<std::uint64_t>(m_p); }
+        std::int64_t price() const { return detail::load_le<std::int64_t>(m_p + 8); }
+        std::int64_t quantity() const { return detail::load_le<std::int64_t>(m_p + 16); }
+        std::uint32_t account() const { return detail::load_le<std::uint32_t>(m_p + 24); }
+        orderbook::Side side() const { return static_cast<orderbook::Side>(m_p[28]); }
+
+        bool is_valid() const { return static_cast<unsigned char>(m_p[28]) <= 1; }
+
+        template<util::NumberConcept PriceType>
+        PriceType price_as(std::int64_t ticks_per_unit = 1) const
+        {
+            assert(0 < ticks_per_unit);
+            return detail::from_ticks<PriceType>(price(), ticks_per_unit);
+        }
+
+    private:
+        const char *m_p;
+    };
+
+    class ExecutionView
+    {
+    public:
+        static constexpr BinaryTemplate template_id = BinaryTemplate::Execution;
+        static constexpr std::uint16_t block_length = 32;
+
+        explicit ExecutionView(const char *p): m_p(p)
+        {}
+
+        std::uint64_t exec_id() const { return detail::load_le<std::uint64_t>(m_p); }
+        std::int64_t price() const { return detail::load_le<std::int64_t>(m_p + 8); }
+        std::int64_t quantity() const { return detail::load_le<std::int64_t>(m_p + 16); }
+        std::uint32_t account() const { return detail::load_le<std::uint32_t>(m_p + 24); }
+        orderbook::Side side() const { return static_cast<orderbook::Side>(m_p[28]); }
+
+        bool is_valid() const { return static_cast<unsigned char>(m_p[28]) <= 1; }
+
+    private:
+        const char *m_p;
+    };
+
+    // Decode one message from the front of the buffer, and pass its view to
+    // the handler, which is called as one of:
+    //
+    //      handler(NewOrderView);
+    //      handler(CancelView);
+    //      handler(AmendView);
+    //      handler(ExecutionView);
+    //
+    // View is only valid during the call, as it points into the buffer.
+    template<typename Handler>
+    BinaryDecodeResult decode_binary_message(std::string_view buffer, Handler &&handler)
+    {
+        if (buffer.size() < BinaryHeaderView::size)
+        {
+            return {BinaryError::Incomplete, 0};
+        }
+
+        const BinaryHeaderView header(buffer.data());
+        const std::size_t consumed = BinaryHeaderView::size + header.block_length();
+        if (buffer.size() < consumed)
+        {
+            return {BinaryError::Incomplete, 0};
+        }
+        if (header.schema_id() != binary_schema_id || header.version() < binary_schema_version)
+        {
+            return {BinaryError::UnsupportedSchema, consumed};
+        }
+
+        const char *block = buffer.data() + BinaryHeaderView::size;
+        auto dispatch = [&]<typename View>(View view) -> BinaryDecodeResult
+        {
+            if (header.block_length() < View::block_length)
+            {
+                return {BinaryError::BadBlockLength, consumed};
+            }
+            if (!view.is_valid())
+            {
+                return {BinaryError::BadValue, consumed};
+            }
+            handler(view);
+            return {BinaryError::None, consumed};
+        };
+
+        switch (static_cast<BinaryTemplate>(header.template_id()))
+        {
+        case BinaryTemplate::NewOrder:
+            return dispatch(NewOrderView(block));
+        case BinaryTemplate::Cancel:
+            return dispatch(CancelView(block));
+        case BinaryTemplate::Amend:
+            return dispatch(AmendView(block));
+        case BinaryTemplate::Execution:
+            return dispatch(ExecutionView(block));
+        }
+
+        return {BinaryError::UnknownTemplate, consumed};
+    }
+
+    // Encoders return size of the message, or zero if it doesn't fit into
+    // the output buffer
+
+    template<orderbook::OrderConcept OrderType>
+    std::size_t encode_new_order(
+        const OrderType &order, std::uint64_t order_id, std::span<char> out, std::int64_t ticks_per_unit = 1)
+    {
+        constexpr std::size_t size = BinaryHeaderView::size + NewOrderView::block_length;
+        if (out.size() < size)
+        {
+            return 0;
+        }
+
+        char *p = out.data();
+        BinaryHeaderView::write(p, NewOrderView::template_id, NewOrderView::block_length);
+        p += BinaryHeaderView::size;
+
+        std::int64_t display_quantity = 0;
+        if constexpr (orderbook::IcebergOrderConcept<OrderType>)
+        {
+            display_quantity = static_cast<std::int64_t>(order.display_quantity);
+        }
+
+        detail::store_le<std::uint64_t>(p, order_id);
+        detail::store_le<std::int64_t>(p + 8, detail::to_ticks(order.price, ticks_per_unit));
+        detail::store_le<std::int64_t>(p + 16, static_cast<std::int64_t>(order.quantity));
+        detail::store_le<std::int64_t>(p + 24, detail::to_ticks(orderbook::stop_price_of(order), ticks_per_unit));
+        detail::store_le<std::int64_t>(p + 32, display_quantity);
+        detail::store_le<std::uint32_t>(p + 40, detail::account_of(order));
+        p[44] = static_cast<char>(order.side);
+        p[45] = static_cast<char>(order.order_type);
+        p[46] = p[47] = 0;
+
+        return size;
+    }
+
+    inline std::size_t encode_cancel(
+        std::uint64_t order_id, std::uint32_t account, orderbook::Side side, std::span<char> out)
+    {
+        constexpr std::size_t size = BinaryHeaderView::size + CancelView::block_length;
+        if (out.size() < size)
+        {
+            return 0;
+        }
+
+        char *p = out.data();
+        BinaryHeaderView::write(p, CancelView::template_id, CancelView::block_length);
+        p += BinaryHeaderView::size;
+
+        std::memset(p, 0, CancelView::block_length);
+        detail::store_le<std::uint64_t>(p, order_id);
+        detail::store_le<std::uint32_t>(p + 8, account);
+        p[12] = static_cast<char>(side);
+
+        return size;
+    }
+
+    template<util::NumberConcept PriceType, util::NumberConcept QuantityType>
+    std::size_t encode_amend(
+        std::uint64_t order_id, PriceType price, QuantityType quantity, std::uint32_t account,
+        orderbook::Side side, std::span<char> out, std::int64_t ticks_per_unit = 1)
+    {
+        constexpr std::size_t size = BinaryHeaderView::size + AmendView::block_length;
+        if (out.size() < size)
+        {
+            return 0;
+        }
+
+        char *p = out.data();
+        BinaryHeaderView::write(p, AmendView::template_id, AmendView::block_length);
+        p += BinaryHeaderView::size;
+
+        std::memset(p, 0, AmendView::block_length);
+        detail::store_le<std::uint64_t>(p, order_id);
+        detail::store_le<std::int64_t>(p + 8, detail::to_ticks(price, ticks_per_unit));
+        detail::store_le<std::int64_t>(p + 16, static_cast<std::int64_t>(quantity));
+        detail::store_le<std::uint32_t>(p + 24, account);
+        p[28] = static_cast<char>(side);
+
+        return size;
+    }
+
+    // Execution report for the resting side of an execution, as yielded by
+    // `OrderBook::accept_order()`
+    template<typename OrderQuantityType>
+    std::size_t encode_execution(
+        const OrderQuantityType &executed, std::uint64_t exec_id, std::span<char> out, std::int64_t ticks_per_unit = 1)
+    {
+        constexpr std::size_t size = BinaryHeaderView::size + ExecutionView::block_length;
+        if (out.size() < size)
+        {
+            return 0;
+        }
+
+        const auto &order = executed.order();
+
+        char *p = out.data();
+        BinaryHeaderView::write(p, ExecutionView::template_id, ExecutionView::block_length);
+        p += BinaryHeaderView::size;
+
+        std::memset(p, 0, ExecutionView::block_length);
+        detail::store_le<std::uint64_t>(p, exec_id);
+        detail::store_le<std::int64_t>(p + 8, detail::to_ticks(orderbook::price_of(order), ticks_per_unit));
+        detail::store_le<std::int64_t>(p + 16, static_cast<std::int64_t>(executed.quantity));
+        detail::store_le<std::uint32_t>(p + 24, detail::account_of(order));
+        p[28] = static_cast<char>(order.side);
+
+        return size;
+    }
+
+} // end of namespace sadhbhcraft::codec
+#endif//INCLUDED_CODEC_BINARY_HPP
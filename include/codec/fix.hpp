@@ -0,0 +1,529 @@
+#ifndef INCLUDED_CODEC_FIX_HPP
+#define INCLUDED_CODEC_FIX_HPP
+
+//
+// Zero-copy FIX tag=value codec for NewOrderSingle (35=D) messages.
+//
+// Parser maps fields straight from the message buffer into any type
+// conforming to `OrderConcept`, and it doesn't allocate nor copy strings.
+// Field boundaries are found by `util::DelimiterScanner`, which looks for
+// both '=' and SOH in 16 bytes at once, and numbers are converted using
+// std::from_chars().
+//
+// Optional parts of the order are mapped when the order type has them:
+//
+//  - StopPx (99) goes to `stop_price` (see `StopOrderConcept`), and if there
+//    is no such member, Stop order uses it as its price,
+//  - MaxFloor (111) goes to `display_quantity` (see `IcebergOrderConcept`),
+//  - Account (1) goes to `owner` if that is integral.
+//
+// Input is untrusted, so parser validates framing: BeginString (8) and
+// BodyLength (9) header, CheckSum (10) trailer, and never reads past the end
+// of the buffer.
+//
+
+#include "orderbook/enums.hpp"
+#include "orderbook/concepts.hpp"
+#include "orderbook/traits.hpp"
+
+#include "util/bytescan.hpp"
+
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+
+namespace sadhbhcraft::codec
+{
+    constexpr char FIX_SOH = '\x01';
+
+    // BeginString of every FIX version, e.g. FIX.4.4 or FIXT.1.1
+    constexpr std::string_view FIX_VERSION_PREFIX = "FIX";
+
+    namespace fix_tag
+    {
+        constexpr unsigned Account = 1;
+        constexpr unsigned BeginString = 8;
+        constexpr unsigned BodyLength = 9;
+        constexpr unsigned CheckSum = 10;
+        constexpr unsigned MsgType = 35;
+        constexpr unsigned OrderQty = 38;
+        constexpr unsigned OrdType = 40;
+        constexpr unsigned Price = 44;
+        constexpr unsigned Side = 54;
+        constexpr unsigned TimeInForce = 59;
+        constexpr unsigned StopPx = 99;
+        constexpr unsigned MaxFloor = 111;
+    }
+
+    enum class FixError
+    {
+        None,
+        Incomplete,         // Buffer ends before the end of the message
+        Malformed,          // Not a sequence of tag=value fields
+        BadBodyLength,      // BodyLength doesn't land on CheckSum field
+        BadChecksum,
+        UnsupportedMsgType, // Well formed message, but not a NewOrderSingle
+        MissingField,
+        BadValue
+    };
+
+    struct FixParseResult
+    {
+        FixError error;
+        // Length of the message, so that caller can move on to the next one.
+        // It is zero for incomplete or malformed message, where we don't
+        // know where the message ends.
+        std::size_t consumed;
+
+        explicit operator bool() const { return error == FixError::None; }
+    };
+
+    // Parse number from whole of the field value. Integral types also accept
+    // decimal point if it is followed only by zeros, e.g. price of "101.00".
+    template<util::NumberConcept T>
+    bool parse_fix_number(std::string_view value, T &out)
+    {
+        const char *first = value.data();
+        const char *last = first + value.size();
+        std::from_chars_result res;
+
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            res = std::from_chars(first, last, out, std::chars_format::fixed);
+        }
+        else
+        {
+            res = std::from_chars(first, last, out);
+            if (res.ec == std::errc{} && res.ptr != last && *res.ptr == '.')
+            {
+                for (++res.ptr; res.ptr != last && *res.ptr == '0'; ++res.ptr)
+                {}
+            }
+        }
+
+        return res.ec == std::errc{} && res.ptr == last && first != last;
+    }
+
+    // Parse unsigned integer from whole of the field value, which must be
+    // digits only, e.g. for BodyLength and CheckSum
+    template<std::unsigned_integral T>
+    bool parse_fix_integer(std::string_view value, T &out)
+    {
+        const char *first = value.data();
+        const char *last = first + value.size();
+        const auto res = std::from_chars(first, last, out);
+        return res.ec == std::errc{} && res.ptr == last && first != last;
+    }
+
+    namespace detail
+    {
+        template<bool Vectorised>
+        class FixFieldReader
+        {
+        public:
+            FixFieldReader(const char *first, const char *last)
+                : m_scanner(first, last), m_position(first), m_last(last)
+            {}
+
+            // Read next tag=value<SOH> field
+            FixError next(unsigned &tag, std::string_view &value)
+            {
+                const char *equals = m_scanner.next();
+                if (equals == m_last)
+                {
+                    return FixError::Incomplete;
+                }
+                if (*equals != '=' || !parse_tag(m_position, equals, tag))
+                {
+                    return FixError::Malformed;
+                }
+
+                // Value may itself contain '=', so skip to SOH
+                const char *soh = m_scanner.next();
+                while (soh != m_last && *soh != FIX_SOH)
+                {
+                    soh = m_scanner.next();
+                }
+                if (soh == m_last)
+                {
+                    return FixError::Incomplete;
+                }
+
+                value = std::string_view(equals + 1, static_cast<std::size_t>(soh - equals - 1));
+                m_position = soh + 1;
+                return FixError::None;
+            }
+
+            const char *position() const { return m_position; }
+
+        private:
+            util::BasicDelimiterScanner<Vectorised, '=', FIX_SOH> m_scanner;
+            const char *m_position;
+            const char *m_last;
+
+            static bool parse_tag(const char *first, const char *last, unsigned &tag)
+            {
+                // Tag is positive number without leading zeros
+                if (first == last || last - first > 6 || *first == '0')
+                {
+                    return false;
+                }
+                unsigned x = 0;
+                for (; first != last; ++first)
+                {
+                    const unsigned digit = static_cast<unsigned char>(*first) - '0';
+                    if (digit > 9)
+                    {
+                        return false;
+                    }
+                    x = x * 10 + digit;
+                }
+                tag = x;
+                return true;
+            }
+        };
+    }
+
+    // Parse NewOrderSingle from the front of the buffer. Order is modified
+    // only if whole message is parsed successfully.
+    template<orderbook::OrderConcept OrderType, bool Vectorised = util::simd_available>
+    FixParseResult parse_new_order_single(std::string_view buffer, OrderType &order)
+    {
+        using PriceType = typename OrderType::PriceType;
+        using QuantityType = typename OrderType::QuantityType;
+
+        constexpr std::size_t checksum_size = 7; //< 10=NNN<SOH>
+
+        const char *first = buffer.data();
+        const char *last = first + buffer.size();
+        detail::FixFieldReader<Vectorised> reader(first, last);
+
+        unsigned tag = 0;
+        std::string_view value;
+
+        // 1. Header tells where body ends
+        if (FixError e = reader.next(tag, value); e != FixError::None)
+        {
+            return {e, 0};
+        }
+        if (tag != fix_tag::BeginString || !value.starts_with(FIX_VERSION_PREFIX))
+        {
+            return {FixError::Malformed, 0};
+        }
+        if (FixError e = reader.next(tag, value); e != FixError::None)
+        {
+            return {e, 0};
+        }
+        std::size_t body_length = 0;
+        if (tag != fix_tag::BodyLength || value.size() > 6 || !parse_fix_integer(value, body_length))
+        {
+            return {FixError::Malformed, 0};
+        }
+
+        if (static_cast<std::size_t>(last - reader.position()) < body_length + checksum_size)
+        {
+            return {FixError::Incomplete, 0};
+        }
+        const char *body_end = reader.position() + body_length;
+
+        // 2. Trailer
+        const std::string_view trailer(body_end, checksum_size);
+        if (trailer.substr(0, 3) != "10=" || trailer[checksum_size - 1] != FIX_SOH)
+        {
+            return {FixError::BadBodyLength, 0};
+        }
+        unsigned checksum = 0;
+        if (!parse_fix_integer(trailer.substr(3, 3), checksum))
+        {
+            return {FixError::Malformed, 0};
+        }
+
+        const std::size_t consumed = static_cast<std::size_t>(body_end - first) + checksum_size;
+        if ((util::byte_sum<Vectorised>(first, body_end) & 0xFF) != checksum)
+        {
+            return {FixError::BadChecksum, consumed};
+        }
+
+        // 3. Body, which must start with MsgType
+        detail::FixFieldReader<Vectorised> body(reader.position(), body_end);
+        if (body.next(tag, value) != FixError::None)
+        {
+            return {FixError::BadBodyLength, consumed};
+        }
+        if (tag != fix_tag::MsgType)
+        {
+            return {FixError::Malformed, consumed};
+        }
+        if (value != "D")
+        {
+            return {FixError::UnsupportedMsgType, consumed};
+        }
+
+        enum : unsigned { HasSide = 1, HasOrdType = 2, HasQty = 4, HasPrice = 8, HasStopPx = 16 };
+        unsigned seen = 0;
+        bool is_bad = false;
+
+        orderbook::Side side = orderbook::Side::Buy;
+        orderbook::OrderType order_type = orderbook::OrderType::Limit;
+        char time_in_force = '0';
+        PriceType price{};
+        PriceType stop_price{};
+        QuantityType quantity{};
+        QuantityType display_quantity{};
+        std::uint64_t account = 0;
+
+        while (body.position() != body_end)
+        {
+            if (body.next(tag, value) != FixError::None)
+            {
+                return {FixError::BadBodyLength, consumed};
+            }
+
+            switch (tag)
+            {
+            case fix_tag::Side:
+                is_bad |= (value != "1" && value != "2");
+                side = (value == "2" ? orderbook::Side::Sell : orderbook::Side::Buy);
+                seen |= HasSide;
+                break;
+            case fix_tag::OrdType:
+                is_bad |= (value.size() != 1 || value[0] < '1' || value[0] > '4');
+                if (!is_bad)
+                {
+                    constexpr orderbook::OrderType ord_types[] = {
+                        orderbook::OrderType::Market, orderbook::OrderType::Limit,
+                        orderbook::OrderType::Stop, orderbook::OrderType::StopLimit};
+                    order_type = ord_types[value[0] - '1'];
+                }
+                seen |= HasOrdType;
+                break;
+            case fix_tag::TimeInForce:
+                // Day, GTC, IOC, FOK and GTD
+                is_bad |= (value.size() != 1 || std::string_view("01346").find(value[0]) == std::string_view::npos);
+                time_in_force = value.empty() ? '0' : value[0];
+                break;
+            case fix_tag::OrderQty:
+                is_bad |= !parse_fix_number(value, quantity) || !(quantity > 0);
+                seen |= HasQty;
+                break;
+            case fix_tag::Price:
+                is_bad |= !parse_fix_number(value, price);
+                seen |= HasPrice;
+                break;
+            case fix_tag::StopPx:
+                is_bad |= !parse_fix_number(value, stop_price);
+                seen |= HasStopPx;
+                break;
+            case fix_tag::MaxFloor:
+                is_bad |= !parse_fix_number(value, display_quantity) || display_quantity < 0;
+                break;
+            case fix_tag::Account:
+                is_bad |= !parse_fix_number(value, account);
+                break;
+            default:
+                break; //< Fields we don't need
+            }
+        }
+
+        if (is_bad)
+        {
+            return {FixError::BadValue, consumed};
+        }
+        if ((seen & (HasSide | HasOrdType | HasQty)) != (HasSide | HasOrdType | HasQty))
+        {
+            return {FixError::MissingField, consumed};
+        }
+
+        const bool needs_price = (order_type == orderbook::OrderType::Limit || order_type == orderbook::OrderType::StopLimit);
+        const bool needs_stop_price = orderbook::is_stop_order_type(order_type);
+        if ((needs_price && !(seen & HasPrice)) || (needs_stop_price && !(seen & HasStopPx)))
+        {
+            return {FixError::MissingField, consumed};
+        }
+        if (display_quantity > quantity)
+        {
+            return {FixError::BadValue, consumed};
+        }
+
+        if (order_type == orderbook::OrderType::Limit)
+        {
+            if (time_in_force == '3')
+            {
+                order_type = orderbook::OrderType::IOC;
+            }
+            else if (time_in_force == '4')
+            {
+                order_type = orderbook::OrderType::FOC;
+            }
+        }
+
+        // Stop price goes to its own member, or becomes price of Stop order
+        if constexpr (!orderbook::StopOrderConcept<OrderType>)
+        {
+            if (order_type == orderbook::OrderType::StopLimit)
+            {
+                return {FixError::BadValue, consumed};
+            }
+            if (order_type == orderbook::OrderType::Stop)
+            {
+                price = stop_price;
+            }
+        }
+
+        order.side = side;
+        order.order_type = order_type;
+        order.price = price;
+        order.quantity = quantity;
+        if constexpr (orderbook::StopOrderConcept<OrderType>)
+        {
+            order.stop_price = stop_price;
+        }
+        if constexpr (orderbook::IcebergOrderConcept<OrderType>)
+        {
+            order.display_quantity = display_quantity;
+        }
+        if constexpr (orderbook::OwnerMemberConcept<OrderType>)
+        {
+            if constexpr (std::is_integral_v<decltype(order.owner)>)
+            {
+                order.owner = static_cast<decltype(order.owner)>(account);
+            }
+        }
+
+        return {FixError::None, consumed};
+    }
+
+    namespace detail
+    {
+        struct FixWriter
+        {
+            char *position;
+            char *last;
+
+            bool put(std::string_view s)
+            {
+                if (static_cast<std::size_t>(last - position) < s.size())
+                {
+                    return false;
+                }
+                for (char c : s)
+                {
+                    *position++ = c;
+                }
+                return true;
+            }
+
+            template<util::NumberConcept T>
+            bool put(T x)
+            {
+                std::to_chars_result res;
+                if constexpr (std::is_floating_point_v<T>)
+                {
+                    res = std::to_chars(position, last, x, std::chars_format::fixed);
+                }
+                else
+                {
+                    res = std::to_chars(position, last, x);
+                }
+                position = (res.ec == std::errc{} ? res.ptr : last);
+                return res.ec == std::errc{};
+            }
+
+            template<typename T>
+            bool field(unsigned tag, T value)
+            {
+                return put(tag) && put("=") && put(value) && put(std::string_view(&FIX_SOH, 1));
+            }
+        };
+    }
+
+    // Write NewOrderSingle for the order. Returns size of the message, or
+    // zero if it doesn't fit into the output buffer.
+    template<orderbook::OrderConcept OrderType>
+    std::size_t write_new_order_single(const OrderType &order, std::span<char> out)
+    {
+        using orderbook::OrderType::Market;
+        using orderbook::OrderType::Limit;
+        using orderbook::OrderType::IOC;
+        using orderbook::OrderType::FOC;
+        using orderbook::OrderType::Stop;
+        using orderbook::OrderType::StopLimit;
+
+        std::array<char, 256> body_buffer;
+        detail::FixWriter body{body_buffer.data(), body_buffer.data() + body_buffer.size()};
+
+        const auto order_type = static_cast<orderbook::OrderType>(order.order_type);
+        const std::string_view ord_type =
+            (order_type == Market ? "1" : order_type == Stop ? "3" : order_type == StopLimit ? "4" : "2");
+
+        bool ok = body.field(fix_tag::MsgType, std::string_view("D"))
+            && body.field(fix_tag::Side, std::string_view(order.side == orderbook::Side::Sell ? "2" : "1"))
+            && body.field(fix_tag::OrdType, ord_type)
+            && body.field(fix_tag::OrderQty, order.quantity);
+
+        if (order_type == IOC || order_type == FOC)
+        {
+            ok = ok && body.field(fix_tag::TimeInForce, std::string_view(order_type == IOC ? "3" : "4"));
+        }
+        if (order_type != Market && order_type != Stop)
+        {
+            ok = ok && body.field(fix_tag::Price, order.price);
+        }
+        if (orderbook::is_stop_order_type(order_type))
+        {
+            ok = ok && body.field(fix_tag::StopPx, orderbook::stop_price_of(order));
+        }
+        if constexpr (orderbook::IcebergOrderConcept<OrderType>)
+        {
+            if (order.display_quantity)
+            {
+                ok = ok && body.field(fix_tag::MaxFloor, order.display_quantity);
+            }
+        }
+        if constexpr (orderbook::OwnerMemberConcept<OrderType>)
+        {
+            if constexpr (std::is_integral_v<decltype(order.owner)>)
+            {
+                ok = ok && body.field(fix_tag::Account, order.owner);
+            }
+        }
+        if (!ok)
+        {
+            return 0;
+        }
+
+        const std::string_view body_view(body_buffer.data(), static_cast<std::size_t>(body.position - body_buffer.data()));
+        detail::FixWriter message{out.data(), out.data() + out.size()};
+
+        ok = message.field(fix_tag::BeginString, std::string_view("FIX.4.4"))
+            && message.field(fix_tag::BodyLength, body_view.size())
+            && message.put(body_view);
+        if (!ok)
+        {
+            return 0;
+        }
+
+        const unsigned checksum = util::byte_sum(out.data(), message.position) & 0xFF;
+        const char trailer[] = {
+            '1', '0', '=',
+            static_cast<char>('0' + checksum / 100),
+            static_cast<char>('0' + checksum / 10 % 10),
+            static_cast<char>('0' + checksum % 10),
+            FIX_SOH};
+        if (!message.put(std::string_view(trailer, sizeof(trailer))))
+        {
+            return 0;
+        }
+
+        return static_cast<std::size_t>(message.position - out.data());
+    }
+
+} // end of namespace sadhbhcraft::codec
+#endif//INCLUDED_CODEC_FIX_HPP
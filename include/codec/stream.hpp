@@ -0,0 +1,127 @@
+#ifndef INCLUDED_CODEC_STREAM_HPP
+#define INCLUDED_CODEC_STREAM_HPP
+
+//
+// Lazy decoding of order capture files
+//
+//      util::ChunkedFileSource source("capture.fix");
+//      auto orders = read_orders<MyOrder>(source, FixOrderDecoder{});
+//
+//      while (orders)
+//      {
+//          MyOrder order = orders();
+//          ...
+//      }
+//
+// Orders are decoded one by one as they are pulled from generator, straight
+// from the source's buffer, so that decoding interleaves with matching, and
+// memory used doesn't depend on the size of the file.
+//
+// Decoder is called as:
+//
+//      RecordDecodeResult res = decoder(data, order);
+//
+// and it tells how many bytes it consumed, and whether it has decoded the
+// record. Zero consumed means that record isn't complete, and we need to
+// read more. Decoder skips malformed record by itself, so that one bad
+// record doesn't end the replay.
+//
+
+#include "binary.hpp"
+#include "fix.hpp"
+
+#include "orderbook/concepts.hpp"
+
+#include "util/concepts.hpp"
+#include "util/generator.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+
+namespace sadhbhcraft::codec
+{
+    struct RecordDecodeResult
+    {
+        std::size_t consumed;
+        bool decoded;
+    };
+
+    struct FixOrderDecoder
+    {
+        template<orderbook::OrderConcept OrderType>
+        RecordDecodeResult operator()(std::string_view data, OrderType &order) const
+        {
+            auto res = parse_new_order_single(data, order);
+            if (!res.consumed && res.error != FixError::Incomplete)
+            {
+                // Framing is broken, and we don't know where the message
+                // ends, so we skip to the start of the next one
+                return {resync(data), false};
+            }
+            // Skip other messages and messages we can't use, as long as we
+            // know where they end
+            return {res.consumed, static_cast<bool>(res)};
+        }
+
+        // Bytes up to next SOH followed by BeginString. If there isn't one,
+        // then all but the last bytes, which might be start of it.
+        static std::size_t resync(std::string_view data)
+        {
+            constexpr std::string_view next_message = "\x01" "8=";
+            const std::size_t found = data.find(next_message, 1);
+            if (found != std::string_view::npos)
+            {
+                return found + 1;
+            }
+            return (data.size() < next_message.size() ? 0 : data.size() - next_message.size() + 1);
+        }
+    };
+
+    struct BinaryOrderDecoder
+    {
+        std::int64_t ticks_per_unit = 1;
+
+        template<orderbook::OrderConcept OrderType>
+        RecordDecodeResult operator()(std::string_view data, OrderType &order) const
+        {
+            bool decoded = false;
+            auto res = decode_binary_message(data, [&](auto view)
+            {
+                if constexpr (std::is_same_v<decltype(view), NewOrderView>)
+                {
+                    decoded = (view.to_order(order, ticks_per_unit) == BinaryError::None);
+                }
+            });
+            return {res.consumed, decoded};
+        }
+    };
+
+    // Ends when source is exhausted, or when record can't be decoded even
+    // after refill, e.g. truncated file. Caller may check what's left in
+    // `source.data()` after that.
+    template<orderbook::OrderConcept OrderType, util::ByteSourceConcept Source, typename Decoder>
+    util::Generator<OrderType> read_orders(Source &source, Decoder decoder)
+    {
+        for (;;)
+        {
+            OrderType order{};
+            RecordDecodeResult res = decoder(source.data(), order);
+
+            if (res.consumed)
+            {
+                source.consume(res.consumed);
+                if (res.decoded)
+                {
+                    co_yield order;
+                }
+            }
+            else if (!source.fill())
+            {
+                co_return;
+            }
+        }
+    }
+
+} // end of namespace sadhbhcraft::codec
+#endif//INCLUDED_CODEC_STREAM_HPP
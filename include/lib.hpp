@@ -2,6 +2,7 @@
 #define INCLUDED_LIB_HPP
 
 #include "orderbook/orderbook.hpp"
+#include "orderbook/scheduler.hpp"
 
 namespace sadhbhcraft::orderbook
 {
@@ -0,0 +1,522 @@
+#ifndef INCLUDED_ANALYTICS_HPP
+#define INCLUDED_ANALYTICS_HPP
+
+//
+// Book analytics kept up to date by book sides
+//
+//      OrderBook<MyOrder, AnalyticsBookSidePolicy<1, 5, 10>> book;
+//      ...
+//      auto analytics = book.analytics();
+//      analytics.imbalance();                  // Of top levels, in [-1, 1]
+//      analytics.imbalance_within(5);          // Of quantity within 5 ticks of top
+//      analytics.bid_depth_within(10);
+//      analytics.microprice();
+//
+// Each side keeps quantities of levels within the largest of configured
+// depths, in a ring indexed by price modulo its size, and running depth for
+// each of configured depths. Order added behind the top updates one slot of
+// the ring, and depths it falls within, in O(1), and so does partial fill of
+// the top. Matching that doesn't execute costs nothing. When the top moves,
+// the ring stays where it is, and only levels that cross the boundary of
+// each depth are added or taken, so that it costs as many levels as have
+// moved, plus a scan of the ring a 64-bit word at a time. Cancel looks up
+// levels of the ring within the cancelled range.
+//
+// Top of book metrics are O(1) anyway, and `OrderBook::analytics()` is a
+// view over both sides, which computes nothing until asked.
+//
+// NOTE: Prices are integral ticks, as depth is counted in price units.
+//
+// NOTE: Depth not configured is still answered, but by walking the levels.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "pricelevelstack.hpp"
+#include "traits.hpp"
+
+#include "util/generator.hpp"
+#include "util/stats.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<typename T>
+    concept AnalyticsBookSideConcept =
+        requires(const T &c) {
+            { c.depth_within(std::size_t{}) } -> std::convertible_to<typename T::OrderType::QuantityType>;
+        };
+
+    template<Side MySide, OrderConcept _OrderType,
+        template <typename> class _StackType,
+        template <typename> class _QueueType,
+        template <typename, template <typename> class> class _LevelType,
+        std::size_t... DepthTicks>
+    requires std::integral<typename _OrderType::PriceType> && (sizeof...(DepthTicks) > 0)
+    class AnalyticsBookSide : public PriceLevelStack<MySide, _OrderType, _StackType, _QueueType, _LevelType>
+    {
+        typedef PriceLevelStack<MySide, _OrderType, _StackType, _QueueType, _LevelType> BaseType;
+
+    public:
+        typedef _OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef typename OrderType::QuantityType QuantityType;
+
+        static constexpr std::array<std::size_t, sizeof...(DepthTicks)> depth_ticks{DepthTicks...};
+        static constexpr std::size_t max_depth_ticks = std::max({DepthTicks...});
+
+        AnalyticsBookSide(): m_ladder(ring_size), m_occupied((ring_size + 63) / 64)
+        {}
+
+        template<typename Instrumentation = NoStats>
+        void add_order(OrderType &order, QuantityType quantity, Instrumentation *instrumentation = nullptr)
+        {
+            [[maybe_unused]] std::uint64_t start = 0;
+            if constexpr (Instrumentation::enabled)
+            {
+                start = util::read_cycles();
+            }
+
+            auto [level_iterator, is_new_level] = this->do_add_order(order, quantity);
+            if (is_new_level && level_iterator == this->m_levels.begin())
+            {
+                improve_top(price_of(*level_iterator));
+            }
+            update_level(price_of(*level_iterator), level_iterator->total_quantity());
+
+            if constexpr (Instrumentation::enabled)
+            {
+                if (is_new_level)
+                {
+                    instrumentation->on_level_created(MySide, price_of(order));
+                }
+                instrumentation->on_add_order_cycles(util::read_cycles() - start);
+                instrumentation->on_level_update(MySide, level_iterator->price(), level_iterator->total_quantity());
+            }
+        }
+
+        template<ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy, typename Instrumentation = NoStats>
+        util::Generator<OrderQuantity<OrderType>>
+        match_order(
+            OrderType &order,
+            ExecutionPolicy &&execution_policy = {},
+            SelfTradeCheck<OrderType> *self_trade = nullptr,
+            Instrumentation *instrumentation = nullptr)
+        {
+            auto res = BaseType::match_order(order, std::forward<ExecutionPolicy>(execution_policy), self_trade, instrumentation);
+            while (co_await res.next())
+            {
+                co_yield res();
+            }
+            sync_front();
+            co_return;
+        }
+
+        template<typename Output, typename Instrumentation = NoStats>
+        QuantityType fill_orders(PriceType limit_price, QuantityType quantity, Output &fills, Instrumentation *instrumentation = nullptr)
+        {
+            const QuantityType filled = BaseType::fill_orders(limit_price, quantity, fills, instrumentation);
+            sync_front();
+            return filled;
+        }
+
+        template<typename Predicate, typename Output, typename Instrumentation = NoStats>
+        std::size_t cancel_orders_if(
+            PriceType min_price,
+            PriceType max_price,
+            Predicate &&predicate,
+            Output &cancelled,
+            Instrumentation *instrumentation = nullptr)
+        {
+            const std::size_t count = BaseType::cancel_orders_if(min_price, max_price, std::forward<Predicate>(predicate), cancelled, instrumentation);
+            if (count)
+            {
+                sync_range(min_price, max_price);
+            }
+            return count;
+        }
+
+        template<typename Predicate, typename Output, typename Instrumentation = NoStats>
+        std::size_t cancel_orders_at(
+            std::span<const PriceType> prices,
+            Predicate &&predicate,
+            Output &cancelled,
+            Instrumentation *instrumentation = nullptr)
+        {
+            const std::size_t count = BaseType::cancel_orders_at(prices, std::forward<Predicate>(predicate), cancelled, instrumentation);
+            if (count)
+            {
+                const auto [min_price, max_price] = std::minmax(prices.front(), prices.back());
+                sync_range(min_price, max_price);
+            }
+            return count;
+        }
+
+        // Quantity on levels at most ticks away from the top, including the
+        // top. It is O(1) for configured depths.
+        QuantityType depth_within(std::size_t ticks) const
+        {
+            for (std::size_t i = 0; i != depth_ticks.size(); ++i)
+            {
+                if (depth_ticks[i] == ticks)
+                {
+                    return m_depths[i];
+                }
+            }
+
+            QuantityType depth{};
+            for (auto &level : this->m_levels)
+            {
+                if (ticks < ticks_from_top(price_of(level)))
+                {
+                    break;
+                }
+                depth += level.total_quantity();
+            }
+            return depth;
+        }
+
+    private:
+        typedef std::make_unsigned_t<PriceType> DistanceType;
+
+        static constexpr std::size_t ring_size = max_depth_ticks + 1;
+
+        std::pmr::vector<QuantityType> m_ladder;        // Quantity of level in slot of its price modulo ring size
+        std::pmr::vector<std::uint64_t> m_occupied;     // Slots of levels within the largest depth
+        std::array<QuantityType, sizeof...(DepthTicks)> m_depths{};
+        std::size_t m_window_levels = 0;                // Occupied slots, which are the first levels
+        PriceType m_top_price{};
+
+        // Ticks from better price to worse price, capped at ring size
+        static std::size_t distance(PriceType better, PriceType worse)
+        {
+            const DistanceType ticks = (MySide == Side::Buy
+                ? static_cast<DistanceType>(better) - static_cast<DistanceType>(worse)
+                : static_cast<DistanceType>(worse) - static_cast<DistanceType>(better));
+            return (ticks < ring_size ? static_cast<std::size_t>(ticks) : ring_size);
+        }
+
+        std::size_t ticks_from_top(PriceType price) const
+        {
+            return (PriceLevelCompare<MySide>()(price, m_top_price) ? 0 : distance(m_top_price, price));
+        }
+
+        static std::size_t slot_of(PriceType price)
+        {
+            if constexpr (std::is_signed_v<PriceType>)
+            {
+                const auto n = static_cast<std::intmax_t>(ring_size);
+                return static_cast<std::size_t>((static_cast<std::intmax_t>(price) % n + n) % n);
+            }
+            else
+            {
+                return static_cast<std::size_t>(price % ring_size);
+            }
+        }
+
+        // Of occupied slot, relative to the current top
+        std::size_t ticks_of_slot(std::size_t slot) const
+        {
+            const std::size_t top_slot = slot_of(m_top_price);
+            return (MySide == Side::Buy ? top_slot + ring_size - slot : slot + ring_size - top_slot) % ring_size;
+        }
+
+        PriceType price_of_slot(std::size_t slot) const
+        {
+            const auto ticks = static_cast<PriceType>(ticks_of_slot(slot));
+            return (MySide == Side::Buy ? m_top_price - ticks : m_top_price + ticks);
+        }
+
+        bool is_occupied(std::size_t slot) const { return (m_occupied[slot / 64] >> (slot % 64)) & 1; }
+
+        void add_to_depths(std::size_t ticks, QuantityType delta)
+        {
+            for (std::size_t i = 0; i != depth_ticks.size(); ++i)
+            {
+                if (ticks <= depth_ticks[i])
+                {
+                    m_depths[i] += delta;
+                }
+            }
+        }
+
+        // Calls f(slot) for occupied slots from first to last ticks away from
+        // the top, skipping empty slots a word at a time
+        template<typename F>
+        void for_each_occupied(std::size_t first_ticks, std::size_t last_ticks, F &&f) const
+        {
+            const std::size_t top_slot = slot_of(m_top_price);
+            const std::size_t first_slot = (MySide == Side::Buy
+                ? top_slot + ring_size - last_ticks
+                : top_slot + first_ticks) % ring_size;
+            const std::size_t wrapped = first_slot + last_ticks - first_ticks + 1;
+
+            auto scan = [&](std::size_t from, std::size_t to)
+            {
+                while (from < to)
+                {
+                    // Re-read, as f may clear slots it has been given
+                    const std::uint64_t bits = m_occupied[from / 64] >> (from % 64);
+                    if (!bits)
+                    {
+                        from = (from / 64 + 1) * 64;
+                        continue;
+                    }
+                    from += std::countr_zero(bits);
+                    if (from < to)
+                    {
+                        f(from++);
+                    }
+                }
+            };
+
+            scan(first_slot, std::min(wrapped, ring_size));
+            if (ring_size < wrapped)
+            {
+                scan(0, wrapped - ring_size);
+            }
+        }
+
+        // Level at price has new total, and takes a slot if it is within
+        // the largest depth
+        void update_level(PriceType price, QuantityType total)
+        {
+            const std::size_t ticks = ticks_from_top(price);
+            if (max_depth_ticks < ticks)
+            {
+                return;
+            }
+
+            const std::size_t slot = slot_of(price);
+            if (!is_occupied(slot))
+            {
+                m_occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+                ++m_window_levels;
+            }
+            add_to_depths(ticks, total - m_ladder[slot]);
+            m_ladder[slot] = total;
+        }
+
+        // Level has left the window, and depths are up to caller
+        void drop_slot(std::size_t slot)
+        {
+            m_ladder[slot] = QuantityType{};
+            m_occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+            --m_window_levels;
+        }
+
+        // Level has left the book
+        void erase_slot(std::size_t slot)
+        {
+            add_to_depths(ticks_of_slot(slot), -m_ladder[slot]);
+            drop_slot(slot);
+        }
+
+        void clear_window()
+        {
+            if (m_window_levels)
+            {
+                for_each_occupied(0, max_depth_ticks, [this](std::size_t slot) { drop_slot(slot); });
+            }
+            m_depths.fill(QuantityType{});
+        }
+
+        // New level is ahead of the top. Levels falling out of each depth
+        // are taken from it, and those falling out of the largest depth
+        // leave the window, so that it costs as many levels as have moved.
+        void improve_top(PriceType price)
+        {
+            const std::size_t shift = distance(price, m_top_price);
+            if (!m_window_levels || max_depth_ticks < shift)
+            {
+                clear_window();
+            }
+            else
+            {
+                for (std::size_t i = 0; i != depth_ticks.size(); ++i)
+                {
+                    const std::size_t first = (shift <= depth_ticks[i] ? depth_ticks[i] + 1 - shift : 0);
+                    for_each_occupied(first, depth_ticks[i], [&](std::size_t slot) { m_depths[i] -= m_ladder[slot]; });
+                }
+                for_each_occupied(max_depth_ticks + 1 - shift, max_depth_ticks, [this](std::size_t slot) { drop_slot(slot); });
+            }
+            m_top_price = price;
+        }
+
+        // Levels ahead of price have left the book, and top moves back to
+        // it. Levels coming within each depth are added to it, and levels
+        // coming within the largest depth enter the window, so that it costs
+        // as many levels as have moved.
+        void worsen_top(PriceType price)
+        {
+            const std::size_t shift = distance(m_top_price, price);
+            if (m_window_levels)
+            {
+                for (std::size_t i = 0; i != depth_ticks.size(); ++i)
+                {
+                    if (depth_ticks[i] < max_depth_ticks)
+                    {
+                        const std::size_t last = std::min(depth_ticks[i] + shift, max_depth_ticks);
+                        for_each_occupied(depth_ticks[i] + 1, last, [&](std::size_t slot) { m_depths[i] += m_ladder[slot]; });
+                    }
+                }
+            }
+            m_top_price = price;
+
+            for (std::size_t i = m_window_levels; i < this->m_levels.size(); ++i)
+            {
+                const auto &level = this->m_levels[i];
+                if (max_depth_ticks < ticks_from_top(price_of(level)))
+                {
+                    break;
+                }
+                update_level(price_of(level), level.total_quantity());
+            }
+        }
+
+        // Matching and fills only take from the front, so levels ahead of
+        // the new front have left, and the front may have less quantity.
+        // When nothing has executed this only reads the front.
+        void sync_front()
+        {
+            if (this->m_levels.empty())
+            {
+                clear_window();
+                return;
+            }
+
+            const auto &front = this->m_levels.front();
+            if (price_of(front) != m_top_price)
+            {
+                const std::size_t shift = distance(m_top_price, price_of(front));
+                for_each_occupied(0, std::min(shift, ring_size) - 1, [this](std::size_t slot) { erase_slot(slot); });
+                worsen_top(price_of(front));
+            }
+            update_level(price_of(front), front.total_quantity());
+        }
+
+        // Cancel may take levels anywhere in the range, so those within the
+        // window are looked up, and top moves back if it was taken
+        void sync_range(PriceType min_price, PriceType max_price)
+        {
+            if (this->m_levels.empty())
+            {
+                clear_window();
+                return;
+            }
+
+            const PriceType best = (MySide == Side::Buy ? max_price : min_price);
+            const PriceType worst = (MySide == Side::Buy ? min_price : max_price);
+            if (!PriceLevelCompare<MySide>()(worst, m_top_price))
+            {
+                const std::size_t first = ticks_from_top(best);
+                const std::size_t last = std::min(ticks_from_top(worst), max_depth_ticks);
+                if (first <= last)
+                {
+                    for_each_occupied(first, last, [this](std::size_t slot)
+                    {
+                        if (const auto *level = this->find_level(price_of_slot(slot)))
+                        {
+                            update_level(price_of(*level), level->total_quantity());
+                        }
+                        else
+                        {
+                            erase_slot(slot);
+                        }
+                    });
+                }
+            }
+
+            const auto &front = this->m_levels.front();
+            if (price_of(front) != m_top_price)
+            {
+                worsen_top(price_of(front));
+            }
+        }
+    };
+
+    template<
+        template <typename> class StackType,
+        template <typename> class QueueType,
+        template <typename, template <typename> class> class LevelType,
+        std::size_t... DepthTicks>
+    struct BasicAnalyticsBookSidePolicy
+    {
+        template<Side MySide, OrderConcept OrderType>
+        using OrderBookSideType = AnalyticsBookSide<MySide, OrderType, StackType, QueueType, LevelType, DepthTicks...>;
+    };
+
+    template<std::size_t... DepthTicks>
+    using AnalyticsBookSidePolicy = BasicAnalyticsBookSidePolicy<std::deque, std::deque, OrderPriceLevel, DepthTicks...>;
+
+    // View over both sides of the book, which is as cheap to make as it is
+    // to copy two pointers
+    template<typename BidBookSideType, typename AskBookSideType>
+    class BookAnalytics
+    {
+    public:
+        typedef typename BidBookSideType::OrderType::QuantityType QuantityType;
+
+        BookAnalytics(const BidBookSideType &bid, const AskBookSideType &ask): m_bid(bid), m_ask(ask)
+        {}
+
+        // Of top levels as (bid - ask) / (bid + ask), and zero if both
+        // sides are empty
+        double imbalance() const { return imbalance_of(top_quantity(m_bid), top_quantity(m_ask)); }
+
+        double imbalance_within(std::size_t ticks) const
+        {
+            return imbalance_of(m_bid.depth_within(ticks), m_ask.depth_within(ticks));
+        }
+
+        QuantityType bid_depth_within(std::size_t ticks) const { return m_bid.depth_within(ticks); }
+        QuantityType ask_depth_within(std::size_t ticks) const { return m_ask.depth_within(ticks); }
+
+        // Mid price weighted by quantity of the other side, i.e. closer to
+        // the side with less quantity, or nothing unless both sides have
+        // a level
+        std::optional<double> microprice() const
+        {
+            if (m_bid.empty() || m_ask.empty())
+            {
+                return std::nullopt;
+            }
+            const double bid_quantity = static_cast<double>(m_bid.top().total_quantity());
+            const double ask_quantity = static_cast<double>(m_ask.top().total_quantity());
+            return (static_cast<double>(m_bid.top().price()) * ask_quantity + static_cast<double>(m_ask.top().price()) * bid_quantity)
+                / (bid_quantity + ask_quantity);
+        }
+
+    private:
+        const BidBookSideType &m_bid;
+        const AskBookSideType &m_ask;
+
+        template<typename BookSide>
+        static QuantityType top_quantity(const BookSide &book_side)
+        {
+            return book_side.empty() ? QuantityType{} : book_side.top().total_quantity();
+        }
+
+        static double imbalance_of(QuantityType bid, QuantityType ask)
+        {
+            const double total = static_cast<double>(bid) + static_cast<double>(ask);
+            return total == 0.0 ? 0.0 : (static_cast<double>(bid) - static_cast<double>(ask)) / total;
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_ANALYTICS_HPP
@@ -0,0 +1,237 @@
+#ifndef INCLUDED_AUCTION_HPP
+#define INCLUDED_AUCTION_HPP
+
+//
+// Call auction equilibrium
+//
+// During auction orders accumulate on both sides of the book without
+// matching, and the book may be crossed. At uncross everything is executed
+// at single price, which is chosen by these rules, in order:
+//
+//  1. Price that maximises executed volume
+//  2. Price with the smallest surplus (imbalance), i.e. quantity left
+//     unexecuted on either side at that price
+//  3. Market pressure: the highest price if all candidates left have buy
+//     surplus, or the lowest price if all have sell surplus
+//  4. Price closest to reference price (e.g. last trade), or the lowest
+//     price if there is no reference
+//
+// Equilibrium is found from cumulative depth of both sides in one pass over
+// the levels, and not by simulating matches. Only levels within crossed
+// range, i.e. between the best ask and the best bid are visited.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "traits.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<typename PriceType, typename QuantityType>
+    struct AuctionResult
+    {
+        PriceType price{};
+        QuantityType volume{};
+        QuantityType surplus{};
+        // ^ Demand minus supply at price, i.e. positive for buy surplus, and
+        // negative for sell surplus
+
+        explicit operator bool() const { return volume != QuantityType{}; }
+    };
+
+    // Trade at uncross between two resting orders
+    template<OrderConcept _OrderType>
+    struct AuctionTrade
+    {
+        typedef _OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef typename OrderType::QuantityType QuantityType;
+
+        AuctionTrade(OrderType &buy, OrderType &sell, PriceType price, QuantityType quantity)
+            : price(price), quantity(quantity), buy_ref(buy), sell_ref(sell)
+        {}
+
+        OrderType &buy() noexcept { return buy_ref; }
+        const OrderType &buy() const noexcept { return buy_ref; }
+        OrderType &sell() noexcept { return sell_ref; }
+        const OrderType &sell() const noexcept { return sell_ref; }
+
+        PriceType price;
+        QuantityType quantity;
+
+    private:
+        std::reference_wrapper<OrderType> buy_ref;
+        std::reference_wrapper<OrderType> sell_ref;
+    };
+
+    template<OrderConcept OrderType>
+    struct PriceTrait<AuctionTrade<OrderType>>
+    {
+        static auto price(const AuctionTrade<OrderType> &t) { return t.price; }
+    };
+
+    template<OrderConcept OrderType>
+    struct QuantityTrait<AuctionTrade<OrderType>>
+    {
+        static auto quantity(const AuctionTrade<OrderType> &t) { return t.quantity; }
+    };
+
+    // Keeps depth arrays between calls, so that computing indicative price
+    // during auction doesn't allocate
+    template<typename PriceType, typename QuantityType>
+    class AuctionCalculator
+    {
+    public:
+        typedef AuctionResult<PriceType, QuantityType> ResultType;
+
+        template<typename BidSide, typename AskSide>
+        ResultType compute(const BidSide &bid, const AskSide &ask, std::optional<PriceType> reference_price = {})
+        {
+            if (bid.empty() || ask.empty() || bid.top().price() < ask.top().price())
+            {
+                return {}; //< Book isn't crossed
+            }
+            const PriceType low = ask.top().price();
+            const PriceType high = bid.top().price();
+
+            build_depth(bid, low, high, m_bid_depth);
+            build_depth(ask, low, high, m_ask_depth);
+            build_candidates();
+
+            return select(reference_price);
+        }
+
+    private:
+        struct DepthPoint
+        {
+            PriceType price;
+            QuantityType cumulative;
+        };
+
+        struct Candidate
+        {
+            PriceType price;
+            QuantityType volume;
+            QuantityType surplus;
+        };
+
+        std::vector<DepthPoint> m_bid_depth;    // From the best bid down
+        std::vector<DepthPoint> m_ask_depth;    // From the best ask up
+        std::vector<Candidate> m_candidates;    // Ascending by price
+
+        // Iceberg reserve executes at uncross too, so it counts in depth
+        template<typename Side>
+        static void build_depth(const Side &side, PriceType low, PriceType high, std::vector<DepthPoint> &depth)
+        {
+            depth.clear();
+            QuantityType cumulative{};
+            for (const auto &level : side)
+            {
+                if (level.price() < low || high < level.price())
+                {
+                    break;
+                }
+                cumulative += level.total_quantity() + level.hidden_quantity();
+                depth.push_back({level.price(), cumulative});
+            }
+        }
+
+        // Merges prices of both sides in ascending order. Demand at price is
+        // cumulative bid quantity at or above it, and supply is cumulative
+        // ask quantity at or below it.
+        void build_candidates()
+        {
+            m_candidates.clear();
+
+            std::size_t a = 0;                      // Next ask price
+            std::size_t b = m_bid_depth.size();     // One past next bid price
+            QuantityType supply{};
+
+            while (a != m_ask_depth.size() || b)
+            {
+                PriceType price;
+                if (a == m_ask_depth.size())
+                {
+                    price = m_bid_depth[b - 1].price;
+                }
+                else if (!b)
+                {
+                    price = m_ask_depth[a].price;
+                }
+                else
+                {
+                    price = std::min(m_ask_depth[a].price, m_bid_depth[b - 1].price);
+                }
+
+                if (a != m_ask_depth.size() && m_ask_depth[a].price == price)
+                {
+                    supply = m_ask_depth[a++].cumulative;
+                }
+                // Bids below this price don't take part any more
+                QuantityType demand = b ? m_bid_depth[b - 1].cumulative : QuantityType{};
+                if (b && m_bid_depth[b - 1].price == price)
+                {
+                    --b;
+                }
+
+                m_candidates.push_back({price, std::min(demand, supply), demand - supply});
+            }
+        }
+
+        static QuantityType abs(QuantityType x) { return x < QuantityType{} ? -x : x; }
+
+        ResultType select(std::optional<PriceType> reference_price) const
+        {
+            // Volume rises and then falls with price, and surplus only falls,
+            // so that candidates tied by the first two rules are contiguous
+            std::size_t first = 0;
+            std::size_t last = 0;
+            for (std::size_t i = 1; i != m_candidates.size(); ++i)
+            {
+                const auto &c = m_candidates[i];
+                const auto &best = m_candidates[first];
+                if (best.volume < c.volume || (best.volume == c.volume && abs(c.surplus) < abs(best.surplus)))
+                {
+                    first = last = i;
+                }
+                else if (best.volume == c.volume && abs(c.surplus) == abs(best.surplus))
+                {
+                    last = i;
+                }
+            }
+
+            std::size_t chosen = first;
+            if (m_candidates[last].surplus > QuantityType{})
+            {
+                chosen = last;  //< Buy pressure
+            }
+            else if (m_candidates[first].surplus < QuantityType{})
+            {
+                chosen = first; //< Sell pressure
+            }
+            else if (reference_price)
+            {
+                for (std::size_t i = first + 1; i <= last; ++i)
+                {
+                    if (distance(m_candidates[i].price, *reference_price) < distance(m_candidates[chosen].price, *reference_price))
+                    {
+                        chosen = i;
+                    }
+                }
+            }
+
+            const auto &c = m_candidates[chosen];
+            return {c.price, c.volume, c.surplus};
+        }
+
+        static PriceType distance(PriceType a, PriceType b) { return a < b ? b - a : a - b; }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_AUCTION_HPP
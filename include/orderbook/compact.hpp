@@ -0,0 +1,57 @@
+#ifndef INCLUDED_COMPACT_HPP
+#define INCLUDED_COMPACT_HPP
+
+//
+// Compact books for hosting many thin instruments
+//
+//      std::pmr::unsynchronized_pool_resource pool;        // Shared by all books
+//      util::ScopedDefaultResource scope(&pool);
+//
+//      std::deque<OrderBook<MyOrder, CompactBookSidePolicy<>>> books(20000);
+//
+// Empty book doesn't allocate anything: levels of both sides, and of stop
+// orders, are in `std::pmr::vector`, which allocates on first insert, and
+// from memory resource that was default when the book was created. With one
+// pool resource for all books, levels of all instruments come from shared
+// blocks of a few size classes, and not from separate heap allocations.
+//
+// Orders of each level are held in `util::SmallQueue` inline in the level,
+// so that a level with up to `InlineOrders` orders is one slot of the levels
+// vector, and only deeper levels allocate their queue from heap.
+//
+// Run `bin/bench_memory` to see bytes per empty book, and per resting order.
+//
+// NOTE: Inserting level moves levels behind it, which is cheap for thin
+// books, but deep books are better off with `std::deque` of
+// `PriceLevelStackBookSidePolicy`.
+//
+
+#include "concepts.hpp"
+#include "pricelevelstack.hpp"
+#include "triggerbook.hpp"
+
+#include "util/smallqueue.hpp"
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<
+        template <typename, template <typename> class> class LevelType = OrderPriceLevel,
+        std::size_t InlineOrders = 1>
+    struct CompactBookSidePolicy
+    {
+        template<typename T> using QueueType = util::SmallQueue<T, InlineOrders>;
+
+        template<Side MySide, OrderConcept OrderType>
+        using OrderBookSideType = PriceLevelStack<MySide, OrderType, std::pmr::vector, QueueType, LevelType>;
+
+        template<OrderConcept OrderType>
+        using StopBookType = StopTriggerBook<OrderType, std::pmr::vector, QueueType>;
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_COMPACT_HPP
@@ -26,6 +26,27 @@ namespace sadhbhcraft::orderbook
             { x.quantity } -> std::convertible_to<typename T::QuantityType>;
         };
 
+    template<typename T>
+    concept StopOrderConcept =
+        OrderConcept<T> &&
+        requires(T &x) {
+            { x.stop_price } -> std::convertible_to<typename T::PriceType>;
+        };
+
+    template<typename T>
+    concept IcebergOrderConcept =
+        OrderConcept<T> &&
+        requires(T &x) {
+            { x.display_quantity } -> std::convertible_to<typename T::QuantityType>;
+        };
+
+    template<typename T>
+    concept OwnerMemberConcept =
+        OrderConcept<T> &&
+        requires(T &x) {
+            { x.owner } -> std::equality_comparable;
+        };
+
     template <typename T, typename OrderType>
     concept OrderQuantityConcept = 
         requires(T &x) {
@@ -15,9 +15,36 @@ namespace sadhbhcraft::orderbook
         Market, // Take order(s) from opposite side to fully fill quantity requested
         Limit,  // Place order on the book, cross and execute up to requested price level
         IOC,    // Take order(s) from opposite side up to requested price level
-        FOC     // Take order(s) from opposite side only up to requested price level,
+        FOC,    // Take order(s) from opposite side only up to requested price level,
                 // and only if can fully fill quantity requested
+        Stop,   // Rest in trigger book until trade crosses stop price, then becomes Market
+        StopLimit // Rest in trigger book until trade crosses stop price, then becomes Limit
     };
 
+    enum class SelfTradePrevention
+    {
+        None,               // Orders of same owner are matched as any other
+        CancelResting,      // Cancel resting order, and continue matching
+        CancelAggressor,    // Cancel rest of incoming order, and stop matching
+        CancelBoth          // Cancel both resting order and rest of incoming order
+    };
+
+    enum class TradingPhase
+    {
+        Continuous,         // Incoming orders are matched as they arrive
+        Auction             // Limit orders rest on the book without matching until uncross
+    };
+
+    enum class CapacityOverflow
+    {
+        Reject,             // Order that doesn't fit is not placed on the book
+        EvictWorst          // Worst level is cancelled to make room for better price
+    };
+
+    constexpr bool is_stop_order_type(OrderType order_type)
+    {
+        return order_type == OrderType::Stop || order_type == OrderType::StopLimit;
+    }
+
 }; // end of namespace
 #endif//INCLUDED_ENUMS_HPP
\ No newline at end of file
@@ -0,0 +1,152 @@
+#ifndef INCLUDED_EXPIRY_HPP
+#define INCLUDED_EXPIRY_HPP
+
+//
+// Good-till-time expiry of resting orders
+//
+//      ManualClock clock;
+//      ...
+//      clock.advance(1000);
+//      book.expire_orders(clock);
+//      for (auto &oq : book.expired_orders()) { ... }
+//
+// Order types can opt in for expiry by having `expire_time` and `expiry_hook`
+// members:
+//
+//      struct MyOrder
+//      {
+//          ...
+//          std::uint64_t expire_time;      // 0 for good-till-cancel
+//          ExpiryHook<MyOrder> expiry_hook;
+//      };
+//
+// Then book schedules each resting order with expire time in a hierarchical
+// timer wheel (see `util::HierarchicalTimerWheel`), and the order leaves the
+// wheel in O(1) when it leaves the book. Advancing the clock visits only
+// orders that are due, and levels holding them.
+//
+// Time is whatever clock passed to `expire_orders()` says, so that tests and
+// replays can drive it with `ManualClock`, and expire times are in the same
+// units. Book only knows the time of the last `expire_orders()`, and orders
+// which have already expired by then are dropped by `accept_order()`, and
+// reported in `expired_orders()`.
+//
+// NOTE: Positions in level queues aren't stable, and that's why each level
+// holding due orders is compacted in one pass (see `OwnerIndex`). Finding
+// due orders in the wheel is amortised O(1) each, but removing them costs
+// O(orders on the level) for each level holding any, once per call of
+// `expire_orders()`, however many of them are due there. Levels are found
+// in one sweep of each side, same as for cancel by owner (see `OwnerIndex`),
+// and not by searching the whole side for each level.
+//
+// NOTE: Stop orders waiting for trigger are not in the wheel. They are
+// scheduled once triggered, if they rest on the book.
+//
+
+#include "concepts.hpp"
+#include "util/timerwheel.hpp"
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<typename T>
+    concept ClockConcept = requires(const T &clock) {
+        { clock.now() } -> std::convertible_to<std::uint64_t>;
+    };
+
+    // Clock which only moves when told to
+    class ManualClock
+    {
+    public:
+        explicit ManualClock(std::uint64_t now = 0) : m_now(now) {}
+
+        std::uint64_t now() const { return m_now; }
+        void set(std::uint64_t now) { m_now = now; }
+        void advance(std::uint64_t duration) { m_now += duration; }
+
+    private:
+        std::uint64_t m_now;
+    };
+
+    // Nanoseconds of std::chrono::steady_clock
+    struct SteadyClock
+    {
+        std::uint64_t now() const
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    };
+
+    template<typename OrderType>
+    using ExpiryHook = util::TimerWheelHook<OrderType>;
+
+    template<typename T>
+    concept ExpiringOrderConcept = OrderConcept<T> && requires(T &x) {
+        { x.expire_time } -> std::convertible_to<std::uint64_t>;
+        { x.expiry_hook } -> std::same_as<ExpiryHook<T> &>;
+    };
+
+    // Called whenever order leaves the book
+    template<OrderConcept OrderType>
+    void unlink_expiry(OrderType &order)
+    {
+        if constexpr (ExpiringOrderConcept<OrderType>)
+        {
+            order.expiry_hook.unlink();
+        }
+    }
+
+    template<typename OrderType>
+    class ExpiryIndex
+    {
+    };
+
+    template<ExpiringOrderConcept OrderType>
+    class ExpiryIndex<OrderType>
+    {
+    public:
+        // 8 levels cover 2^48 ticks, e.g. 78 hours in nanoseconds, so that
+        // overflow list is rarely used
+        typedef util::HierarchicalTimerWheel<OrderType, 8> WheelType;
+
+        std::uint64_t now() const { return m_wheel.now(); }
+
+        bool is_expired(const OrderType &order) const
+        {
+            return order.expire_time && static_cast<std::uint64_t>(order.expire_time) <= now();
+        }
+
+        // Order has fired, and it is still on the book
+        static bool is_due(const OrderType &order)
+        {
+            return order.expire_time && !order.expiry_hook.is_linked();
+        }
+
+        void link(OrderType &order)
+        {
+            if (order.expire_time)
+            {
+                m_wheel.schedule(order, order.expiry_hook, static_cast<std::uint64_t>(order.expire_time));
+            }
+        }
+
+        // Calls handler for each order due by `now`, after it has left the
+        // wheel. Returns number of orders due.
+        template<typename Handler>
+        std::size_t advance(std::uint64_t now, Handler &&handler)
+        {
+            return m_wheel.advance(now, handler);
+        }
+
+    private:
+        WheelType m_wheel;
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_EXPIRY_HPP
@@ -0,0 +1,157 @@
+#ifndef INCLUDED_FIXEDBOOK_HPP
+#define INCLUDED_FIXEDBOOK_HPP
+
+//
+// Book sides with capacity fixed at compile time, which never allocate
+//
+//      typedef OrderBook<MyOrder, FixedBookSidePolicy<32, 16>> BookType;
+//      static_assert(sizeof(BookType) < (1 << 20));
+//
+//      BookType book;                      // e.g. in pinned, prefaulted memory
+//      ...
+//      for (auto &oq : book.bid().overflow())
+//      {
+//          // Orders that have left bid side for lack of capacity
+//      }
+//
+// Levels are in `util::FixedStack` of `MaxLevels`, and orders of each level
+// in `util::FixedQueue` of `MaxOrders`, both inline, so that all memory the
+// side will ever use is in the object itself, and its size is known at
+// compile time.
+//
+// Order that doesn't fit, either on full level, or on new level when there
+// are already `MaxLevels` levels, is not placed on the book, and is left in
+// `overflow()` with its quantity, and unlinked from owner and expiry indices.
+// With `CapacityOverflow::EvictWorst` order at price better than the worst
+// level makes room by cancelling all orders of the worst level instead, and
+// those are left in `overflow()`. It holds orders of the last `add_order()`
+// only, and `overflow_count()` is total since the side was created.
+//
+// NOTE: Inserting level moves levels behind it, with their orders, so that
+// capacities are best kept small, e.g. for thin instruments, or for top of
+// deep book.
+//
+// NOTE: Stop orders are held by default stop book of `OrderBook`, which
+// allocates once stop orders are used, and `Generator` of `accept_order()`
+// allocates its coroutine frame, as with any other book side.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "expiry.hpp"
+#include "instrumentation.hpp"
+#include "masscancel.hpp"
+#include "pricelevelstack.hpp"
+#include "traits.hpp"
+
+#include "util/fixedcapacity.hpp"
+#include "util/stats.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<Side MySide, OrderConcept _OrderType,
+        std::size_t MaxLevels,
+        std::size_t MaxOrders,
+        CapacityOverflow Overflow = CapacityOverflow::Reject>
+    class FixedBookSide : public PriceLevelStack<
+        MySide, _OrderType,
+        util::FixedStackOf<MaxLevels>::template type,
+        util::FixedQueueOf<MaxOrders>::template type,
+        OrderPriceLevel>
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef typename OrderType::QuantityType QuantityType;
+        typedef util::FixedQueue<OrderQuantity<OrderType>, MaxOrders> OverflowType;
+
+        static constexpr std::size_t max_levels = MaxLevels;
+        static constexpr std::size_t max_orders = MaxOrders;
+
+        template<typename Instrumentation = NoStats>
+        void add_order(OrderType &order, QuantityType quantity, Instrumentation *instrumentation = nullptr)
+        {
+            [[maybe_unused]] std::uint64_t start = 0;
+            if constexpr (Instrumentation::enabled)
+            {
+                start = util::read_cycles();
+            }
+
+            m_overflow.clear();
+            if (!make_room(price_of(order), instrumentation))
+            {
+                m_overflow.emplace_back(order, quantity);
+                unlink_owner_index(order);
+                unlink_expiry(order);
+                ++m_overflow_count;
+                return;
+            }
+
+            auto [level_iterator, is_new_level] = this->do_add_order(order, quantity);
+
+            if constexpr (Instrumentation::enabled)
+            {
+                if (is_new_level)
+                {
+                    instrumentation->on_level_created(MySide, price_of(order));
+                }
+                instrumentation->on_add_order_cycles(util::read_cycles() - start);
+                instrumentation->on_level_update(MySide, level_iterator->price(), level_iterator->total_quantity());
+            }
+        }
+
+        // Orders that have left this side for lack of capacity by the last
+        // `add_order()`, with quantity they had
+        const OverflowType &overflow() const { return m_overflow; }
+
+        std::uint64_t overflow_count() const { return m_overflow_count; }
+
+    private:
+        OverflowType m_overflow;
+        std::uint64_t m_overflow_count = 0;
+
+        // Tells whether order at price fits, and evicts the worst level if
+        // that's what makes it fit
+        template<typename Instrumentation>
+        bool make_room(PriceType price, Instrumentation *instrumentation)
+        {
+            auto it = this->find_or_get_insert_iterator(price);
+            if (it != this->m_levels.end() && price_of(*it) == price)
+            {
+                return it->size() != MaxOrders;
+            }
+            if (!this->m_levels.full())
+            {
+                return true;
+            }
+            if constexpr (Overflow == CapacityOverflow::EvictWorst)
+            {
+                if (it != this->m_levels.end())
+                {
+                    auto &worst = this->m_levels.back();
+                    m_overflow_count += worst.cancel_orders_if([](const OrderType &) { return true; }, m_overflow);
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        instrumentation->on_level_erased(MySide, worst.price());
+                    }
+                    this->m_levels.pop_back();
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    template<std::size_t MaxLevels, std::size_t MaxOrders, CapacityOverflow Overflow = CapacityOverflow::Reject>
+    struct FixedBookSidePolicy
+    {
+        template<Side MySide, OrderConcept OrderType>
+        using OrderBookSideType = FixedBookSide<MySide, OrderType, MaxLevels, MaxOrders, Overflow>;
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_FIXEDBOOK_HPP
@@ -0,0 +1,234 @@
+#ifndef INCLUDED_FLIGHTRECORDER_HPP
+#define INCLUDED_FLIGHTRECORDER_HPP
+
+//
+// Flight recorder instrumentation policy for `OrderBook`
+//
+//      OrderBook<MyOrder, PriceLevelStackBookSidePolicy<>, FlightRecorder<>> book;
+//      book.instrumentation().install_crash_dump("/var/tmp/book.trace");
+//      ...
+//      book.instrumentation().dump(fd);    // On demand
+//
+// Book mutations are recorded as compact fixed size events with TSC
+// timestamp into `util::TraceRing`, which keeps the last `Capacity` events,
+// so that when latency spikes, or process crashes, we can reconstruct what
+// the book was doing just before. Run `bin/trace_decode <file>` to turn dump
+// into readable timeline.
+//
+// Orders have no identity of their own, and they are identified by address,
+// which is stable while order rests on the book.
+//
+// To record book that already has another policy, e.g. `MarketDataPublisher`,
+// combine them with `CompositeInstrumentation`.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "instrumentation.hpp"
+#include "traits.hpp"
+
+#include "util/stats.hpp"
+#include "util/tracering.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
+
+namespace sadhbhcraft::orderbook
+{
+    enum class TraceEventType : std::uint8_t
+    {
+        AcceptOrder = 1,    // Order received by accept_order()
+        AcceptOrderDone,    // accept_order() has finished, `aux` has number of executions
+        Execution,          // Resting order executed, with price and quantity executed
+        LevelCreated,
+        LevelErased
+    };
+
+    enum TraceEventFlags : std::uint8_t
+    {
+        TracePriceIsFloat = 1,      // Price holds bits of double
+        TraceQuantityIsFloat = 2    // Quantity holds bits of double
+    };
+
+    struct TraceEvent
+    {
+        std::uint64_t tsc;
+        std::uint64_t order;        // Address of the order, or zero for level events
+        std::int64_t price;
+        std::int64_t quantity;
+        std::uint32_t aux;
+        TraceEventType type;
+        std::uint8_t side;
+        std::uint8_t order_type;
+        std::uint8_t flags;
+    };
+
+    static_assert(sizeof(TraceEvent) == 40);
+    static_assert(std::is_trivially_copyable_v<TraceEvent>);
+
+    // Numbers of any type are stored in 64-bit field, with flag telling
+    // whether it's double
+    template<typename NumberType>
+    std::int64_t encode_trace_number(NumberType value, std::uint8_t &flags, std::uint8_t float_flag)
+    {
+        if constexpr (std::is_floating_point_v<NumberType>)
+        {
+            flags |= float_flag;
+            return std::bit_cast<std::int64_t>(static_cast<double>(value));
+        }
+        else
+        {
+            return static_cast<std::int64_t>(value);
+        }
+    }
+
+    template<std::size_t Capacity = 65536>
+    class FlightRecorder : public InstrumentationHooks
+    {
+    public:
+        typedef util::TraceRing<TraceEvent, Capacity> RingType;
+
+        template<typename OrderType>
+        void on_accept_order(const OrderType &order)
+        {
+            record_order(TraceEventType::AcceptOrder, order, price_of(order), quantity_of(order));
+            m_order_executions = 0;
+        }
+
+        template<typename OrderType>
+        void on_accept_order_done(const OrderType &order)
+        {
+            TraceEvent event{};
+            event.type = TraceEventType::AcceptOrderDone;
+            event.order = reinterpret_cast<std::uintptr_t>(&order);
+            event.aux = m_order_executions;
+            push(event);
+        }
+
+        template<typename ExecutionType>
+        void on_execution(const ExecutionType &executed)
+        {
+            record_order(TraceEventType::Execution, executed.order(), price_of(executed), quantity_of(executed));
+            ++m_order_executions;
+        }
+
+        // Both orders are resting, and each is recorded as executed
+        template<typename TradeType>
+        void on_auction_trade(const TradeType &trade)
+        {
+            record_order(TraceEventType::Execution, trade.buy(), trade.price, trade.quantity);
+            record_order(TraceEventType::Execution, trade.sell(), trade.price, trade.quantity);
+        }
+
+        template<typename PriceType>
+        void on_level_created(Side side, PriceType price) { record_level(TraceEventType::LevelCreated, side, price); }
+
+        template<typename PriceType>
+        void on_level_erased(Side side, PriceType price) { record_level(TraceEventType::LevelErased, side, price); }
+
+        const RingType &trace() const { return m_ring; }
+
+        // Writes trace to file descriptor, and returns false if write failed
+        bool dump(int fd) const { return m_ring.dump(fd); }
+
+        // Book must outlive the process, or call `util::uninstall_crash_dump()`
+        bool install_crash_dump(const char *path) const { return util::install_crash_dump(m_ring, path); }
+
+        void clear() { m_ring.clear(); }
+
+    private:
+        RingType m_ring;
+        std::uint32_t m_order_executions = 0;
+
+        void push(TraceEvent &event)
+        {
+            event.tsc = util::read_cycles();
+            m_ring.push(event);
+        }
+
+        template<typename OrderType, typename PriceType, typename QuantityType>
+        void record_order(TraceEventType type, const OrderType &order, PriceType price, QuantityType quantity)
+        {
+            TraceEvent event{};
+            event.type = type;
+            event.order = reinterpret_cast<std::uintptr_t>(&order);
+            event.side = static_cast<std::uint8_t>(order.side);
+            event.order_type = static_cast<std::uint8_t>(order.order_type);
+            event.price = encode_trace_number(price, event.flags, TracePriceIsFloat);
+            event.quantity = encode_trace_number(quantity, event.flags, TraceQuantityIsFloat);
+            push(event);
+        }
+
+        template<typename PriceType>
+        void record_level(TraceEventType type, Side side, PriceType price)
+        {
+            TraceEvent event{};
+            event.type = type;
+            event.side = static_cast<std::uint8_t>(side);
+            event.price = encode_trace_number(price, event.flags, TracePriceIsFloat);
+            push(event);
+        }
+    };
+
+    inline const char *to_string(TraceEventType type)
+    {
+        switch (type)
+        {
+            case TraceEventType::AcceptOrder: return "ACCEPT";
+            case TraceEventType::AcceptOrderDone: return "DONE";
+            case TraceEventType::Execution: return "EXEC";
+            case TraceEventType::LevelCreated: return "LEVEL+";
+            case TraceEventType::LevelErased: return "LEVEL-";
+        }
+        return "?";
+    }
+
+    // Writes event as one line of timeline, with time in cycles since `base_tsc`
+    inline void format_trace_event(std::ostream &out, const TraceEvent &event, std::uint64_t base_tsc = 0)
+    {
+        static const char *side_names[] = {"Buy", "Sell"};
+        static const char *order_type_names[] = {"Market", "Limit", "IOC", "FOC", "Stop", "StopLimit"};
+
+        auto write_number = [&](std::int64_t value, std::uint8_t float_flag)
+        {
+            if (event.flags & float_flag)
+            {
+                out << std::bit_cast<double>(value);
+            }
+            else
+            {
+                out << value;
+            }
+        };
+
+        const char *side = event.side < 2 ? side_names[event.side] : "?";
+
+        out << '+' << (event.tsc - base_tsc) << ' ' << to_string(event.type);
+
+        switch (event.type)
+        {
+            case TraceEventType::AcceptOrder:
+            case TraceEventType::Execution:
+                out << " order=0x" << std::hex << event.order << std::dec << ' ' << side << ' '
+                    << (event.order_type < 6 ? order_type_names[event.order_type] : "?") << ' ';
+                write_number(event.price, TracePriceIsFloat);
+                out << " x ";
+                write_number(event.quantity, TraceQuantityIsFloat);
+                break;
+            case TraceEventType::AcceptOrderDone:
+                out << " order=0x" << std::hex << event.order << std::dec << " executions=" << event.aux;
+                break;
+            case TraceEventType::LevelCreated:
+            case TraceEventType::LevelErased:
+                out << ' ' << side << ' ';
+                write_number(event.price, TracePriceIsFloat);
+                break;
+        }
+    }
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_FLIGHTRECORDER_HPP
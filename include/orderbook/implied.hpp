@@ -0,0 +1,377 @@
+#ifndef INCLUDED_IMPLIED_HPP
+#define INCLUDED_IMPLIED_HPP
+
+//
+// Implied matching across calendar spreads and their legs
+//
+//      ImpliedMatcher<MyBook> implied;
+//      auto near = implied.add_instrument(near_book);
+//      auto far = implied.add_instrument(far_book);
+//      auto spread = implied.add_spread(spread_book, near, far);   // Spread is near minus far
+//
+//      implied.accept_order(spread, order, [](std::size_t instrument, auto executed) { ... });
+//      implied.implied_top(near, Side::Sell);                     // e.g. for market data
+//
+//      std::vector<ImpliedFill<Price, Quantity>> fills;            // Order's own fills at implied prices
+//      implied.accept_order(spread, order, handler, &fills);
+//
+// Buying spread is buying near leg and selling far leg, so that each book
+// has liquidity implied by top levels of two other books:
+//
+//  - implied-in, spread from legs:     ask(S) = ask(N) - bid(F),   bid(S) = bid(N) - ask(F)
+//  - implied-out, near leg:            ask(N) = ask(S) + ask(F),   bid(N) = bid(S) + bid(F)
+//  - implied-out, far leg:             ask(F) = ask(N) - bid(S),   bid(F) = bid(N) - ask(S)
+//
+// Each of these is a route, and order taking implied liquidity is executed
+// as two IOC orders at top prices of the two books of the route, for
+// quantity not above either top level, so that both fill completely, and
+// execution is atomic across the books. Second order is sized by what the
+// first one has executed, in case it was short.
+//
+// Matcher keeps top of every book, and after every order, or whenever
+// caller says book has changed (see `refresh()`), it compares tops of that
+// book, and recomputes only the routes that depend on the side that has
+// changed, and then best implied price of their targets. Nothing is
+// recomputed for orders that don't change the top.
+//
+// Incoming order takes outright liquidity first when price is the same,
+// and only Limit, IOC, and Market orders take implied liquidity, while the
+// rest go straight to the book.
+//
+// NOTE: Implied prices are first generation, i.e. only from outright
+// orders, and not from other implied prices.
+//
+// NOTE: Quantity of incoming Limit order is reduced by quantity executed,
+// before it rests on its book.
+//
+// NOTE: Self-trade prevention must be off on all books, as it could cancel
+// one of the two IOC orders.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "orderbook.hpp"
+#include "traits.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    constexpr Side opposite_side(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
+
+    // Fill of incoming order against implied liquidity, at implied price,
+    // while executions of its two IOC orders are passed to handler
+    template<typename PriceType, typename QuantityType>
+    struct ImpliedFill
+    {
+        PriceType price;
+        QuantityType quantity;
+
+        bool operator==(const ImpliedFill &) const = default;
+    };
+
+    template<typename PriceType, typename QuantityType>
+    struct ImpliedTop
+    {
+        PriceType price{};
+        QuantityType quantity{};    // Zero if there's no price
+
+        explicit operator bool() const { return quantity != QuantityType{}; }
+
+        bool operator==(const ImpliedTop &) const = default;
+    };
+
+    template<typename _OrderBookType>
+    class ImpliedMatcher
+    {
+    public:
+        typedef _OrderBookType OrderBookType;
+        typedef typename OrderBookType::OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef typename OrderType::QuantityType QuantityType;
+        typedef ImpliedTop<PriceType, QuantityType> TopType;
+        typedef ImpliedFill<PriceType, QuantityType> FillType;
+
+        // Returns index of the instrument
+        std::size_t add_instrument(OrderBookType &book)
+        {
+            m_instruments.emplace_back(book);
+            refresh(m_instruments.size() - 1);
+            return m_instruments.size() - 1;
+        }
+
+        // Adds spread of near minus far leg, and returns its index
+        std::size_t add_spread(OrderBookType &book, std::size_t near, std::size_t far)
+        {
+            const std::size_t spread = add_instrument(book);
+            // Routes for asks of target, and bids are the same with sides flipped
+            add_routes(spread, near, Side::Sell, far, Side::Buy, -1);
+            add_routes(near, spread, Side::Sell, far, Side::Sell, +1);
+            add_routes(far, near, Side::Sell, spread, Side::Buy, -1);
+            return spread;
+        }
+
+        // Matches order against outright and implied liquidity in price
+        // priority, and then passes whatever is left to the book. Handler is
+        // called for every execution as:
+        //
+        //      handler(instrument, executed);
+        //
+        // where executed is the resting order on book of the instrument,
+        // including orders executed by stops that were triggered (see
+        // `OrderBook::aggressor()`). Fills of the order itself against
+        // implied liquidity, at implied price, are added to implied fills,
+        // if given. Returns quantity executed by order.
+        template<typename Handler, typename Output = std::vector<FillType>>
+        QuantityType accept_order(std::size_t instrument, OrderType &order, Handler &&handler, Output *implied_fills = nullptr)
+        {
+            const auto type = order.order_type;
+            if (type != orderbook::OrderType::Limit && type != orderbook::OrderType::IOC && type != orderbook::OrderType::Market)
+            {
+                return submit(instrument, order, handler);
+            }
+
+            const Side resting_side = opposite_side(order.side);
+            QuantityType remaining = quantity_of(order);
+
+            while (remaining)
+            {
+                const TopType &outright = m_instruments[instrument].tops[side_index(resting_side)];
+                const TopType &implied = m_instruments[instrument].implied[side_index(resting_side)];
+                const bool outright_crosses = outright && crosses(order, outright.price);
+                const bool implied_crosses = implied && crosses(order, implied.price);
+
+                QuantityType executed = 0;
+                if (outright_crosses && !(implied_crosses && is_better(resting_side, implied.price, outright.price)))
+                {
+                    executed = take(instrument, order.side, outright.price, remaining, handler, &order);
+                }
+                else if (implied_crosses)
+                {
+                    const std::size_t route_index = m_instruments[instrument].best_route[side_index(resting_side)];
+                    const PriceType implied_price = implied.price; //< Copy, as top is updated by taking it
+                    executed = take_implied(m_routes[route_index], std::min(remaining, implied.quantity), handler);
+                    if (executed && implied_fills)
+                    {
+                        implied_fills->push_back(FillType{implied_price, executed});
+                    }
+                }
+                if (!executed)
+                {
+                    break;
+                }
+                remaining -= executed;
+            }
+
+            const QuantityType executed = quantity_of(order) - remaining;
+            if (remaining && type == orderbook::OrderType::Limit)
+            {
+                order.quantity = remaining;
+                submit(instrument, order, handler);
+            }
+            return executed;
+        }
+
+        // Call after book has been changed other than by `accept_order()`,
+        // e.g. after cancels
+        void refresh(std::size_t instrument)
+        {
+            Instrument &entry = m_instruments[instrument];
+            refresh_side(entry, Side::Buy, top_of(entry.book.bid()));
+            refresh_side(entry, Side::Sell, top_of(entry.book.ask()));
+        }
+
+        // Best price implied on the side of the book, i.e. Sell for implied
+        // ask, and Buy for implied bid
+        const TopType &implied_top(std::size_t instrument, Side side) const
+        {
+            return m_instruments[instrument].implied[side_index(side)];
+        }
+
+        const OrderBookType &book(std::size_t instrument) const { return m_instruments[instrument].book; }
+        std::size_t size() const { return m_instruments.size(); }
+
+        // Number of times any route was recomputed
+        std::size_t route_updates() const { return m_route_updates; }
+
+    private:
+        struct Route
+        {
+            std::size_t target;
+            Side target_side;
+            std::size_t a;
+            Side a_side;        // Side of book `a` giving liquidity
+            std::size_t b;
+            Side b_side;
+            int sign;           // Price is price of `a` plus sign times price of `b`
+            TopType top;
+        };
+
+        struct Instrument
+        {
+            Instrument(OrderBookType &book): book(book)
+            {}
+
+            OrderBookType &book;
+            std::array<TopType, 2> tops;                        // Outright
+            std::array<TopType, 2> implied;                     // Best of routes targeting this instrument
+            std::array<std::size_t, 2> best_route{};
+            std::array<std::vector<std::size_t>, 2> targeting;  // Routes implying into this instrument
+            std::array<std::vector<std::size_t>, 2> dependent;  // Routes using top of this instrument
+        };
+
+        std::deque<Instrument> m_instruments;
+        std::vector<Route> m_routes;
+        std::size_t m_route_updates = 0;
+
+        static std::size_t side_index(Side side) { return side == Side::Buy ? 0 : 1; }
+
+        // Is `a` better than `b` for taker of side that gives liquidity
+        static bool is_better(Side resting_side, PriceType a, PriceType b)
+        {
+            return resting_side == Side::Buy ? b < a : a < b;
+        }
+
+        static bool crosses(const OrderType &order, PriceType price)
+        {
+            if (order.order_type == orderbook::OrderType::Market)
+            {
+                return true;
+            }
+            return order.side == Side::Buy ? !(price_of(order) < price) : !(price < price_of(order));
+        }
+
+        template<typename BookSide>
+        static TopType top_of(const BookSide &book_side)
+        {
+            if (book_side.empty())
+            {
+                return {};
+            }
+            return {book_side.top().price(), book_side.top().total_quantity()};
+        }
+
+        void add_routes(std::size_t target, std::size_t a, Side a_side, std::size_t b, Side b_side, int sign)
+        {
+            add_route({target, Side::Sell, a, a_side, b, b_side, sign, {}});
+            add_route({target, Side::Buy, a, opposite_side(a_side), b, opposite_side(b_side), sign, {}});
+        }
+
+        void add_route(const Route &route)
+        {
+            const std::size_t index = m_routes.size();
+            m_routes.push_back(route);
+            m_instruments[route.target].targeting[side_index(route.target_side)].push_back(index);
+            m_instruments[route.a].dependent[side_index(route.a_side)].push_back(index);
+            m_instruments[route.b].dependent[side_index(route.b_side)].push_back(index);
+            update_route(index);
+            update_implied(route.target, route.target_side);
+        }
+
+        void refresh_side(Instrument &entry, Side side, const TopType &top)
+        {
+            TopType &cached = entry.tops[side_index(side)];
+            if (cached == top)
+            {
+                return;
+            }
+            cached = top;
+            for (std::size_t index : entry.dependent[side_index(side)])
+            {
+                update_route(index);
+                update_implied(m_routes[index].target, m_routes[index].target_side);
+            }
+        }
+
+        void update_route(std::size_t index)
+        {
+            Route &route = m_routes[index];
+            ++m_route_updates;
+            const TopType &a = m_instruments[route.a].tops[side_index(route.a_side)];
+            const TopType &b = m_instruments[route.b].tops[side_index(route.b_side)];
+            if (!a || !b)
+            {
+                route.top = {};
+                return;
+            }
+            route.top.price = (route.sign < 0 ? a.price - b.price : a.price + b.price);
+            route.top.quantity = std::min(a.quantity, b.quantity);
+        }
+
+        void update_implied(std::size_t instrument, Side side)
+        {
+            Instrument &entry = m_instruments[instrument];
+            TopType best{};
+            std::size_t best_route = 0;
+            for (std::size_t index : entry.targeting[side_index(side)])
+            {
+                const TopType &top = m_routes[index].top;
+                if (top && (!best || is_better(side, top.price, best.price)))
+                {
+                    best = top;
+                    best_route = index;
+                }
+            }
+            entry.implied[side_index(side)] = best;
+            entry.best_route[side_index(side)] = best_route;
+        }
+
+        // Passes order to the book, and returns quantity it has executed
+        template<typename Handler>
+        QuantityType submit(std::size_t instrument, OrderType &order, Handler &handler)
+        {
+            OrderBookType &book = m_instruments[instrument].book;
+            QuantityType executed = 0;
+            for (auto executions = book.accept_order(order); executions; )
+            {
+                const bool is_own = (book.aggressor() == &order);
+                auto resting = executions();
+                if (is_own)
+                {
+                    executed += quantity_of(resting);
+                }
+                handler(instrument, resting);
+            }
+            refresh(instrument);
+            return executed;
+        }
+
+        // Takes up to quantity from top level of the book at price with IOC
+        // order, and returns quantity executed
+        template<typename Handler>
+        QuantityType take(std::size_t instrument, Side side, PriceType price, QuantityType quantity, Handler &handler, const OrderType *prototype = nullptr)
+        {
+            OrderType child = (prototype ? *prototype : OrderType{});
+            child.side = side;
+            child.order_type = orderbook::OrderType::IOC;
+            child.price = price;
+            child.quantity = quantity;
+            return submit(instrument, child, handler);
+        }
+
+        template<typename Handler>
+        QuantityType take_implied(const Route &route, QuantityType quantity, Handler &handler)
+        {
+            // Copy, as route is updated by the first take
+            const PriceType a_price = m_instruments[route.a].tops[side_index(route.a_side)].price;
+            const PriceType b_price = m_instruments[route.b].tops[side_index(route.b_side)].price;
+
+            // Second leg takes only what the first one has executed, e.g. when
+            // top was changed without `refresh()`
+            const QuantityType a_executed = take(route.a, opposite_side(route.a_side), a_price, quantity, handler);
+            if (!a_executed)
+            {
+                return 0;
+            }
+            return take(route.b, opposite_side(route.b_side), b_price, a_executed, handler);
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_IMPLIED_HPP
@@ -0,0 +1,99 @@
+#ifndef INCLUDED_INGRESS_HPP
+#define INCLUDED_INGRESS_HPP
+
+//
+// Ingress of orders from many gateway threads into one book
+//
+//      OrderIngress<MyBook> ingress;
+//
+//      // Gateway threads
+//      if (!ingress.submit(order)) { ... }     // Queue full, try again, or reject
+//
+//      // Matching thread
+//      ingress.drain(book, [](std::uint64_t sequence, auto executed) { ... });
+//
+// Gateways push pointers to orders into `util::MpscQueue`, and matching
+// thread takes them out in batches and passes each to
+// `OrderBook::accept_order()`. Sequence number is assigned when order is
+// claimed in the queue, and orders are accepted in order of sequence, so
+// that it's the same number that goes into journal, and replaying journal
+// in that order rebuilds the same book.
+//
+// Orders with `sequence` member get it set by matching thread just before
+// they are accepted.
+//
+// NOTE: Order must not be touched by gateway once submitted, and it must
+// stay where it is while it rests on the book, as with `accept_order()`.
+//
+// NOTE: Execution policy must complete synchronously, as there's nowhere
+// to park the book here (see `OrderBookScheduler`).
+//
+
+#include "concepts.hpp"
+#include "orderbook.hpp"
+
+#include "util/async.hpp"
+#include "util/mpscqueue.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<typename T>
+    concept SequencedOrderConcept =
+        OrderConcept<T> &&
+        requires(T &x) {
+            { x.sequence } -> std::convertible_to<std::uint64_t>;
+        };
+
+    template<typename _OrderBookType, std::size_t Capacity = 4096>
+    class OrderIngress
+    {
+    public:
+        typedef _OrderBookType OrderBookType;
+        typedef typename OrderBookType::OrderType OrderType;
+
+        // Any thread may submit. Returns sequence number, or nothing if queue
+        // is full.
+        std::optional<std::uint64_t> submit(OrderType &order) { return m_queue.try_push(&order); }
+
+        // Only matching thread may drain. Accepts up to `max_batch` orders
+        // into the book, and handler is called for every execution as:
+        //
+        //      handler(sequence, executed);
+        //
+        // Returns number of orders accepted.
+        template<typename Handler, ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy = util::AsyncNoop>
+        std::size_t drain(OrderBookType &book, Handler &&handler, std::size_t max_batch = Capacity, ExecutionPolicy &&execution_policy = {})
+        {
+            return m_queue.drain([&](std::uint64_t sequence, OrderType *order)
+            {
+                if constexpr (SequencedOrderConcept<OrderType>)
+                {
+                    order->sequence = sequence;
+                }
+                for (auto executions = book.accept_order(*order, execution_policy); executions; )
+                {
+                    handler(sequence, executions());
+                }
+            }, max_batch);
+        }
+
+        // Sequence number of the next order to be accepted
+        std::uint64_t sequence() const { return m_queue.head(); }
+
+        // Orders submitted and not accepted yet. Any thread may ask, e.g. to
+        // monitor backlog, and it's exact only on matching thread.
+        std::size_t size() const { return m_queue.size(); }
+
+    private:
+        util::MpscQueue<OrderType *, Capacity> m_queue;
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_INGRESS_HPP
@@ -0,0 +1,206 @@
+#ifndef INCLUDED_INSTRUMENTATION_HPP
+#define INCLUDED_INSTRUMENTATION_HPP
+
+//
+// Instrumentation policies for `OrderBook`
+//
+//      OrderBook<MyOrder, PriceLevelStackBookSidePolicy<>, HotPathStats> book;
+//      ...
+//      book.instrumentation().counter(HotPathStats::LevelsTouched);
+//
+// Default policy is `NoStats`, and every hook is guarded by
+// `if constexpr (Instrumentation::enabled)`, so that it is compiled out
+// completely, including reading of the clock.
+//
+// Instrumentation object lives in the book, and it is passed down to book
+// sides and to levels as a pointer for the duration of a call, so book sides
+// don't hold any extra state.
+//
+// Enabled policy derives from `InstrumentationHooks`, and hides the hooks it
+// is interested in.
+//
+// Book has one policy, and `CompositeInstrumentation` is the policy that
+// passes every hook to each of several policies in turn, e.g. to record
+// flight trace and publish market data from the same book:
+//
+//      typedef CompositeInstrumentation<HotPathStats, FlightRecorder<>> Instrumentation;
+//      OrderBook<MyOrder, PriceLevelStackBookSidePolicy<>, Instrumentation> book;
+//      book.instrumentation().get<FlightRecorder<>>().dump(fd);
+//
+
+#include "enums.hpp"
+
+#include "util/stats.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+
+namespace sadhbhcraft::orderbook
+{
+    struct NoStats
+    {
+        static constexpr bool enabled = false;
+    };
+
+    struct InstrumentationHooks
+    {
+        static constexpr bool enabled = true;
+
+        template<typename OrderType> void on_accept_order(const OrderType &) {}
+        template<typename OrderType> void on_accept_order_done(const OrderType &) {}
+        template<typename ExecutionType> void on_execution(const ExecutionType &) {}
+        template<typename TradeType> void on_auction_trade(const TradeType &) {}
+        void on_level_touched() {}
+        void on_order_touched() {}
+        template<typename PriceType> void on_level_created(Side, PriceType) {}
+        template<typename PriceType> void on_level_erased(Side, PriceType) {}
+        template<typename PriceType, typename QuantityType> void on_level_update(Side, PriceType, QuantityType) {}
+        void on_add_order_cycles(std::uint64_t) {}
+        void on_match_order_cycles(std::uint64_t) {}
+    };
+
+    // Per-book counters and histograms, which can be read from another
+    // thread while the book is being matched (see util::RelaxedCounter)
+    class alignas(64) HotPathStats : public InstrumentationHooks
+    {
+    public:
+        enum Counter
+        {
+            AcceptOrder,    // Calls to accept_order()
+            Executions,     // Executions yielded, and trades at uncross
+            LevelsTouched,  // Price levels visited by matching
+            OrdersTouched,  // Resting orders visited by matching
+            LevelsCreated,
+            LevelsErased,
+            CounterCount
+        };
+
+        enum Histogram
+        {
+            AddOrderCycles,         // Time spent adding order to the book side
+            MatchOrderCycles,       // Time spent matching, excluding time spent by caller consuming executions
+            ExecutionsPerOrder,
+            HistogramCount
+        };
+
+        template<typename OrderType>
+        void on_accept_order(const OrderType &)
+        {
+            count(AcceptOrder);
+            m_order_executions = 0;
+        }
+
+        template<typename OrderType>
+        void on_accept_order_done(const OrderType &)
+        {
+            record(ExecutionsPerOrder, m_order_executions);
+        }
+
+        template<typename ExecutionType>
+        void on_execution(const ExecutionType &)
+        {
+            count(Executions);
+            ++m_order_executions;
+        }
+
+        template<typename TradeType>
+        void on_auction_trade(const TradeType &) { count(Executions); }
+
+        void on_level_touched() { count(LevelsTouched); }
+        void on_order_touched() { count(OrdersTouched); }
+        template<typename PriceType> void on_level_created(Side, PriceType) { count(LevelsCreated); }
+        template<typename PriceType> void on_level_erased(Side, PriceType) { count(LevelsErased); }
+        void on_add_order_cycles(std::uint64_t cycles) { record(AddOrderCycles, cycles); }
+        void on_match_order_cycles(std::uint64_t cycles) { record(MatchOrderCycles, cycles); }
+
+        void count(Counter c, std::uint64_t n = 1) { m_counters[c].add(n); }
+        void record(Histogram h, std::uint64_t value) { m_histograms[h].record(value); }
+
+        std::uint64_t counter(Counter c) const { return m_counters[c].load(); }
+        const util::Log2Histogram &histogram(Histogram h) const { return m_histograms[h]; }
+
+        void reset()
+        {
+            for (auto &c : m_counters)
+            {
+                c.reset();
+            }
+            for (auto &h : m_histograms)
+            {
+                h.reset();
+            }
+        }
+
+    private:
+        std::array<util::RelaxedCounter, CounterCount> m_counters;
+        std::array<util::Log2Histogram, HistogramCount> m_histograms;
+        std::uint64_t m_order_executions = 0;
+    };
+
+    // Passes every hook to each of the policies, in order they are given,
+    // and policies not enabled are skipped
+    template<typename... Policies>
+    class CompositeInstrumentation : public InstrumentationHooks
+    {
+    public:
+        template<typename OrderType>
+        void on_accept_order(const OrderType &order) { each([&](auto &p) { p.on_accept_order(order); }); }
+
+        template<typename OrderType>
+        void on_accept_order_done(const OrderType &order) { each([&](auto &p) { p.on_accept_order_done(order); }); }
+
+        template<typename ExecutionType>
+        void on_execution(const ExecutionType &executed) { each([&](auto &p) { p.on_execution(executed); }); }
+
+        template<typename TradeType>
+        void on_auction_trade(const TradeType &trade) { each([&](auto &p) { p.on_auction_trade(trade); }); }
+
+        void on_level_touched() { each([](auto &p) { p.on_level_touched(); }); }
+        void on_order_touched() { each([](auto &p) { p.on_order_touched(); }); }
+
+        template<typename PriceType>
+        void on_level_created(Side side, PriceType price) { each([&](auto &p) { p.on_level_created(side, price); }); }
+
+        template<typename PriceType>
+        void on_level_erased(Side side, PriceType price) { each([&](auto &p) { p.on_level_erased(side, price); }); }
+
+        template<typename PriceType, typename QuantityType>
+        void on_level_update(Side side, PriceType price, QuantityType quantity)
+        {
+            each([&](auto &p) { p.on_level_update(side, price, quantity); });
+        }
+
+        void on_add_order_cycles(std::uint64_t cycles) { each([&](auto &p) { p.on_add_order_cycles(cycles); }); }
+        void on_match_order_cycles(std::uint64_t cycles) { each([&](auto &p) { p.on_match_order_cycles(cycles); }); }
+
+        template<typename Policy> Policy &get() { return std::get<Policy>(m_policies); }
+        template<typename Policy> const Policy &get() const { return std::get<Policy>(m_policies); }
+
+        template<std::size_t I> auto &get() { return std::get<I>(m_policies); }
+        template<std::size_t I> const auto &get() const { return std::get<I>(m_policies); }
+
+    private:
+        std::tuple<Policies...> m_policies;
+
+        template<typename F>
+        void each(F &&f)
+        {
+            std::apply([&](auto &...policies)
+            {
+                ([&](auto &policy)
+                {
+                    if constexpr (std::remove_reference_t<decltype(policy)>::enabled)
+                    {
+                        f(policy);
+                    }
+                }(policies), ...);
+            }, m_policies);
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_INSTRUMENTATION_HPP
@@ -0,0 +1,311 @@
+#ifndef INCLUDED_MARKETDATA_HPP
+#define INCLUDED_MARKETDATA_HPP
+
+//
+// Market data publishing into shared memory for local consumers
+//
+//      // Engine
+//      OrderBook<MyOrder, PriceLevelStackBookSidePolicy<>, MarketDataPublisher<>> book;
+//      book.instrumentation().open("/book.EURUSD");
+//      ...
+//      book.accept_order(order);                           // Updates published as book changes
+//      book.instrumentation().publish_snapshot(book);      // e.g. every few milliseconds
+//
+//      // Strategy, risk, recorder... in other processes
+//      MarketDataSubscriber<> feed("/book.EURUSD");
+//      MarketDataMessage msg;
+//      switch (feed.next(msg))
+//      {
+//          case util::ShmReadStatus::Ok: ...               // Apply msg
+//          case util::ShmReadStatus::Empty: ...            // Nothing new
+//          case util::ShmReadStatus::Overrun:              // Too slow, start over from snapshot
+//              feed.recover(snapshot);
+//      }
+//
+// Publisher is instrumentation policy of `OrderBook`, and it writes L2 level
+// updates (total displayed quantity at price, zero when level goes away) and
+// trades (aggressor side, price and quantity, or `MarketDataAuction` flag for
+// trades at uncross, which have no aggressor) into `util::ShmRing`, with one
+// writer, and any number of readers, none of which makes a syscall per
+// message. Sequence number of message is its position in the ring.
+//
+// Reader that falls behind more than ring capacity is overrun, and then it
+// loads the last snapshot of top `Depth` levels, and continues from the
+// first message published after that snapshot.
+//
+// NOTE: Snapshot holds only top `Depth` levels of each side, while updates
+// are published for every level, so that reader which has recovered knows
+// nothing of deeper levels until they change. Side which had more levels
+// than that is flagged `MarketDataBidsTruncated` or `MarketDataAsksTruncated`
+// in the snapshot, and then levels beyond its count are unknown, and not
+// absent.
+//
+// NOTE: Hidden quantity of icebergs is not published.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "flightrecorder.hpp"
+#include "instrumentation.hpp"
+#include "traits.hpp"
+
+#include "util/shmring.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+
+namespace sadhbhcraft::orderbook
+{
+    enum class MarketDataType : std::uint8_t
+    {
+        LevelUpdate = 1,    // Total quantity at price is now `quantity`, and zero means level was removed
+        Trade               // Aggressor of `side` has traded `quantity` at `price`
+    };
+
+    enum MarketDataFlags : std::uint8_t
+    {
+        MarketDataAuction = 4,          // Trade at uncross, which has no aggressor, and side is Buy
+        MarketDataBidsTruncated = 8,    // Snapshot has only top `Depth` of more bid levels
+        MarketDataAsksTruncated = 16    // Snapshot has only top `Depth` of more ask levels
+    };
+
+    // Numbers are encoded same as in `TraceEvent` (see `encode_trace_number`)
+    struct MarketDataMessage
+    {
+        std::int64_t price;
+        std::int64_t quantity;
+        MarketDataType type;
+        std::uint8_t side;
+        std::uint8_t flags;
+    };
+
+    static_assert(sizeof(MarketDataMessage) == 24);
+    static_assert(std::is_trivially_copyable_v<MarketDataMessage>);
+
+    struct MarketDataLevel
+    {
+        std::int64_t price;
+        std::int64_t quantity;
+    };
+
+    template<std::size_t Depth>
+    struct MarketDataSnapshot
+    {
+        std::uint64_t sequence;     // Number of messages published before snapshot was taken
+        std::uint32_t bid_count;
+        std::uint32_t ask_count;
+        std::uint8_t flags;         // Float encoding, and which side is truncated
+        MarketDataLevel bids[Depth];
+        MarketDataLevel asks[Depth];
+    };
+
+    // Layout of shared memory object
+    template<std::size_t Capacity, std::size_t Depth>
+    struct MarketDataRegion
+    {
+        typedef util::ShmRing<MarketDataMessage, Capacity> RingType;
+        typedef MarketDataSnapshot<Depth> SnapshotType;
+
+        RingType ring;
+        util::SeqlockCell<SnapshotType> snapshot;
+
+        static MarketDataRegion &create(void *memory)
+        {
+            auto *region = ::new (memory) MarketDataRegion;
+            RingType::create(&region->ring);
+            region->snapshot.version.store(0, std::memory_order_release);
+            return *region;
+        }
+
+        static const MarketDataRegion *attach(const void *memory, std::size_t size)
+        {
+            if (size < sizeof(MarketDataRegion) || !RingType::attach(memory, size))
+            {
+                return nullptr;
+            }
+            return static_cast<const MarketDataRegion *>(memory);
+        }
+    };
+
+    template<std::size_t Capacity = 65536, std::size_t Depth = 16>
+    class MarketDataPublisher : public InstrumentationHooks
+    {
+    public:
+        typedef MarketDataRegion<Capacity, Depth> RegionType;
+        typedef typename RegionType::SnapshotType SnapshotType;
+
+        // Creates shared memory object, and returns false if that failed.
+        // Nothing is published until it's open.
+        bool open(const char *name)
+        {
+            m_memory = std::make_unique<util::SharedMemory>(name, sizeof(RegionType));
+            if (!m_memory->is_open())
+            {
+                m_memory.reset();
+                m_region = nullptr;
+                return false;
+            }
+            m_region = &RegionType::create(m_memory->data());
+            return true;
+        }
+
+        bool is_open() const { return m_region != nullptr; }
+
+        // Removes shared memory object, and readers still mapping it keep it
+        void close()
+        {
+            if (m_memory)
+            {
+                m_memory->unlink();
+                m_memory.reset();
+            }
+            m_region = nullptr;
+        }
+
+        // Number of messages published so far
+        std::uint64_t sequence() const { return m_region ? m_region->ring.write_sequence() : 0; }
+
+        template<typename ExecutionType>
+        void on_execution(const ExecutionType &executed)
+        {
+            if (m_region)
+            {
+                const Side aggressor_side = (executed.order().side == Side::Buy ? Side::Sell : Side::Buy);
+                publish(MarketDataType::Trade, aggressor_side, price_of(executed), quantity_of(executed));
+            }
+        }
+
+        template<typename TradeType>
+        void on_auction_trade(const TradeType &trade)
+        {
+            if (m_region)
+            {
+                publish(MarketDataType::Trade, Side::Buy, trade.price, trade.quantity, MarketDataAuction);
+            }
+        }
+
+        template<typename PriceType, typename QuantityType>
+        void on_level_update(Side side, PriceType price, QuantityType quantity)
+        {
+            if (m_region)
+            {
+                publish(MarketDataType::LevelUpdate, side, price, quantity);
+            }
+        }
+
+        template<typename PriceType>
+        void on_level_erased(Side side, PriceType price)
+        {
+            if (m_region)
+            {
+                publish(MarketDataType::LevelUpdate, side, price, 0);
+            }
+        }
+
+        // Publishes top levels of the book, as of the last message published
+        template<typename BookType>
+        void publish_snapshot(const BookType &book)
+        {
+            if (!m_region)
+            {
+                return;
+            }
+            SnapshotType snapshot{};
+            snapshot.sequence = m_region->ring.write_sequence();
+            snapshot.bid_count = take_levels(book.bid(), snapshot.bids, snapshot.flags, MarketDataBidsTruncated);
+            snapshot.ask_count = take_levels(book.ask(), snapshot.asks, snapshot.flags, MarketDataAsksTruncated);
+            m_region->snapshot.store(snapshot);
+        }
+
+    private:
+        std::unique_ptr<util::SharedMemory> m_memory;
+        RegionType *m_region = nullptr;
+
+        template<typename PriceType, typename QuantityType>
+        void publish(MarketDataType type, Side side, PriceType price, QuantityType quantity, std::uint8_t flags = 0)
+        {
+            MarketDataMessage message{};
+            message.type = type;
+            message.flags = flags;
+            message.side = static_cast<std::uint8_t>(side);
+            message.price = encode_trace_number(price, message.flags, TracePriceIsFloat);
+            message.quantity = encode_trace_number(quantity, message.flags, TraceQuantityIsFloat);
+            m_region->ring.push(message);
+        }
+
+        template<typename BookSideType>
+        static std::uint32_t take_levels(const BookSideType &book_side, MarketDataLevel *levels, std::uint8_t &flags, std::uint8_t truncated)
+        {
+            std::uint32_t count = 0;
+            auto it = book_side.begin();
+            for (; it != book_side.end() && count != Depth; ++it, ++count)
+            {
+                levels[count].price = encode_trace_number(it->price(), flags, TracePriceIsFloat);
+                levels[count].quantity = encode_trace_number(it->total_quantity(), flags, TraceQuantityIsFloat);
+            }
+            if (it != book_side.end())
+            {
+                flags |= truncated;
+            }
+            return count;
+        }
+    };
+
+    template<std::size_t Capacity = 65536, std::size_t Depth = 16>
+    class MarketDataSubscriber
+    {
+    public:
+        typedef MarketDataRegion<Capacity, Depth> RegionType;
+        typedef typename RegionType::SnapshotType SnapshotType;
+
+        // Maps shared memory object read-only, and starts from the next
+        // message published
+        explicit MarketDataSubscriber(const char *name) : m_memory(name)
+        {
+            m_region = RegionType::attach(m_memory.data(), m_memory.size());
+            if (m_region)
+            {
+                m_reader.emplace(m_region->ring);
+            }
+        }
+
+        // False if object doesn't exist, or publisher has different layout.
+        // Subscriber that isn't open has nothing to read, and never recovers.
+        bool is_open() const { return m_region != nullptr; }
+
+        // Sequence number of the next message to read
+        std::uint64_t sequence() const { return m_reader ? m_reader->sequence() : 0; }
+        std::uint64_t lag() const { return m_reader ? m_reader->lag() : 0; }
+
+        util::ShmReadStatus next(MarketDataMessage &message)
+        {
+            return m_reader ? m_reader->read(message) : util::ShmReadStatus::Empty;
+        }
+
+        // Loads the last snapshot, and continues from the first message
+        // after it. Returns false if there is no snapshot yet, or messages
+        // after it were overwritten too, and then try again later.
+        bool recover(SnapshotType &snapshot)
+        {
+            if (!m_region || !m_region->snapshot.load(snapshot) || snapshot.sequence + Capacity < m_region->ring.write_sequence())
+            {
+                return false;
+            }
+            m_reader->seek(snapshot.sequence);
+            return true;
+        }
+
+    private:
+        util::SharedMemory m_memory;
+        const RegionType *m_region = nullptr;
+        std::optional<util::ShmRingReader<MarketDataMessage, Capacity>> m_reader;
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_MARKETDATA_HPP
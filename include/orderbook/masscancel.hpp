@@ -0,0 +1,191 @@
+#ifndef INCLUDED_MASSCANCEL_HPP
+#define INCLUDED_MASSCANCEL_HPP
+
+//
+// Mass cancel of resting orders by side, price range and owner
+//
+//      book.cancel_orders({.side = Side::Buy, .min_price = 100});
+//      book.cancel_owner_orders(42);
+//      for (auto &oq : book.mass_cancels()) { ... }
+//
+// Orders are removed in one pass over each level affected, and levels left
+// empty are erased.
+//
+// Order types can opt in for owner index by having `owner_hook` member:
+//
+//      struct MyOrder
+//      {
+//          ...
+//          int owner;
+//          OwnerIndexHook<MyOrder> owner_hook;
+//      };
+//
+// Then book links each resting order into intrusive list of its owner, and
+// cancelling orders of an owner only visits levels holding owner's orders,
+// instead of scanning the whole book. Order leaves the list in O(1) when it
+// leaves the book.
+//
+// NOTE: Positions in level queues aren't stable (e.g. `SmallQueue` moves
+// orders around), and that's why the list holds orders and not their queue
+// slots, and each affected level is still compacted in one pass.
+// Prices of those levels are sorted, and each side is swept once (see
+// `PriceLevelStack::cancel_orders_at()`), and so cancel isn't O(orders
+// cancelled), but O(orders on affected levels) plus moving levels from the
+// first one emptied to the last affected.
+//
+// NOTE: Owner index needs integral owner, and owner with all bits set, e.g.
+// -1, is reserved (see `util::FlatHashMap`). Orders of reserved owner are
+// not linked, and cancelling them scans the book.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "traits.hpp"
+
+#include "util/flatmap.hpp"
+
+#include <concepts>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <type_traits>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<OrderConcept OrderType>
+    struct MassCancelFilter
+    {
+        typedef typename OrderType::PriceType PriceType;
+
+        std::optional<Side> side;               // Both sides if not set
+        std::optional<PriceType> min_price;     // Inclusive, unbounded if not set
+        std::optional<PriceType> max_price;     // Inclusive, unbounded if not set
+
+        bool matches_side(Side s) const { return !side || *side == s; }
+
+        PriceType low() const { return min_price ? *min_price : std::numeric_limits<PriceType>::lowest(); }
+        PriceType high() const { return max_price ? *max_price : std::numeric_limits<PriceType>::max(); }
+
+        bool matches(const OrderType &order) const
+        {
+            return matches_side(order.side) && !(price_of(order) < low()) && !(high() < price_of(order));
+        }
+    };
+
+    // Intrusive node of circular doubly linked list. Copy of an order is not
+    // on the book, so that copying gives node that isn't linked.
+    template<typename OrderType>
+    class OwnerIndexHook
+    {
+    public:
+        OwnerIndexHook() noexcept = default;
+        OwnerIndexHook(const OwnerIndexHook &) noexcept {}
+        OwnerIndexHook &operator=(const OwnerIndexHook &) noexcept { return *this; }
+        ~OwnerIndexHook() { unlink(); }
+
+        bool is_linked() const { return m_next != nullptr; }
+
+        void unlink()
+        {
+            if (m_next)
+            {
+                m_prev->m_next = m_next;
+                m_next->m_prev = m_prev;
+                m_prev = m_next = nullptr;
+            }
+        }
+
+    private:
+        template<typename> friend class OwnerIndex;
+
+        OwnerIndexHook *m_prev = nullptr;
+        OwnerIndexHook *m_next = nullptr;
+        OrderType *m_order = nullptr;
+    };
+
+    template<typename T>
+    concept OwnerIndexedOrderConcept =
+        OwnedOrderConcept<T> &&
+        std::integral<decltype(owner_of(std::declval<const T &>()))> &&
+        requires(T &x) {
+            { x.owner_hook } -> std::same_as<OwnerIndexHook<T> &>;
+        };
+
+    // Called whenever order leaves the book
+    template<OrderConcept OrderType>
+    void unlink_owner_index(OrderType &order)
+    {
+        if constexpr (OwnerIndexedOrderConcept<OrderType>)
+        {
+            order.owner_hook.unlink();
+        }
+    }
+
+    template<typename OrderType>
+    class OwnerIndex
+    {
+    };
+
+    template<OwnerIndexedOrderConcept OrderType>
+    class OwnerIndex<OrderType>
+    {
+    public:
+        typedef decltype(owner_of(std::declval<const OrderType &>())) OwnerType;
+        typedef OwnerIndexHook<OrderType> HookType;
+
+        static bool is_indexed(OwnerType owner) { return !util::FlatHashMap<KeyType, HookType *>::is_reserved(key_of(owner)); }
+
+        // Returns false, and leaves order unlinked, if owner is reserved
+        bool link(OrderType &order)
+        {
+            auto [head, inserted] = m_heads.try_emplace(key_of(owner_of(order)));
+            if (!head)
+            {
+                order.owner_hook.unlink();
+                return false;
+            }
+            if (inserted)
+            {
+                // List heads are never freed, and they don't move
+                HookType &sentinel = m_sentinels.emplace_back();
+                sentinel.m_prev = sentinel.m_next = &sentinel;
+                *head = &sentinel;
+            }
+
+            HookType &hook = order.owner_hook;
+            HookType &sentinel = **head;
+            hook.unlink();
+            hook.m_order = &order;
+            hook.m_prev = sentinel.m_prev;
+            hook.m_next = &sentinel;
+            sentinel.m_prev->m_next = &hook;
+            sentinel.m_prev = &hook;
+            return true;
+        }
+
+        // Visits resting orders of the owner in the order they were linked.
+        // Handler must not unlink orders.
+        template<typename Handler>
+        void for_each(OwnerType owner, Handler &&handler) const
+        {
+            if (auto head = m_heads.find(key_of(owner)))
+            {
+                for (HookType *hook = (*head)->m_next; hook != *head; hook = hook->m_next)
+                {
+                    handler(*hook->m_order);
+                }
+            }
+        }
+
+    private:
+        typedef std::make_unsigned_t<OwnerType> KeyType;
+
+        util::FlatHashMap<KeyType, HookType *> m_heads;
+        std::deque<HookType> m_sentinels;
+
+        static KeyType key_of(OwnerType owner) { return static_cast<KeyType>(owner); }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_MASSCANCEL_HPP
@@ -2,10 +2,27 @@
 #define INCLUDED_ORDERBOOK_HPP
 
 #include "enums.hpp"
+#include "analytics.hpp"
+#include "auction.hpp"
 #include "concepts.hpp"
+#include "expiry.hpp"
+#include "instrumentation.hpp"
+#include "masscancel.hpp"
 #include "pricelevelstack.hpp"
+#include "compact.hpp"
+#include "proratalevel.hpp"
+#include "queuerank.hpp"
+#include "triggerbook.hpp"
 #include "util/async.hpp"
 #include "util/generator.hpp"
+#include "util/smallqueue.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
 
 
 namespace sadhbhcraft::orderbook
@@ -25,12 +42,15 @@ namespace sadhbhcraft::orderbook
 
     template<
         OrderConcept _OrderType = Order<>,
-        typename OrderBookSidePolicy = PriceLevelStackBookSidePolicy<>
+        typename OrderBookSidePolicy = PriceLevelStackBookSidePolicy<>,
+        typename InstrumentationPolicy = NoStats
         >
     class OrderBook
     {
     public:
         typedef _OrderType OrderType;
+        typedef InstrumentationPolicy Instrumentation;
+        typedef AuctionResult<typename OrderType::PriceType, typename OrderType::QuantityType> AuctionResultType;
         template<Side MySide, OrderConcept OrderType>
         using OrderBookSideType = typename OrderBookSidePolicy::OrderBookSideType<MySide, OrderType>;
         using BidBookSideType = OrderBookSideType<Side::Buy, OrderType>;
@@ -41,49 +61,530 @@ namespace sadhbhcraft::orderbook
         util::Generator<OrderQuantity<OrderType>>
         accept_order(OrderType &order, ExecutionPolicy &&execution_policy = {})
         {
-            if (order.side == Side::Buy)
+            return do_accept_order(order, std::forward<ExecutionPolicy>(execution_policy));
+        }
+
+        const auto &bid() const { return m_bid; }
+        const auto &ask() const { return m_ask; }
+        const auto &stops() const { return m_stops; }
+
+        // Orders of the same owner can be prevented from matching each other
+        // if order type has owner (see `OwnerTrait`)
+        void set_self_trade_prevention(SelfTradePrevention mode) { m_self_trade.mode = mode; }
+        SelfTradePrevention self_trade_prevention() const { return m_self_trade.mode; }
+
+        // Orders cancelled by the last `accept_order()` to prevent self-trade
+        // with quantity that was cancelled
+        const auto &self_trade_cancels() const { return m_self_trade.cancelled; }
+
+        // Execution policy calls this when aggressor can't trade any more,
+        // e.g. its account reached risk limit. Matching stops after execution
+        // being checked, and the rest of the aggressor is cancelled, while
+        // resting order keeps quantity that wasn't executed.
+        void stop_aggressor() { m_self_trade.aggressor_stopped = true; }
+
+        // Aggressors stopped by execution policy in the last `accept_order()`
+        // with quantity that was cancelled
+        const auto &stopped_aggressors() const { return m_stopped; }
+
+        // Price of the last execution, which is what triggers stop orders
+        auto last_trade_price() const { return m_last_trade_price; }
+
+        // Order currently matched by `accept_order()` -- this is either the
+        // order passed in, or one of the stop orders it has triggered.
+        const OrderType *aggressor() const { return m_aggressor; }
+        OrderType *aggressor() { return m_aggressor; }
+
+        // In auction phase limit orders rest on the book without matching,
+        // and the book may be crossed until `uncross()`. Market, IOC and FOC
+        // orders are not accepted, and they are dropped without executions.
+        void set_trading_phase(TradingPhase phase) { m_phase = phase; }
+        TradingPhase trading_phase() const { return m_phase; }
+
+        // Indicative price and volume, if auction was uncrossed now (see
+        // `AuctionCalculator`). Last trade price is the reference price.
+        AuctionResultType auction_equilibrium()
+        {
+            return m_auction.compute(m_bid, m_ask, m_last_trade_price);
+        }
+
+        // Executes all orders crossing at equilibrium price, at that price,
+        // in price-time priority on both sides, and switches book back to
+        // continuous trading. Book is uncrossed as soon as generator is first
+        // resumed, and trades are yielded after.
+        // NOTE: Stop orders are not triggered by auction price, but next
+        // stop accepted is checked against it.
+        util::Generator<AuctionTrade<OrderType>> uncross()
+        {
+            return do_uncross();
+        }
+
+        // Cancels resting orders on given side, or both, with price in given
+        // range, and returns number of orders cancelled. Each affected level
+        // is visited once. Stop orders waiting for trigger are not cancelled.
+        std::size_t cancel_orders(const MassCancelFilter<OrderType> &filter = {})
+        {
+            return do_cancel_orders(filter, [](const OrderType &) { return true; });
+        }
+
+        // Cancels resting orders of given owner, which also match the filter.
+        // If order type has `owner_hook` (see `OwnerIndexHook`), then only
+        // levels holding owner's orders are visited.
+        template<typename OwnerType>
+        requires OwnedOrderConcept<OrderType>
+        std::size_t cancel_owner_orders(const OwnerType &owner, const MassCancelFilter<OrderType> &filter = {})
+        {
+            auto is_owner = [&owner](const OrderType &order) { return owner_of(order) == owner; };
+
+            if constexpr (OwnerIndexedOrderConcept<OrderType>)
             {
-                return do_accept_order(order, m_ask, m_bid, std::forward<ExecutionPolicy>(execution_policy));
+                if (!OwnerIndex<OrderType>::is_indexed(owner))
+                {
+                    // Orders of reserved owner aren't in the index
+                    return do_cancel_orders(filter, is_owner);
+                }
+
+                m_mass_cancels.clear();
+                m_affected_bids.clear();
+                m_affected_asks.clear();
+                m_owner_index.for_each(owner, [&](const OrderType &order)
+                {
+                    if (filter.matches(order))
+                    {
+                        affected_prices(order.side).push_back(price_of(order));
+                    }
+                });
+                return cancel_at_prices(is_owner, m_mass_cancels);
             }
             else
             {
-                return do_accept_order(order, m_bid, m_ask, std::forward<ExecutionPolicy>(execution_policy));
+                return do_cancel_orders(filter, is_owner);
             }
         }
 
-        const auto &bid() const { return m_bid; }
-        const auto &ask() const { return m_ask; }
+        // Orders cancelled by the last mass cancel with quantity that was
+        // cancelled
+        const auto &mass_cancels() const { return m_mass_cancels; }
+
+        // Cancels resting orders with expire time up to `now`, and returns
+        // number of orders cancelled. Only levels holding orders due are
+        // visited, in one sweep of each side, and each of them is compacted
+        // in one pass over its orders (see `ExpiryIndex`). Time doesn't go back, and so earlier time than
+        // before cancels nothing.
+        // NOTE: Must not be called while generator of `accept_order()` is
+        // active.
+        std::size_t expire_orders(std::uint64_t now) requires ExpiringOrderConcept<OrderType>
+        {
+            m_expired.clear();
+            m_affected_bids.clear();
+            m_affected_asks.clear();
+            m_expiry.advance(now, [this](const OrderType &order)
+            {
+                affected_prices(order.side).push_back(price_of(order));
+            });
+            return cancel_at_prices(&ExpiryIndex<OrderType>::is_due, m_expired);
+        }
+
+        template<ClockConcept Clock>
+        requires ExpiringOrderConcept<OrderType>
+        std::size_t expire_orders(const Clock &clock)
+        {
+            return expire_orders(static_cast<std::uint64_t>(clock.now()));
+        }
+
+        // Orders cancelled by the last `expire_orders()`, or the order dropped
+        // by the last `accept_order()` because it had already expired, with
+        // quantity that was cancelled
+        const auto &expired_orders() const { return m_expired; }
+
+        // Orders, and displayed quantity, ahead of resting order in queue of
+        // its level in O(log n) (see `QueueRank`), or nothing if there's no
+        // level at its price
+        // NOTE: Order must be resting on this book.
+        std::optional<QueuePosition<typename OrderType::QuantityType>>
+        queue_position(const OrderType &order) const requires RankedOrderConcept<OrderType>
+        {
+            if (order.side == Side::Buy)
+            {
+                return queue_position_on(m_bid, order);
+            }
+            return queue_position_on(m_ask, order);
+        }
+
+        // Imbalance, depth within ticks of the top, and microprice, which
+        // book sides keep up to date (see `AnalyticsBookSide`)
+        BookAnalytics<BidBookSideType, AskBookSideType> analytics() const requires AnalyticsBookSideConcept<BidBookSideType>
+        {
+            return {m_bid, m_ask};
+        }
+
+        // Counters and histograms of this book (see `HotPathStats`)
+        const Instrumentation &instrumentation() const { return m_instrumentation; }
+        Instrumentation &instrumentation() { return m_instrumentation; }
 
     private:
         BidBookSideType m_bid;
         AskBookSideType m_ask;
+        typename StopBookOf<OrderBookSidePolicy, OrderType>::type m_stops;
+        util::SmallQueue<std::reference_wrapper<OrderType>, 1> m_triggered;
+        std::optional<typename OrderType::PriceType> m_last_trade_price;
+        OrderType *m_aggressor = nullptr;
+        SelfTradeCheck<OrderType> m_self_trade;
+        std::vector<OrderQuantity<OrderType>> m_stopped;
+        [[no_unique_address]] Instrumentation m_instrumentation;
+        TradingPhase m_phase = TradingPhase::Continuous;
+        AuctionCalculator<typename OrderType::PriceType, typename OrderType::QuantityType> m_auction;
+        std::vector<OrderQuantity<OrderType>> m_auction_buys;
+        std::vector<OrderQuantity<OrderType>> m_auction_sells;
+        [[no_unique_address]] OwnerIndex<OrderType> m_owner_index;
+        std::vector<OrderQuantity<OrderType>> m_mass_cancels;
+        std::vector<typename OrderType::PriceType> m_affected_bids;
+        std::vector<typename OrderType::PriceType> m_affected_asks;
+        [[no_unique_address]] ExpiryIndex<OrderType> m_expiry;
+        std::vector<OrderQuantity<OrderType>> m_expired;
+
+        template <ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy>
+        util::Generator<OrderQuantity<OrderType>>
+        match_order(OrderType &order, ExecutionPolicy &&execution_policy)
+        {
+            // Execution policy may stop the aggressor, and so outcome of
+            // matching is tracked even without self-trade prevention
+            m_self_trade.aggressor_cancelled = false;
+            m_self_trade.aggressor_stopped = false;
+            SelfTradeCheck<OrderType> *self_trade = &m_self_trade;
+
+            if constexpr (Instrumentation::enabled)
+            {
+                if (order.side == Side::Buy)
+                {
+                    return m_ask.match_order(order, std::forward<ExecutionPolicy>(execution_policy), self_trade, &m_instrumentation);
+                }
+                else
+                {
+                    return m_bid.match_order(order, std::forward<ExecutionPolicy>(execution_policy), self_trade, &m_instrumentation);
+                }
+            }
+            else
+            {
+                if (order.side == Side::Buy)
+                {
+                    return m_ask.match_order(order, std::forward<ExecutionPolicy>(execution_policy), self_trade);
+                }
+                else
+                {
+                    return m_bid.match_order(order, std::forward<ExecutionPolicy>(execution_policy), self_trade);
+                }
+            }
+        }
+
+        void add_order(OrderType &order, typename OrderType::QuantityType quantity)
+        {
+            if constexpr (OwnerIndexedOrderConcept<OrderType>)
+            {
+                m_owner_index.link(order);
+            }
+            if constexpr (ExpiringOrderConcept<OrderType>)
+            {
+                m_expiry.link(order);
+            }
+
+            if constexpr (Instrumentation::enabled)
+            {
+                if (order.side == Side::Buy)
+                {
+                    m_bid.add_order(order, quantity, &m_instrumentation);
+                }
+                else
+                {
+                    m_ask.add_order(order, quantity, &m_instrumentation);
+                }
+            }
+            else
+            {
+                if (order.side == Side::Buy)
+                {
+                    m_bid.add_order(order, quantity);
+                }
+                else
+                {
+                    m_ask.add_order(order, quantity);
+                }
+            }
+        }
+
+        static void activate_stop(OrderType &order)
+        {
+            if (order.order_type == orderbook::OrderType::Stop)
+            {
+                order.order_type = orderbook::OrderType::Market;
+            }
+            else if (order.order_type == orderbook::OrderType::StopLimit)
+            {
+                order.order_type = orderbook::OrderType::Limit;
+            }
+        }
 
-        template <
-            OrderBookSideConcept MatchSideType,
-            OrderBookSideConcept AddSideType,
-            ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy>
+        template <ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy>
         util::Generator<OrderQuantity<OrderType>>
         do_accept_order(
             OrderType &order,
-            MatchSideType &match_side,
-            AddSideType &add_side,
             ExecutionPolicy &&execution_policy)
         {
-            auto executions = match_side.match_order(order, std::forward<ExecutionPolicy>(execution_policy));
-            typename OrderType::QuantityType matched_quantity = 0;
-            while (executions)
+            m_self_trade.cancelled.clear();
+            m_stopped.clear();
+
+            if constexpr (Instrumentation::enabled)
+            {
+                m_instrumentation.on_accept_order(order);
+            }
+
+            if constexpr (ExpiringOrderConcept<OrderType>)
+            {
+                m_expired.clear();
+                if (m_expiry.is_expired(order))
+                {
+                    m_expired.emplace_back(order, order.quantity);
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        m_instrumentation.on_accept_order_done(order);
+                    }
+                    co_return;
+                }
+            }
+
+            if (is_stop_order_type(order.order_type))
+            {
+                if (!m_stops.is_crossed(order, m_last_trade_price))
+                {
+                    m_stops.add_order(order);
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        m_instrumentation.on_accept_order_done(order);
+                    }
+                    co_return;
+                }
+                activate_stop(order);
+            }
+
+            if (m_phase == TradingPhase::Auction)
+            {
+                if (order.order_type == orderbook::OrderType::Limit)
+                {
+                    add_order(order, order.quantity);
+                }
+                if constexpr (Instrumentation::enabled)
+                {
+                    m_instrumentation.on_accept_order_done(order);
+                }
+                co_return;
+            }
+
+            // Stops triggered by trades are queued, and then matched one by
+            // one after the order that triggered them. Each stop leaves
+            // trigger book when triggered, so cascade ends after at most as
+            // many steps as there were stops resting.
+            for (OrderType *aggressor = &order; aggressor; )
+            {
+                m_aggressor = aggressor;
+
+                auto executions = match_order(*aggressor, std::forward<ExecutionPolicy>(execution_policy));
+                typename OrderType::QuantityType matched_quantity = 0;
+                while (co_await executions.next())
+                {
+                    auto executed = executions();
+                    const auto trade_price = price_of(executed);
+                    m_last_trade_price = trade_price;
+                    if (m_stops.is_triggered(trade_price))
+                    {
+                        m_stops.take_triggered(trade_price, m_triggered);
+                    }
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        m_instrumentation.on_execution(executed);
+                    }
+                    co_yield executed;
+                    matched_quantity += quantity_of(executed);
+                }
+                auto quantity_remaining = aggressor->quantity - matched_quantity;
+
+                if (quantity_remaining && m_self_trade.aggressor_cancelled)
+                {
+                    m_self_trade.aggressor_cancelled = false;
+                    m_self_trade.cancelled.emplace_back(*aggressor, quantity_remaining);
+                }
+                else if (quantity_remaining && m_self_trade.aggressor_stopped)
+                {
+                    m_stopped.emplace_back(*aggressor, quantity_remaining);
+                }
+                else if (quantity_remaining && (aggressor->order_type == orderbook::OrderType::Limit))
+                {
+                    add_order(*aggressor, quantity_remaining);
+                }
+
+                if (m_triggered.empty())
+                {
+                    aggressor = nullptr;
+                }
+                else
+                {
+                    aggressor = &m_triggered.front().get();
+                    m_triggered.pop_front();
+                    activate_stop(*aggressor);
+                }
+            }
+
+            m_aggressor = nullptr;
+            if constexpr (Instrumentation::enabled)
             {
-                auto executed = executions();
-                co_yield executed;
-                matched_quantity += quantity_of(executed);
+                m_instrumentation.on_accept_order_done(order);
             }
-            auto quantity_remaining = order.quantity - matched_quantity;
+            co_return;
+        }
+
+        template<typename Predicate>
+        std::size_t do_cancel_orders(const MassCancelFilter<OrderType> &filter, Predicate &&predicate)
+        {
+            m_mass_cancels.clear();
+            return cancel_on_side(filter, predicate, m_mass_cancels);
+        }
 
-            if (quantity_remaining && (order.order_type == orderbook::OrderType::Limit))
+        template<typename Predicate, typename Output>
+        std::size_t cancel_on_side(const MassCancelFilter<OrderType> &filter, Predicate &&predicate, Output &cancelled)
+        {
+            std::size_t count = 0;
+            if (filter.matches_side(Side::Buy))
+            {
+                count += cancel_on_side(m_bid, filter, predicate, cancelled);
+            }
+            if (filter.matches_side(Side::Sell))
             {
-                add_side.add_order(order, quantity_remaining);
+                count += cancel_on_side(m_ask, filter, predicate, cancelled);
             }
+            return count;
+        }
 
+        template<typename BookSide, typename Predicate, typename Output>
+        std::size_t cancel_on_side(BookSide &book_side, const MassCancelFilter<OrderType> &filter, Predicate &&predicate, Output &cancelled)
+        {
+            if constexpr (Instrumentation::enabled)
+            {
+                return book_side.cancel_orders_if(filter.low(), filter.high(), predicate, cancelled, &m_instrumentation);
+            }
+            else
+            {
+                return book_side.cancel_orders_if(filter.low(), filter.high(), predicate, cancelled);
+            }
+        }
+
+        auto &affected_prices(Side side)
+        {
+            return (side == Side::Buy ? m_affected_bids : m_affected_asks);
+        }
+
+        // Each side is swept once over prices of levels affected, which are
+        // collected in any order, and may repeat
+        template<typename Predicate, typename Output>
+        std::size_t cancel_at_prices(Predicate &&predicate, Output &cancelled)
+        {
+            return cancel_at_prices<Side::Buy>(m_bid, m_affected_bids, predicate, cancelled)
+                + cancel_at_prices<Side::Sell>(m_ask, m_affected_asks, predicate, cancelled);
+        }
+
+        template<Side MySide, typename BookSide, typename Prices, typename Predicate, typename Output>
+        std::size_t cancel_at_prices(BookSide &book_side, Prices &prices, Predicate &&predicate, Output &cancelled)
+        {
+            if (prices.empty())
+            {
+                return 0;
+            }
+            std::sort(prices.begin(), prices.end(), PriceLevelCompare<MySide>());
+            prices.erase(std::unique(prices.begin(), prices.end()), prices.end());
+
+            if constexpr (Instrumentation::enabled)
+            {
+                return book_side.cancel_orders_at(prices, predicate, cancelled, &m_instrumentation);
+            }
+            else
+            {
+                return book_side.cancel_orders_at(prices, predicate, cancelled);
+            }
+        }
+
+        template<typename BookSide>
+        static std::optional<QueuePosition<typename OrderType::QuantityType>>
+        queue_position_on(const BookSide &book_side, const OrderType &order)
+        {
+            if (const auto *level = book_side.find_level(price_of(order)))
+            {
+                return level->queue_position(order);
+            }
+            return std::nullopt;
+        }
+
+        template<typename Output, typename BookSide>
+        void fill_auction_side(Output &fills, BookSide &book_side, typename OrderType::PriceType price, typename OrderType::QuantityType volume)
+        {
+            fills.clear();
+            if constexpr (Instrumentation::enabled)
+            {
+                book_side.fill_orders(price, volume, fills, &m_instrumentation);
+            }
+            else
+            {
+                book_side.fill_orders(price, volume, fills);
+            }
+        }
+
+        util::Generator<AuctionTrade<OrderType>> do_uncross()
+        {
+            const auto equilibrium = auction_equilibrium();
+            m_phase = TradingPhase::Continuous;
+            if (!equilibrium)
+            {
+                co_return;
+            }
+            m_last_trade_price = equilibrium.price;
+
+            // Both sides have at least the volume on levels crossing the
+            // price, and so each side is filled in one pass, and then fills
+            // are paired up.
+            fill_auction_side(m_auction_buys, m_bid, equilibrium.price, equilibrium.volume);
+            fill_auction_side(m_auction_sells, m_ask, equilibrium.price, equilibrium.volume);
+
+            auto buy = m_auction_buys.begin();
+            auto sell = m_auction_sells.begin();
+            typename OrderType::QuantityType buy_left = buy->quantity;
+            typename OrderType::QuantityType sell_left = sell->quantity;
+
+            for (;;)
+            {
+                const auto quantity = std::min(buy_left, sell_left);
+                AuctionTrade<OrderType> trade{buy->order(), sell->order(), equilibrium.price, quantity};
+                if constexpr (Instrumentation::enabled)
+                {
+                    m_instrumentation.on_auction_trade(trade);
+                }
+                co_yield trade;
+
+                buy_left -= quantity;
+                sell_left -= quantity;
+                if (!buy_left)
+                {
+                    if (++buy == m_auction_buys.end())
+                    {
+                        break;
+                    }
+                    buy_left = buy->quantity;
+                }
+                if (!sell_left)
+                {
+                    if (++sell == m_auction_sells.end())
+                    {
+                        break;
+                    }
+                    sell_left = sell->quantity;
+                }
+            }
             co_return;
         }
     };
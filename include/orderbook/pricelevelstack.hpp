@@ -4,21 +4,43 @@
 #include "enums.hpp"
 #include "concepts.hpp"
 #include "traits.hpp"
+#include "instrumentation.hpp"
+#include "masscancel.hpp"
+#include "expiry.hpp"
+#include "queuerank.hpp"
 
 #include "util/concepts.hpp"
 #include "util/generator.hpp"
 
+#include<cstdint>
 #include<vector>
 #include<deque>
 #include<algorithm>
 #include<set>
 #include<list>
+#include<memory_resource>
+#include<span>
+#include<utility>
 
 
 namespace sadhbhcraft::orderbook
 {
+    // Hidden reserve is only stored for orders that can have it
+    template<OrderConcept OrderType>
+    struct OrderQuantityReserve
+    {
+    };
+
+    template<IcebergOrderConcept OrderType>
+    struct OrderQuantityReserve<OrderType>
+    {
+        typename OrderType::QuantityType hidden_quantity = 0;
+        // ^ Reserve of an iceberg order, which isn't visible on the level.
+        // Displayed quantity is refreshed from here once it is filled.
+    };
+
     template<OrderConcept _OrderType>
-    struct OrderQuantity
+    struct OrderQuantity : OrderQuantityReserve<_OrderType>
     {
         typedef _OrderType OrderType;
         typedef typename _OrderType::QuantityType QuantityType;
@@ -57,6 +79,39 @@ namespace sadhbhcraft::orderbook
         static auto quantity(const OrderQuantity<OrderType> &o) { return o.quantity; }
     };
 
+    // Self-trade prevention settings and outcome of matching an order
+    template<OrderConcept OrderType>
+    struct SelfTradeCheck
+    {
+        SelfTradePrevention mode = SelfTradePrevention::None;
+        bool aggressor_cancelled = false;
+        std::vector<OrderQuantity<OrderType>> cancelled;
+        // ^ Orders cancelled to prevent self-trade, both resting and incoming,
+        // each with quantity that was cancelled.
+
+        bool aggressor_stopped = false;
+        // ^ Execution policy has stopped the aggressor, e.g. its account
+        // reached risk limit, and the rest of the aggressor is cancelled.
+
+        std::vector<OrderQuantity<OrderType>> fills;
+        // ^ Fills of one level planned for batch execution policy (see
+        // `BatchExecutionPolicyConcept`), kept here to reuse the storage.
+
+        bool enabled() const { return mode != SelfTradePrevention::None; }
+        bool aggressor_done() const { return aggressor_cancelled || aggressor_stopped; }
+    };
+
+    // Execution policy, which can also check all fills planned on a level at
+    // once, before any of them is applied. Returns number of fills aggressor
+    // could take in full. Fill at that position holds what aggressor could
+    // still take, and fills after it are not executed. Fills trimmed before
+    // that position cancel the rest of their resting orders.
+    template<typename T, typename OrderType>
+    concept BatchExecutionPolicyConcept =
+        requires(T &x, const OrderType &order, std::span<OrderQuantity<OrderType>> fills) {
+            { x.check_fills(order, fills) } -> std::convertible_to<std::size_t>;
+        };
+
     template<OrderConcept _OrderType, template <typename> class _QueueType>
     requires util::IsQueue<_QueueType, OrderQuantity<_OrderType>>::value
     class OrderPriceLevel
@@ -67,71 +122,234 @@ namespace sadhbhcraft::orderbook
         typedef typename _OrderType::QuantityType QuantityType;
         template<typename T> using QueueType = _QueueType<T>;
 
-        OrderPriceLevel(PriceType price): m_price(price), m_total_quantity(0)
+        OrderPriceLevel(PriceType price): m_price(price), m_total_quantity(0), m_hidden_quantity(0)
         {}
 
         void add_order(OrderType &order, QuantityType quantity)
         {
+            if constexpr (IcebergOrderConcept<OrderType>)
+            {
+                // Only display quantity is queued, and the rest is held in reserve
+                QuantityType display_quantity = display_quantity_of(order);
+                if (display_quantity && display_quantity < quantity)
+                {
+                    auto &oq = m_orders.emplace_back(order, display_quantity);
+                    oq.hidden_quantity = quantity - display_quantity;
+                    m_rank.push(order, display_quantity);
+
+                    m_total_quantity += display_quantity;
+                    m_hidden_quantity += oq.hidden_quantity;
+                    return;
+                }
+            }
+
             m_orders.emplace_back(order, quantity);
+            m_rank.push(order, quantity);
 
             m_total_quantity += quantity;
         }
 
-        template<ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy>
+        template<ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy, typename Instrumentation = NoStats>
         util::Generator<OrderQuantity<OrderType>>
         match_order(
             OrderType &order,
             QuantityType quantity,
-            ExecutionPolicy &&execution_policy)
+            ExecutionPolicy &&execution_policy,
+            SelfTradeCheck<OrderType> *self_trade = nullptr,
+            Instrumentation *instrumentation = nullptr)
         {
-            QuantityType quantity_filled = 0;
-        
-            auto it = m_orders.begin();
-            auto end = m_orders.end();
+            // Self-trade check costs one owner comparison per resting order
+            const bool check_self_trade = (self_trade && self_trade->enabled());
 
-            for (; it != end; ++it)
+            if constexpr (BatchExecutionPolicyConcept<std::remove_cvref_t<ExecutionPolicy>, OrderType>)
             {
+                // Self-trade check needs to look at each order before it's
+                // matched, and so it's only done one by one
+                if (self_trade && !check_self_trade)
+                {
+                    auto fills = match_batches(order, quantity, execution_policy, *self_trade, instrumentation);
+                    while (co_await fills.next())
+                    {
+                        co_yield fills();
+                    }
+                    co_return;
+                }
+            }
+
+            // We always match the first order in the queue, and remove it
+            // once it's done. Refreshed iceberg order goes to the back of the
+            // queue, and we may match it again if it is the only one left.
+            while (quantity && !m_orders.empty())
+            {
+                auto &first_order = m_orders.front();
+
+                if constexpr (Instrumentation::enabled)
+                {
+                    instrumentation->on_order_touched();
+                }
+
+                if constexpr (OwnedOrderConcept<OrderType>)
+                {
+                    if (check_self_trade && owner_of(first_order.order()) == owner_of(order))
+                    {
+                        if (self_trade->mode != SelfTradePrevention::CancelAggressor)
+                        {
+                            cancel_first_order(self_trade->cancelled);
+                        }
+                        if (self_trade->mode != SelfTradePrevention::CancelResting)
+                        {
+                            self_trade->aggressor_cancelled = true;
+                            break;
+                        }
+                        continue;
+                    }
+                }
+
                 // Quantity we should fill on this order
-                QuantityType quantity_to_fill = std::min(quantity, it->quantity);
+                QuantityType quantity_to_fill = std::min(quantity, first_order.quantity);
 
-                OrderQuantity<OrderType> executed{it->order(), quantity_to_fill};
+                OrderQuantity<OrderType> executed{first_order.order(), quantity_to_fill};
                 co_await execution_policy(std::ref(executed));
 
+                // Resting order keeps what aggressor couldn't take
+                const bool aggressor_stopped = (self_trade && self_trade->aggressor_stopped);
                 quantity -= executed.quantity;
-                quantity_filled += executed.quantity;
-                it->quantity -= executed.quantity;
-                m_total_quantity -= executed.quantity;
-                
-                co_yield executed;
+                fill_first_order(executed.quantity, quantity_to_fill, aggressor_stopped);
 
-                // Check if we fully filled incomming order
-                if (!quantity)
+                if (aggressor_stopped)
                 {
-                    // Either there is no quantity left on the order,
-                    // or execution policy has trimmed the order.
-                    // DISCUSSION:
-                    // We could introduce new type for execution instead of using OrderQuantity
-                    // and perhaps have executed_quantity and cancelled_quantity there.
-                    if (!it->quantity || executed.quantity != quantity_to_fill)
+                    if (executed.quantity)
                     {
-                        ++it;
+                        co_yield executed;
                     }
                     break;
                 }
+
+                co_yield executed;
             }
 
-            m_orders.erase(m_orders.begin(), it);
             co_return;
         }
 
+        // Fills orders from the front of the queue in the same order as
+        // match_order() would, but without aggressor, and appends fills to
+        // output. Returns quantity filled.
+        template<typename Output>
+        QuantityType fill_orders(QuantityType quantity, Output &fills)
+        {
+            QuantityType filled = 0;
+            while (filled != quantity && !m_orders.empty())
+            {
+                auto &first_order = m_orders.front();
+                QuantityType quantity_to_fill = std::min(quantity - filled, first_order.quantity);
+
+                fills.emplace_back(first_order.order(), quantity_to_fill);
+                filled += quantity_to_fill;
+                first_order.quantity -= quantity_to_fill;
+                m_total_quantity -= quantity_to_fill;
+                m_rank.reduce(first_order.order(), quantity_to_fill);
+
+                if (!first_order.quantity)
+                {
+                    if constexpr (IcebergOrderConcept<OrderType>)
+                    {
+                        if (first_order.hidden_quantity)
+                        {
+                            replenish_first_order();
+                            continue;
+                        }
+                    }
+                    remove_first_order();
+                }
+            }
+            return filled;
+        }
+
+        // Cancels all orders matching predicate in one pass, keeping the
+        // order of the rest, and appends them to output with quantity that
+        // was cancelled. Returns number of orders cancelled.
+        template<typename Predicate, typename Output>
+        std::size_t cancel_orders_if(Predicate &&predicate, Output &cancelled)
+        {
+            std::size_t count = 0;
+            auto out = m_orders.begin();
+
+            for (auto it = m_orders.begin(); it != m_orders.end(); ++it)
+            {
+                if (!predicate(it->order()))
+                {
+                    if (out != it)
+                    {
+                        *out = std::move(*it);
+                    }
+                    ++out;
+                    continue;
+                }
+
+                QuantityType quantity = it->quantity;
+                m_total_quantity -= it->quantity;
+                if constexpr (IcebergOrderConcept<OrderType>)
+                {
+                    quantity += it->hidden_quantity;
+                    m_hidden_quantity -= it->hidden_quantity;
+                }
+
+                cancelled.emplace_back(it->order(), quantity);
+                m_rank.remove(it->order(), it->quantity);
+                unlink_owner_index(it->order());
+                unlink_expiry(it->order());
+                ++count;
+            }
+
+            m_orders.erase(out, m_orders.end());
+            m_rank.compact(m_orders);
+            return count;
+        }
+
+        // Reduces quantity of order at position (see `begin()`), and removes
+        // the order if nothing is left, e.g. when other venue reports partial
+        // cancel or execution. Returns quantity left on the order.
+        // NOTE: Queue must keep positions of other orders on erase, e.g.
+        // `std::list`.
+        template<typename Position>
+        QuantityType reduce_order(Position position, QuantityType quantity)
+        {
+            // Erasing empty range gives mutable iterator from const one
+            auto it = m_orders.erase(position, position);
+            quantity = std::min(quantity, it->quantity);
+
+            it->quantity -= quantity;
+            m_total_quantity -= quantity;
+            if (it->quantity)
+            {
+                m_rank.reduce(it->order(), quantity);
+                return it->quantity;
+            }
+
+            m_rank.remove(it->order(), quantity);
+            unlink_owner_index(it->order());
+            unlink_expiry(it->order());
+            m_orders.erase(it);
+            m_rank.compact(m_orders);
+            return 0;
+        }
+
         auto price() const { return m_price; }
         auto total_quantity() const { return m_total_quantity; }
+        auto hidden_quantity() const { return m_hidden_quantity; }
 
         auto begin() const { return m_orders.begin(); }
         auto end() const { return m_orders.end(); }
 
         const auto &first() const { return m_orders.front(); }
 
+        // Orders, and displayed quantity, ahead of order resting on this
+        // level in O(log n) (see `QueueRank`)
+        QueuePosition<QuantityType> queue_position(const OrderType &order) const requires RankedOrderConcept<OrderType>
+        {
+            return m_rank.position(order);
+        }
+
         size_t size() const { return m_orders.size(); }
         bool empty() const { return m_orders.empty(); }
 
@@ -139,6 +357,165 @@ namespace sadhbhcraft::orderbook
         QueueType<OrderQuantity<OrderType>> m_orders;
         PriceType m_price;
         QuantityType m_total_quantity;
+        QuantityType m_hidden_quantity;
+        [[no_unique_address]] QueueRank<OrderType> m_rank;
+
+        // Fills on the level are planned from the front of the queue, and
+        // checked by execution policy all at once, and then applied in the
+        // same order as one by one
+        template<typename ExecutionPolicy, typename Instrumentation>
+        util::Generator<OrderQuantity<OrderType>>
+        match_batches(
+            OrderType &order,
+            QuantityType quantity,
+            ExecutionPolicy &execution_policy,
+            SelfTradeCheck<OrderType> &self_trade,
+            Instrumentation *instrumentation)
+        {
+            auto &fills = self_trade.fills;
+
+            // Another batch is needed only if icebergs were refreshed
+            while (quantity && !m_orders.empty() && !self_trade.aggressor_stopped)
+            {
+                fills.clear();
+                QuantityType planned = 0;
+                for (auto it = m_orders.begin(); it != m_orders.end() && planned != quantity; ++it)
+                {
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        instrumentation->on_order_touched();
+                    }
+                    const QuantityType quantity_to_fill = std::min(quantity - planned, it->quantity);
+                    fills.emplace_back(it->order(), quantity_to_fill);
+                    planned += quantity_to_fill;
+                }
+
+                const std::size_t taken = execution_policy.check_fills(order, std::span{fills});
+
+                // Each fill but the last one takes whole order at the front,
+                // which then leaves the front of the queue
+                for (std::size_t i = 0; i != fills.size(); ++i)
+                {
+                    const QuantityType quantity_to_fill = std::min(planned, m_orders.front().quantity);
+                    const OrderQuantity<OrderType> executed = fills[i];
+                    const bool aggressor_stopped = (i == taken);
+
+                    planned -= quantity_to_fill;
+                    quantity -= executed.quantity;
+                    fill_first_order(executed.quantity, quantity_to_fill, aggressor_stopped);
+
+                    if (aggressor_stopped)
+                    {
+                        self_trade.aggressor_stopped = true;
+                        if (executed.quantity)
+                        {
+                            co_yield executed;
+                        }
+                        break;
+                    }
+
+                    co_yield executed;
+                }
+            }
+
+            co_return;
+        }
+
+        // Applies execution to the order at the front of the queue. Order
+        // trimmed by execution policy is cancelled, unless it keeps the rest
+        // (e.g. when aggressor was stopped).
+        void fill_first_order(QuantityType executed_quantity, QuantityType quantity_to_fill, bool keep_rest)
+        {
+            auto &first_order = m_orders.front();
+            first_order.quantity -= executed_quantity;
+            m_total_quantity -= executed_quantity;
+            m_rank.reduce(first_order.order(), executed_quantity);
+
+            if (executed_quantity != quantity_to_fill && !keep_rest)
+            {
+                // Execution policy has trimmed the order, and we cancel
+                // whatever is left on it.
+                // DISCUSSION:
+                // We could introduce new type for execution instead of using OrderQuantity
+                // and perhaps have executed_quantity and cancelled_quantity there.
+                m_total_quantity -= first_order.quantity;
+                if constexpr (IcebergOrderConcept<OrderType>)
+                {
+                    m_hidden_quantity -= first_order.hidden_quantity;
+                }
+                remove_first_order();
+            }
+            else if (!first_order.quantity)
+            {
+                if constexpr (IcebergOrderConcept<OrderType>)
+                {
+                    if (first_order.hidden_quantity)
+                    {
+                        replenish_first_order();
+                        return;
+                    }
+                }
+                remove_first_order();
+            }
+        }
+
+        template<typename Output>
+        void cancel_first_order(Output &cancelled)
+        {
+            auto &first_order = m_orders.front();
+            QuantityType quantity = first_order.quantity;
+
+            m_total_quantity -= first_order.quantity;
+            if constexpr (IcebergOrderConcept<OrderType>)
+            {
+                quantity += first_order.hidden_quantity;
+                m_hidden_quantity -= first_order.hidden_quantity;
+            }
+
+            cancelled.emplace_back(first_order.order(), quantity);
+            remove_first_order();
+        }
+
+        // Order leaves the level, and the book
+        void remove_first_order()
+        {
+            m_rank.remove(m_orders.front().order(), m_orders.front().quantity);
+            unlink_owner_index(m_orders.front().order());
+            unlink_expiry(m_orders.front().order());
+            m_orders.erase(m_orders.begin());
+            m_rank.compact(m_orders);
+        }
+
+        void replenish_first_order()
+        {
+            // Refresh display quantity from reserve, and send order to the back
+            // of the queue.
+            auto &order = m_orders.front().order();
+            QuantityType hidden_quantity = m_orders.front().hidden_quantity;
+            QuantityType display_quantity = std::min(display_quantity_of(order), hidden_quantity);
+
+            m_total_quantity += display_quantity;
+            m_hidden_quantity -= display_quantity;
+
+            if (m_orders.size() == 1)
+            {
+                // Alone on the level, the back is where it already stands
+                auto &oq = m_orders.front();
+                oq.quantity = display_quantity;
+                oq.hidden_quantity = hidden_quantity - display_quantity;
+                m_rank.refill(order, display_quantity);
+                return;
+            }
+
+            // Moving to the back erases the front and appends, which may free
+            // a block at the front of the deque and allocate one at the back.
+            m_rank.remove(order, m_orders.front().quantity);
+            m_orders.erase(m_orders.begin());
+
+            auto &oq = m_orders.emplace_back(order, display_quantity);
+            oq.hidden_quantity = hidden_quantity - display_quantity;
+            m_rank.push(order, display_quantity);
+        }
     };
 
     template<OrderConcept OrderType, template <typename> class QueueType>
@@ -164,76 +541,297 @@ namespace sadhbhcraft::orderbook
         }
     };
     
+    // Levels are kept in a stack, from the best price down. Level type
+    // decides how incoming quantity is allocated to orders resting on the
+    // level, e.g. `OrderPriceLevel` in time priority, or `ProRataPriceLevel`.
     template<Side MySide, OrderConcept _OrderType,
         template <typename> class _StackType,
-        template <typename> class _QueueType>
-    requires util::IsRandomStack<_StackType, OrderPriceLevel<_OrderType, _QueueType>>::value
+        template <typename> class _QueueType,
+        template <typename, template <typename> class> class _LevelType = OrderPriceLevel>
+    requires util::IsRandomStack<_StackType, _LevelType<_OrderType, _QueueType>>::value
     class PriceLevelStack
     {
     public:
         typedef _OrderType OrderType;
         typedef typename OrderType::QuantityType QuantityType;
+        typedef _LevelType<_OrderType, _QueueType> LevelType;
         template<typename T> using StackType = _StackType<T>;
         template<typename T> using QueueType = _QueueType<T>;
 
-        void add_order(OrderType &order, QuantityType quantity)
+        template<typename Instrumentation = NoStats>
+        void add_order(OrderType &order, QuantityType quantity, Instrumentation *instrumentation = nullptr)
         {
-            do_add_order(order, quantity);
+            if constexpr (Instrumentation::enabled)
+            {
+                const auto start = util::read_cycles();
+                auto [level_iterator, is_new_level] = do_add_order(order, quantity);
+                if (is_new_level)
+                {
+                    instrumentation->on_level_created(MySide, price_of(order));
+                }
+                instrumentation->on_add_order_cycles(util::read_cycles() - start);
+                instrumentation->on_level_update(MySide, level_iterator->price(), level_iterator->total_quantity());
+            }
+            else
+            {
+                do_add_order(order, quantity);
+            }
         }
 
-        template<ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy>
+        template<ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy, typename Instrumentation = NoStats>
         util::Generator<OrderQuantity<OrderType>>
         match_order(
             OrderType &order,
-            ExecutionPolicy &&execution_policy = {})
+            ExecutionPolicy &&execution_policy = {},
+            SelfTradeCheck<OrderType> *self_trade = nullptr,
+            Instrumentation *instrumentation = nullptr)
         {
             QuantityType quantity_filled = 0;
+            [[maybe_unused]] std::uint64_t match_cycles = 0;
             PriceLevelCompare<MySide> price_compare;
+            // Market order takes whatever is on the book regardless of price
+            const bool is_market = (order.order_type == orderbook::OrderType::Market);
 
             auto it = m_levels.begin();
+            [[maybe_unused]] bool is_level_left = false;
             
-            if (price_compare(*it, order))
+            for (; it != m_levels.end(); ++it)
             {
-                for (; it != m_levels.end(); ++it)
+                if (quantity_of(order) == quantity_filled)
                 {
-                    if (quantity_of(order) == quantity_filled)
-                    {
-                        break; //< Order was fully filled
-                    }
-                    else if (price_compare(order, *it))
+                    break; //< Order was fully filled
+                }
+                else if (self_trade && self_trade->aggressor_done())
+                {
+                    break; //< Order was cancelled to prevent self-trade, or stopped by execution policy
+                }
+                else if (!is_market && price_compare(order, *it))
+                {
+                    break; //< Order was partially filled
+                }
+
+                if constexpr (Instrumentation::enabled)
+                {
+                    instrumentation->on_level_touched();
+                }
+
+                auto res = it->match_order(
+                    order,
+                    quantity_of(order) - quantity_filled,
+                    std::forward<ExecutionPolicy>(execution_policy),
+                    self_trade,
+                    instrumentation);
+
+                for (;;)
+                {
+                    // Only time spent in matching is measured, and not the
+                    // time caller spends consuming executions
+                    [[maybe_unused]] std::uint64_t start = 0;
+                    if constexpr (Instrumentation::enabled)
                     {
-                        break; //< Order was partially filled
+                        start = util::read_cycles();
                     }
 
-                    auto res = it->match_order(
-                        order,
-                        quantity_of(order) - quantity_filled,
-                        std::forward<ExecutionPolicy>(execution_policy));
+                    const bool has_execution = co_await res.next();
 
-                    while (res)
+                    if constexpr (Instrumentation::enabled)
                     {
-                        auto executed = res();
-                        co_yield executed;
-                        quantity_filled += executed.quantity;
+                        match_cycles += util::read_cycles() - start;
                     }
-
-                    if (!it->empty())
+                    if (!has_execution)
                     {
-                        // Level wasn't fully filled
                         break;
                     }
+
+                    auto executed = res();
+                    co_yield executed;
+                    quantity_filled += executed.quantity;
                 }
 
-                // Remove all levels that were fully filled, but keep the one
-                // that still has quantity left
-                m_levels.erase(m_levels.begin(), it);
+                if (!it->empty())
+                {
+                    // Level wasn't fully filled
+                    is_level_left = true;
+                    break;
+                }
             }
 
+            // Remove all levels that were fully filled, but keep the one
+            // that still has quantity left
+            if constexpr (Instrumentation::enabled)
+            {
+                for (auto erased = m_levels.begin(); erased != it; ++erased)
+                {
+                    instrumentation->on_level_erased(MySide, erased->price());
+                }
+                if (is_level_left)
+                {
+                    instrumentation->on_level_update(MySide, it->price(), it->total_quantity());
+                }
+                instrumentation->on_match_order_cycles(match_cycles);
+            }
+            m_levels.erase(m_levels.begin(), it);
+
             co_return;
         }
 
+        // Fills resting orders in price-time priority up to given quantity,
+        // on levels not worse than limit price, and appends fills to output,
+        // e.g. to execute one side of uncrossed auction. Returns quantity
+        // filled.
+        template<typename Output, typename Instrumentation = NoStats>
+        QuantityType fill_orders(
+            typename OrderType::PriceType limit_price,
+            QuantityType quantity,
+            Output &fills,
+            Instrumentation *instrumentation = nullptr)
+        {
+            QuantityType filled = 0;
+            PriceLevelCompare<MySide> price_compare;
+
+            auto it = m_levels.begin();
+            [[maybe_unused]] bool is_level_left = false;
+            for (; it != m_levels.end() && filled != quantity; ++it)
+            {
+                if (price_compare(limit_price, *it))
+                {
+                    break;
+                }
+                filled += it->fill_orders(quantity - filled, fills);
+                if (!it->empty())
+                {
+                    is_level_left = true;
+                    break;
+                }
+            }
+
+            if constexpr (Instrumentation::enabled)
+            {
+                for (auto erased = m_levels.begin(); erased != it; ++erased)
+                {
+                    instrumentation->on_level_erased(MySide, erased->price());
+                }
+                if (is_level_left)
+                {
+                    instrumentation->on_level_update(MySide, it->price(), it->total_quantity());
+                }
+            }
+            m_levels.erase(m_levels.begin(), it);
+
+            return filled;
+        }
+
+        // Cancels orders matching predicate on levels with price in range
+        // [min_price, max_price], in one pass over those levels, and erases
+        // levels left empty. Returns number of orders cancelled.
+        template<typename Predicate, typename Output, typename Instrumentation = NoStats>
+        std::size_t cancel_orders_if(
+            typename OrderType::PriceType min_price,
+            typename OrderType::PriceType max_price,
+            Predicate &&predicate,
+            Output &cancelled,
+            Instrumentation *instrumentation = nullptr)
+        {
+            const auto best = (MySide == Side::Buy ? max_price : min_price);
+            const auto worst = (MySide == Side::Buy ? min_price : max_price);
+            auto first = find_or_get_insert_iterator(best);
+            auto last = std::upper_bound(first, m_levels.end(), worst, PriceLevelCompare<MySide>());
+
+            std::size_t count = 0;
+            for (auto it = first; it != last; ++it)
+            {
+                const std::size_t level_count = it->cancel_orders_if(predicate, cancelled);
+                count += level_count;
+
+                if constexpr (Instrumentation::enabled)
+                {
+                    if (it->empty())
+                    {
+                        instrumentation->on_level_erased(MySide, it->price());
+                    }
+                    else if (level_count)
+                    {
+                        instrumentation->on_level_update(MySide, it->price(), it->total_quantity());
+                    }
+                }
+            }
+
+            m_levels.erase(std::remove_if(first, last, [](const auto &level) { return level.empty(); }), last);
+            return count;
+        }
+
+        // Cancels orders matching predicate on levels at given prices, which
+        // are unique and sorted from the best price down, walking levels and
+        // prices together. Only levels at those prices are compacted, and
+        // levels left empty are erased in one pass. Returns number of orders
+        // cancelled.
+        // NOTE: This is not O(orders cancelled). Each price is found by binary
+        // search from the previous one, each level found is compacted in one
+        // pass over its orders, and erasing empty levels moves the levels
+        // from the first one emptied to the last price.
+        template<typename Predicate, typename Output, typename Instrumentation = NoStats>
+        std::size_t cancel_orders_at(
+            std::span<const typename OrderType::PriceType> prices,
+            Predicate &&predicate,
+            Output &cancelled,
+            Instrumentation *instrumentation = nullptr)
+        {
+            auto it = m_levels.begin();
+            auto first_empty = m_levels.end();
+
+            std::size_t count = 0;
+            for (const auto price : prices)
+            {
+                it = std::lower_bound(it, m_levels.end(), price, PriceLevelCompare<MySide>());
+                if (it == m_levels.end())
+                {
+                    break;
+                }
+                if (price_of(*it) != price)
+                {
+                    continue;
+                }
+
+                const std::size_t level_count = it->cancel_orders_if(predicate, cancelled);
+                count += level_count;
+
+                if (it->empty())
+                {
+                    if (first_empty == m_levels.end())
+                    {
+                        first_empty = it;
+                    }
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        instrumentation->on_level_erased(MySide, it->price());
+                    }
+                }
+                else if (level_count)
+                {
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        instrumentation->on_level_update(MySide, it->price(), it->total_quantity());
+                    }
+                }
+                ++it;
+            }
+
+            if (first_empty != m_levels.end())
+            {
+                m_levels.erase(std::remove_if(first_empty, it, [](const auto &level) { return level.empty(); }), it);
+            }
+            return count;
+        }
+
         constexpr Side side() const { return MySide; }
 
+        // Level at price, or nullptr if there's none
+        const LevelType *find_level(typename OrderType::PriceType price) const
+        {
+            auto it = std::lower_bound(m_levels.begin(), m_levels.end(), price, PriceLevelCompare<MySide>());
+            return (it != m_levels.end() && price_of(*it) == price) ? &*it : nullptr;
+        }
+
         auto begin() const { return m_levels.begin(); }
         auto end() const { return m_levels.end(); }
 
@@ -243,32 +841,44 @@ namespace sadhbhcraft::orderbook
         bool empty() const { return m_levels.empty(); }
 
     protected:
-        StackType<OrderPriceLevel<OrderType, QueueType>> m_levels;
+        StackType<LevelType> m_levels;
         
         auto find_or_get_insert_iterator(typename OrderType::PriceType price)
         {
             return std::lower_bound(m_levels.begin(), m_levels.end(), price, PriceLevelCompare<MySide>());
         }
 
-        void do_add_order(OrderType &order, QuantityType quantity)
+        // Returns level of the order, and true if it was created for the order
+        auto do_add_order(OrderType &order, QuantityType quantity)
         {
             auto level_iterator = find_or_get_insert_iterator(price_of(order));
+            bool is_new_level = false;
 
             if (level_iterator == m_levels.end() || price_of(*level_iterator) != price_of(order))
             {
                 level_iterator = m_levels.emplace(level_iterator, price_of(order));
+                is_new_level = true;
             }
             level_iterator->add_order(order, quantity);
+            return std::make_pair(level_iterator, is_new_level);
         }
     };
 
-    template<template <typename> class StackType = std::deque, template <typename> class QueueType = std::deque>
+    template<
+        template <typename> class StackType = std::deque,
+        template <typename> class QueueType = std::deque,
+        template <typename, template <typename> class> class LevelType = OrderPriceLevel>
     struct PriceLevelStackBookSidePolicy
     {
         template<Side MySide, OrderConcept OrderType>
-        using OrderBookSideType = PriceLevelStack<MySide, OrderType, StackType, QueueType>;
+        using OrderBookSideType = PriceLevelStack<MySide, OrderType, StackType, QueueType, LevelType>;
     };
 
+    // Levels and queues allocate from default memory resource at the time
+    // they are created, e.g. `util::HugePageResource`
+    template<template <typename, template <typename> class> class LevelType = OrderPriceLevel>
+    using PmrBookSidePolicy = PriceLevelStackBookSidePolicy<std::pmr::deque, std::pmr::deque, LevelType>;
+
     template<OrderConcept _OrderType>
     class OrderSizeLimit
     {
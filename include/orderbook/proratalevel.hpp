@@ -0,0 +1,431 @@
+#ifndef INCLUDED_PRORATALEVEL_HPP
+#define INCLUDED_PRORATALEVEL_HPP
+
+//
+// Pro-rata matching on price level
+//
+//      OrderBook<MyOrder, ProRataBookSidePolicy<>> book;
+//
+// Incoming quantity is allocated on each level in this order:
+//
+//  1. Top order, i.e. the order that has created the level, is filled
+//     first, but only by the first match on the level
+//  2. The rest is allocated to all orders in proportion to their size, and
+//     allocations are rounded down to whole lots for integral quantities
+//  3. Quantity left over by rounding goes to orders in time priority, each
+//     up to its size
+//
+// Allocation is computed in one pass over quantities of the level, which
+// are kept in contiguous array apart from order references, so that
+// compiler can vectorise it. The array is `std::vector` with allocator of
+// the level's queue, so that it allocates wherever the side policy's
+// containers do, e.g. from memory resource of `std::pmr::deque` (see
+// `PmrBookSidePolicy`). Then orders allocated are executed in time
+// priority, with the same `ExecutionPolicy` and Generator interface as
+// `OrderPriceLevel`, so that `PriceLevelStack` and `OrderBook` work the
+// same with either level.
+//
+// NOTE: Iceberg order refreshed from reserve keeps its place in the queue,
+// as place only matters for the top order and for lots left over.
+//
+// NOTE: With self-trade prevention that cancels aggressor, level holding
+// any order of the same owner is not matched at all, since all orders on
+// the level take part in every match.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "traits.hpp"
+#include "pricelevelstack.hpp"
+
+#include "util/concepts.hpp"
+#include "util/generator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    namespace detail
+    {
+        // Vector of T with allocator of queue, or default one if queue has
+        // none (e.g. `util::SmallQueue`)
+        template<typename Queue, typename T>
+        struct VectorLike
+        {
+            typedef std::vector<T> type;
+        };
+
+        template<typename Queue, typename T>
+        requires requires { typename Queue::allocator_type; }
+        struct VectorLike<Queue, T>
+        {
+            typedef std::vector<T, typename std::allocator_traits<typename Queue::allocator_type>::template rebind_alloc<T>> type;
+        };
+    }
+
+    template<OrderConcept _OrderType, template <typename> class _QueueType>
+    requires util::IsQueue<_QueueType, OrderQuantity<_OrderType>>::value
+    class ProRataPriceLevel
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef typename _OrderType::PriceType PriceType;
+        typedef typename _OrderType::QuantityType QuantityType;
+        template<typename T> using QueueType = _QueueType<T>;
+
+        ProRataPriceLevel(PriceType price): m_price(price), m_total_quantity(0), m_hidden_quantity(0)
+        {}
+
+        void add_order(OrderType &order, QuantityType quantity)
+        {
+            QuantityType display_quantity = quantity;
+            if constexpr (IcebergOrderConcept<OrderType>)
+            {
+                if (display_quantity_of(order) && display_quantity_of(order) < quantity)
+                {
+                    display_quantity = display_quantity_of(order);
+                }
+            }
+
+            auto &oq = m_orders.emplace_back(order, display_quantity);
+            if constexpr (IcebergOrderConcept<OrderType>)
+            {
+                oq.hidden_quantity = quantity - display_quantity;
+                m_hidden_quantity += oq.hidden_quantity;
+            }
+            m_quantities.push_back(display_quantity);
+            m_total_quantity += display_quantity;
+        }
+
+        template<ExecutionPolicyConcept<OrderQuantity<OrderType>> ExecutionPolicy, typename Instrumentation = NoStats>
+        util::Generator<OrderQuantity<OrderType>>
+        match_order(
+            OrderType &order,
+            QuantityType quantity,
+            ExecutionPolicy &&execution_policy,
+            SelfTradeCheck<OrderType> *self_trade = nullptr,
+            Instrumentation *instrumentation = nullptr)
+        {
+            if constexpr (OwnedOrderConcept<OrderType>)
+            {
+                if (self_trade && self_trade->enabled() && !prevent_self_trade(order, *self_trade))
+                {
+                    co_return;
+                }
+            }
+
+            // Another round is needed only if execution policy has trimmed
+            // some executions, or icebergs were refreshed
+            while (quantity && !m_orders.empty())
+            {
+                allocate(quantity);
+
+                auto it = m_orders.begin();
+                for (std::size_t i = 0; i != m_allocations.size(); ++i, ++it)
+                {
+                    const QuantityType quantity_to_fill = m_allocations[i];
+                    if (!quantity_to_fill)
+                    {
+                        continue;
+                    }
+                    if constexpr (Instrumentation::enabled)
+                    {
+                        instrumentation->on_order_touched();
+                    }
+
+                    OrderQuantity<OrderType> executed{it->order(), quantity_to_fill};
+                    co_await execution_policy(std::ref(executed));
+
+                    quantity -= executed.quantity;
+                    fill(i, *it, executed.quantity);
+
+                    if (self_trade && self_trade->aggressor_stopped)
+                    {
+                        // Resting order keeps what aggressor couldn't take
+                        if (executed.quantity)
+                        {
+                            co_yield executed;
+                        }
+                        break;
+                    }
+
+                    if (executed.quantity != quantity_to_fill)
+                    {
+                        // Execution policy has trimmed the order, and we
+                        // cancel whatever is left on it (see `OrderPriceLevel`)
+                        cancel(i, *it);
+                    }
+
+                    co_yield executed;
+                }
+
+                remove_filled_orders();
+                if (self_trade && self_trade->aggressor_stopped)
+                {
+                    break;
+                }
+            }
+
+            co_return;
+        }
+
+        // Fills orders in the same way as match_order() would, but without
+        // aggressor, and appends fills to output. Returns quantity filled.
+        template<typename Output>
+        QuantityType fill_orders(QuantityType quantity, Output &fills)
+        {
+            QuantityType filled = 0;
+            while (filled != quantity && !m_orders.empty())
+            {
+                allocate(quantity - filled);
+
+                auto it = m_orders.begin();
+                for (std::size_t i = 0; i != m_allocations.size(); ++i, ++it)
+                {
+                    if (m_allocations[i])
+                    {
+                        fills.emplace_back(it->order(), m_allocations[i]);
+                        filled += m_allocations[i];
+                        fill(i, *it, m_allocations[i]);
+                    }
+                }
+
+                remove_filled_orders();
+            }
+            return filled;
+        }
+
+        // Cancels all orders matching predicate in one pass, keeping the
+        // order of the rest, and appends them to output with quantity that
+        // was cancelled. Returns number of orders cancelled.
+        template<typename Predicate, typename Output>
+        std::size_t cancel_orders_if(Predicate &&predicate, Output &cancelled)
+        {
+            std::size_t count = 0;
+            std::size_t out = 0;
+            auto out_it = m_orders.begin();
+            auto it = m_orders.begin();
+
+            for (std::size_t i = 0; i != m_quantities.size(); ++i, ++it)
+            {
+                if (!predicate(it->order()))
+                {
+                    keep(i, it, out, out_it);
+                    continue;
+                }
+
+                QuantityType quantity = m_quantities[i];
+                m_total_quantity -= m_quantities[i];
+                if constexpr (IcebergOrderConcept<OrderType>)
+                {
+                    quantity += it->hidden_quantity;
+                    m_hidden_quantity -= it->hidden_quantity;
+                }
+                if (!i)
+                {
+                    m_top_order = false;
+                }
+
+                cancelled.emplace_back(it->order(), quantity);
+                unlink_owner_index(it->order());
+                unlink_expiry(it->order());
+                ++count;
+            }
+
+            truncate(out, out_it);
+            return count;
+        }
+
+        auto price() const { return m_price; }
+        auto total_quantity() const { return m_total_quantity; }
+        auto hidden_quantity() const { return m_hidden_quantity; }
+
+        auto begin() const { return m_orders.begin(); }
+        auto end() const { return m_orders.end(); }
+
+        const auto &first() const { return m_orders.front(); }
+
+        size_t size() const { return m_orders.size(); }
+        bool empty() const { return m_orders.empty(); }
+
+    private:
+        typedef typename detail::VectorLike<QueueType<OrderQuantity<OrderType>>, QuantityType>::type QuantitiesType;
+
+        QueueType<OrderQuantity<OrderType>> m_orders;
+        QuantitiesType m_quantities;    // Same as quantities in `m_orders`
+        QuantitiesType m_allocations;   // Of the last match
+        PriceType m_price;
+        QuantityType m_total_quantity;
+        QuantityType m_hidden_quantity;
+        bool m_top_order = true;
+
+        // Allocates min(quantity, total) across orders into `m_allocations`
+        void allocate(QuantityType quantity)
+        {
+            const std::size_t n = m_quantities.size();
+            const QuantityType *q = m_quantities.data();
+            m_allocations.resize(n);
+            QuantityType *a = m_allocations.data();
+
+            QuantityType left = quantity;
+            QuantityType rest_total = m_total_quantity;
+            std::size_t first = 0;
+            if (m_top_order)
+            {
+                a[0] = std::min(left, q[0]);
+                left -= a[0];
+                rest_total -= q[0];
+                first = 1;
+                m_top_order = false;
+            }
+
+            if (!(left < rest_total))
+            {
+                std::copy(q + first, q + n, a + first);
+                return;
+            }
+
+            // The only pass over all orders, and then rounding down
+            const double ratio = static_cast<double>(left) / static_cast<double>(rest_total);
+            QuantityType allocated = 0;
+            for (std::size_t i = first; i != n; ++i)
+            {
+                a[i] = static_cast<QuantityType>(static_cast<double>(q[i]) * ratio);
+                allocated += a[i];
+            }
+
+            // Rounding error of floating point may overshoot by a little
+            if (left < allocated)
+            {
+                allocated = 0;
+                for (std::size_t i = first; i != n; ++i)
+                {
+                    a[i] = std::min(a[i], left - allocated);
+                    allocated += a[i];
+                }
+            }
+
+            // Lots left over go in time priority, and that's usually few
+            // orders from the front
+            left -= allocated;
+            for (std::size_t i = first; i != n && left > QuantityType{}; ++i)
+            {
+                const QuantityType extra = std::min(left, q[i] - a[i]);
+                a[i] += extra;
+                left -= extra;
+            }
+        }
+
+        void fill(std::size_t i, OrderQuantity<OrderType> &oq, QuantityType quantity)
+        {
+            m_quantities[i] -= quantity;
+            oq.quantity = m_quantities[i];
+            m_total_quantity -= quantity;
+        }
+
+        void cancel(std::size_t i, OrderQuantity<OrderType> &oq)
+        {
+            m_total_quantity -= m_quantities[i];
+            m_quantities[i] = 0;
+            oq.quantity = 0;
+            if constexpr (IcebergOrderConcept<OrderType>)
+            {
+                m_hidden_quantity -= oq.hidden_quantity;
+                oq.hidden_quantity = 0;
+            }
+        }
+
+        // Refreshes icebergs from reserve in place, and removes orders that
+        // are done, in one pass
+        void remove_filled_orders()
+        {
+            std::size_t out = 0;
+            auto out_it = m_orders.begin();
+            auto it = m_orders.begin();
+
+            for (std::size_t i = 0; i != m_quantities.size(); ++i, ++it)
+            {
+                if (m_quantities[i] > QuantityType{})
+                {
+                    keep(i, it, out, out_it);
+                    continue;
+                }
+                if constexpr (IcebergOrderConcept<OrderType>)
+                {
+                    if (it->hidden_quantity)
+                    {
+                        const QuantityType display_quantity = std::min(display_quantity_of(it->order()), it->hidden_quantity);
+                        it->hidden_quantity -= display_quantity;
+                        it->quantity = m_quantities[i] = display_quantity;
+                        m_hidden_quantity -= display_quantity;
+                        m_total_quantity += display_quantity;
+                        keep(i, it, out, out_it);
+                        continue;
+                    }
+                }
+                // Order leaves the level, and the book
+                unlink_owner_index(it->order());
+                unlink_expiry(it->order());
+            }
+
+            truncate(out, out_it);
+        }
+
+        template<typename Iterator>
+        void keep(std::size_t i, Iterator it, std::size_t &out, Iterator &out_it)
+        {
+            if (out != i)
+            {
+                *out_it = std::move(*it);
+                m_quantities[out] = m_quantities[i];
+            }
+            ++out;
+            ++out_it;
+        }
+
+        template<typename Iterator>
+        void truncate(std::size_t out, Iterator out_it)
+        {
+            m_orders.erase(out_it, m_orders.end());
+            m_quantities.resize(out);
+        }
+
+        // Applies prevention to orders of aggressor's owner on this level, and
+        // returns false if aggressor was cancelled
+        bool prevent_self_trade(const OrderType &order, SelfTradeCheck<OrderType> &self_trade)
+        {
+            auto is_same_owner = [&order](const OrderType &resting) { return owner_of(resting) == owner_of(order); };
+            if (std::none_of(m_orders.begin(), m_orders.end(), [&](const auto &oq) { return is_same_owner(oq.order()); }))
+            {
+                return true;
+            }
+            if (self_trade.mode != SelfTradePrevention::CancelAggressor)
+            {
+                cancel_orders_if(is_same_owner, self_trade.cancelled);
+            }
+            if (self_trade.mode != SelfTradePrevention::CancelResting)
+            {
+                self_trade.aggressor_cancelled = true;
+                return false;
+            }
+            return true;
+        }
+    };
+
+    template<OrderConcept OrderType, template <typename> class QueueType>
+    struct PriceTrait<ProRataPriceLevel<OrderType, QueueType>>
+    {
+        static auto price(const ProRataPriceLevel<OrderType, QueueType> &level) { return level.price(); }
+    };
+
+    template<template <typename> class StackType = std::deque, template <typename> class QueueType = std::deque>
+    using ProRataBookSidePolicy = PriceLevelStackBookSidePolicy<StackType, QueueType, ProRataPriceLevel>;
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_PRORATALEVEL_HPP
@@ -0,0 +1,162 @@
+#ifndef INCLUDED_QUEUERANK_HPP
+#define INCLUDED_QUEUERANK_HPP
+
+//
+// Queue position of resting orders
+//
+//      auto position = book.queue_position(order);
+//      position->orders_ahead;
+//      position->quantity_ahead;
+//
+// Order types can opt in for queue position by having `queue_ticket` member:
+//
+//      struct MyOrder
+//      {
+//          ...
+//          std::uint64_t queue_ticket;     // Set by the book
+//      };
+//
+// Then each `OrderPriceLevel` gives every order it queues a ticket, which is
+// index into Fenwick trees of displayed quantities and of order counts (see
+// `util::FenwickTree`), and every fill, cancel and reduction of an order
+// updates them. Number of orders, and quantity, ahead of an order are both
+// prefix sums, which are O(log n), instead of walking the queue.
+//
+// Orders that have left the level leave zero slots behind, and once these
+// are the majority, trees are rebuilt from the queue in one pass, and live
+// orders get new tickets, so that cost is amortised over removals.
+//
+// NOTE: Quantity ahead is displayed quantity, i.e. without hidden reserve
+// of iceberg orders, and refreshed iceberg goes to the back of the queue.
+//
+// NOTE: Only `OrderPriceLevel` keeps queue position, as place in the queue
+// hardly matters with pro-rata allocation.
+//
+
+#include "concepts.hpp"
+
+#include "util/fenwick.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<typename T>
+    concept RankedOrderConcept =
+        OrderConcept<T> &&
+        requires(T &x) {
+            { x.queue_ticket } -> std::same_as<std::uint64_t &>;
+        };
+
+    template<typename QuantityType>
+    struct QueuePosition
+    {
+        std::size_t orders_ahead = 0;
+        QuantityType quantity_ahead{};
+    };
+
+    // Order types without ticket don't pay anything
+    template<OrderConcept OrderType>
+    class QueueRank
+    {
+    public:
+        typedef typename OrderType::QuantityType QuantityType;
+
+        void push(OrderType &, QuantityType) {}
+        void reduce(const OrderType &, QuantityType) {}
+        void refill(const OrderType &, QuantityType) {}
+        void remove(const OrderType &, QuantityType) {}
+        template<typename Queue> void compact(Queue &) {}
+    };
+
+    template<RankedOrderConcept OrderType>
+    class QueueRank<OrderType>
+    {
+    public:
+        typedef typename OrderType::QuantityType QuantityType;
+
+        // Order joins at the back of the queue
+        void push(OrderType &order, QuantityType quantity)
+        {
+            order.queue_ticket = m_base + m_counts.size();
+            m_quantities.push_back(quantity);
+            m_counts.push_back(1);
+            ++m_live;
+        }
+
+        // Order has been filled, or reduced, by quantity
+        void reduce(const OrderType &order, QuantityType quantity)
+        {
+            m_quantities.add(index_of(order), QuantityType{} - quantity);
+        }
+
+        // Order alone in the queue has its display refreshed by quantity
+        void refill(const OrderType &order, QuantityType quantity)
+        {
+            m_quantities.add(index_of(order), quantity);
+        }
+
+        // Order leaves the queue with quantity it still had
+        void remove(const OrderType &order, QuantityType quantity)
+        {
+            const std::size_t i = index_of(order);
+            if (quantity != QuantityType{})
+            {
+                m_quantities.add(i, QuantityType{} - quantity);
+            }
+            m_counts.add(i, ~std::size_t{});
+            --m_live;
+        }
+
+        // Call once queue is consistent after removals, i.e. not while
+        // compacting it, and rebuilds trees if slots left are mostly empty
+        template<typename Queue>
+        void compact(Queue &orders)
+        {
+            const std::size_t slots = m_counts.size();
+            if (slots < 2 * m_live + 32)
+            {
+                return;
+            }
+
+            // New tickets never collide with old ones
+            m_base += slots;
+
+            std::pmr::vector<QuantityType> quantities;
+            quantities.reserve(m_live);
+            for (auto &oq : orders)
+            {
+                oq.order().queue_ticket = m_base + quantities.size();
+                quantities.push_back(oq.quantity);
+            }
+            std::pmr::vector<std::size_t> counts(quantities.size(), 1);
+
+            m_quantities.assign(quantities.begin(), quantities.end());
+            m_counts.assign(counts.begin(), counts.end());
+        }
+
+        QueuePosition<QuantityType> position(const OrderType &order) const
+        {
+            const std::size_t i = index_of(order);
+            return {m_counts.prefix(i), m_quantities.prefix(i)};
+        }
+
+    private:
+        util::FenwickTree<QuantityType> m_quantities;
+        util::FenwickTree<std::size_t> m_counts;
+        std::uint64_t m_base = 0;       // Ticket of the first slot
+        std::size_t m_live = 0;         // Orders in the queue
+
+        std::size_t index_of(const OrderType &order) const
+        {
+            return static_cast<std::size_t>(order.queue_ticket - m_base);
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_QUEUERANK_HPP
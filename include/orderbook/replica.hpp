@@ -0,0 +1,323 @@
+#ifndef INCLUDED_REPLICA_HPP
+#define INCLUDED_REPLICA_HPP
+
+//
+// Market-by-order replica of a book of other venue, rebuilt from its feed
+//
+//      ReplicaBook<Order<long, long>> book;
+//      book.add_order(id, Side::Buy, 100, 5);
+//      book.reduce_order(id, 2);               // Partial cancel
+//      book.execute_order(id, 1);              // Execution reported by venue
+//      book.delete_order(id);
+//
+//      book.bid().top().total_quantity();      // L2 totals, as on `OrderBook`
+//
+// Venue does the matching, and replica only applies its events, so that
+// nothing is matched, and book sides are `PriceLevelStack` of
+// `OrderPriceLevel`, as in `OrderBook`.
+//
+// Replica owns copies of orders, and finds them by id in `util::FlatHashMap`,
+// next to their position in level queue, so that reduce, execute and delete
+// touch only the order and its level, without scanning the queue. Level is
+// found by binary search over levels of the side, and that's few levels for
+// orders near the top, where most of the events are.
+//
+// Instrumentation policy is called as by `OrderBook`, so that e.g.
+// `MarketDataPublisher` republishes levels and trades of the replica.
+//
+// Run `bin/bench_replica` to see events per second, for book near the top,
+// and for deep book.
+//
+// NOTE: Each reduce, execute and delete searches the levels again, in
+// O(log levels), as level positions in the stack aren't stable. Erasing a
+// level left empty moves the levels between it and the nearer end of the
+// stack, which is O(levels) for a level deep in `std::deque`. With 100k
+// orders over about 4500 levels a side, events per second are about half
+// of those for the same orders over about 45 levels.
+//
+// NOTE: Queue must keep positions of orders on erase, e.g. `std::list`, or
+// `std::pmr::list` with pool resource (see `ReplicaBookSidePolicy`).
+//
+// NOTE: Order id with all bits set is reserved (see `util::FlatHashMap`),
+// and events for it are ignored, as for any order that isn't on the book.
+//
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "instrumentation.hpp"
+#include "pricelevelstack.hpp"
+#include "queuerank.hpp"
+#include "traits.hpp"
+
+#include "util/flatmap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<Side MySide, OrderConcept _OrderType,
+        template <typename> class _StackType,
+        template <typename> class _QueueType>
+    class ReplicaBookSide : public PriceLevelStack<MySide, _OrderType, _StackType, _QueueType, OrderPriceLevel>
+    {
+        typedef PriceLevelStack<MySide, _OrderType, _StackType, _QueueType, OrderPriceLevel> BaseType;
+
+    public:
+        typedef _OrderType OrderType;
+        typedef typename OrderType::QuantityType QuantityType;
+        typedef typename BaseType::LevelType LevelType;
+        typedef decltype(std::declval<const LevelType &>().begin()) PositionType;
+
+        // Adds order at the back of its level, and returns its position
+        template<typename Instrumentation = NoStats>
+        PositionType add_order(OrderType &order, QuantityType quantity, Instrumentation *instrumentation = nullptr)
+        {
+            auto [level_iterator, is_new_level] = this->do_add_order(order, quantity);
+            if constexpr (Instrumentation::enabled)
+            {
+                if (is_new_level)
+                {
+                    instrumentation->on_level_created(MySide, level_iterator->price());
+                }
+                instrumentation->on_level_update(MySide, level_iterator->price(), level_iterator->total_quantity());
+            }
+            return std::prev(level_iterator->end());
+        }
+
+        // Reduces quantity of order at position, and erases the order, and
+        // its level, if nothing is left. Returns quantity left on the order.
+        template<typename Instrumentation = NoStats>
+        QuantityType reduce_order(PositionType position, QuantityType quantity, Instrumentation *instrumentation = nullptr)
+        {
+            auto level_iterator = this->find_or_get_insert_iterator(price_of(position->order()));
+            const QuantityType left = level_iterator->reduce_order(position, quantity);
+
+            if (level_iterator->empty())
+            {
+                if constexpr (Instrumentation::enabled)
+                {
+                    instrumentation->on_level_erased(MySide, level_iterator->price());
+                }
+                this->m_levels.erase(level_iterator);
+            }
+            else if constexpr (Instrumentation::enabled)
+            {
+                instrumentation->on_level_update(MySide, level_iterator->price(), level_iterator->total_quantity());
+            }
+            return left;
+        }
+    };
+
+    template<
+        template <typename> class StackType = std::deque,
+        template <typename> class QueueType = std::list>
+    struct ReplicaBookSidePolicy
+    {
+        template<Side MySide, OrderConcept OrderType>
+        using OrderBookSideType = ReplicaBookSide<MySide, OrderType, StackType, QueueType>;
+    };
+
+    template<
+        OrderConcept _OrderType = Order<>,
+        typename OrderBookSidePolicy = ReplicaBookSidePolicy<>,
+        typename InstrumentationPolicy = NoStats>
+    requires (!IcebergOrderConcept<_OrderType>)
+    class ReplicaBook
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef typename OrderType::QuantityType QuantityType;
+        typedef InstrumentationPolicy Instrumentation;
+        typedef std::uint64_t OrderIdType;
+        template<Side MySide, OrderConcept OrderType>
+        using OrderBookSideType = typename OrderBookSidePolicy::OrderBookSideType<MySide, OrderType>;
+        using BidBookSideType = OrderBookSideType<Side::Buy, OrderType>;
+        using AskBookSideType = OrderBookSideType<Side::Sell, OrderType>;
+
+        explicit ReplicaBook(std::size_t expected_orders = 1024): m_index(expected_orders * 2)
+        {}
+
+        // Returns false if order with this id is already on the book, if id
+        // is reserved, or if order has no quantity
+        bool add_order(OrderIdType id, Side side, PriceType price, QuantityType quantity)
+        {
+            if (!quantity)
+            {
+                return false;
+            }
+            auto [entry, is_new] = m_index.try_emplace(id);
+            if (!is_new)    //< Also when id is reserved, and there's no entry
+            {
+                return false;
+            }
+
+            OrderType *order = new_order();
+            order->side = side;
+            order->order_type = orderbook::OrderType::Limit;
+            order->price = price;
+            order->quantity = quantity;
+
+            entry->order = order;
+            if (side == Side::Buy)
+            {
+                entry->position = m_bid.add_order(*order, quantity, &m_instrumentation);
+            }
+            else
+            {
+                entry->position = m_ask.add_order(*order, quantity, &m_instrumentation);
+            }
+            return true;
+        }
+
+        // Reduces quantity of order, e.g. on partial cancel, and deletes it
+        // if nothing is left. Returns false if order isn't on the book.
+        bool reduce_order(OrderIdType id, QuantityType quantity)
+        {
+            Entry *entry = m_index.find(id);
+            if (!entry)
+            {
+                return false;
+            }
+            reduce(id, *entry, quantity);
+            return true;
+        }
+
+        // As `reduce_order()`, but resting order has executed, which is
+        // passed to `on_execution()` of instrumentation
+        bool execute_order(OrderIdType id, QuantityType quantity)
+        {
+            Entry *entry = m_index.find(id);
+            if (!entry)
+            {
+                return false;
+            }
+            if constexpr (Instrumentation::enabled)
+            {
+                OrderQuantity<OrderType> executed{*entry->order, std::min(quantity, entry->order->quantity)};
+                m_instrumentation.on_execution(executed);
+            }
+            reduce(id, *entry, quantity);
+            return true;
+        }
+
+        // Returns false if order isn't on the book
+        bool delete_order(OrderIdType id)
+        {
+            Entry *entry = m_index.find(id);
+            if (!entry)
+            {
+                return false;
+            }
+            reduce(id, *entry, entry->order->quantity);
+            return true;
+        }
+
+        // Order with its remaining quantity, or nullptr if it isn't on the
+        // book
+        const OrderType *find_order(OrderIdType id) const
+        {
+            const Entry *entry = m_index.find(id);
+            return entry ? entry->order : nullptr;
+        }
+
+        // Orders, and displayed quantity, ahead of order in queue of its
+        // level (see `QueueRank`), or nothing if order isn't on the book
+        std::optional<QueuePosition<QuantityType>> queue_position(OrderIdType id) const requires RankedOrderConcept<OrderType>
+        {
+            const Entry *entry = m_index.find(id);
+            if (!entry)
+            {
+                return std::nullopt;
+            }
+            const OrderType &order = *entry->order;
+            if (order.side == Side::Buy)
+            {
+                return m_bid.find_level(price_of(order))->queue_position(order);
+            }
+            return m_ask.find_level(price_of(order))->queue_position(order);
+        }
+
+        // Removes all orders, e.g. before recovery from snapshot
+        void clear()
+        {
+            m_index.for_each([this](OrderIdType, Entry &entry)
+            {
+                if (entry.order->side == Side::Buy)
+                {
+                    m_bid.reduce_order(entry.position, entry.order->quantity, &m_instrumentation);
+                }
+                else
+                {
+                    m_ask.reduce_order(entry.position, entry.order->quantity, &m_instrumentation);
+                }
+                m_free.push_back(entry.order);
+            });
+            m_index.clear();
+        }
+
+        const auto &bid() const { return m_bid; }
+        const auto &ask() const { return m_ask; }
+
+        // Number of orders on the book
+        std::size_t size() const { return m_index.size(); }
+
+        const Instrumentation &instrumentation() const { return m_instrumentation; }
+        Instrumentation &instrumentation() { return m_instrumentation; }
+
+    private:
+        typedef typename BidBookSideType::PositionType PositionType;
+
+        struct Entry
+        {
+            OrderType *order = nullptr;
+            PositionType position{};
+        };
+
+        BidBookSideType m_bid;
+        AskBookSideType m_ask;
+        util::FlatHashMap<OrderIdType, Entry> m_index;
+        std::deque<OrderType> m_orders;     // Stable storage referenced by levels
+        std::vector<OrderType *> m_free;    // Orders that have left the book
+        [[no_unique_address]] Instrumentation m_instrumentation;
+
+        OrderType *new_order()
+        {
+            if (m_free.empty())
+            {
+                return &m_orders.emplace_back();
+            }
+            OrderType *order = m_free.back();
+            m_free.pop_back();
+            return order;
+        }
+
+        void reduce(OrderIdType id, Entry &entry, QuantityType quantity)
+        {
+            OrderType *order = entry.order;
+            if (order->side == Side::Buy)
+            {
+                order->quantity = m_bid.reduce_order(entry.position, quantity, &m_instrumentation);
+            }
+            else
+            {
+                order->quantity = m_ask.reduce_order(entry.position, quantity, &m_instrumentation);
+            }
+
+            if (!order->quantity)
+            {
+                m_free.push_back(order);
+                m_index.erase(id);
+            }
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_REPLICA_HPP
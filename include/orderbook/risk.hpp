@@ -0,0 +1,391 @@
+#ifndef INCLUDED_RISK_HPP
+#define INCLUDED_RISK_HPP
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "traits.hpp"
+#include "pricelevelstack.hpp"
+
+#include "util/flatmap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace sadhbhcraft::orderbook
+{
+    template<util::NumberConcept QuantityType, util::NumberConcept NotionalType = double>
+    struct RiskLimits
+    {
+        QuantityType max_position;      // Absolute net position
+        NotionalType max_notional;      // Gross notional traded
+        std::uint32_t max_orders;       // Orders admitted per rate window
+    };
+
+    template<util::NumberConcept QuantityType, util::NumberConcept NotionalType = double>
+    struct AccountRisk
+    {
+        RiskLimits<QuantityType, NotionalType> limits{};
+        QuantityType position = 0;
+        NotionalType notional = 0;
+        std::uint64_t window = 0;
+        std::uint32_t orders = 0;
+    };
+
+    // Pre-trade risk checks of both sides of every execution against limits of
+    // their accounts. Account is the owner of the order (see `OwnerTrait`),
+    // and state of each account is kept in flat open-addressing table.
+    //
+    // Execution is trimmed to what both accounts can still trade. Resting
+    // order trimmed by its own account's limits is cancelled, but aggressor
+    // which ran out of headroom is stopped instead, and resting order keeps
+    // the rest (see `OrderBook::stop_aggressor()`).
+    //
+    // Order rate is counted once per order sent by the account, when it's
+    // admitted (see `admit_order()`), and not per execution, so that resting
+    // orders hit many times aren't cancelled by their account's rate.
+    //
+    // NOTE: Owner that casts to the reserved key of the table (e.g. owner -1)
+    // has no account, and all its executions are rejected.
+    template<OwnedOrderConcept _OrderType, util::NumberConcept _NotionalType = double>
+    requires std::integral<decltype(owner_of(std::declval<const _OrderType &>()))>
+    class PreTradeRisk
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef _NotionalType NotionalType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef typename OrderType::QuantityType QuantityType;
+        typedef RiskLimits<QuantityType, NotionalType> LimitsType;
+        typedef AccountRisk<QuantityType, NotionalType> AccountType;
+
+        PreTradeRisk(
+            LimitsType default_limits,
+            std::chrono::nanoseconds rate_window = std::chrono::seconds(1),
+            std::size_t expected_accounts = 1024)
+            : m_default_limits(default_limits), m_rate_window(rate_window)
+        {
+            reserve(expected_accounts);
+        }
+
+        // Table grows as accounts trade for the first time, and reserving
+        // them at setup keeps rehash off the matching path
+        void reserve(std::size_t accounts) { m_accounts.reserve(accounts); }
+
+        // Returns false for reserved account id
+        bool set_limits(std::uint64_t account_id, LimitsType limits)
+        {
+            AccountType *account = m_accounts.try_emplace(account_id, AccountType{.limits = default_limits()}).first;
+            if (!account)
+            {
+                return false;
+            }
+            account->limits = limits;
+            return true;
+        }
+
+        const AccountType *account(std::uint64_t account_id) const { return m_accounts.find(account_id); }
+
+        const LimitsType &default_limits() const { return m_default_limits; }
+
+        // Current time selects the rate window. We don't read clock for every
+        // order, and user advances time instead (e.g. once per batch of orders).
+        void set_time(std::chrono::nanoseconds now)
+        {
+            m_window = static_cast<std::uint64_t>(now.count() / m_rate_window.count());
+        }
+
+        // Quantity the order's account can still trade at the order's price,
+        // and zero once the account has sent `max_orders` within the window.
+        QuantityType max_quantity(const OrderType &order) const
+        {
+            const std::uint64_t account_id = account_id_of(order);
+            if (m_accounts.is_reserved(account_id))
+            {
+                return 0;
+            }
+            const AccountType *account = m_accounts.find(account_id);
+            const AccountType fresh{.limits = m_default_limits};
+            const AccountType &checked = (account ? *account : fresh);
+            return static_cast<QuantityType>(
+                allowed_quantity(checked, order.side, price_of(order), quantity_of(order)) * (orders_left_of(checked) != 0));
+        }
+
+        // Same as `max_quantity()`, and order that can trade counts against
+        // its account's rate. Call once for each new order, before it is
+        // accepted by the book, and reject or resize it by what is returned.
+        QuantityType admit_order(const OrderType &order)
+        {
+            const QuantityType allowed = max_quantity(order);
+            if (allowed != QuantityType{})
+            {
+                AccountType &account = *account_of(account_id_of(order));
+                account.orders = (account.window == m_window ? account.orders : 0) + 1;
+                account.window = m_window;
+            }
+            return allowed;
+        }
+
+        // Trim execution to what both the resting order's account and the
+        // aggressor's account can still trade. Returns false if aggressor
+        // ran out of headroom before resting order did, and then execution
+        // holds what aggressor could still take.
+        bool check_execution(const OrderType &aggressor, OrderQuantity<OrderType> &executed)
+        {
+            const std::uint64_t aggressor_id = account_id_of(aggressor);
+            const std::uint64_t resting_id = account_id_of(executed.order());
+            if (m_accounts.is_reserved(aggressor_id))
+            {
+                executed.quantity = 0;
+                return false;
+            }
+            if (m_accounts.is_reserved(resting_id))
+            {
+                executed.quantity = 0;
+                return true;
+            }
+
+            const std::size_t capacity = m_accounts.capacity();
+            AccountType *aggressor_account = account_of(aggressor_id);
+            AccountType *resting_account = account_of(resting_id);
+            if (m_accounts.capacity() != capacity)
+            {
+                // Table grew, and moved the account found first
+                aggressor_account = m_accounts.find(aggressor_id);
+            }
+
+            const PriceType price = price_of(executed);
+            const QuantityType resting_allowed = allowed_quantity(*resting_account, executed.order().side, price, executed.quantity);
+            const QuantityType aggressor_allowed = allowed_quantity(*aggressor_account, aggressor.side, price, executed.quantity);
+            const bool aggressor_done = (aggressor_allowed < executed.quantity && !(resting_allowed < aggressor_allowed));
+            const QuantityType allowed = std::min(resting_allowed, aggressor_allowed);
+
+            commit(*resting_account, executed.order().side, price, allowed);
+            if (aggressor_account == resting_account)
+            {
+                // Account traded with itself, and execution counts once
+                commit_position(*aggressor_account, aggressor.side, allowed);
+            }
+            else
+            {
+                commit(*aggressor_account, aggressor.side, price, allowed);
+            }
+            executed.quantity = allowed;
+            return !aggressor_done;
+        }
+
+        // Check all fills of an aggressor on one level at once, before any
+        // of them is applied (see `BatchExecutionPolicyConcept`). Aggressor's
+        // account is looked up once for the whole batch. Returns number
+        // of fills aggressor could take in full, and fill at that position
+        // holds what aggressor could still take, and fills after it are
+        // trimmed to zero.
+        std::size_t check_batch(const OrderType &aggressor, std::span<OrderQuantity<OrderType>> fills)
+        {
+            const std::uint64_t aggressor_id = account_id_of(aggressor);
+            if (m_accounts.is_reserved(aggressor_id))
+            {
+                for (auto &executed : fills)
+                {
+                    executed.quantity = 0;
+                }
+                return 0;
+            }
+            AccountType *aggressor_account = account_of(aggressor_id);
+
+            // Headroom is priced at each fill, since batch may span levels
+            const QuantityType signed_position = signed_quantity(aggressor.side, aggressor_account->position);
+            QuantityType position_room = std::max<QuantityType>(aggressor_account->limits.max_position - signed_position, 0);
+            NotionalType notional_room = std::max<NotionalType>(aggressor_account->limits.max_notional - aggressor_account->notional, 0);
+            QuantityType total_allowed = 0;
+            std::size_t taken = fills.size();
+
+            for (std::size_t i = 0; i != fills.size(); ++i)
+            {
+                auto &executed = fills[i];
+                if (taken != fills.size())
+                {
+                    executed.quantity = 0;
+                    continue;
+                }
+
+                const PriceType price = price_of(executed);
+                const QuantityType aggressor_allowed = quantity_within(position_room, notional_room, price, executed.quantity);
+
+                QuantityType resting_allowed = 0;
+                const std::uint64_t resting_id = account_id_of(executed.order());
+                AccountType *resting_account = nullptr;
+                if (!m_accounts.is_reserved(resting_id))
+                {
+                    const std::size_t capacity = m_accounts.capacity();
+                    resting_account = account_of(resting_id);
+                    if (m_accounts.capacity() != capacity)
+                    {
+                        aggressor_account = m_accounts.find(aggressor_id);
+                    }
+                    resting_allowed = allowed_quantity(*resting_account, executed.order().side, price, executed.quantity);
+                }
+
+                if (aggressor_allowed < executed.quantity && !(resting_allowed < aggressor_allowed))
+                {
+                    taken = i;
+                }
+
+                const QuantityType allowed = std::min(resting_allowed, aggressor_allowed);
+                if (resting_account == aggressor_account)
+                {
+                    // Account traded with itself, and execution counts once
+                    commit_position(*resting_account, executed.order().side, allowed);
+                }
+                else if (resting_account)
+                {
+                    commit(*resting_account, executed.order().side, price, allowed);
+                }
+
+                executed.quantity = allowed;
+                position_room -= allowed;
+                notional_room -= abs_price_of(price) * static_cast<NotionalType>(allowed);
+                total_allowed += allowed;
+            }
+
+            commit_batch(*aggressor_account, aggressor.side, fills, total_allowed);
+            return taken;
+        }
+
+        // ExecutionPolicy checking executions of whichever order is being
+        // matched by the book (including stop orders triggered by it)
+        //
+        //      auto risk_check = risk.check(book);
+        //      if (risk.admit_order(order))
+        //      {
+        //          auto executions = book.accept_order(order, risk_check);
+        //      }
+        //
+        // NOTE: Matching coroutine holds reference to the policy, so it must
+        // outlive the executions generator.
+        template<typename OrderBookType>
+        auto check(OrderBookType &book)
+        {
+            return Check<OrderBookType>{*this, book};
+        }
+
+        // Same as `check()`, but levels that can plan their fills ahead check
+        // them all at once (see `check_batch()`), e.g. when sweeping levels
+        // with many orders. Other levels check executions one by one.
+        template<typename OrderBookType>
+        auto check_batches(OrderBookType &book)
+        {
+            return BatchCheck<OrderBookType>{{*this, book}};
+        }
+
+    private:
+        util::FlatHashMap<std::uint64_t, AccountType> m_accounts;
+        LimitsType m_default_limits;
+        std::chrono::nanoseconds m_rate_window;
+        std::uint64_t m_window = 0;
+
+        template<typename OrderBookType>
+        struct Check
+        {
+            PreTradeRisk &risk;
+            OrderBookType &book;
+
+            template<typename T>
+            std::suspend_never operator()(T &&x)
+            {
+                OrderQuantity<OrderType> &executed = x;
+                if (!risk.check_execution(*book.aggressor(), executed))
+                {
+                    book.stop_aggressor();
+                }
+                return {};
+            }
+        };
+
+        template<typename OrderBookType>
+        struct BatchCheck : Check<OrderBookType>
+        {
+            std::size_t check_fills(const OrderType &aggressor, std::span<OrderQuantity<OrderType>> fills)
+            {
+                return this->risk.check_batch(aggressor, fills);
+            }
+        };
+
+        static std::uint64_t account_id_of(const OrderType &order)
+        {
+            return static_cast<std::uint64_t>(owner_of(order));
+        }
+
+        // Account must not be reserved. Adding an account may move the others.
+        AccountType *account_of(std::uint64_t account_id)
+        {
+            auto [account, inserted] = m_accounts.try_emplace(account_id);
+            if (inserted)
+            {
+                account->limits = m_default_limits;
+            }
+            return account;
+        }
+
+        std::uint32_t orders_left_of(const AccountType &account) const
+        {
+            const std::uint32_t orders = (account.window == m_window ? account.orders : 0);
+            return (orders < account.limits.max_orders ? account.limits.max_orders - orders : 0);
+        }
+
+        static QuantityType signed_quantity(Side side, QuantityType quantity)
+        {
+            return (side == Side::Buy ? quantity : static_cast<QuantityType>(-quantity));
+        }
+
+        static NotionalType abs_price_of(PriceType price)
+        {
+            return static_cast<NotionalType>(price < 0 ? -price : price);
+        }
+
+        // Quantity within position and notional headroom at price
+        static QuantityType quantity_within(QuantityType position_room, NotionalType notional_room, PriceType price, QuantityType quantity)
+        {
+            const NotionalType abs_price = std::max<NotionalType>(abs_price_of(price), 1);
+            const QuantityType notional_quantity = static_cast<QuantityType>(
+                std::min<NotionalType>(notional_room / abs_price, static_cast<NotionalType>(quantity)));
+            return std::min({quantity, position_room, notional_quantity});
+        }
+
+        // Branch-free: each limit gives headroom, and we take the smallest
+        static QuantityType allowed_quantity(const AccountType &account, Side side, PriceType price, QuantityType quantity)
+        {
+            const QuantityType position_room = std::max<QuantityType>(account.limits.max_position - signed_quantity(side, account.position), 0);
+            const NotionalType notional_room = std::max<NotionalType>(account.limits.max_notional - account.notional, 0);
+            return quantity_within(position_room, notional_room, price, quantity);
+        }
+
+        static void commit(AccountType &account, Side side, PriceType price, QuantityType quantity)
+        {
+            commit_position(account, side, quantity);
+            account.notional += abs_price_of(price) * static_cast<NotionalType>(quantity);
+        }
+
+        static void commit_position(AccountType &account, Side side, QuantityType quantity)
+        {
+            account.position += signed_quantity(side, quantity);
+        }
+
+        static void commit_batch(AccountType &account, Side side, std::span<OrderQuantity<OrderType>> fills, QuantityType total)
+        {
+            NotionalType notional = 0;
+            for (const auto &executed : fills)
+            {
+                notional += abs_price_of(price_of(executed)) * static_cast<NotionalType>(executed.quantity);
+            }
+            commit_position(account, side, total);
+            account.notional += notional;
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_RISK_HPP
@@ -0,0 +1,140 @@
+#ifndef INCLUDED_ORDERBOOK_SCHEDULER_HPP
+#define INCLUDED_ORDERBOOK_SCHEDULER_HPP
+
+#include "concepts.hpp"
+#include "orderbook.hpp"
+
+#include "util/generator.hpp"
+#include "util/scheduler.hpp"
+
+#include <deque>
+#include <functional>
+#include <optional>
+#include <vector>
+
+
+namespace sadhbhcraft::orderbook
+{
+    // Pipelines matching of many order books on single thread.
+    //
+    // Each book has a queue of incoming orders, and at most one of them is
+    // being matched at any time, so orders of the same book are matched in
+    // order of submission. When matching is suspended on asynchronous
+    // `ExecutionPolicy` (e.g. util::AsyncDeferred), the book is parked, and we
+    // move on to match other books. Parked book continues once the event loop
+    // resumes its matching coroutine.
+    template<typename _OrderBookType, typename _ExecutionPolicy>
+    requires ExecutionPolicyConcept<_ExecutionPolicy &, OrderQuantity<typename _OrderBookType::OrderType>>
+    class OrderBookScheduler
+    {
+    public:
+        typedef _OrderBookType OrderBookType;
+        typedef _ExecutionPolicy ExecutionPolicy;
+        typedef typename OrderBookType::OrderType OrderType;
+        typedef OrderQuantity<OrderType> ExecutionType;
+
+        OrderBookScheduler(util::EventLoop &loop, ExecutionPolicy &execution_policy)
+            : m_loop(loop), m_execution_policy(execution_policy)
+        {}
+
+        size_t add_book(OrderBookType &book)
+        {
+            m_books.emplace_back(book);
+            return m_books.size() - 1;
+        }
+
+        void submit(size_t book_index, OrderType &order)
+        {
+            m_books[book_index].orders.emplace_back(order);
+        }
+
+        // Matches every book until it gets parked or runs out of orders, and
+        // then resumes books whose asynchronous operations have completed.
+        // Handler is called for every execution as:
+        //
+        //      handler(book_index, execution);
+        //
+        template<typename Handler>
+        void run_once(Handler &&handler)
+        {
+            for (size_t book_index = 0; book_index != m_books.size(); ++book_index)
+            {
+                drive(book_index, handler);
+            }
+            m_loop.run_once();
+        }
+
+        template<typename Handler>
+        void run(Handler &&handler)
+        {
+            while (!idle())
+            {
+                run_once(handler);
+            }
+        }
+
+        bool idle() const
+        {
+            for (const auto &slot : m_books)
+            {
+                if (slot.matching || !slot.orders.empty())
+                {
+                    return false;
+                }
+            }
+            return m_loop.empty();
+        }
+
+        const OrderBookType &book(size_t book_index) const { return m_books[book_index].book; }
+        size_t size() const { return m_books.size(); }
+
+    private:
+        struct BookSlot
+        {
+            BookSlot(OrderBookType &book): book(book)
+            {}
+
+            OrderBookType &book;
+            std::deque<std::reference_wrapper<OrderType>> orders;
+            std::optional<util::Generator<ExecutionType>> matching;
+        };
+
+        util::EventLoop &m_loop;
+        ExecutionPolicy &m_execution_policy;
+        std::deque<BookSlot> m_books;
+
+        template<typename Handler>
+        void drive(size_t book_index, Handler &handler)
+        {
+            BookSlot &slot = m_books[book_index];
+
+            for (;;)
+            {
+                if (!slot.matching)
+                {
+                    if (slot.orders.empty())
+                    {
+                        return;
+                    }
+                    slot.matching.emplace(slot.book.accept_order(slot.orders.front().get(), m_execution_policy));
+                    slot.orders.pop_front();
+                }
+
+                auto &executions = *slot.matching;
+                if (executions.is_pending())
+                {
+                    return; //< Parked, and event loop will resume it
+                }
+                if (!executions)
+                {
+                    slot.matching.reset();
+                    continue;
+                }
+
+                handler(book_index, executions());
+            }
+        }
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_ORDERBOOK_SCHEDULER_HPP
@@ -29,6 +29,59 @@ namespace sadhbhcraft::orderbook
         static auto quantity(const OrderType &o) { return o.quantity; }
     };
 
+    template<typename T> struct StopPriceTrait { };
+
+    template<OrderConcept OrderType>
+    struct StopPriceTrait<OrderType>
+    {
+        // Stop (market) order has no limit price, so price is its stop price
+        static auto stop_price(const OrderType &o) { return o.price; }
+    };
+
+    template<StopOrderConcept OrderType>
+    struct StopPriceTrait<OrderType>
+    {
+        static auto stop_price(const OrderType &o) { return o.stop_price; }
+    };
+
+    template<typename T> struct DisplayQuantityTrait { };
+
+    template<OrderConcept OrderType>
+    struct DisplayQuantityTrait<OrderType>
+    {
+        static auto display_quantity(const OrderType &o) { return o.quantity; }
+    };
+
+    template<IcebergOrderConcept OrderType>
+    struct DisplayQuantityTrait<OrderType>
+    {
+        // Iceberg order with zero display quantity is a regular order
+        static auto display_quantity(const OrderType &o) { return o.display_quantity ? o.display_quantity : o.quantity; }
+    };
+
+    // Specialize for order types, which have owner (account) under different
+    // name, e.g. for `struct MyOrder { ... int userid; }`:
+    //
+    //      template<> struct OwnerTrait<MyOrder>
+    //      {
+    //          static auto owner(const MyOrder &o) { return o.userid; }
+    //      };
+    //
+    template<typename T> struct OwnerTrait { };
+
+    template<OwnerMemberConcept OrderType>
+    struct OwnerTrait<OrderType>
+    {
+        static auto owner(const OrderType &o) { return o.owner; }
+    };
+
+    template<typename T>
+    concept OwnedOrderConcept =
+        OrderConcept<T> &&
+        requires(const T &x) {
+            { OwnerTrait<T>::owner(x) } -> std::equality_comparable;
+        };
+
     template<typename T>
     auto price_of(const T &x)
     {
@@ -41,5 +94,23 @@ namespace sadhbhcraft::orderbook
         return QuantityTrait<T>::quantity(x);
     }
 
+    template<typename T>
+    auto display_quantity_of(const T &x)
+    {
+        return DisplayQuantityTrait<T>::display_quantity(x);
+    }
+
+    template<typename T>
+    auto owner_of(const T &x)
+    {
+        return OwnerTrait<T>::owner(x);
+    }
+
+    template<typename T>
+    auto stop_price_of(const T &x)
+    {
+        return StopPriceTrait<T>::stop_price(x);
+    }
+
 }; // end of namespace
 #endif//INCLUDED_TRAITS_HPP
\ No newline at end of file
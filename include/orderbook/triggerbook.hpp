@@ -0,0 +1,211 @@
+#ifndef INCLUDED_TRIGGERBOOK_HPP
+#define INCLUDED_TRIGGERBOOK_HPP
+
+#include "enums.hpp"
+#include "concepts.hpp"
+#include "traits.hpp"
+#include "pricelevelstack.hpp"
+
+#include "util/concepts.hpp"
+
+#include <deque>
+#include <functional>
+#include <optional>
+
+
+namespace sadhbhcraft::orderbook
+{
+    // Stop orders waiting for their stop price, in order of arrival
+    template<OrderConcept _OrderType, template <typename> class _QueueType>
+    requires util::IsQueue<_QueueType, std::reference_wrapper<_OrderType>>::value
+    class StopTriggerLevel
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef typename _OrderType::PriceType PriceType;
+        template<typename T> using QueueType = _QueueType<T>;
+
+        StopTriggerLevel(PriceType stop_price): m_stop_price(stop_price)
+        {}
+
+        void add_order(OrderType &order)
+        {
+            m_orders.emplace_back(order);
+        }
+
+        template<typename Output>
+        void take_orders(Output &output)
+        {
+            for (auto &order : m_orders)
+            {
+                output.emplace_back(order);
+            }
+            m_orders.clear();
+        }
+
+        auto price() const { return m_stop_price; }
+
+        auto begin() const { return m_orders.begin(); }
+        auto end() const { return m_orders.end(); }
+
+        size_t size() const { return m_orders.size(); }
+        bool empty() const { return m_orders.empty(); }
+
+    private:
+        QueueType<std::reference_wrapper<OrderType>> m_orders;
+        PriceType m_stop_price;
+    };
+
+    template<OrderConcept OrderType, template <typename> class QueueType>
+    struct PriceTrait<StopTriggerLevel<OrderType, QueueType>>
+    {
+        static auto price(const StopTriggerLevel<OrderType, QueueType> &stl) { return stl.price(); }
+    };
+
+    // Stop orders of one side sorted by stop price, so that the next stop to
+    // trigger is always at the top. Buy stops trigger when price rises to stop
+    // price, so they are sorted ascending (like Ask), and Sell stops trigger when
+    // price falls to stop price, so they are sorted descending (like Bid).
+    template<Side MySide, OrderConcept _OrderType,
+        template <typename> class _StackType,
+        template <typename> class _QueueType>
+    requires util::IsRandomStack<_StackType, StopTriggerLevel<_OrderType, _QueueType>>::value
+    class StopTriggerStack
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        typedef StopTriggerLevel<OrderType, _QueueType> LevelType;
+        static constexpr Side CompareSide = (MySide == Side::Buy ? Side::Sell : Side::Buy);
+
+        void add_order(OrderType &order)
+        {
+            auto stop_price = stop_price_of(order);
+            auto level_iterator = std::lower_bound(
+                m_levels.begin(), m_levels.end(), stop_price, PriceLevelCompare<CompareSide>());
+
+            if (level_iterator == m_levels.end() || price_of(*level_iterator) != stop_price)
+            {
+                level_iterator = m_levels.emplace(level_iterator, stop_price);
+            }
+            level_iterator->add_order(order);
+        }
+
+        // Single comparison against the next stop price to trigger
+        bool is_triggered(PriceType last_trade_price) const
+        {
+            PriceLevelCompare<CompareSide> price_compare;
+            return !m_levels.empty() && !price_compare(last_trade_price, m_levels.front());
+        }
+
+        // Move all stops triggered by the trade price to the output queue,
+        // ordered by stop price and then by time of arrival
+        template<typename Output>
+        void take_triggered(PriceType last_trade_price, Output &output)
+        {
+            auto it = m_levels.begin();
+            PriceLevelCompare<CompareSide> price_compare;
+
+            for (; it != m_levels.end() && !price_compare(last_trade_price, *it); ++it)
+            {
+                it->take_orders(output);
+            }
+
+            m_levels.erase(m_levels.begin(), it);
+        }
+
+        constexpr Side side() const { return MySide; }
+
+        auto begin() const { return m_levels.begin(); }
+        auto end() const { return m_levels.end(); }
+
+        const auto &top() const { return m_levels.front(); }
+
+        size_t size() const { return m_levels.size(); }
+        bool empty() const { return m_levels.empty(); }
+
+    private:
+        _StackType<LevelType> m_levels;
+    };
+
+    // Both sides of stop orders resting away from the order book
+    template<OrderConcept _OrderType,
+        template <typename> class StackType = std::deque,
+        template <typename> class QueueType = std::deque>
+    class StopTriggerBook
+    {
+    public:
+        typedef _OrderType OrderType;
+        typedef typename OrderType::PriceType PriceType;
+        using BuyStopsType = StopTriggerStack<Side::Buy, OrderType, StackType, QueueType>;
+        using SellStopsType = StopTriggerStack<Side::Sell, OrderType, StackType, QueueType>;
+
+        void add_order(OrderType &order)
+        {
+            if (order.side == Side::Buy)
+            {
+                m_buy_stops.add_order(order);
+            }
+            else
+            {
+                m_sell_stops.add_order(order);
+            }
+        }
+
+        // Tells whether stop price of an incoming stop order has already been
+        // crossed by the last trade, and it should be activated immediately
+        static bool is_crossed(const OrderType &order, std::optional<PriceType> last_trade_price)
+        {
+            if (!last_trade_price)
+            {
+                return false;
+            }
+            if (order.side == Side::Buy)
+            {
+                return stop_price_of(order) <= *last_trade_price;
+            }
+            else
+            {
+                return *last_trade_price <= stop_price_of(order);
+            }
+        }
+
+        bool is_triggered(PriceType last_trade_price) const
+        {
+            return m_buy_stops.is_triggered(last_trade_price) || m_sell_stops.is_triggered(last_trade_price);
+        }
+
+        template<typename Output>
+        void take_triggered(PriceType last_trade_price, Output &output)
+        {
+            m_buy_stops.take_triggered(last_trade_price, output);
+            m_sell_stops.take_triggered(last_trade_price, output);
+        }
+
+        const auto &buy_stops() const { return m_buy_stops; }
+        const auto &sell_stops() const { return m_sell_stops; }
+
+        bool empty() const { return m_buy_stops.empty() && m_sell_stops.empty(); }
+
+    private:
+        BuyStopsType m_buy_stops;
+        SellStopsType m_sell_stops;
+    };
+
+    // Book side policy may choose containers for stop orders too, by
+    // providing `StopBookType` (see `CompactBookSidePolicy`)
+    template<typename BookSidePolicy, OrderConcept OrderType>
+    struct StopBookOf
+    {
+        typedef StopTriggerBook<OrderType> type;
+    };
+
+    template<typename BookSidePolicy, OrderConcept OrderType>
+    requires requires { typename BookSidePolicy::template StopBookType<OrderType>; }
+    struct StopBookOf<BookSidePolicy, OrderType>
+    {
+        typedef typename BookSidePolicy::template StopBookType<OrderType> type;
+    };
+
+} // end of namespace sadhbhcraft::orderbook
+#endif//INCLUDED_TRIGGERBOOK_HPP
@@ -13,7 +13,7 @@
 // - AsyncImmediate -- which applies function to argument and returns immediately
 //
 // ...something else user-defined could be true async, e.g. send request to a
-// micro-service and await response (this is not in the scope)
+// micro-service and await response (see AsyncDeferred in scheduler.hpp)
 
 #include <coroutine>
 #include <utility>
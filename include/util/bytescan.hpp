@@ -0,0 +1,139 @@
+#ifndef INCLUDED_BYTESCAN_HPP
+#define INCLUDED_BYTESCAN_HPP
+
+//
+// Scanning of byte buffers for delimiters using SIMD.
+//
+// Text protocols (FIX tag=value, CSV) are split by one or two delimiter bytes,
+// and fields are short, so calling memchr() for each delimiter would load the
+// same bytes over and over. Instead DelimiterScanner compares whole 16 byte
+// block against all delimiters at once, keeps resulting bit mask, and then
+// hands out delimiter positions one by one from the mask.
+//
+// With SSE2 a block is compared by a few instructions, and otherwise we fall
+// back to scalar loop building the same mask. Scanner never reads past the
+// end of the buffer, so it is safe to use on untrusted input.
+//
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace sadhbhcraft::util
+{
+#if defined(__SSE2__)
+    constexpr bool simd_available = true;
+#else
+    constexpr bool simd_available = false;
+#endif
+
+    template<bool Vectorised, char... Delimiters>
+    class BasicDelimiterScanner
+    {
+        static_assert(sizeof...(Delimiters) > 0, "Need at least one delimiter");
+        static_assert(!Vectorised || simd_available, "SIMD is not available on this target");
+
+    public:
+        static constexpr std::size_t block_size = 16;
+
+        BasicDelimiterScanner(const char *first, const char *last)
+            : m_block(first), m_last(last), m_mask(0)
+        {
+            if (m_block < m_last)
+            {
+                load();
+            }
+        }
+
+        // Position of next delimiter, or end of buffer when there are no more
+        const char *next()
+        {
+            while (!m_mask)
+            {
+                if (m_last - m_block <= static_cast<std::ptrdiff_t>(block_size))
+                {
+                    m_block = m_last;
+                    return m_last;
+                }
+                m_block += block_size;
+                load();
+            }
+
+            const char *p = m_block + std::countr_zero(m_mask);
+            m_mask &= m_mask - 1;
+            return p;
+        }
+
+    private:
+        const char *m_block;
+        const char *m_last;
+        std::uint32_t m_mask;
+
+        void load()
+        {
+            const std::size_t n = static_cast<std::size_t>(m_last - m_block);
+
+            if constexpr (Vectorised)
+            {
+#if defined(__SSE2__)
+                if (n >= block_size)
+                {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(m_block));
+                    __m128i hits = _mm_setzero_si128();
+                    ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(Delimiters)))), ...);
+                    m_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+                    return;
+                }
+#endif
+            }
+
+            // Scalar fallback and tail of the buffer shorter than a block
+            std::uint32_t mask = 0;
+            const std::size_t count = (n < block_size ? n : block_size);
+            for (std::size_t i = 0; i != count; ++i)
+            {
+                const char c = m_block[i];
+                mask |= static_cast<std::uint32_t>(((c == Delimiters) || ...)) << i;
+            }
+            m_mask = mask;
+        }
+    };
+
+    template<char... Delimiters>
+    using DelimiterScanner = BasicDelimiterScanner<simd_available, Delimiters...>;
+
+    // Sum of bytes modulo 2^32, e.g. for FIX checksum
+    template<bool Vectorised = simd_available>
+    std::uint32_t byte_sum(const char *first, const char *last)
+    {
+        std::uint32_t sum = 0;
+
+        if constexpr (Vectorised)
+        {
+#if defined(__SSE2__)
+            // Sum of absolute differences against zero adds up each 8 bytes
+            __m128i acc = _mm_setzero_si128();
+            for (; last - first >= 16; first += 16)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+                acc = _mm_add_epi64(acc, _mm_sad_epu8(bytes, _mm_setzero_si128()));
+            }
+            sum = static_cast<std::uint32_t>(_mm_cvtsi128_si32(acc))
+                + static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#endif
+        }
+
+        for (; first != last; ++first)
+        {
+            sum += static_cast<unsigned char>(*first);
+        }
+        return sum;
+    }
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_BYTESCAN_HPP
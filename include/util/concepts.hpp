@@ -3,6 +3,8 @@
 
 #include <concepts>
 #include <coroutine>
+#include <cstddef>
+#include <string_view>
 #include <type_traits>
 
 
@@ -74,5 +76,15 @@ namespace sadhbhcraft::util
             static constexpr bool value = test<T<A>>();
         };
 
+    // Window of bytes, which is consumed from the front and refilled at the
+    // back, e.g. ChunkedFileSource
+    template<typename T>
+    concept ByteSourceConcept =
+        requires(T x, std::size_t n) {
+            { x.data() } -> std::convertible_to<std::string_view>;
+            { x.consume(n) };
+            { x.fill() } -> std::convertible_to<bool>;
+        };
+
 }// end of namespace sadhbhcraft::util
 #endif//INCLUDED_UTIL_CONCEPTS_HPP
@@ -0,0 +1,93 @@
+#ifndef INCLUDED_FENWICK_HPP
+#define INCLUDED_FENWICK_HPP
+
+//
+// Fenwick (binary indexed) tree of running sums
+//
+//      FenwickTree<long> tree;
+//      tree.push_back(5);
+//      tree.push_back(7);
+//      tree.add(0, -2);
+//      tree.prefix(1);         // 3, i.e. sum of elements before index 1
+//
+// Update of an element, and sum of elements before an index, are both
+// O(log n). Appending is O(log n) too, so that tree can grow at the back as
+// a queue does, and `assign()` builds tree from values in O(n).
+//
+// Storage comes from default memory resource at the time tree is created,
+// same as levels of the book.
+//
+// NOTE: Unsigned values may be decreased by adding wrapped negative delta,
+// as sums are correct modulo 2^n, and so is every prefix that's in range.
+//
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+
+namespace sadhbhcraft::util
+{
+    template<typename T>
+    class FenwickTree
+    {
+    public:
+        typedef T value_type;
+
+        void push_back(T value)
+        {
+            // Node i covers (i - lowbit(i), i], and all but the last element
+            // of that range are already in the tree
+            const std::size_t i = m_tree.size() + 1;
+            const std::size_t first = i - (i & (~i + 1));
+            m_tree.push_back(value + prefix(i - 1) - prefix(first));
+        }
+
+        // Adds delta to element at index
+        void add(std::size_t index, T delta)
+        {
+            for (std::size_t i = index + 1; i <= m_tree.size(); i += (i & (~i + 1)))
+            {
+                m_tree[i - 1] += delta;
+            }
+        }
+
+        // Sum of elements before index
+        T prefix(std::size_t index) const
+        {
+            T sum{};
+            for (std::size_t i = index; i; i &= i - 1)
+            {
+                sum += m_tree[i - 1];
+            }
+            return sum;
+        }
+
+        // Rebuilds tree from range of values in O(n)
+        template<typename Iterator>
+        void assign(Iterator first, Iterator last)
+        {
+            m_tree.assign(first, last);
+            for (std::size_t i = 1; i <= m_tree.size(); ++i)
+            {
+                const std::size_t parent = i + (i & (~i + 1));
+                if (parent <= m_tree.size())
+                {
+                    m_tree[parent - 1] += m_tree[i - 1];
+                }
+            }
+        }
+
+        T total() const { return prefix(m_tree.size()); }
+
+        void clear() { m_tree.clear(); }
+
+        std::size_t size() const { return m_tree.size(); }
+        bool empty() const { return m_tree.empty(); }
+
+    private:
+        std::pmr::vector<T> m_tree;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_FENWICK_HPP
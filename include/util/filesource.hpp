@@ -0,0 +1,221 @@
+#ifndef INCLUDED_FILESOURCE_HPP
+#define INCLUDED_FILESOURCE_HPP
+
+//
+// Sources of bytes for streaming large input files with constant memory.
+//
+// Both sources present window of bytes not yet consumed:
+//
+//      auto data = source.data();      // View of unconsumed bytes
+//      source.consume(n);              // We've done with first n bytes
+//      source.fill();                  // Need more, returns false at the end
+//
+// ChunkedFileSource reads file in big chunks into page aligned buffer of
+// fixed size. Bytes left unconsumed at the end of the buffer (e.g. record
+// split by chunk boundary) are carried over just in front of the next
+// chunk, so that reads always land on aligned offsets both in the buffer and
+// in the file.
+//
+// MappedFileSource maps whole file, so that data() spans the rest of the
+// file, and it releases pages behind consumed position, so that resident
+// memory doesn't grow with the file size either.
+//
+// NOTE: Sources don't throw, and failure to open file is reported by
+// is_open().
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace sadhbhcraft::util
+{
+    class ChunkedFileSource
+    {
+    public:
+        static constexpr std::size_t page_size = 4096;
+        static constexpr std::size_t default_chunk_size = std::size_t(1) << 20;
+
+        explicit ChunkedFileSource(const char *path, std::size_t chunk_size = default_chunk_size)
+            : m_chunk_size((std::max(chunk_size, page_size) + page_size - 1) / page_size * page_size)
+        {
+            m_fd = ::open(path, O_RDONLY);
+            if (m_fd < 0)
+            {
+                return;
+            }
+            // Let the kernel read ahead, so that I/O overlaps with parsing
+            ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            // Room for carried over bytes in front of the chunk
+            m_buffer = static_cast<char *>(std::aligned_alloc(page_size, 2 * m_chunk_size));
+            m_head = m_tail = m_chunk_size;
+        }
+
+        ChunkedFileSource(const ChunkedFileSource &) = delete;
+        ChunkedFileSource &operator=(const ChunkedFileSource &) = delete;
+
+        ~ChunkedFileSource()
+        {
+            std::free(m_buffer);
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+        }
+
+        bool is_open() const { return m_fd >= 0 && m_buffer; }
+
+        std::string_view data() const { return std::string_view(m_buffer + m_head, m_tail - m_head); }
+
+        void consume(std::size_t n) { m_head += std::min(n, m_tail - m_head); }
+
+        // Read next chunk. Returns false at the end of file, on read error,
+        // or when unconsumed bytes don't fit in front of the next chunk, i.e.
+        // single record is larger than chunk.
+        bool fill()
+        {
+            const std::size_t carry = m_tail - m_head;
+            if (!is_open() || m_eof || carry > m_chunk_size)
+            {
+                return false;
+            }
+
+            std::memmove(m_buffer + m_chunk_size - carry, m_buffer + m_head, carry);
+            m_head = m_chunk_size - carry;
+            m_tail = m_chunk_size;
+
+            while (m_tail != 2 * m_chunk_size)
+            {
+                const ssize_t n = ::read(m_fd, m_buffer + m_tail, 2 * m_chunk_size - m_tail);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    m_eof = true;
+                    m_error = (n < 0);
+                    break;
+                }
+                m_tail += static_cast<std::size_t>(n);
+            }
+
+            return m_tail != m_chunk_size;
+        }
+
+        bool eof() const { return m_eof; }
+        bool error() const { return m_error; }
+
+        // Memory used is fixed regardless of file size
+        std::size_t buffer_size() const { return 2 * m_chunk_size; }
+        std::size_t chunk_size() const { return m_chunk_size; }
+
+    private:
+        std::size_t m_chunk_size;
+        int m_fd = -1;
+        char *m_buffer = nullptr;
+        std::size_t m_head = 0;
+        std::size_t m_tail = 0;
+        bool m_eof = false;
+        bool m_error = false;
+    };
+
+    class MappedFileSource
+    {
+    public:
+        // Release pages behind consumed position in steps of this size
+        static constexpr std::size_t release_step = std::size_t(64) << 20;
+
+        explicit MappedFileSource(const char *path)
+        {
+            m_fd = ::open(path, O_RDONLY);
+            if (m_fd < 0)
+            {
+                return;
+            }
+
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0)
+            {
+                close();
+                return;
+            }
+
+            m_size = static_cast<std::size_t>(st.st_size);
+            if (m_size)
+            {
+                void *p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+                if (p == MAP_FAILED)
+                {
+                    close();
+                    return;
+                }
+                m_data = static_cast<const char *>(p);
+                ::madvise(p, m_size, MADV_SEQUENTIAL);
+            }
+        }
+
+        MappedFileSource(const MappedFileSource &) = delete;
+        MappedFileSource &operator=(const MappedFileSource &) = delete;
+
+        ~MappedFileSource()
+        {
+            if (m_data)
+            {
+                ::munmap(const_cast<char *>(m_data), m_size);
+            }
+            close();
+        }
+
+        bool is_open() const { return m_fd >= 0; }
+
+        std::string_view data() const { return std::string_view(m_data + m_position, m_size - m_position); }
+
+        void consume(std::size_t n)
+        {
+            m_position += std::min(n, m_size - m_position);
+
+            if (m_position - m_released >= release_step)
+            {
+                const std::size_t release_end = m_position / release_step * release_step;
+                ::madvise(const_cast<char *>(m_data) + m_released, release_end - m_released, MADV_DONTNEED);
+                m_released = release_end;
+            }
+        }
+
+        // Whole file is already there
+        bool fill() { return false; }
+
+        bool eof() const { return true; }
+        bool error() const { return false; }
+
+    private:
+        int m_fd = -1;
+        const char *m_data = nullptr;
+        std::size_t m_size = 0;
+        std::size_t m_position = 0;
+        std::size_t m_released = 0;
+
+        void close()
+        {
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_FILESOURCE_HPP
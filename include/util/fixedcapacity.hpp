@@ -0,0 +1,354 @@
+#ifndef INCLUDED_FIXEDCAPACITY_HPP
+#define INCLUDED_FIXEDCAPACITY_HPP
+
+//
+// Stack and queue with fixed capacity and inline storage
+//
+//      FixedStack<Level, 64> levels;       // RandomStackConcept
+//      FixedQueue<Order, 32> orders;       // QueueConcept
+//
+// Neither ever allocates, and size of the object is all the memory it will
+// ever use, so that structure holding them has footprint known at compile
+// time, and can be placed in pinned, prefaulted memory.
+//
+// Elements are contiguous, and iterators are plain pointers. Stack keeps
+// elements in [0, size), and inserting in the middle moves elements behind
+// it. Queue keeps elements in [head, tail), popping from the front only
+// advances head, and elements are moved to the front once tail reaches
+// capacity.
+//
+// NOTE: Inserting into full container is an error, and callers must check
+// `full()` first (see `FixedBookSide`).
+//
+// NOTE: Elements don't need to be default constructible, same as for
+// `SmallQueue`.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace sadhbhcraft::util
+{
+    template<typename T, std::size_t N>
+    class FixedStack
+    {
+        static_assert(N > 0, "FixedStack needs capacity");
+
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+        typedef std::size_t size_type;
+
+        static constexpr size_type fixed_capacity = N;
+
+        FixedStack() noexcept = default;
+
+        FixedStack(const FixedStack &other)
+        {
+            std::uninitialized_copy(other.begin(), other.end(), data());
+            m_size = other.m_size;
+        }
+
+        FixedStack(FixedStack &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            std::uninitialized_move(other.begin(), other.end(), data());
+            m_size = other.m_size;
+            other.clear();
+        }
+
+        FixedStack &operator=(const FixedStack &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                std::uninitialized_copy(other.begin(), other.end(), data());
+                m_size = other.m_size;
+            }
+            return *this;
+        }
+
+        FixedStack &operator=(FixedStack &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &other)
+            {
+                clear();
+                std::uninitialized_move(other.begin(), other.end(), data());
+                m_size = other.m_size;
+                other.clear();
+            }
+            return *this;
+        }
+
+        ~FixedStack() { clear(); }
+
+        template<typename... Args>
+        iterator emplace(const_iterator pos, Args &&...args)
+        {
+            assert(!full());
+            T *p = const_cast<T *>(pos);
+            T *e = end();
+
+            if (p == e)
+            {
+                ::new (static_cast<void *>(e)) T(std::forward<Args>(args)...);
+            }
+            else
+            {
+                // Constructed first, as args may refer to element that moves
+                T x(std::forward<Args>(args)...);
+                ::new (static_cast<void *>(e)) T(std::move(e[-1]));
+                std::move_backward(p, e - 1, e);
+                *p = std::move(x);
+            }
+            ++m_size;
+            return p;
+        }
+
+        template<typename... Args>
+        reference emplace_back(Args &&...args) { return *emplace(end(), std::forward<Args>(args)...); }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            T *f = const_cast<T *>(first);
+            T *l = const_cast<T *>(last);
+
+            if (f == l)
+            {
+                return f;
+            }
+
+            T *out = std::move(l, end(), f);
+            std::destroy(out, end());
+            m_size -= (l - f);
+            return f;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+        void pop_back()
+        {
+            std::destroy_at(end() - 1);
+            --m_size;
+        }
+
+        void clear() noexcept
+        {
+            std::destroy(begin(), end());
+            m_size = 0;
+        }
+
+        reference front() { return data()[0]; }
+        const_reference front() const { return data()[0]; }
+        reference back() { return data()[m_size - 1]; }
+        const_reference back() const { return data()[m_size - 1]; }
+
+        reference operator[](size_type i) { return data()[i]; }
+        const_reference operator[](size_type i) const { return data()[i]; }
+
+        iterator begin() noexcept { return data(); }
+        iterator end() noexcept { return data() + m_size; }
+        const_iterator begin() const noexcept { return data(); }
+        const_iterator end() const noexcept { return data() + m_size; }
+
+        size_type size() const noexcept { return m_size; }
+        bool empty() const noexcept { return m_size == 0; }
+        bool full() const noexcept { return m_size == N; }
+        static constexpr size_type capacity() noexcept { return N; }
+
+    private:
+        alignas(T) std::byte m_storage[N * sizeof(T)];
+        size_type m_size = 0;
+
+        T *data() noexcept { return std::launder(reinterpret_cast<T *>(m_storage)); }
+        const T *data() const noexcept { return std::launder(reinterpret_cast<const T *>(m_storage)); }
+    };
+
+    template<typename T, std::size_t N>
+    class FixedQueue
+    {
+        static_assert(N > 0, "FixedQueue needs capacity");
+
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+        typedef std::size_t size_type;
+
+        static constexpr size_type fixed_capacity = N;
+
+        FixedQueue() noexcept = default;
+
+        FixedQueue(const FixedQueue &other)
+        {
+            std::uninitialized_copy(other.begin(), other.end(), data());
+            m_tail = other.size();
+        }
+
+        FixedQueue(FixedQueue &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            std::uninitialized_move(other.begin(), other.end(), data());
+            m_tail = other.size();
+            other.clear();
+        }
+
+        FixedQueue &operator=(const FixedQueue &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                std::uninitialized_copy(other.begin(), other.end(), data());
+                m_tail = other.size();
+            }
+            return *this;
+        }
+
+        FixedQueue &operator=(FixedQueue &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &other)
+            {
+                clear();
+                std::uninitialized_move(other.begin(), other.end(), data());
+                m_tail = other.size();
+                other.clear();
+            }
+            return *this;
+        }
+
+        ~FixedQueue() { clear(); }
+
+        template<typename... Args>
+        reference emplace_back(Args &&...args)
+        {
+            assert(!full());
+            if (m_tail == N)
+            {
+                compact();
+            }
+            T *p = ::new (static_cast<void *>(data() + m_tail)) T(std::forward<Args>(args)...);
+            ++m_tail;
+            return *p;
+        }
+
+        void push_back(const T &x) { emplace_back(x); }
+        void push_back(T &&x) { emplace_back(std::move(x)); }
+
+        void pop_front()
+        {
+            std::destroy_at(data() + m_head);
+            if (++m_head == m_tail)
+            {
+                m_head = m_tail = 0;
+            }
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            T *f = const_cast<T *>(first);
+            T *l = const_cast<T *>(last);
+
+            if (f == l)
+            {
+                return f;
+            }
+
+            if (f == begin())
+            {
+                // Matching removes filled orders from the front
+                std::destroy(f, l);
+                m_head += (l - f);
+                if (m_head == m_tail)
+                {
+                    m_head = m_tail = 0;
+                    return end();
+                }
+                return begin();
+            }
+
+            T *out = std::move(l, end(), f);
+            std::destroy(out, end());
+            m_tail -= (l - f);
+            return f;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+        void clear() noexcept
+        {
+            std::destroy(begin(), end());
+            m_head = m_tail = 0;
+        }
+
+        reference front() { return data()[m_head]; }
+        const_reference front() const { return data()[m_head]; }
+        reference back() { return data()[m_tail - 1]; }
+        const_reference back() const { return data()[m_tail - 1]; }
+
+        reference operator[](size_type i) { return data()[m_head + i]; }
+        const_reference operator[](size_type i) const { return data()[m_head + i]; }
+
+        iterator begin() noexcept { return data() + m_head; }
+        iterator end() noexcept { return data() + m_tail; }
+        const_iterator begin() const noexcept { return data() + m_head; }
+        const_iterator end() const noexcept { return data() + m_tail; }
+
+        size_type size() const noexcept { return m_tail - m_head; }
+        bool empty() const noexcept { return m_tail == m_head; }
+        bool full() const noexcept { return size() == N; }
+        static constexpr size_type capacity() noexcept { return N; }
+
+    private:
+        alignas(T) std::byte m_storage[N * sizeof(T)];
+        size_type m_head = 0;
+        size_type m_tail = 0;
+
+        T *data() noexcept { return std::launder(reinterpret_cast<T *>(m_storage)); }
+        const T *data() const noexcept { return std::launder(reinterpret_cast<const T *>(m_storage)); }
+
+        // Moves elements down to the front (ranges may overlap). Slots below
+        // head are raw storage, slots at or above head are live.
+        void compact()
+        {
+            const size_type n = size();
+            T *p = data();
+            for (size_type i = 0; i != n; ++i)
+            {
+                if (i < m_head)
+                {
+                    ::new (static_cast<void *>(p + i)) T(std::move(p[m_head + i]));
+                }
+                else
+                {
+                    p[i] = std::move(p[m_head + i]);
+                }
+            }
+            std::destroy(p + std::max(n, m_head), p + m_head + n);
+            m_head = 0;
+            m_tail = n;
+        }
+    };
+
+    template<std::size_t N>
+    struct FixedStackOf
+    {
+        template<typename T> using type = FixedStack<T, N>;
+    };
+
+    template<std::size_t N>
+    struct FixedQueueOf
+    {
+        template<typename T> using type = FixedQueue<T, N>;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_FIXEDCAPACITY_HPP
@@ -0,0 +1,224 @@
+#ifndef INCLUDED_FLATMAP_HPP
+#define INCLUDED_FLATMAP_HPP
+
+//
+// Flat open-addressing hash map for compact integer keys (account ids, order
+// ids, etc.)
+//
+// Slots hold key and value side by side in a single array, which is probed
+// linearly, so lookup of a present key is typically a single cache line.
+// Capacity is always a power of two, and keys are spread by Fibonacci hashing.
+// Erase shifts following entries back instead of leaving tombstones, so
+// probe sequences don't degrade over time.
+//
+// NOTE: Maximum value of the key type is reserved to mark empty slots. It is
+// never found, and `try_emplace()` returns nullptr for it, so callers taking
+// keys from outside must check (see `is_reserved()`).
+//
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+namespace sadhbhcraft::util
+{
+    template<std::unsigned_integral Key, typename Value>
+    requires std::default_initializable<Value> && std::movable<Value>
+    class FlatHashMap
+    {
+    public:
+        typedef Key key_type;
+        typedef Value mapped_type;
+
+        static constexpr Key empty_key = std::numeric_limits<Key>::max();
+
+        struct Slot
+        {
+            Key key = empty_key;
+            Value value{};
+        };
+
+        explicit FlatHashMap(std::size_t capacity = 16)
+        {
+            rehash(std::bit_ceil(std::max<std::size_t>(capacity, 2)));
+        }
+
+        static constexpr bool is_reserved(Key key) { return key == empty_key; }
+
+        Value *find(Key key)
+        {
+            if (is_reserved(key))
+            {
+                return nullptr;
+            }
+            for (std::size_t i = index_of(key); ; i = (i + 1) & m_mask)
+            {
+                Slot &slot = m_slots[i];
+                if (slot.key == key)
+                {
+                    return &slot.value;
+                }
+                if (slot.key == empty_key)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        const Value *find(Key key) const
+        {
+            return const_cast<FlatHashMap *>(this)->find(key);
+        }
+
+        bool contains(Key key) const { return find(key) != nullptr; }
+
+        template<typename... Args>
+        std::pair<Value *, bool> try_emplace(Key key, Args &&...args)
+        {
+            if (is_reserved(key))
+            {
+                return {nullptr, false};
+            }
+
+            // Keep load factor at most 1/2
+            if ((m_size + 1) * 2 > m_slots.size())
+            {
+                rehash(m_slots.size() * 2);
+            }
+
+            for (std::size_t i = index_of(key); ; i = (i + 1) & m_mask)
+            {
+                Slot &slot = m_slots[i];
+                if (slot.key == key)
+                {
+                    return {&slot.value, false};
+                }
+                if (slot.key == empty_key)
+                {
+                    slot.key = key;
+                    slot.value = Value(std::forward<Args>(args)...);
+                    ++m_size;
+                    return {&slot.value, true};
+                }
+            }
+        }
+
+        Value &operator[](Key key)
+        {
+            assert(!is_reserved(key));
+            return *try_emplace(key).first;
+        }
+
+        bool erase(Key key)
+        {
+            if (is_reserved(key))
+            {
+                return false;
+            }
+
+            std::size_t i = index_of(key);
+            for (; m_slots[i].key != key; i = (i + 1) & m_mask)
+            {
+                if (m_slots[i].key == empty_key)
+                {
+                    return false;
+                }
+            }
+
+            // Backward shift deletion: move back any entry, which would be
+            // unreachable after we leave a hole at position i
+            for (std::size_t j = (i + 1) & m_mask; m_slots[j].key != empty_key; j = (j + 1) & m_mask)
+            {
+                std::size_t home = index_of(m_slots[j].key);
+                if (((j - home) & m_mask) >= ((j - i) & m_mask))
+                {
+                    m_slots[i] = std::move(m_slots[j]);
+                    i = j;
+                }
+            }
+
+            m_slots[i].key = empty_key;
+            m_slots[i].value = Value{};
+            --m_size;
+            return true;
+        }
+
+        template<typename F>
+        void for_each(F &&f)
+        {
+            for (auto &slot : m_slots)
+            {
+                if (slot.key != empty_key)
+                {
+                    f(slot.key, slot.value);
+                }
+            }
+        }
+
+        void clear()
+        {
+            for (auto &slot : m_slots)
+            {
+                slot = Slot{};
+            }
+            m_size = 0;
+        }
+
+        void reserve(std::size_t size)
+        {
+            if (size * 2 > m_slots.size())
+            {
+                rehash(std::bit_ceil(size * 2));
+            }
+        }
+
+        std::size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        std::size_t capacity() const { return m_slots.size(); }
+
+    private:
+        std::vector<Slot> m_slots;
+        std::size_t m_mask = 0;
+        std::size_t m_size = 0;
+        int m_shift = 0;
+
+        std::size_t index_of(Key key) const
+        {
+            // Fibonacci hashing: multiply by 2^64/phi and take top bits
+            return static_cast<std::size_t>(
+                (static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> m_shift);
+        }
+
+        void rehash(std::size_t capacity)
+        {
+            std::vector<Slot> slots(capacity);
+            std::swap(slots, m_slots);
+            m_mask = capacity - 1;
+            m_shift = 64 - std::countr_zero(capacity);
+            m_size = 0;
+
+            for (auto &slot : slots)
+            {
+                if (slot.key != empty_key)
+                {
+                    std::size_t i = index_of(slot.key);
+                    while (m_slots[i].key != empty_key)
+                    {
+                        i = (i + 1) & m_mask;
+                    }
+                    m_slots[i] = std::move(slot);
+                    ++m_size;
+                }
+            }
+        }
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_FLATMAP_HPP
@@ -10,11 +10,18 @@
 // type is then stored using std::optional, which does not
 // requie from its value to be constructed at all times.
 //
+// I have also added next() awaitable, so that generators can be nested
+// inside other coroutines, and any of them can be suspended on truly
+// asynchronous operation. Once such operation completes, the innermost
+// coroutine is resumed, and as it yields the control is transferred to
+// coroutines awaiting on it, all the way up.
+//
 // NOTE: C++23 will have <generator> header with generator<T>
 //
 
 #include <coroutine>
 #include <exception>
+#include <utility>
 
 #include "util.hpp"
 
@@ -35,24 +42,54 @@ namespace sadhbhcraft::util
         {
             typename DefaultConstructibleWrapper<T>::type value_;
             std::exception_ptr exception_;
+            bool ready_ = false;
+            std::coroutine_handle<> continuation_;
+            // ^ Coroutine awaiting on next() while we were suspended on
+            // something else than co_yield, i.e. asynchronous ExecutionPolicy.
+            // Once we yield we transfer control straight to it.
     
             Generator get_return_object()
             {
                 return Generator(handle_type::from_promise(*this));
             }
             std::suspend_always initial_suspend() { return {}; }
-            std::suspend_always final_suspend() noexcept { return {}; }
+            auto final_suspend() noexcept { return transfer_awaiter{}; }
             void unhandled_exception() { exception_ = std::current_exception(); } // saving
                                                                                 // exception
     
             template <std::convertible_to<T> From> // C++20 concept
-            std::suspend_always yield_value(From&& from)
+            auto yield_value(From&& from)
             {
                 value_ = std::forward<From>(from); // caching the result in promise
-                return {};
+                ready_ = true;
+                return transfer_awaiter{};
             }
             void return_void() { }
         };
+
+        // Suspends generator, and resumes coroutine awaiting on next() if
+        // there is one, otherwise returns to whoever resumed generator.
+        struct transfer_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(handle_type h) noexcept
+            {
+                auto continuation = std::exchange(h.promise().continuation_, nullptr);
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        // Awaitable returned by next(), which is ready straight away unless
+        // generator got suspended on asynchronous operation
+        struct next_awaiter
+        {
+            Generator &generator_;
+
+            bool await_ready() { return !generator_.is_pending(); }
+            void await_suspend(std::coroutine_handle<> h) { generator_.h_.promise().continuation_ = h; }
+            bool await_resume() { return static_cast<bool>(generator_); }
+        };
     
         handle_type h_;
     
@@ -60,7 +97,13 @@ namespace sadhbhcraft::util
             : h_(h)
         {
         }
-        ~Generator() { h_.destroy(); }
+        Generator(Generator &&other) noexcept
+            : h_(std::exchange(other.h_, nullptr)), full_(other.full_), pending_(other.pending_)
+        {
+        }
+        Generator(const Generator &) = delete;
+        Generator &operator=(const Generator &) = delete;
+        ~Generator() { if (h_) h_.destroy(); }
         explicit operator bool()
         {
             fill(); // The only way to reliably find out whether or not we finished coroutine,
@@ -82,20 +125,47 @@ namespace sadhbhcraft::util
                     std::forward<typename DefaultConstructibleWrapper<T>::type>(
                         h_.promise().value_)));
         }
+
+        // Tells whether generator is suspended on asynchronous operation, and
+        // has neither yielded nor finished yet. Generator will be resumed by
+        // whoever completes that operation (see util::EventLoop), and until
+        // then we must neither resume it nor read the value.
+        bool is_pending()
+        {
+            fill();
+            return pending_;
+        }
+
+        // Use from within another coroutine:
+        //
+        //      while (co_await generator.next())
+        //      {
+        //          auto x = generator();
+        //      }
+        //
+        // If generator gets suspended on asynchronous operation, then awaiting
+        // coroutine is suspended too, and is resumed once generator yields.
+        next_awaiter next() { return next_awaiter{*this}; }
     
     private:
         bool full_ = false;
+        bool pending_ = false;
     
         void fill()
         {
             if (!full_)
             {
-                h_();
+                if (!pending_)
+                {
+                    h_.promise().ready_ = false;
+                    h_();
+                }
                 if (h_.promise().exception_)
                     std::rethrow_exception(h_.promise().exception_);
                 // propagate coroutine exception in called context
     
-                full_ = true;
+                pending_ = !(h_.done() || h_.promise().ready_);
+                full_ = !pending_;
             }
         }
     };
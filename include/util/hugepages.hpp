@@ -0,0 +1,177 @@
+#ifndef INCLUDED_HUGEPAGES_HPP
+#define INCLUDED_HUGEPAGES_HPP
+
+//
+// Memory resource backed by huge pages
+//
+//      HugePageResource arena(1 << 30);                    // Reserved and pre-faulted here
+//      std::pmr::unsynchronized_pool_resource pool(&arena);
+//      ScopedDefaultResource scope(&pool);
+//
+//      OrderBook<MyOrder, PmrBookSidePolicy<>> book;       // All levels and queues in arena
+//
+// Region is mapped with MAP_HUGETLB, and if there are no huge pages
+// reserved in the system, then with normal pages and MADV_HUGEPAGE, so that
+// transparent huge pages can back it. Every page is touched in constructor,
+// so that page faults happen at startup, and not on matching path.
+//
+// Arena only ever grows, i.e. memory given back is not reused, and that's
+// why it should be upstream of a pool resource, which recycles blocks.
+// Once region is used up, allocations go to upstream resource.
+//
+// NOTE: Not thread-safe, as each book is driven from one thread.
+//
+// NOTE: Containers of `PriceLevelStack` are default constructed, and so
+// they take resource from `std::pmr::get_default_resource()` at the time
+// book, or level is created (see `ScopedDefaultResource`).
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace sadhbhcraft::util
+{
+    enum class HugePageBacking
+    {
+        HugeTlb,        // Explicit huge pages (MAP_HUGETLB)
+        Transparent,    // Normal pages with MADV_HUGEPAGE
+        None            // Mapping failed, and everything goes to upstream
+    };
+
+    class HugePageResource : public std::pmr::memory_resource
+    {
+    public:
+        static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+        explicit HugePageResource(std::size_t size, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : m_upstream(upstream)
+        {
+            m_size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+            if (!m_size)
+            {
+                m_backing = HugePageBacking::None;
+                return;
+            }
+
+#ifdef MAP_HUGETLB
+            void *p = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+            {
+                m_backing = HugePageBacking::HugeTlb;
+            }
+            else
+#endif
+            {
+                p = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED)
+                {
+                    m_size = 0;
+                    m_backing = HugePageBacking::None;
+                    return;
+                }
+#ifdef MADV_HUGEPAGE
+                ::madvise(p, m_size, MADV_HUGEPAGE);
+#endif
+                m_backing = HugePageBacking::Transparent;
+            }
+
+            m_region = static_cast<std::byte *>(p);
+            prefault();
+        }
+
+        HugePageResource(const HugePageResource &) = delete;
+        HugePageResource &operator=(const HugePageResource &) = delete;
+
+        ~HugePageResource()
+        {
+            if (m_region)
+            {
+                ::munmap(m_region, m_size);
+            }
+        }
+
+        HugePageBacking backing() const { return m_backing; }
+
+        // Bytes of region, and bytes given out from region so far
+        std::size_t capacity() const { return m_size; }
+        std::size_t used() const { return m_used; }
+
+        // Bytes given out by upstream, because region was used up
+        std::size_t overflow() const { return m_overflow; }
+
+        bool owns(const void *p) const
+        {
+            return m_region && static_cast<const std::byte *>(p) >= m_region && static_cast<const std::byte *>(p) < m_region + m_size;
+        }
+
+    private:
+        std::byte *m_region = nullptr;
+        std::size_t m_size = 0;
+        std::size_t m_used = 0;
+        std::size_t m_overflow = 0;
+        HugePageBacking m_backing = HugePageBacking::None;
+        std::pmr::memory_resource *m_upstream;
+
+        // Writing to each small page makes kernel back whole region now
+        void prefault()
+        {
+            const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            for (std::size_t offset = 0; offset < m_size; offset += page_size)
+            {
+                static_cast<volatile std::byte *>(m_region)[offset] = std::byte{0};
+            }
+        }
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            const auto base = reinterpret_cast<std::uintptr_t>(m_region);
+            const std::uintptr_t start = (base + m_used + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+            if (m_region && start + bytes <= base + m_size)
+            {
+                m_used = start + bytes - base;
+                return reinterpret_cast<void *>(start);
+            }
+            m_overflow += bytes;
+            return m_upstream->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+        {
+            if (!owns(p))
+            {
+                m_overflow -= bytes;
+                m_upstream->deallocate(p, bytes, alignment);
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    // Makes resource default for containers constructed in scope, and
+    // restores previous default at the end of scope
+    class ScopedDefaultResource
+    {
+    public:
+        explicit ScopedDefaultResource(std::pmr::memory_resource *resource)
+            : m_previous(std::pmr::set_default_resource(resource))
+        {}
+
+        ScopedDefaultResource(const ScopedDefaultResource &) = delete;
+        ScopedDefaultResource &operator=(const ScopedDefaultResource &) = delete;
+
+        ~ScopedDefaultResource() { std::pmr::set_default_resource(m_previous); }
+
+    private:
+        std::pmr::memory_resource *m_previous;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_HUGEPAGES_HPP
@@ -0,0 +1,73 @@
+#ifndef INCLUDED_ISTREAM_HPP
+#define INCLUDED_ISTREAM_HPP
+
+//
+// IStream powered by Generator co-routine
+//
+//      ChunkedFileSource source("orders.txt");
+//      GeneratorStreamBuf buf(read_chunks(source));
+//      std::istream in(&buf);
+//
+//      for (std::string line; std::getline(in, line);)
+//      ...
+//
+// Stream buffer doesn't own any storage, and it only points into chunks
+// yielded by the generator, so any producer of bytes (file, socket,
+// decompressor) written as co-routine can be read with standard streams.
+//
+
+#include <streambuf>
+#include <string_view>
+
+#include "concepts.hpp"
+#include "generator.hpp"
+
+
+namespace sadhbhcraft::util
+{
+    // Yield whatever the source has, and then refill it, until the end
+    template<ByteSourceConcept Source>
+    Generator<std::string_view> read_chunks(Source &source)
+    {
+        do
+        {
+            std::string_view chunk = source.data();
+            if (!chunk.empty())
+            {
+                co_yield chunk;
+                source.consume(chunk.size());
+            }
+        }
+        while (source.fill());
+    }
+
+    class GeneratorStreamBuf : public std::streambuf
+    {
+    public:
+        explicit GeneratorStreamBuf(Generator<std::string_view> chunks)
+            : m_chunks(std::move(chunks))
+        {}
+
+    protected:
+        int_type underflow() override
+        {
+            // Chunk yielded last stays valid until we resume generator
+            while (m_chunks)
+            {
+                std::string_view chunk = m_chunks();
+                if (!chunk.empty())
+                {
+                    char *first = const_cast<char *>(chunk.data());
+                    setg(first, first, first + chunk.size());
+                    return traits_type::to_int_type(*gptr());
+                }
+            }
+            return traits_type::eof();
+        }
+
+    private:
+        Generator<std::string_view> m_chunks;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_ISTREAM_HPP
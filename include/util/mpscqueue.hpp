@@ -0,0 +1,163 @@
+#ifndef INCLUDED_MPSCQUEUE_HPP
+#define INCLUDED_MPSCQUEUE_HPP
+
+//
+// Bounded multi-producer single-consumer queue
+//
+//      MpscQueue<MyMessage, 4096> queue;
+//
+//      // Any number of producer threads
+//      if (auto sequence = queue.try_push(message)) { ... }    // Full otherwise
+//
+//      // One consumer thread
+//      queue.drain([](std::uint64_t sequence, MyMessage &message) { ... });
+//
+// Every slot has a sequence, which tells whose turn it is: slot for
+// position P is free for producer when its sequence is P, and it holds
+// message when its sequence is P + 1. Producer claims position with CAS on
+// tail, and then it writes into its own slot with no other producer
+// touching it, so that producers don't wait for each other, and one that is
+// preempted holds back only the consumer.
+//
+// Position claimed is sequence number of the message, which is dense and
+// increasing in the order messages are drained, and that's the order in
+// which they should be journaled and matched.
+//
+// Consumer drains messages in batches, from head until the first slot that
+// isn't complete yet, and it doesn't touch tail, which is the only line
+// producers contend on.
+//
+// NOTE: Try pushing again when full, as there's no blocking push.
+//
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+
+namespace sadhbhcraft::util
+{
+    template<typename T, std::size_t Capacity>
+    class MpscQueue
+    {
+        static_assert(std::has_single_bit(Capacity));
+        static_assert(std::is_nothrow_move_constructible_v<T>);
+
+    public:
+        MpscQueue() : m_slots(std::make_unique<Slot[]>(Capacity))
+        {
+            for (std::size_t i = 0; i != Capacity; ++i)
+            {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+
+        ~MpscQueue()
+        {
+            drain([](std::uint64_t, T &) {});
+        }
+
+        // Returns sequence number of the message, or nothing if queue is full
+        template<typename... Args>
+        std::optional<std::uint64_t> try_emplace(Args &&...args)
+        {
+            std::uint64_t position = m_tail.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Slot &slot = m_slots[position & (Capacity - 1)];
+                const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+                if (sequence == position)
+                {
+                    if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        ::new (slot.storage) T(std::forward<Args>(args)...);
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return position;
+                    }
+                    // ^ Another producer has taken it, and position is reloaded
+                }
+                else if (sequence < position)
+                {
+                    return std::nullopt; //< Consumer hasn't taken it yet from the previous lap
+                }
+                else
+                {
+                    position = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::optional<std::uint64_t> try_push(const T &value) { return try_emplace(value); }
+        std::optional<std::uint64_t> try_push(T &&value) { return try_emplace(std::move(value)); }
+
+        // Only consumer may call. Handler is called as:
+        //
+        //      handler(sequence, message);
+        //
+        // for up to `max_count` messages in order of sequence, and message is
+        // destroyed once handler returns. Returns number of messages drained.
+        template<typename Handler>
+        std::size_t drain(Handler &&handler, std::size_t max_count = Capacity)
+        {
+            std::uint64_t head = m_head.load(std::memory_order_relaxed);
+            std::size_t count = 0;
+            for (; count != max_count; ++count, ++head)
+            {
+                Slot &slot = m_slots[head & (Capacity - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+                {
+                    break;
+                }
+
+                T *value = std::launder(reinterpret_cast<T *>(slot.storage));
+                handler(head, *value);
+                value->~T();
+
+                // Slot is free for producer in the next lap
+                slot.sequence.store(head + Capacity, std::memory_order_release);
+            }
+            m_head.store(head, std::memory_order_release);
+            return count;
+        }
+
+        // Sequence number of the next message consumer will take. Any thread
+        // may ask, and it's exact on consumer thread.
+        std::uint64_t head() const { return m_head.load(std::memory_order_acquire); }
+
+        // Number of messages claimed by producers, and not drained yet. Any
+        // thread may ask, and it's exact only on consumer thread, when
+        // producers are quiet. Head is loaded first, so that messages it has
+        // passed are claimed in tail that is loaded after it.
+        std::size_t size() const
+        {
+            const std::uint64_t head = m_head.load(std::memory_order_acquire);
+            return static_cast<std::size_t>(m_tail.load(std::memory_order_relaxed) - head);
+        }
+
+        static constexpr std::size_t capacity() { return Capacity; }
+
+    private:
+        struct Slot
+        {
+            std::atomic<std::uint64_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        std::unique_ptr<Slot[]> m_slots;
+        alignas(64) std::atomic<std::uint64_t> m_tail{0};
+        alignas(64) std::atomic<std::uint64_t> m_head{0};
+        // ^ Written by consumer only, once per batch
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_MPSCQUEUE_HPP
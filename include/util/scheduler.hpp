@@ -0,0 +1,139 @@
+#ifndef INCLUDED_SCHEDULER_HPP
+#define INCLUDED_SCHEDULER_HPP
+
+// Event loop for truly asynchronous things we can co_await on
+//
+//      EventLoop loop;
+//      AsyncDeferred<SomeCheck> policy{loop, SomeCheck{}, 50us};
+//
+//      co_await policy(arg);
+//
+// Unlike AsyncImmediate, the AsyncDeferred does not resume coroutine from
+// await_suspend(). Instead coroutine is parked on the EventLoop, and once
+// operation is due, the function is applied to the argument and coroutine is
+// resumed by EventLoop::run_once(). Here operation is just a local stand-in
+// for an external service (e.g. pre-trade check) responding after some latency.
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "util.hpp"
+
+
+namespace sadhbhcraft::util
+{
+    class EventLoop
+    {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        // Parked coroutine together with operation it awaits on. This is
+        // meant to be a base of an awaitable, which lives in coroutine frame
+        // while coroutine is suspended, so scheduling doesn't allocate.
+        struct Operation
+        {
+            Clock::time_point due;
+            std::coroutine_handle<> handle;
+            void (*complete)(Operation &) = nullptr;
+            std::uint64_t sequence = 0;
+        };
+
+        void schedule(Operation &operation, Clock::time_point due)
+        {
+            operation.due = due;
+            operation.sequence = m_sequence++;
+            m_operations.push_back(&operation);
+            std::push_heap(m_operations.begin(), m_operations.end(), later);
+        }
+
+        // Complete all operations that are due, and resume coroutines that
+        // were waiting for them. Operations due at the same time complete in
+        // order in which they were scheduled.
+        std::size_t run_once()
+        {
+            std::size_t resumed = 0;
+            const auto now = Clock::now();
+
+            while (!m_operations.empty() && m_operations.front()->due <= now)
+            {
+                std::pop_heap(m_operations.begin(), m_operations.end(), later);
+                Operation &operation = *m_operations.back();
+                m_operations.pop_back();
+
+                if (operation.complete)
+                {
+                    operation.complete(operation);
+                }
+                operation.handle.resume();
+                ++resumed;
+            }
+
+            return resumed;
+        }
+
+        std::size_t size() const { return m_operations.size(); }
+        bool empty() const { return m_operations.empty(); }
+
+    private:
+        std::vector<Operation *> m_operations;
+        std::uint64_t m_sequence = 0;
+
+        static bool later(const Operation *a, const Operation *b)
+        {
+            return a->due != b->due ? b->due < a->due : b->sequence < a->sequence;
+        }
+    };
+
+    template<typename F>
+    struct AsyncDeferred
+    {
+        AsyncDeferred(EventLoop &loop, F f, EventLoop::Clock::duration latency)
+            : loop_(loop), f_(std::move(f)), latency_(latency)
+        {}
+
+        template<ArgumentToCallable<F> T>
+        auto operator()(T &&x)
+        {
+            return awaitable<std::decay_t<T>>{*this, std::forward<T>(x)};
+        }
+
+        EventLoop &loop() { return loop_; }
+
+    private:
+        EventLoop &loop_;
+        F f_;
+        EventLoop::Clock::duration latency_;
+
+        template<typename T>
+        struct awaitable : EventLoop::Operation
+        {
+            awaitable(AsyncDeferred &owner, T x): owner_(owner), x_(std::move(x))
+            {}
+
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                this->handle = h;
+                this->complete = &apply;
+                owner_.loop_.schedule(*this, EventLoop::Clock::now() + owner_.latency_);
+            }
+            void await_resume() {}
+
+        private:
+            AsyncDeferred &owner_;
+            T x_;
+
+            static void apply(EventLoop::Operation &operation)
+            {
+                auto &self = static_cast<awaitable &>(operation);
+                self.owner_.f_(self.x_);
+            }
+        };
+    };
+
+} // namespace sadhbhcraft::util
+#endif//INCLUDED_SCHEDULER_HPP
@@ -0,0 +1,336 @@
+#ifndef INCLUDED_SHMRING_HPP
+#define INCLUDED_SHMRING_HPP
+
+//
+// Single writer, multiple reader ring in POSIX shared memory
+//
+//      // Writer process
+//      SharedMemory shm("/book", sizeof(ShmRing<Msg, 4096>));
+//      auto &ring = ShmRing<Msg, 4096>::create(shm.data());
+//      ring.push(msg);
+//
+//      // Reader process
+//      SharedMemory shm("/book");
+//      const auto *ring = ShmRing<Msg, 4096>::attach(shm.data(), shm.size());
+//      ShmRingReader<Msg, 4096> reader(*ring);
+//      while (reader.read(msg) == ShmReadStatus::Ok) { ... }
+//
+// Each slot has version, which is odd while writer is writing the slot, and
+// even once message is complete (seqlock). Message number N lives in slot
+// N % Capacity, and it is complete when its version is 2 * (N + 1). Reader
+// copies the message, and checks that version hasn't changed meanwhile.
+// Then reader never blocks writer, and neither of them makes a syscall per
+// message, as all of it is plain loads and stores in shared memory.
+//
+// Writer doesn't wait for readers, and reader that falls more than
+// `Capacity` messages behind is overrun. It has to resync from some other
+// state, e.g. snapshot in `SeqlockCell`, and then skip to sequence number
+// of that state (see `ShmRingReader::seek`).
+//
+// NOTE: Message must be trivially copyable, and it is read while writer may
+// be writing it, which is what seqlock is about: the copy is discarded if
+// version has changed.
+//
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace sadhbhcraft::util
+{
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+    // Named POSIX shared memory object mapped into this process. Creating
+    // maps it for writing, and opening existing maps it read-only. Name is
+    // copied, so that `unlink()` doesn't depend on caller's string.
+    class SharedMemory
+    {
+    public:
+        // Creates (or truncates) object of given size
+        SharedMemory(const char *name, std::size_t size) : m_name(name), m_size(size)
+        {
+            m_fd = ::shm_open(name, O_CREAT | O_RDWR, 0644);
+            if (m_fd < 0)
+            {
+                return;
+            }
+            if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+            {
+                close();
+                return;
+            }
+            map(PROT_READ | PROT_WRITE);
+        }
+
+        // Opens existing object read-only
+        explicit SharedMemory(const char *name) : m_name(name)
+        {
+            m_fd = ::shm_open(name, O_RDONLY, 0);
+            if (m_fd < 0)
+            {
+                return;
+            }
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0)
+            {
+                close();
+                return;
+            }
+            m_size = static_cast<std::size_t>(st.st_size);
+            map(PROT_READ);
+        }
+
+        SharedMemory(const SharedMemory &) = delete;
+        SharedMemory &operator=(const SharedMemory &) = delete;
+
+        ~SharedMemory()
+        {
+            if (m_data)
+            {
+                ::munmap(m_data, m_size);
+            }
+            close();
+        }
+
+        bool is_open() const { return m_data != nullptr; }
+
+        void *data() { return m_data; }
+        const void *data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+
+        // Removes the name, and memory goes away once all have unmapped it
+        bool unlink() { return ::shm_unlink(m_name.c_str()) == 0; }
+
+    private:
+        std::string m_name;
+        int m_fd = -1;
+        void *m_data = nullptr;
+        std::size_t m_size = 0;
+
+        void map(int protection)
+        {
+            if (m_size)
+            {
+                void *p = ::mmap(nullptr, m_size, protection, MAP_SHARED, m_fd, 0);
+                if (p == MAP_FAILED)
+                {
+                    close();
+                    return;
+                }
+                m_data = p;
+            }
+            // Mapping stays valid without the descriptor
+            close();
+        }
+
+        void close()
+        {
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+    };
+
+    // Copies value in and out under version, so that single writer never
+    // waits, and readers retry if they have seen a write in progress
+    template<typename T>
+    struct SeqlockCell
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        std::atomic<std::uint64_t> version{0};
+        T value;
+
+        void store(const T &x)
+        {
+            const std::uint64_t v = version.load(std::memory_order_relaxed);
+            version.store(v + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(static_cast<void *>(&value), &x, sizeof(T));
+            version.store(v + 2, std::memory_order_release);
+        }
+
+        // Returns false if writer was writing, and copy is torn
+        bool try_load(T &x, std::uint64_t expected_version) const
+        {
+            std::memcpy(&x, static_cast<const void *>(&value), sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return version.load(std::memory_order_relaxed) == expected_version;
+        }
+
+        // Returns false if nothing has been stored yet
+        bool load(T &x) const
+        {
+            for (;;)
+            {
+                const std::uint64_t v = version.load(std::memory_order_acquire);
+                if (!v)
+                {
+                    return false;
+                }
+                if (!(v & 1) && try_load(x, v))
+                {
+                    return true;
+                }
+            }
+        }
+    };
+
+    enum class ShmReadStatus
+    {
+        Ok,         // Message was read
+        Empty,      // Nothing new yet
+        Overrun     // Writer has lapped reader, and messages were lost
+    };
+
+    struct ShmRingHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t message_size;
+        std::uint64_t capacity;
+        alignas(64) std::atomic<std::uint64_t> write_sequence;
+        // ^ Number of messages published so far
+    };
+
+    inline constexpr char SHM_RING_MAGIC[8] = {'S', 'C', 'O', 'B', 'R', 'I', 'N', 'G'};
+
+    template<typename Message, std::size_t Capacity>
+    struct ShmRing
+    {
+        static_assert(std::is_trivially_copyable_v<Message>);
+        static_assert(std::has_single_bit(Capacity));
+
+        static constexpr std::uint32_t layout_version = 1;
+
+        struct Slot
+        {
+            std::atomic<std::uint64_t> version;
+            Message message;
+        };
+
+        ShmRingHeader header;
+        Slot slots[Capacity];
+
+        // Lays out empty ring in memory of at least `sizeof(ShmRing)`
+        static ShmRing &create(void *memory)
+        {
+            auto *ring = ::new (memory) ShmRing;
+            std::memcpy(ring->header.magic, SHM_RING_MAGIC, sizeof(SHM_RING_MAGIC));
+            ring->header.version = layout_version;
+            ring->header.message_size = sizeof(Message);
+            ring->header.capacity = Capacity;
+            ring->header.write_sequence.store(0, std::memory_order_relaxed);
+            for (auto &slot : ring->slots)
+            {
+                slot.version.store(0, std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            return *ring;
+        }
+
+        // Returns nullptr if memory doesn't hold ring of this type
+        static const ShmRing *attach(const void *memory, std::size_t size)
+        {
+            if (!memory || size < sizeof(ShmRing))
+            {
+                return nullptr;
+            }
+            const auto *ring = static_cast<const ShmRing *>(memory);
+            if (std::memcmp(ring->header.magic, SHM_RING_MAGIC, sizeof(SHM_RING_MAGIC)) != 0
+                    || ring->header.version != layout_version
+                    || ring->header.message_size != sizeof(Message)
+                    || ring->header.capacity != Capacity)
+            {
+                return nullptr;
+            }
+            return ring;
+        }
+
+        std::uint64_t write_sequence() const { return header.write_sequence.load(std::memory_order_acquire); }
+
+        // Only one writer may push
+        void push(const Message &message)
+        {
+            const std::uint64_t sequence = header.write_sequence.load(std::memory_order_relaxed);
+            Slot &slot = slots[sequence & (Capacity - 1)];
+
+            slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(static_cast<void *>(&slot.message), &message, sizeof(Message));
+            slot.version.store(2 * (sequence + 1), std::memory_order_release);
+
+            header.write_sequence.store(sequence + 1, std::memory_order_release);
+        }
+    };
+
+    // Reader's position in the ring. Each reader has its own, and it lives
+    // in reader's process only.
+    template<typename Message, std::size_t Capacity>
+    class ShmRingReader
+    {
+    public:
+        typedef ShmRing<Message, Capacity> RingType;
+
+        // Starts from the next message published
+        explicit ShmRingReader(const RingType &ring) : m_ring(ring), m_sequence(ring.write_sequence())
+        {}
+
+        // Sequence number of the next message to read
+        std::uint64_t sequence() const { return m_sequence; }
+
+        // Messages published, but not read yet
+        std::uint64_t lag() const { return m_ring.write_sequence() - m_sequence; }
+
+        // Continues from given message, e.g. the first message after snapshot
+        void seek(std::uint64_t sequence) { m_sequence = sequence; }
+
+        ShmReadStatus read(Message &message)
+        {
+            const auto &slot = m_ring.slots[m_sequence & (Capacity - 1)];
+            const std::uint64_t expected = 2 * (m_sequence + 1);
+
+            // Slot is written in order of messages, so that older version
+            // means message isn't there yet, or it's being written now, and
+            // newer version means writer has moved on to the next lap
+            const std::uint64_t version = slot.version.load(std::memory_order_acquire);
+            if (version < expected)
+            {
+                return ShmReadStatus::Empty;
+            }
+            if (version != expected)
+            {
+                return ShmReadStatus::Overrun;
+            }
+
+            std::memcpy(&message, static_cast<const void *>(&slot.message), sizeof(Message));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) != expected)
+            {
+                return ShmReadStatus::Overrun;
+            }
+
+            ++m_sequence;
+            return ShmReadStatus::Ok;
+        }
+
+    private:
+        const RingType &m_ring;
+        std::uint64_t m_sequence;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_SHMRING_HPP
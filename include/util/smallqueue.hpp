@@ -0,0 +1,282 @@
+#ifndef INCLUDED_SMALLQUEUE_HPP
+#define INCLUDED_SMALLQUEUE_HPP
+
+//
+// FIFO queue with small-buffer storage.
+//
+// First N elements are stored inline inside the queue object, and only when
+// the queue gets deeper than that we spill to heap storage. Most of the price
+// levels hold just one to three orders, so with inline storage walking the top
+// of the book touches the level object only, and thin levels don't allocate.
+//
+// Elements are kept contiguous in range [head, tail) of the buffer, so
+// iterators are plain pointers. Popping from the front only advances head, and
+// space at the front is reclaimed lazily when we run out of space at the back.
+//
+// NOTE: Elements don't need to be default constructible, which is important as
+// OrderQuantity holds std::reference_wrapper.
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+
+namespace sadhbhcraft::util
+{
+    template<typename T, std::size_t N = 3>
+    class SmallQueue
+    {
+        static_assert(N > 0, "SmallQueue needs at least one inline slot");
+
+    public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+        typedef std::size_t size_type;
+
+        static constexpr size_type inline_capacity = N;
+
+        SmallQueue() noexcept
+            : m_data(inline_data()), m_head(0), m_tail(0), m_capacity(N)
+        {}
+
+        SmallQueue(const SmallQueue &other)
+            : SmallQueue()
+        {
+            reserve(other.size());
+            for (const auto &x : other)
+            {
+                emplace_back(x);
+            }
+        }
+
+        SmallQueue(SmallQueue &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : SmallQueue()
+        {
+            steal(std::move(other));
+        }
+
+        SmallQueue &operator=(const SmallQueue &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                reserve(other.size());
+                for (const auto &x : other)
+                {
+                    emplace_back(x);
+                }
+            }
+            return *this;
+        }
+
+        SmallQueue &operator=(SmallQueue &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &other)
+            {
+                clear();
+                release_heap();
+                steal(std::move(other));
+            }
+            return *this;
+        }
+
+        ~SmallQueue()
+        {
+            clear();
+            release_heap();
+        }
+
+        template<typename... Args>
+        reference emplace_back(Args &&...args)
+        {
+            if (m_tail == m_capacity)
+            {
+                make_room();
+            }
+            T *p = ::new (static_cast<void *>(m_data + m_tail)) T(std::forward<Args>(args)...);
+            ++m_tail;
+            return *p;
+        }
+
+        void push_back(const T &x) { emplace_back(x); }
+        void push_back(T &&x) { emplace_back(std::move(x)); }
+
+        void pop_front()
+        {
+            std::destroy_at(m_data + m_head);
+            if (++m_head == m_tail)
+            {
+                m_head = m_tail = 0;
+            }
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            T *f = const_cast<T *>(first);
+            T *l = const_cast<T *>(last);
+            T *e = end();
+
+            if (f == l)
+            {
+                return f;
+            }
+
+            if (f == begin())
+            {
+                // Most common case: matching removes filled orders from the front
+                std::destroy(f, l);
+                m_head += (l - f);
+                if (m_head == m_tail)
+                {
+                    m_head = m_tail = 0;
+                    return end();
+                }
+                return begin();
+            }
+
+            T *out = std::move(l, e, f);
+            std::destroy(out, e);
+            m_tail -= (l - f);
+            return f;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+        void clear() noexcept
+        {
+            std::destroy(begin(), end());
+            m_head = m_tail = 0;
+        }
+
+        void reserve(size_type n)
+        {
+            if (n > m_capacity)
+            {
+                relocate(n);
+            }
+            else if (n > m_capacity - m_head)
+            {
+                relocate(m_capacity);
+            }
+        }
+
+        reference front() { return m_data[m_head]; }
+        const_reference front() const { return m_data[m_head]; }
+        reference back() { return m_data[m_tail - 1]; }
+        const_reference back() const { return m_data[m_tail - 1]; }
+
+        reference operator[](size_type i) { return m_data[m_head + i]; }
+        const_reference operator[](size_type i) const { return m_data[m_head + i]; }
+
+        iterator begin() noexcept { return m_data + m_head; }
+        iterator end() noexcept { return m_data + m_tail; }
+        const_iterator begin() const noexcept { return m_data + m_head; }
+        const_iterator end() const noexcept { return m_data + m_tail; }
+
+        size_type size() const noexcept { return m_tail - m_head; }
+        bool empty() const noexcept { return m_tail == m_head; }
+        size_type capacity() const noexcept { return m_capacity; }
+        bool is_inline() const noexcept { return m_data == inline_data(); }
+
+    private:
+        alignas(T) std::byte m_inline[N * sizeof(T)];
+        T *m_data;
+        size_type m_head;
+        size_type m_tail;
+        size_type m_capacity;
+
+        T *inline_data() noexcept { return std::launder(reinterpret_cast<T *>(m_inline)); }
+        const T *inline_data() const noexcept { return std::launder(reinterpret_cast<const T *>(m_inline)); }
+
+        void make_room()
+        {
+            // Reclaim space at the front only if that frees at least as much
+            // as we hold, so that compaction stays amortised O(1) per element.
+            if (m_head && m_head >= size())
+            {
+                relocate(m_capacity);
+            }
+            else
+            {
+                relocate(m_capacity * 2);
+            }
+        }
+
+        void relocate(size_type new_capacity)
+        {
+            const size_type n = size();
+
+            if (new_capacity == m_capacity)
+            {
+                // Compact in place (moving down, ranges may overlap). Slots
+                // below head are raw storage, slots at or above head are live.
+                for (size_type i = 0; i != n; ++i)
+                {
+                    if (i < m_head)
+                    {
+                        ::new (static_cast<void *>(m_data + i)) T(std::move(m_data[m_head + i]));
+                    }
+                    else
+                    {
+                        m_data[i] = std::move(m_data[m_head + i]);
+                    }
+                }
+                std::destroy(m_data + std::max(n, m_head), m_data + m_head + n);
+            }
+            else
+            {
+                T *p = std::allocator<T>().allocate(new_capacity);
+                std::uninitialized_move(begin(), end(), p);
+                std::destroy(begin(), end());
+                release_heap();
+                m_data = p;
+                m_capacity = new_capacity;
+            }
+
+            m_head = 0;
+            m_tail = n;
+        }
+
+        void release_heap() noexcept
+        {
+            if (!is_inline())
+            {
+                std::allocator<T>().deallocate(m_data, m_capacity);
+                m_data = inline_data();
+                m_capacity = N;
+            }
+        }
+
+        void steal(SmallQueue &&other)
+        {
+            if (other.is_inline())
+            {
+                std::uninitialized_move(other.begin(), other.end(), inline_data());
+                m_tail = other.size();
+                other.clear();
+            }
+            else
+            {
+                m_data = std::exchange(other.m_data, other.inline_data());
+                m_capacity = std::exchange(other.m_capacity, N);
+                m_head = std::exchange(other.m_head, 0);
+                m_tail = std::exchange(other.m_tail, 0);
+            }
+        }
+    };
+
+    template<std::size_t N>
+    struct SmallQueueOf
+    {
+        template<typename T> using type = SmallQueue<T, N>;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_SMALLQUEUE_HPP
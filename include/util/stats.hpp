@@ -0,0 +1,201 @@
+#ifndef INCLUDED_STATS_HPP
+#define INCLUDED_STATS_HPP
+
+//
+// Building blocks for hot path statistics
+//
+// Counters and histograms have single writer (the thread doing the work),
+// and any number of readers on other threads. Writer updates them with
+// relaxed load and store instead of atomic read-modify-write, so that there
+// is no locked instruction on the hot path, and readers see each value
+// whole, but not necessarily consistent with the other values.
+//
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+namespace sadhbhcraft::util
+{
+    // Cheap timestamp for measuring short intervals. It is TSC on x86, and
+    // nanoseconds of steady clock elsewhere.
+    inline std::uint64_t read_cycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    class RelaxedCounter
+    {
+    public:
+        // Only one thread may call add()
+        void add(std::uint64_t n = 1)
+        {
+            m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        std::uint64_t load() const { return m_value.load(std::memory_order_relaxed); }
+
+        void reset() { m_value.store(0, std::memory_order_relaxed); }
+
+    private:
+        std::atomic<std::uint64_t> m_value{0};
+    };
+
+    // Histogram with power of two buckets: bucket i counts values that need
+    // exactly i bits, i.e. bucket 0 counts zeros, bucket 1 counts ones,
+    // bucket 2 counts 2-3, bucket 3 counts 4-7, and so on.
+    class Log2Histogram
+    {
+    public:
+        static constexpr std::size_t bucket_count = 65;
+
+        void record(std::uint64_t value)
+        {
+            m_buckets[std::bit_width(value)].add();
+            m_count.add();
+            m_sum.add(value);
+        }
+
+        std::uint64_t bucket(std::size_t i) const { return m_buckets[i].load(); }
+        std::uint64_t count() const { return m_count.load(); }
+        std::uint64_t sum() const { return m_sum.load(); }
+
+        static std::uint64_t bucket_lower_bound(std::size_t i) { return i ? std::uint64_t(1) << (i - 1) : 0; }
+
+        // Upper bound of the bucket containing given quantile, e.g. 0.99
+        std::uint64_t quantile_upper_bound(double q) const
+        {
+            const std::uint64_t total = count();
+            const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total));
+            std::uint64_t seen = 0;
+
+            for (std::size_t i = 0; i != bucket_count; ++i)
+            {
+                seen += bucket(i);
+                if (total && seen > rank)
+                {
+                    return i == bucket_count - 1 ? ~std::uint64_t(0) : (std::uint64_t(1) << i) - 1;
+                }
+            }
+            return 0;
+        }
+
+        void reset()
+        {
+            for (auto &b : m_buckets)
+            {
+                b.reset();
+            }
+            m_count.reset();
+            m_sum.reset();
+        }
+
+    private:
+        std::array<RelaxedCounter, bucket_count> m_buckets;
+        RelaxedCounter m_count;
+        RelaxedCounter m_sum;
+    };
+
+    // Histogram with each power of two bucket split into 2^SubBucketBits
+    // linear sub-buckets, so that upper bound of a quantile is within
+    // 1 / 2^SubBucketBits of the value, e.g. 3% with 5 bits, where
+    // `Log2Histogram` is within 100%. Values below 2^SubBucketBits have
+    // bucket each.
+    template<unsigned SubBucketBits = 5>
+    class LogLinearHistogram
+    {
+        static_assert(SubBucketBits < 16);
+
+    public:
+        static constexpr std::size_t sub_bucket_count = std::size_t(1) << SubBucketBits;
+        static constexpr std::size_t bucket_count = (65 - SubBucketBits) * sub_bucket_count;
+
+        static std::size_t bucket_of(std::uint64_t value)
+        {
+            if (value < sub_bucket_count)
+            {
+                return static_cast<std::size_t>(value);
+            }
+            const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - SubBucketBits;
+            return (shift + 1) * sub_bucket_count + static_cast<std::size_t>((value >> shift) - sub_bucket_count);
+        }
+
+        static std::uint64_t bucket_lower_bound(std::size_t i)
+        {
+            if (i < sub_bucket_count)
+            {
+                return i;
+            }
+            const std::size_t shift = i / sub_bucket_count - 1;
+            return (sub_bucket_count + i % sub_bucket_count) << shift;
+        }
+
+        static std::uint64_t bucket_upper_bound(std::size_t i)
+        {
+            if (i < sub_bucket_count)
+            {
+                return i;
+            }
+            const std::size_t shift = i / sub_bucket_count - 1;
+            return bucket_lower_bound(i) + ((std::uint64_t(1) << shift) - 1);
+        }
+
+        void record(std::uint64_t value)
+        {
+            m_buckets[bucket_of(value)].add();
+            m_count.add();
+            m_sum.add(value);
+        }
+
+        std::uint64_t bucket(std::size_t i) const { return m_buckets[i].load(); }
+        std::uint64_t count() const { return m_count.load(); }
+        std::uint64_t sum() const { return m_sum.load(); }
+
+        // Upper bound of the bucket containing given quantile, e.g. 0.999
+        std::uint64_t quantile_upper_bound(double q) const
+        {
+            const std::uint64_t total = count();
+            const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total));
+            std::uint64_t seen = 0;
+
+            for (std::size_t i = 0; i != bucket_count; ++i)
+            {
+                seen += bucket(i);
+                if (total && seen > rank)
+                {
+                    return bucket_upper_bound(i);
+                }
+            }
+            return 0;
+        }
+
+        void reset()
+        {
+            for (auto &b : m_buckets)
+            {
+                b.reset();
+            }
+            m_count.reset();
+            m_sum.reset();
+        }
+
+    private:
+        std::array<RelaxedCounter, bucket_count> m_buckets;
+        RelaxedCounter m_count;
+        RelaxedCounter m_sum;
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_STATS_HPP
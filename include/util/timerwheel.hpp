@@ -0,0 +1,270 @@
+#ifndef INCLUDED_TIMERWHEEL_HPP
+#define INCLUDED_TIMERWHEEL_HPP
+
+//
+// Hierarchical timer wheel with intrusive timers
+//
+//      struct Job { ...; TimerWheelHook<Job> hook; };
+//
+//      HierarchicalTimerWheel<Job> wheel;
+//      wheel.schedule(job, job.hook, deadline);
+//      ...
+//      wheel.advance(now, [](Job &job) { ... });     // All due by now
+//      job.hook.unlink();                              // Cancel timer
+//
+// Time is in ticks. Level 0 has one slot per tick, and each next level has
+// slots 64 times wider. Timer goes to the lowest level which covers its
+// deadline, and it is moved one level down each time time reaches its slot,
+// until it fires from level 0. Then each timer is touched at most once per
+// level, so that scheduling, cancelling and firing are amortised O(1).
+// Timers beyond the top level wait in overflow list, which is revisited once
+// per rotation of the top level.
+//
+// Each level keeps bitmap of slots which may have timers, so that advancing
+// jumps straight to the next slot that needs attention, and the cost doesn't
+// depend on number of ticks passed.
+//
+// Timer lives in the hook, which is a member of the object, so that
+// scheduling doesn't allocate, and cancelling is unlinking the hook.
+//
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace sadhbhcraft::util
+{
+    template<typename T, std::size_t LevelCount> class HierarchicalTimerWheel;
+
+    // Node of circular doubly linked list of timers in a slot. Copy of an
+    // object doesn't copy its timer.
+    template<typename T>
+    class TimerWheelHook
+    {
+    public:
+        TimerWheelHook() noexcept = default;
+        TimerWheelHook(const TimerWheelHook &) noexcept {}
+        TimerWheelHook &operator=(const TimerWheelHook &) noexcept { return *this; }
+        ~TimerWheelHook() { unlink(); }
+
+        bool is_linked() const { return m_next != nullptr; }
+        std::uint64_t deadline() const { return m_deadline; }
+
+        void unlink()
+        {
+            if (m_next)
+            {
+                m_prev->m_next = m_next;
+                m_next->m_prev = m_prev;
+                m_prev = m_next = nullptr;
+            }
+        }
+
+    private:
+        template<typename, std::size_t> friend class HierarchicalTimerWheel;
+
+        TimerWheelHook *m_prev = nullptr;
+        TimerWheelHook *m_next = nullptr;
+        T *m_value = nullptr;
+        std::uint64_t m_deadline = 0;
+
+        bool is_empty_list() const { return m_next == this; }
+
+        void make_empty_list() { m_prev = m_next = this; }
+
+        void link_before(TimerWheelHook &head)
+        {
+            m_prev = head.m_prev;
+            m_next = &head;
+            head.m_prev->m_next = this;
+            head.m_prev = this;
+        }
+    };
+
+    template<typename T, std::size_t LevelCount = 4>
+    class HierarchicalTimerWheel
+    {
+    public:
+        typedef TimerWheelHook<T> HookType;
+
+        static constexpr unsigned slot_bits = 6;
+        static constexpr std::size_t slot_count = std::size_t(1) << slot_bits;
+        static constexpr std::uint64_t slot_mask = slot_count - 1;
+
+        static_assert(LevelCount > 0 && LevelCount * slot_bits < 64);
+
+        // Slot heads are on heap, so that timers stay linked when wheel is moved
+        explicit HierarchicalTimerWheel(std::uint64_t now = 0)
+            : m_slots(std::make_unique<HookType[]>(LevelCount * slot_count + 1)), m_now(now)
+        {
+            for (std::size_t i = 0; i != LevelCount * slot_count + 1; ++i)
+            {
+                m_slots[i].make_empty_list();
+            }
+        }
+
+        std::uint64_t now() const { return m_now; }
+
+        // Timer with deadline that has already passed fires on the next tick
+        void schedule(T &value, HookType &hook, std::uint64_t deadline)
+        {
+            hook.unlink();
+            hook.m_value = &value;
+            hook.m_deadline = (deadline > m_now ? deadline : m_now + 1);
+            place(hook);
+        }
+
+        // Moves time forward to `now`, and calls `handler(value)` for each
+        // timer that is due, in order of deadlines. Timer is unlinked before
+        // handler is called, and handler may schedule and cancel timers.
+        template<typename Handler>
+        std::size_t advance(std::uint64_t now, Handler &&handler)
+        {
+            std::size_t fired = 0;
+            for (std::uint64_t tick = next_event(); tick <= now; tick = next_event())
+            {
+                m_now = tick;
+                if (!(tick & slot_mask))
+                {
+                    cascade(1);
+                }
+
+                const std::size_t index = tick & slot_mask;
+                HookType &head = slot(0, index);
+                m_bitmaps[0] &= ~(std::uint64_t(1) << index);
+                while (!head.is_empty_list())
+                {
+                    HookType &hook = *head.m_next;
+                    hook.unlink();
+                    handler(*hook.m_value);
+                    ++fired;
+                }
+            }
+            if (m_now < now)
+            {
+                m_now = now;
+            }
+            return fired;
+        }
+
+        bool empty() const
+        {
+            for (std::size_t i = 0; i != LevelCount * slot_count + 1; ++i)
+            {
+                if (!m_slots[i].is_empty_list())
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::unique_ptr<HookType[]> m_slots;    // Level by level, and overflow list at the end
+        std::array<std::uint64_t, LevelCount> m_bitmaps{};
+        std::uint64_t m_now;
+
+        static constexpr std::uint64_t no_event = ~std::uint64_t(0);
+
+        HookType &slot(std::size_t level, std::size_t index) { return m_slots[level * slot_count + index]; }
+        HookType &overflow() { return m_slots[LevelCount * slot_count]; }
+
+        void place(HookType &hook)
+        {
+            const std::uint64_t delta = hook.m_deadline - m_now;
+            for (std::size_t level = 0; level != LevelCount; ++level)
+            {
+                const unsigned shift = level * slot_bits;
+                if (delta < (std::uint64_t(1) << (shift + slot_bits)))
+                {
+                    const std::size_t index = (hook.m_deadline >> shift) & slot_mask;
+                    hook.link_before(slot(level, index));
+                    m_bitmaps[level] |= std::uint64_t(1) << index;
+                    return;
+                }
+            }
+            hook.link_before(overflow());
+        }
+
+        // Moves timers from slot of given level, which time has just reached,
+        // to lower levels. Higher level goes first, so that its timers land
+        // in slot of this level that we're about to empty.
+        void cascade(std::size_t level)
+        {
+            HookType *head;
+            if (level == LevelCount)
+            {
+                head = &overflow();
+            }
+            else
+            {
+                const unsigned shift = level * slot_bits;
+                const std::size_t index = (m_now >> shift) & slot_mask;
+                if (!index)
+                {
+                    cascade(level + 1);
+                }
+                head = &slot(level, index);
+                m_bitmaps[level] &= ~(std::uint64_t(1) << index);
+            }
+
+            // Detach the list first, as timers from overflow may go back to it
+            HookType pending;
+            pending.make_empty_list();
+            if (!head->is_empty_list())
+            {
+                pending.m_next = head->m_next;
+                pending.m_prev = head->m_prev;
+                pending.m_next->m_prev = &pending;
+                pending.m_prev->m_next = &pending;
+                head->make_empty_list();
+            }
+            while (!pending.is_empty_list())
+            {
+                HookType &hook = *pending.m_next;
+                hook.unlink();
+                place(hook);
+            }
+            pending.m_prev = pending.m_next = nullptr;
+        }
+
+        // The earliest tick at which some slot needs attention, i.e. level 0
+        // slot fires, or higher level slot cascades
+        std::uint64_t next_event() const
+        {
+            std::uint64_t next = no_event;
+            for (std::size_t level = 0; level != LevelCount; ++level)
+            {
+                if (!m_bitmaps[level])
+                {
+                    continue;
+                }
+                const unsigned shift = level * slot_bits;
+                const std::size_t index = (m_now >> shift) & slot_mask;
+                const std::uint64_t rotation = (m_now >> (shift + slot_bits)) << (shift + slot_bits);
+
+                // Slots after current one are in this rotation, and the rest
+                // are in the next one
+                const std::uint64_t later = (index == slot_mask ? 0 : m_bitmaps[level] & (~std::uint64_t(0) << (index + 1)));
+                const std::uint64_t tick = later
+                    ? rotation + (std::uint64_t(std::countr_zero(later)) << shift)
+                    : rotation + (std::uint64_t(1) << (shift + slot_bits)) + (std::uint64_t(std::countr_zero(m_bitmaps[level])) << shift);
+
+                next = std::min(next, tick);
+            }
+
+            if (!m_slots[LevelCount * slot_count].is_empty_list())
+            {
+                const unsigned shift = LevelCount * slot_bits;
+                next = std::min(next, ((m_now >> shift) + 1) << shift);
+            }
+            return next;
+        }
+    };
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_TIMERWHEEL_HPP
@@ -0,0 +1,265 @@
+#ifndef INCLUDED_TRACERING_HPP
+#define INCLUDED_TRACERING_HPP
+
+//
+// Flight recorder ring of fixed size events
+//
+//      TraceRing<MyEvent, 65536> ring;
+//      ring.push(event);       // Overwrites the oldest event when full
+//      ...
+//      ring.dump(fd);          // Write events oldest first
+//
+// Recording is a copy of the event into preallocated slot and one relaxed
+// store, so that ring can be left on all the time, and it keeps the last
+// `Capacity` events for when something goes wrong.
+//
+// Dump is written with plain write(2) and it doesn't allocate, so that it
+// can be called from signal handler (see `install_crash_dump()`).
+//
+// NOTE: Ring has single writer. Dump taken on another thread while writer is
+// running may contain torn events at the oldest end.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace sadhbhcraft::util
+{
+    struct TraceDumpHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t event_size;
+        std::uint64_t total_count;  // Events ever recorded
+        std::uint64_t count;        // Events in this dump
+    };
+
+    constexpr char TRACE_DUMP_MAGIC[8] = {'S', 'C', 'T', 'R', 'A', 'C', 'E', '\0'};
+    constexpr std::uint32_t TRACE_DUMP_VERSION = 1;
+
+    enum class TraceDumpError
+    {
+        None,
+        Truncated,          // Buffer ends before the last event
+        BadMagic,
+        BadVersion,
+        BadEventSize        // Dump was recorded with different event type
+    };
+
+    // Writes whole buffer, retrying after interrupts and partial writes, and
+    // returns false on error
+    inline bool write_all(int fd, const void *data, std::size_t size)
+    {
+        const char *p = static_cast<const char *>(data);
+        while (size)
+        {
+            ssize_t n = ::write(fd, p, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            p += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    template<typename Event, std::size_t Capacity>
+    requires (std::is_trivially_copyable_v<Event> && std::has_single_bit(Capacity))
+    class TraceRing
+    {
+    public:
+        typedef Event EventType;
+        static constexpr std::size_t capacity = Capacity;
+
+        // Storage is allocated and zeroed up front, so that we don't take
+        // page faults on the hot path
+        TraceRing() : m_events(std::make_unique<Event[]>(Capacity))
+        {}
+
+        void push(const Event &event)
+        {
+            const std::uint64_t head = m_head.load(std::memory_order_relaxed);
+            m_events[head & (Capacity - 1)] = event;
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        // Events ever recorded, including those overwritten
+        std::uint64_t total_count() const { return m_head.load(std::memory_order_acquire); }
+
+        std::size_t size() const
+        {
+            const std::uint64_t head = total_count();
+            return head < Capacity ? static_cast<std::size_t>(head) : Capacity;
+        }
+
+        // Visits events oldest first
+        template<typename Handler>
+        void for_each(Handler &&handler) const
+        {
+            const std::uint64_t head = total_count();
+            for (std::uint64_t i = head - size(); i != head; ++i)
+            {
+                handler(m_events[i & (Capacity - 1)]);
+            }
+        }
+
+        void clear() { m_head.store(0, std::memory_order_release); }
+
+        // Writes header followed by events oldest first, and returns false if
+        // write has failed. It is async-signal-safe.
+        bool dump(int fd) const
+        {
+            const std::uint64_t head = total_count();
+            const std::uint64_t count = head < Capacity ? head : Capacity;
+
+            TraceDumpHeader header{};
+            std::memcpy(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic));
+            header.version = TRACE_DUMP_VERSION;
+            header.event_size = sizeof(Event);
+            header.total_count = head;
+            header.count = count;
+
+            // Events wrap around the end of the storage, so that it takes
+            // two writes: from the oldest to the end, and then from the
+            // beginning to the newest.
+            const std::size_t first = static_cast<std::size_t>((head - count) & (Capacity - 1));
+            const std::size_t first_count = std::min<std::size_t>(count, Capacity - first);
+
+            return write_all(fd, &header, sizeof(header))
+                && write_all(fd, &m_events[first], first_count * sizeof(Event))
+                && write_all(fd, &m_events[0], (count - first_count) * sizeof(Event));
+        }
+
+    private:
+        std::unique_ptr<Event[]> m_events;
+        std::atomic<std::uint64_t> m_head{0};
+    };
+
+    // Reads dump written by `TraceRing::dump()` and calls handler for each
+    // event, oldest first
+    template<typename Event, typename Handler>
+    TraceDumpError read_trace_dump(std::string_view data, Handler &&handler, TraceDumpHeader *header_out = nullptr)
+    {
+        TraceDumpHeader header;
+        if (data.size() < sizeof(header))
+        {
+            return TraceDumpError::Truncated;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic)))
+        {
+            return TraceDumpError::BadMagic;
+        }
+        if (header.version != TRACE_DUMP_VERSION)
+        {
+            return TraceDumpError::BadVersion;
+        }
+        if (header.event_size != sizeof(Event))
+        {
+            return TraceDumpError::BadEventSize;
+        }
+        if (header_out)
+        {
+            *header_out = header;
+        }
+
+        data.remove_prefix(sizeof(header));
+        for (std::uint64_t i = 0; i != header.count; ++i)
+        {
+            if (data.size() < sizeof(Event))
+            {
+                return TraceDumpError::Truncated;
+            }
+            Event event;
+            std::memcpy(&event, data.data(), sizeof(Event));
+            handler(event);
+            data.remove_prefix(sizeof(Event));
+        }
+        return TraceDumpError::None;
+    }
+
+    namespace detail
+    {
+        inline const void *crash_dump_ring = nullptr;
+        inline bool (*crash_dump_function)(const void *, int) = nullptr;
+        inline char crash_dump_path[256] = {};
+
+        inline void crash_dump_handler(int signal)
+        {
+            int fd = ::open(crash_dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0)
+            {
+                crash_dump_function(crash_dump_ring, fd);
+                ::close(fd);
+            }
+            // Handler was installed with SA_RESETHAND, so that raising signal
+            // again terminates process as it would without us
+            ::raise(signal);
+        }
+    }
+
+    // Dumps ring to file at given path when process crashes, i.e. on SIGSEGV,
+    // SIGBUS, SIGFPE, SIGILL and SIGABRT. Returns false if path is too long,
+    // or handler could not be installed.
+    // NOTE: There is only one crash dump per process, and installing another
+    // replaces the previous one. Ring must outlive the process or be
+    // uninstalled by `uninstall_crash_dump()`.
+    template<typename Ring>
+    bool install_crash_dump(const Ring &ring, const char *path)
+    {
+        const std::size_t length = std::strlen(path);
+        if (length >= sizeof(detail::crash_dump_path))
+        {
+            return false;
+        }
+        std::memcpy(detail::crash_dump_path, path, length + 1);
+        detail::crash_dump_ring = &ring;
+        detail::crash_dump_function = [](const void *r, int fd)
+        {
+            return static_cast<const Ring *>(r)->dump(fd);
+        };
+
+        struct sigaction action{};
+        action.sa_handler = detail::crash_dump_handler;
+        action.sa_flags = SA_RESETHAND;
+        sigemptyset(&action.sa_mask);
+
+        bool ok = true;
+        for (int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT})
+        {
+            ok = (::sigaction(signal, &action, nullptr) == 0) && ok;
+        }
+        return ok;
+    }
+
+    inline void uninstall_crash_dump()
+    {
+        for (int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT})
+        {
+            std::signal(signal, SIG_DFL);
+        }
+        detail::crash_dump_ring = nullptr;
+        detail::crash_dump_function = nullptr;
+    }
+
+} // end of namespace sadhbhcraft::util
+#endif//INCLUDED_TRACERING_HPP
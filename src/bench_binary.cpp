@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+#include "codec/binary.hpp"
+#include "codec/fix.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scc = sadhbhcraft::codec;
+
+
+struct BenchOrder
+{
+    typedef long PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    unsigned owner;
+};
+
+std::vector<BenchOrder> make_orders(size_t count)
+{
+    std::mt19937 rng(42);
+    std::vector<BenchOrder> orders;
+    orders.reserve(count);
+
+    for (size_t i = 0; i != count; ++i)
+    {
+        orders.push_back({
+            .side = (rng() % 2 ? scob::Side::Buy : scob::Side::Sell),
+            .order_type = (rng() % 4 ? scob::OrderType::Limit : scob::OrderType::IOC),
+            .price = static_cast<long>(10000 + rng() % 200),
+            .quantity = static_cast<long>(1 + rng() % 1000),
+            .owner = static_cast<unsigned>(rng() % 10000)});
+    }
+    return orders;
+}
+
+template<typename Encode, typename Decode>
+void run(const char *name, const std::vector<BenchOrder> &orders, int rounds, Encode encode, Decode decode)
+{
+    std::vector<char> buffer(orders.size() * 128);
+    size_t size = 0;
+    for (size_t i = 0; i != orders.size(); ++i)
+    {
+        size += encode(orders[i], i, std::span<char>(buffer).subspan(size));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    long checksum = 0;
+    size_t decoded = 0;
+
+    for (int round = 0; round != rounds; ++round)
+    {
+        std::string_view view(buffer.data(), size);
+        BenchOrder order{};
+        while (!view.empty())
+        {
+            const size_t consumed = decode(view, order);
+            if (!consumed)
+            {
+                std::fprintf(stderr, "Decode error\n");
+                return;
+            }
+            checksum += order.quantity;
+            ++decoded;
+            view.remove_prefix(consumed);
+        }
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-8s %10.2f M msg/s %8.1f MB/s %4zu bytes/msg (checksum %ld)\n",
+        name,
+        decoded / elapsed.count() / 1e6,
+        size * static_cast<double>(rounds) / elapsed.count() / 1e6,
+        size / orders.size(),
+        checksum);
+}
+
+int main(int argc, const char **argv)
+{
+    const int rounds = (argc > 1 ? std::atoi(argv[1]) : 20);
+    const auto orders = make_orders(100000);
+
+    std::printf("Decoding NewOrder into OrderConcept type\n");
+
+    run("fix", orders, rounds,
+        [](const BenchOrder &order, size_t, std::span<char> out)
+        {
+            return scc::write_new_order_single(order, out);
+        },
+        [](std::string_view buffer, BenchOrder &order) -> size_t
+        {
+            auto res = scc::parse_new_order_single(buffer, order);
+            return res ? res.consumed : 0;
+        });
+
+    run("binary", orders, rounds,
+        [](const BenchOrder &order, size_t id, std::span<char> out)
+        {
+            return scc::encode_new_order(order, id, out);
+        },
+        [](std::string_view buffer, BenchOrder &order) -> size_t
+        {
+            bool decoded = false;
+            auto res = scc::decode_binary_message(buffer, [&](auto view)
+            {
+                if constexpr (std::is_same_v<decltype(view), scc::NewOrderView>)
+                {
+                    decoded = (view.to_order(order) == scc::BinaryError::None);
+                }
+            });
+            return (res && decoded) ? res.consumed : 0;
+        });
+
+    return 0;
+}
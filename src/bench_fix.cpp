@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+#include "codec/fix.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scc = sadhbhcraft::codec;
+namespace scu = sadhbhcraft::util;
+
+
+struct BenchOrder
+{
+    typedef long PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    unsigned owner;
+};
+
+std::vector<char> make_messages(size_t count)
+{
+    std::mt19937 rng(42);
+    std::vector<char> buffer(count * 128);
+    size_t size = 0;
+
+    for (size_t i = 0; i != count; ++i)
+    {
+        BenchOrder order{
+            .side = (rng() % 2 ? scob::Side::Buy : scob::Side::Sell),
+            .order_type = (rng() % 4 ? scob::OrderType::Limit : scob::OrderType::IOC),
+            .price = static_cast<long>(10000 + rng() % 200),
+            .quantity = static_cast<long>(1 + rng() % 1000),
+            .owner = static_cast<unsigned>(rng() % 10000)};
+        size += scc::write_new_order_single(order, std::span<char>(buffer).subspan(size));
+    }
+
+    buffer.resize(size);
+    return buffer;
+}
+
+template<bool Vectorised>
+void run(const char *name, const std::vector<char> &buffer, int rounds)
+{
+    const auto start = std::chrono::steady_clock::now();
+    long checksum = 0;
+    size_t parsed = 0;
+
+    for (int round = 0; round != rounds; ++round)
+    {
+        std::string_view view(buffer.data(), buffer.size());
+        BenchOrder order{};
+        while (!view.empty())
+        {
+            auto res = scc::parse_new_order_single<BenchOrder, Vectorised>(view, order);
+            if (!res)
+            {
+                std::cerr << "Parse error" << std::endl;
+                return;
+            }
+            checksum += order.quantity;
+            ++parsed;
+            view.remove_prefix(res.consumed);
+        }
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-8s %10.2f M msg/s %8.1f MB/s (%zu messages, checksum %ld)\n",
+        name,
+        parsed / elapsed.count() / 1e6,
+        buffer.size() * static_cast<double>(rounds) / elapsed.count() / 1e6,
+        parsed, checksum);
+}
+
+int main(int argc, const char **argv)
+{
+    const size_t count = 100000;
+    const int rounds = (argc > 1 ? std::atoi(argv[1]) : 20);
+    const auto buffer = make_messages(count);
+
+    std::printf("FIX NewOrderSingle, %zu bytes per message on average\n", buffer.size() / count);
+    run<false>("scalar", buffer, rounds);
+    if constexpr (scu::simd_available)
+    {
+        run<scu::simd_available>("simd", buffer, rounds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/ingress.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+
+
+struct BenchOrder
+{
+    typedef long PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    std::uint64_t sequence;
+};
+
+typedef scob::OrderBook<BenchOrder> BookType;
+typedef scob::OrderIngress<BookType, 4096> IngressType;
+
+std::deque<BenchOrder> make_orders(size_t count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::deque<BenchOrder> orders;
+
+    for (size_t i = 0; i != count; ++i)
+    {
+        orders.push_back({
+            .side = (rng() % 2 ? scob::Side::Buy : scob::Side::Sell),
+            .order_type = (rng() % 4 ? scob::OrderType::Limit : scob::OrderType::IOC),
+            .price = static_cast<long>(10000 + rng() % 200),
+            .quantity = static_cast<long>(1 + rng() % 1000),
+            .sequence = 0});
+    }
+    return orders;
+}
+
+// Producers submit all their orders as fast as they can, while matching
+// thread drains them into the book
+void run(int producer_count, size_t orders_per_producer)
+{
+    std::vector<std::deque<BenchOrder>> orders;
+    for (int p = 0; p != producer_count; ++p)
+    {
+        orders.push_back(make_orders(orders_per_producer, 42 + p));
+    }
+
+    BookType book;
+    IngressType ingress;
+    std::atomic<bool> go{false};
+    std::atomic<int> done{0};
+    std::atomic<std::uint64_t> full{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p != producer_count; ++p)
+    {
+        producers.emplace_back([&, p]
+        {
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            std::uint64_t retries = 0;
+            for (auto &order : orders[p])
+            {
+                while (!ingress.submit(order))
+                {
+                    ++retries;
+                    std::this_thread::yield();
+                }
+            }
+            full.fetch_add(retries, std::memory_order_relaxed);
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    long executed = 0;
+    size_t accepted = 0;
+    size_t batches = 0;
+    auto handler = [&](std::uint64_t, auto execution) { executed += execution.quantity; };
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+
+    while (done.load(std::memory_order_acquire) != producer_count || ingress.size())
+    {
+        if (size_t n = ingress.drain(book, handler))
+        {
+            accepted += n;
+            ++batches;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+
+    std::printf("%3d producers %10.2f M orders/s %8.1f orders/batch %10lu full (executed %ld)\n",
+        producer_count,
+        accepted / elapsed.count() / 1e6,
+        static_cast<double>(accepted) / (batches ? batches : 1),
+        static_cast<unsigned long>(full.load()),
+        executed);
+}
+
+int main(int argc, const char **argv)
+{
+    const size_t orders_per_producer = (argc > 1 ? std::atol(argv[1]) : 200000);
+    const int max_producers = (argc > 2 ? std::atoi(argv[2]) : 16);
+
+    std::printf("Submitting orders from gateway threads into one book (%u hardware threads)\n",
+        std::thread::hardware_concurrency());
+
+    for (int producer_count = 1; producer_count <= max_producers; producer_count *= 2)
+    {
+        run(producer_count, orders_per_producer);
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <vector>
+
+#include <malloc.h>
+
+#include "lib.hpp"
+#include "orderbook/compact.hpp"
+#include "util/hugepages.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+// Bytes of heap in use, as malloc sees it, i.e. with its own overhead
+static std::size_t heap_bytes = 0;
+
+void *operator new(std::size_t size)
+{
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        heap_bytes += ::malloc_usable_size(p);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p)
+    {
+        heap_bytes -= ::malloc_usable_size(p);
+        std::free(p);
+    }
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    const std::size_t a = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a))
+    {
+        heap_bytes += ::malloc_usable_size(p);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+void operator delete(void *p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { operator delete(p); }
+
+
+typedef scob::Order<long, long> OrderType;
+
+// Creates given number of books, and then puts orders into one in ten of
+// them, few levels deep, as thin instruments would have
+template<typename BookType>
+void run(const char *name, std::size_t book_count)
+{
+    std::pmr::unsynchronized_pool_resource pool;
+    scu::ScopedDefaultResource scope(&pool);
+    std::mt19937 rng(42);
+
+    std::deque<OrderType> orders;
+    const std::size_t start = heap_bytes;
+    {
+        std::deque<BookType> books;
+        for (std::size_t i = 0; i != book_count; ++i)
+        {
+            books.emplace_back();
+        }
+        const std::size_t empty = heap_bytes - start;
+
+        // Orders are owned by caller, and don't count towards book memory
+        orders.resize(book_count / 10 * 8);
+        const std::size_t before_orders = heap_bytes;
+        const std::size_t orders_bytes = before_orders - start - empty;
+
+        std::size_t order_count = 0;
+        for (std::size_t i = 0; i < book_count; i += 10)
+        {
+            for (int j = 0; j != 8; ++j)
+            {
+                auto &order = orders[order_count++];
+                order.side = (j % 2 ? scob::Side::Buy : scob::Side::Sell);
+                order.order_type = scob::OrderType::Limit;
+                order.price = (order.side == scob::Side::Buy ? 99 - rng() % 4 : 101 + rng() % 4);
+                order.quantity = 1 + rng() % 100;
+                for (auto ex = books[i].accept_order(order); ex; ex())
+                {}
+            }
+        }
+        const std::size_t with_orders = heap_bytes - before_orders;
+
+        std::printf("%-8s %7zu books %8.1f bytes/empty book %8.1f bytes/order %8.1f MB total\n",
+            name,
+            book_count,
+            static_cast<double>(empty) / book_count,
+            static_cast<double>(with_orders) / order_count,
+            (heap_bytes - start - orders_bytes) / 1e6);
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    std::printf("Memory of books hosting thin instruments, with books themselves in std::deque\n");
+
+    for (std::size_t book_count : {1000, 10000, 100000})
+    {
+        run<scob::OrderBook<OrderType>>("deque", book_count);
+        run<scob::OrderBook<OrderType, scob::CompactBookSidePolicy<>>>("compact", book_count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/replica.hpp"
+#include "util/hugepages.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+enum class EventType { Add, Reduce, Execute, Delete };
+
+struct Event
+{
+    EventType type;
+    std::uint64_t id;
+    scob::Side side;
+    long price;
+    long quantity;
+};
+
+// Feed of order events, as market-by-order feed of busy instrument would
+// have, with most of the orders added close to the top (mean depth in ticks),
+// and most of them deleted soon after
+std::vector<Event> make_events(std::size_t count, std::size_t live_orders, double mean_depth)
+{
+    std::mt19937_64 rng(42);
+    std::geometric_distribution<long> depth(1.0 / (1.0 + mean_depth));
+    std::vector<Event> events;
+    std::vector<std::pair<std::uint64_t, long>> live;   // Id and quantity left
+    std::uint64_t next_id = 1;
+
+    events.reserve(count);
+    while (events.size() != count)
+    {
+        const unsigned dice = rng() % 100;
+        if (live.size() < live_orders / 2 || (live.size() < live_orders && dice < 50))
+        {
+            const scob::Side side = (rng() % 2 ? scob::Side::Buy : scob::Side::Sell);
+            const long price = (side == scob::Side::Buy ? 9999 - depth(rng) : 10001 + depth(rng));
+            const long quantity = 1 + rng() % 500;
+            events.push_back({EventType::Add, next_id, side, price, quantity});
+            live.emplace_back(next_id++, quantity);
+            continue;
+        }
+
+        const std::size_t index = rng() % live.size();
+        auto &[id, quantity] = live[index];
+        if (dice < 85)
+        {
+            events.push_back({EventType::Delete, id, {}, 0, 0});
+            quantity = 0;
+        }
+        else
+        {
+            const long reduce_by = 1 + rng() % quantity;
+            events.push_back({dice < 92 ? EventType::Reduce : EventType::Execute, id, {}, 0, reduce_by});
+            quantity -= reduce_by;
+        }
+        if (!quantity)
+        {
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+    return events;
+}
+
+template<typename BookType>
+void run(const char *name, const std::vector<Event> &events, std::size_t live_orders)
+{
+    BookType book(live_orders);
+    std::size_t missed = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const Event &event : events)
+    {
+        bool ok = false;
+        switch (event.type)
+        {
+            case EventType::Add: ok = book.add_order(event.id, event.side, event.price, event.quantity); break;
+            case EventType::Reduce: ok = book.reduce_order(event.id, event.quantity); break;
+            case EventType::Execute: ok = book.execute_order(event.id, event.quantity); break;
+            case EventType::Delete: ok = book.delete_order(event.id); break;
+        }
+        missed += !ok;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("%-10s %10.2f M events/s %8zu orders %6zu bid levels %6zu ask levels (missed %zu)\n",
+        name,
+        events.size() / elapsed.count() / 1e6,
+        book.size(),
+        book.bid().size(),
+        book.ask().size(),
+        missed);
+}
+
+int main(int argc, const char **argv)
+{
+    const std::size_t event_count = (argc > 1 ? std::atol(argv[1]) : 10000000);
+    const std::size_t live_orders = (argc > 2 ? std::atol(argv[2]) : 100000);
+    const double deep_depth = (argc > 3 ? std::atof(argv[3]) : 1000);
+
+    typedef scob::Order<long, long> OrderType;
+    std::pmr::unsynchronized_pool_resource pool;
+    scu::ScopedDefaultResource scope(&pool);
+
+    // Deep book has many levels, and erasing a level far from the top of
+    // the stack moves the levels on either side of it
+    for (const double mean_depth : {4.0, deep_depth})
+    {
+        std::printf("Applying %zu market-by-order events with up to %zu orders on the book, %.0f ticks deep on average\n",
+            event_count, live_orders, mean_depth);
+        const auto events = make_events(event_count, live_orders, mean_depth);
+
+        run<scob::ReplicaBook<OrderType>>("list", events, live_orders);
+        run<scob::ReplicaBook<OrderType, scob::ReplicaBookSidePolicy<std::pmr::deque, std::pmr::list>>>("pmr list", events, live_orders);
+    }
+
+    return 0;
+}
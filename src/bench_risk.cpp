@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/risk.hpp"
+#include "util/stats.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+struct BenchOrder
+{
+    typedef long PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    unsigned owner;
+};
+
+typedef scob::PreTradeRisk<BenchOrder> RiskType;
+typedef scob::OrderQuantity<BenchOrder> OrderQuantityType;
+
+// Aggressor and resting order of each execution, from random accounts
+struct Execution
+{
+    BenchOrder *aggressor;
+    BenchOrder *resting;
+    long quantity;
+};
+
+std::vector<Execution> make_executions(std::vector<BenchOrder> &orders, std::size_t count)
+{
+    std::mt19937 rng(42);
+    std::vector<Execution> executions;
+    executions.reserve(count);
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        BenchOrder *a = &orders[rng() % orders.size()];
+        BenchOrder *b = &orders[rng() % orders.size()];
+        if (a->side == b->side)
+        {
+            continue;
+        }
+        executions.push_back({a, b, static_cast<long>(1 + rng() % 100)});
+    }
+    return executions;
+}
+
+RiskType make_risk(std::size_t accounts)
+{
+    return RiskType{{.max_position = 1000000000, .max_notional = 1e18, .max_orders = 1000000000}, std::chrono::seconds(1), accounts};
+}
+
+void report(const char *name, std::vector<std::uint64_t> &cycles, double ns_per_check)
+{
+    std::sort(cycles.begin(), cycles.end());
+    auto at = [&](double q) { return cycles[static_cast<std::size_t>(q * static_cast<double>(cycles.size() - 1))]; };
+    std::printf("%-12s %8.1f ns/check   cycles p50 %6lu  p99 %6lu  p99.9 %6lu  max %8lu\n",
+        name, ns_per_check, at(0.5), at(0.99), at(0.999), cycles.back());
+}
+
+// Each execution checked on its own, as by `PreTradeRisk::check()` policy
+void run_single(const std::vector<Execution> &executions, std::size_t accounts)
+{
+    RiskType risk = make_risk(accounts);
+    std::vector<std::uint64_t> cycles;
+    cycles.reserve(executions.size());
+
+    // Throughput pass, without timestamps around each check
+    long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &execution : executions)
+    {
+        OrderQuantityType executed{*execution.resting, execution.quantity};
+        risk.check_execution(*execution.aggressor, executed);
+        checksum += executed.quantity;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    // Latency pass, on accounts that have already traded
+    for (const auto &execution : executions)
+    {
+        OrderQuantityType executed{*execution.resting, execution.quantity};
+        const std::uint64_t t0 = scu::read_cycles();
+        risk.check_execution(*execution.aggressor, executed);
+        cycles.push_back(scu::read_cycles() - t0);
+        checksum += executed.quantity;
+    }
+
+    report("single", cycles, elapsed.count() / static_cast<double>(executions.size()));
+    std::printf("%-12s checksum %ld\n", "", checksum);
+}
+
+// Fills of one aggressor checked together, as when sweeping a level
+void run_batch(const std::vector<Execution> &executions, std::size_t accounts, std::size_t batch_size)
+{
+    RiskType risk = make_risk(accounts);
+    std::vector<std::uint64_t> cycles;
+    std::vector<OrderQuantityType> fills;
+    long checksum = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i + batch_size <= executions.size(); i += batch_size)
+    {
+        fills.clear();
+        for (std::size_t j = i; j != i + batch_size; ++j)
+        {
+            fills.emplace_back(*executions[j].resting, executions[j].quantity);
+        }
+        const std::uint64_t t0 = scu::read_cycles();
+        risk.check_batch(*executions[i].aggressor, fills);
+        cycles.push_back((scu::read_cycles() - t0) / batch_size);
+        for (const auto &executed : fills)
+        {
+            checksum += executed.quantity;
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    report("batch", cycles, elapsed.count() / static_cast<double>(cycles.size() * batch_size));
+    std::printf("%-12s checksum %ld\n", "", checksum);
+}
+
+int main(int argc, const char **argv)
+{
+    const std::size_t execution_count = (argc > 1 ? std::atol(argv[1]) : 5000000);
+    const std::size_t accounts = (argc > 2 ? std::atol(argv[2]) : 10000);
+    const std::size_t batch_size = (argc > 3 ? std::atol(argv[3]) : 8);
+
+    std::mt19937 rng(7);
+    std::vector<BenchOrder> orders;
+    for (std::size_t i = 0; i != accounts * 4; ++i)
+    {
+        orders.push_back({
+            .side = (rng() % 2 ? scob::Side::Buy : scob::Side::Sell),
+            .order_type = scob::OrderType::Limit,
+            .price = static_cast<long>(10000 + rng() % 200),
+            .quantity = 1000,
+            .owner = static_cast<unsigned>(rng() % accounts)});
+    }
+    const auto executions = make_executions(orders, execution_count);
+
+    std::printf("Checking %zu executions between %zu accounts (cycles per check, batch of %zu)\n",
+        executions.size(), accounts, batch_size);
+    run_single(executions, accounts);
+    run_batch(executions, accounts, batch_size);
+
+    return 0;
+}
@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+#include "util/hugepages.hpp"
+#include "util/stats.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+//
+// Synthetic order flow generator and stress tool
+//
+//      loadgen seconds=300 rate=2000000 books=4 zipf=1.2
+//
+// Each book has its own mid price doing random walk, and orders are placed
+// at Zipf-distributed distance from it: adds rest behind the mid, and
+// aggressors (IOC) reach across it. Cancels pick random resting order. Flow
+// is paced to target rate, which is multiplied during bursts, and books are
+// driven round robin from one thread.
+//
+// Every report interval it prints throughput achieved, and percentiles of
+// service time, spent in the book per order, and of response time, from
+// when the order was due by the pacing schedule until it was done (see
+// `util::LogLinearHistogram`), and also size of the books and of order pool,
+// so that degradation over minutes of run is visible. Response time counts
+// the wait of orders queued behind a slow one, which service time alone
+// hides (coordinated omission). Without pacing the two are the same.
+//
+// With arena=<MB> books and orders are allocated from pre-faulted huge
+// pages (see `util::HugePageResource`). Book sides use `std::pmr` containers
+// (see `PmrBookSidePolicy`) with arena, and default containers without it,
+// unless pmr=1 or pmr=0 says otherwise, so that runs can compare policies
+// with and without arena.
+//
+// NOTE: Book has no single order cancel, and so cancel is mass cancel of
+// the owner's orders on the level of order picked (see `OwnerIndexHook`).
+// With many owners this is almost always the one order.
+//
+
+struct LoadOrder
+{
+    typedef long PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    unsigned owner;
+    QuantityType remaining;
+    size_t live_index;
+    scob::OwnerIndexHook<LoadOrder> owner_hook;
+};
+
+struct Options
+{
+    double seconds = 10;
+    double rate = 1000000;          // Orders per second, 0 for no pacing
+    unsigned books = 1;
+    unsigned seed = 42;
+    double add = 50;                // Weights of actions
+    double cancel = 40;
+    double aggress = 10;
+    double zipf = 1.1;              // Exponent of distance from the mid
+    unsigned depth = 200;           // Maximum distance from the mid in ticks
+    double walk = 0.01;             // Probability of mid moving by a tick
+    unsigned owners = 10000;
+    double burst_every = 1.0;       // Seconds between starts of bursts
+    double burst_length = 0.1;      // Seconds, 0 for no bursts
+    double burst_factor = 5;        // Rate multiplier during burst
+    double report = 1.0;            // Seconds between reports
+    double arena = 0;               // Megabytes of huge pages, 0 for heap
+    double pmr = -1;                // Book side policy: 1 for std::pmr, 0 for default, -1 for std::pmr with arena only
+
+    bool use_pmr() const { return pmr < 0 ? arena > 0 : pmr > 0; }
+};
+
+bool parse_option(Options &options, const char *arg)
+{
+    const char *eq = std::strchr(arg, '=');
+    if (!eq)
+    {
+        return false;
+    }
+    const std::string_view name(arg, eq - arg);
+    const double value = std::atof(eq + 1);
+
+    if (name == "seconds") { options.seconds = value; }
+    else if (name == "rate") { options.rate = value; }
+    else if (name == "books") { options.books = std::max(1u, static_cast<unsigned>(value)); }
+    else if (name == "seed") { options.seed = static_cast<unsigned>(value); }
+    else if (name == "add") { options.add = value; }
+    else if (name == "cancel") { options.cancel = value; }
+    else if (name == "aggress") { options.aggress = value; }
+    else if (name == "zipf") { options.zipf = value; }
+    else if (name == "depth") { options.depth = std::max(1u, static_cast<unsigned>(value)); }
+    else if (name == "walk") { options.walk = value; }
+    else if (name == "owners") { options.owners = std::max(1u, static_cast<unsigned>(value)); }
+    else if (name == "burst_every") { options.burst_every = value; }
+    else if (name == "burst_length") { options.burst_length = value; }
+    else if (name == "burst_factor") { options.burst_factor = value; }
+    else if (name == "report") { options.report = value; }
+    else if (name == "arena") { options.arena = value; }
+    else if (name == "pmr") { options.pmr = value; }
+    else { return false; }
+    return true;
+}
+
+// Samples distance in [0, depth) with P(d) proportional to 1 / (d + 1)^s
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(unsigned depth, double exponent)
+    {
+        double total = 0;
+        for (unsigned d = 0; d != depth; ++d)
+        {
+            total += 1.0 / std::pow(d + 1.0, exponent);
+            m_cdf.push_back(total);
+        }
+        for (auto &x : m_cdf)
+        {
+            x /= total;
+        }
+    }
+
+    template<typename Rng>
+    long operator()(Rng &rng)
+    {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return std::min<long>(std::lower_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin(), m_cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> m_cdf;
+};
+
+// Orders stay where they are while on the book, and slots of orders that
+// are done are reused (see replay). Resting orders are also kept in a
+// vector, so that cancels can pick one at random.
+class OrderPool
+{
+public:
+    static constexpr size_t not_live = ~size_t(0);
+
+    LoadOrder &acquire(const LoadOrder &order)
+    {
+        LoadOrder *slot;
+        if (m_free.empty())
+        {
+            slot = &m_orders.emplace_back(order);
+        }
+        else
+        {
+            slot = m_free.back();
+            m_free.pop_back();
+            *slot = order;
+        }
+        slot->live_index = not_live;
+        return *slot;
+    }
+
+    void release(LoadOrder &order)
+    {
+        if (order.live_index != not_live)
+        {
+            LoadOrder *last = m_live.back();
+            m_live[order.live_index] = last;
+            last->live_index = order.live_index;
+            m_live.pop_back();
+            order.live_index = not_live;
+        }
+        m_free.push_back(&order);
+    }
+
+    void make_live(LoadOrder &order)
+    {
+        order.live_index = m_live.size();
+        m_live.push_back(&order);
+    }
+
+    template<typename Rng>
+    LoadOrder *pick_live(Rng &rng)
+    {
+        return m_live.empty() ? nullptr : m_live[rng() % m_live.size()];
+    }
+
+    size_t live() const { return m_live.size(); }
+    size_t capacity() const { return m_orders.size(); }
+
+private:
+    std::pmr::deque<LoadOrder> m_orders;
+    std::vector<LoadOrder *> m_free;
+    std::vector<LoadOrder *> m_live;
+};
+
+template<typename BookSidePolicy>
+struct BookState
+{
+    scob::OrderBook<LoadOrder, BookSidePolicy> book;
+    OrderPool pool;
+    long mid = 100000;
+};
+
+template<typename BookSidePolicy>
+class LoadGenerator
+{
+    typedef BookState<BookSidePolicy> BookStateType;
+
+public:
+    explicit LoadGenerator(const Options &options)
+        : m_options(options), m_books(options.books), m_rng(options.seed), m_zipf(options.depth, options.zipf)
+    {}
+
+    int run()
+    {
+        typedef std::chrono::steady_clock Clock;
+        const auto start = Clock::now();
+        const auto end = start + std::chrono::duration<double>(m_options.seconds);
+        auto next_report = start + std::chrono::duration<double>(m_options.report);
+        auto last_report = start;
+        auto due = start;
+
+        size_t order_count = 0;
+        size_t interval_count = 0;
+        size_t book_index = 0;
+
+        print_header();
+
+        for (auto now = start; now < end; )
+        {
+            // Pace to target rate, and catch up when behind
+            auto scheduled = now;
+            if (m_options.rate > 0)
+            {
+                while (now < due)
+                {
+                    now = Clock::now();
+                }
+                scheduled = due;
+                due += std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(1.0 / current_rate(now - start)));
+            }
+
+            BookStateType &state = m_books[book_index];
+            book_index = (book_index + 1) % m_books.size();
+
+            const auto t0 = Clock::now();
+            step(state);
+            now = Clock::now();
+            record(m_service, nanoseconds(now - t0));
+            record(m_response, nanoseconds(now - scheduled));
+
+            ++order_count;
+            ++interval_count;
+
+            if (now >= next_report)
+            {
+                const std::chrono::duration<double> interval = now - last_report;
+                const std::chrono::duration<double> total = now - start;
+                print_report(total.count(), interval_count / interval.count());
+
+                m_service.reset();
+                m_response.reset();
+                interval_count = 0;
+                last_report = now;
+                next_report += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_options.report));
+            }
+        }
+
+        const std::chrono::duration<double> total = Clock::now() - start;
+        std::printf("Generated %zu orders with %zu executions and %zu cancels in %.3fs (%.2f M orders/s)\n",
+            order_count, m_execution_count, m_cancel_count, total.count(), order_count / total.count() / 1e6);
+        return 0;
+    }
+
+private:
+    Options m_options;
+    std::vector<BookStateType> m_books;
+    std::mt19937_64 m_rng;
+    ZipfDistribution m_zipf;
+    // Percentiles, and maximum of each interval
+    struct Latency
+    {
+        scu::LogLinearHistogram<> histogram;
+        std::uint64_t max = 0;
+
+        void reset()
+        {
+            histogram.reset();
+            max = 0;
+        }
+    };
+
+    Latency m_service;
+    Latency m_response;
+    size_t m_execution_count = 0;
+    size_t m_cancel_count = 0;
+
+    static std::uint64_t nanoseconds(std::chrono::steady_clock::duration duration)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    static void record(Latency &latency, std::uint64_t value)
+    {
+        latency.histogram.record(value);
+        latency.max = std::max(latency.max, value);
+    }
+
+    double current_rate(std::chrono::steady_clock::duration since_start) const
+    {
+        if (m_options.burst_length <= 0 || m_options.burst_every <= 0)
+        {
+            return m_options.rate;
+        }
+        const double t = std::chrono::duration<double>(since_start).count();
+        const bool in_burst = std::fmod(t, m_options.burst_every) < m_options.burst_length;
+        return in_burst ? m_options.rate * m_options.burst_factor : m_options.rate;
+    }
+
+    double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng); }
+
+    void step(BookStateType &state)
+    {
+        if (uniform() < m_options.walk)
+        {
+            state.mid += (m_rng() % 2 ? 1 : -1);
+        }
+
+        const double action = uniform() * (m_options.add + m_options.cancel + m_options.aggress);
+        if (action >= m_options.add && action < m_options.add + m_options.cancel)
+        {
+            if (LoadOrder *order = state.pool.pick_live(m_rng))
+            {
+                cancel(state, *order);
+                return;
+            }
+        }
+
+        const bool aggress = action >= m_options.add + m_options.cancel;
+        const auto side = (m_rng() % 2 ? scob::Side::Buy : scob::Side::Sell);
+        const long distance = (aggress ? m_zipf(m_rng) : 1 + m_zipf(m_rng));
+        const long offset = (aggress ? distance : -distance);
+
+        LoadOrder order{
+            .side = side,
+            .order_type = (aggress ? scob::OrderType::IOC : scob::OrderType::Limit),
+            .price = state.mid + (side == scob::Side::Buy ? offset : -offset),
+            .quantity = static_cast<long>(1 + m_rng() % 100),
+            .owner = static_cast<unsigned>(m_rng() % m_options.owners)};
+        order.remaining = order.quantity;
+        submit(state, state.pool.acquire(order));
+    }
+
+    void submit(BookStateType &state, LoadOrder &order)
+    {
+        for (auto executions = state.book.accept_order(order); executions;)
+        {
+            auto execution = executions();
+            LoadOrder &resting = execution.order();
+            ++m_execution_count;
+
+            order.remaining -= execution.quantity;
+            if (!(resting.remaining -= execution.quantity))
+            {
+                state.pool.release(resting); //< Already removed from its level
+            }
+        }
+
+        if (order.order_type == scob::OrderType::Limit && order.remaining > 0)
+        {
+            state.pool.make_live(order);
+        }
+        else
+        {
+            state.pool.release(order);
+        }
+    }
+
+    void cancel(BookStateType &state, LoadOrder &order)
+    {
+        state.book.cancel_owner_orders(order.owner, {order.side, order.price, order.price});
+        for (const auto &cancelled : state.book.mass_cancels())
+        {
+            state.pool.release(const_cast<LoadOrder &>(cancelled.order()));
+            ++m_cancel_count;
+        }
+    }
+
+    void print_header() const
+    {
+        std::printf("%8s %12s | %-43s | %-43s | %8s %8s %10s\n",
+            "", "", "service ns", "response ns (from due)", "", "", "");
+        std::printf("%8s %12s | %10s %10s %10s %10s | %10s %10s %10s %10s | %8s %8s %10s\n",
+            "time", "orders/s", "p50<=", "p99<=", "p99.9<=", "max", "p50<=", "p99<=", "p99.9<=", "max", "bids", "asks", "pool");
+    }
+
+    static void print_latency(const Latency &latency)
+    {
+        std::printf(" %10lu %10lu %10lu %10lu |",
+            static_cast<unsigned long>(latency.histogram.quantile_upper_bound(0.5)),
+            static_cast<unsigned long>(latency.histogram.quantile_upper_bound(0.99)),
+            static_cast<unsigned long>(latency.histogram.quantile_upper_bound(0.999)),
+            static_cast<unsigned long>(latency.max));
+    }
+
+    void print_report(double time, double rate) const
+    {
+        size_t bids = 0;
+        size_t asks = 0;
+        size_t pool = 0;
+        for (const auto &state : m_books)
+        {
+            bids += state.book.bid().size();
+            asks += state.book.ask().size();
+            pool += state.pool.capacity();
+        }
+
+        std::printf("%7.1fs %12.0f |", time, rate);
+        print_latency(m_service);
+        print_latency(m_response);
+        std::printf(" %8zu %8zu %10zu\n", bids, asks, pool);
+        std::fflush(stdout);
+    }
+};
+
+int main(int argc, const char **argv)
+{
+    Options options;
+    for (int i = 1; i != argc; ++i)
+    {
+        if (!parse_option(options, argv[i]))
+        {
+            std::fprintf(stderr, "Usage: %s [name=value ...]\n", argv[0]);
+            std::fprintf(stderr, "  seconds rate books seed add cancel aggress zipf depth walk owners\n");
+            std::fprintf(stderr, "  burst_every burst_length burst_factor report arena pmr\n");
+            return 1;
+        }
+    }
+
+    // Page faults are taken here, before load starts
+    std::optional<scu::HugePageResource> arena;
+    std::optional<std::pmr::unsynchronized_pool_resource> pool;
+    std::optional<scu::ScopedDefaultResource> scope;
+    if (options.arena > 0)
+    {
+        arena.emplace(static_cast<size_t>(options.arena * (1 << 20)));
+        pool.emplace(&*arena);
+        scope.emplace(&*pool);
+        std::printf("Arena of %zu MB backed by %s\n", arena->capacity() >> 20,
+            arena->backing() == scu::HugePageBacking::HugeTlb ? "huge pages" :
+            arena->backing() == scu::HugePageBacking::Transparent ? "transparent huge pages" : "heap");
+    }
+
+    std::printf("Book sides with %s containers\n", options.use_pmr() ? "std::pmr" : "default");
+    if (options.use_pmr())
+    {
+        LoadGenerator<scob::PmrBookSidePolicy<>> generator(options);
+        return generator.run();
+    }
+    LoadGenerator<scob::PriceLevelStackBookSidePolicy<>> generator(options);
+    return generator.run();
+}
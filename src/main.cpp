@@ -10,6 +10,13 @@ struct MyOrder : scob::Order<>
     int userid;
 };
 
+// Tell the order book who owns the order, so that it can prevent self-trade
+template<>
+struct scob::OwnerTrait<MyOrder>
+{
+    static auto owner(const MyOrder &o) { return o.userid; }
+};
+
 using MyOrderBook = scob::OrderBook<MyOrder>;
 
 
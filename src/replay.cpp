@@ -0,0 +1,159 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "lib.hpp"
+#include "codec/stream.hpp"
+#include "util/filesource.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scc = sadhbhcraft::codec;
+namespace scu = sadhbhcraft::util;
+
+
+struct ReplayOrder : scob::Order<long, long>
+{
+    long remaining;
+};
+
+// Orders must stay where they are while resting on the book, so we keep
+// them in a deque, and reuse slots of orders that are done. Then memory
+// depends on the number of resting orders, and not on the size of capture.
+// NOTE: Stops triggered by another order, which don't trade at all, are not
+// seen by the replay, and so they are not reused.
+class OrderPool
+{
+public:
+    ReplayOrder &acquire(const ReplayOrder &order)
+    {
+        if (m_free.empty())
+        {
+            return m_orders.emplace_back(order);
+        }
+        ReplayOrder &slot = *m_free.back();
+        m_free.pop_back();
+        slot = order;
+        return slot;
+    }
+
+    void release(ReplayOrder &order) { m_free.push_back(&order); }
+
+    // Aggressor is done once it's matched, unless it's a stop waiting for
+    // trigger, or a limit order resting with remaining quantity
+    void release_matched(ReplayOrder &order)
+    {
+        const bool is_resting = scob::is_stop_order_type(order.order_type)
+            || (order.order_type == scob::OrderType::Limit && order.remaining > 0);
+        if (!is_resting)
+        {
+            release(order);
+        }
+    }
+
+    size_t capacity() const { return m_orders.size(); }
+
+private:
+    std::deque<ReplayOrder> m_orders;
+    std::vector<ReplayOrder *> m_free;
+};
+
+template<typename Source, typename Decoder>
+int replay(Source &source, Decoder decoder)
+{
+    scob::OrderBook<ReplayOrder> book;
+    OrderPool pool;
+    size_t order_count = 0;
+    size_t execution_count = 0;
+    long executed_quantity = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto orders = scc::read_orders<ReplayOrder>(source, decoder); orders; ++order_count)
+    {
+        ReplayOrder decoded = orders();
+        decoded.remaining = decoded.quantity;
+        ReplayOrder &order = pool.acquire(decoded);
+        ReplayOrder *aggressor = &order;
+
+        for (auto executions = book.accept_order(order); executions;)
+        {
+            auto execution = executions();
+            ReplayOrder &resting = execution.order();
+            ++execution_count;
+            executed_quantity += execution.quantity;
+
+            // Stops triggered by the order are matched one by one after it,
+            // and each is done when the next one starts
+            if (book.aggressor() != aggressor)
+            {
+                pool.release_matched(*aggressor);
+                aggressor = book.aggressor();
+            }
+
+            aggressor->remaining -= execution.quantity;
+            if (!(resting.remaining -= execution.quantity))
+            {
+                pool.release(resting); //< Already removed from its level
+            }
+        }
+
+        pool.release_matched(*aggressor);
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (!source.data().empty())
+    {
+        std::fprintf(stderr, "Stopped with %zu bytes left undecoded\n", source.data().size());
+    }
+    std::printf("Replayed %zu orders with %zu executions of %ld in total in %.3fs (%.2f M orders/s)\n",
+        order_count, execution_count, executed_quantity, elapsed.count(), order_count / elapsed.count() / 1e6);
+    std::printf("Book has %zu bid and %zu ask levels, and pool holds %zu orders\n",
+        book.bid().size(), book.ask().size(), pool.capacity());
+
+    return 0;
+}
+
+template<typename Source>
+int replay(Source &source, const char *format)
+{
+    if (!source.is_open())
+    {
+        std::fprintf(stderr, "Cannot open capture file\n");
+        return 1;
+    }
+    if (std::strcmp(format, "fix") == 0)
+    {
+        return replay(source, scc::FixOrderDecoder{});
+    }
+    if (std::strcmp(format, "binary") == 0)
+    {
+        return replay(source, scc::BinaryOrderDecoder{});
+    }
+
+    std::fprintf(stderr, "Unknown format: %s\n", format);
+    return 1;
+}
+
+int main(int argc, const char **argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "Usage: %s <fix|binary> <capture file> [mmap]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc > 3 && std::strcmp(argv[3], "mmap") == 0)
+    {
+        scu::MappedFileSource source(argv[2]);
+        return replay(source, argv[1]);
+    }
+    else
+    {
+        scu::ChunkedFileSource source(argv[2]);
+        return replay(source, argv[1]);
+    }
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "orderbook/flightrecorder.hpp"
+#include "util/filesource.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+const char *to_string(scu::TraceDumpError error)
+{
+    switch (error)
+    {
+        case scu::TraceDumpError::None: return "none";
+        case scu::TraceDumpError::Truncated: return "dump is truncated";
+        case scu::TraceDumpError::BadMagic: return "not a trace dump";
+        case scu::TraceDumpError::BadVersion: return "unsupported version";
+        case scu::TraceDumpError::BadEventSize: return "event size doesn't match";
+    }
+    return "unknown";
+}
+
+// Prints timeline of book mutations from flight recorder dump, with time
+// in cycles since the oldest event, or in nanoseconds if TSC frequency is
+// given in GHz
+int main(int argc, const char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <trace dump> [tsc GHz]\n", argv[0]);
+        return 1;
+    }
+    const double tsc_ghz = argc > 2 ? std::atof(argv[2]) : 0.0;
+
+    scu::MappedFileSource source(argv[1]);
+    if (!source.is_open())
+    {
+        std::fprintf(stderr, "Cannot open trace dump\n");
+        return 1;
+    }
+
+    std::uint64_t base_tsc = 0;
+    bool first = true;
+    scu::TraceDumpHeader header{};
+
+    auto error = scu::read_trace_dump<scob::TraceEvent>(source.data(), [&](const scob::TraceEvent &event)
+    {
+        if (first)
+        {
+            base_tsc = event.tsc;
+            first = false;
+        }
+        if (tsc_ghz > 0)
+        {
+            std::cout << (event.tsc - base_tsc) / tsc_ghz << "ns ";
+        }
+        scob::format_trace_event(std::cout, event, base_tsc);
+        std::cout << '\n';
+    }, &header);
+
+    if (error != scu::TraceDumpError::None)
+    {
+        std::fprintf(stderr, "Cannot decode trace dump: %s\n", to_string(error));
+        return 1;
+    }
+
+    std::cout << "# " << header.count << " of " << header.total_count << " events recorded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "test_util.hpp"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+
+#include "lib.hpp"
+#include "orderbook/analytics.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+
+
+typedef scob::Order<int, int> OrderType;
+typedef scob::OrderBook<OrderType, scob::AnalyticsBookSidePolicy<0, 2, 5>> BookType;
+
+// What depth is by walking the levels
+template<typename BookSide>
+int walk_depth(const BookSide &book_side, int ticks)
+{
+    int depth = 0;
+    for (auto &level : book_side)
+    {
+        if (ticks < std::abs(level.price() - book_side.top().price()))
+        {
+            break;
+        }
+        depth += level.total_quantity();
+    }
+    return depth;
+}
+
+void test_top_metrics()
+{
+    BookType book;
+    std::deque<OrderType> orders;
+    auto add = [&](scob::Side side, int price, int quantity)
+    {
+        auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Limit, price, quantity});
+        assert(!book.accept_order(order));
+    };
+
+    // 1. Nothing on the book
+    assert(book.analytics().imbalance() == 0.0);
+    assert(!book.analytics().microprice());
+
+    // 2. Microprice leans towards the side with less quantity
+    add(scob::Side::Buy, 100, 30);
+    add(scob::Side::Sell, 104, 10);
+    assert(book.analytics().imbalance() == 0.5);
+    assert(*book.analytics().microprice() == 103.0);
+
+    // 3. Depth counts levels within ticks of the top
+    add(scob::Side::Buy, 98, 5);
+    add(scob::Side::Buy, 95, 7);
+    add(scob::Side::Buy, 94, 1);
+    add(scob::Side::Sell, 106, 20);
+    auto analytics = book.analytics();
+    assert(analytics.bid_depth_within(0) == 30);
+    assert(analytics.bid_depth_within(2) == 35);
+    assert(analytics.bid_depth_within(5) == 42);
+    assert(analytics.ask_depth_within(2) == 30);
+    assert(analytics.imbalance_within(2) == 5.0 / 65.0);
+
+    // 4. Depth not configured is walked
+    assert(analytics.bid_depth_within(6) == 43);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Adds, matching and cancels keep depths the same as walking levels, with
+// levels spread around mid price, and some cancels of the whole side
+void test_against_walk(int mid, int spread)
+{
+    BookType book;
+    std::deque<OrderType> orders;
+    std::mt19937 rng(11);
+
+    for (int i = 0; i != 20000; ++i)
+    {
+        const scob::Side side = (rng() % 2 ? scob::Side::Buy : scob::Side::Sell);
+        const unsigned dice = rng() % 100;
+        if (dice < 70)
+        {
+            const int price = (side == scob::Side::Buy ? mid - static_cast<int>(rng() % spread) : mid + 1 + static_cast<int>(rng() % spread));
+            auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Limit, price, 1 + static_cast<int>(rng() % 20)});
+            for (auto ex = book.accept_order(order); ex; ex())
+            {}
+        }
+        else if (dice < 90)
+        {
+            auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Market, 0, 1 + static_cast<int>(rng() % 40)});
+            for (auto ex = book.accept_order(order); ex; ex())
+            {}
+        }
+        else if (dice < 99)
+        {
+            const int price = mid - spread + static_cast<int>(rng() % (2 * spread + 2));
+            book.cancel_orders({.side = side, .min_price = price, .max_price = price + static_cast<int>(rng() % 3)});
+        }
+        else
+        {
+            book.cancel_orders({.side = side});
+        }
+
+        for (int ticks : {0, 2, 5})
+        {
+            assert(book.analytics().bid_depth_within(ticks) == (book.bid().empty() ? 0 : walk_depth(book.bid(), ticks)));
+            assert(book.analytics().ask_depth_within(ticks) == (book.ask().empty() ? 0 : walk_depth(book.ask(), ticks)));
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_top_metrics();
+    test_against_walk(1000, 12);
+    test_against_walk(-3, 20);
+    test_against_walk(0, 3);
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "test_util.hpp"
+
+#include <iostream>
+#include <memory>
+
+#include "lib.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<typename GeneratorType, typename OrderType>
+void assert_trade(GeneratorType &trades, const OrderType &buy, const OrderType &sell, auto price, auto quantity)
+{
+    assert(trades);
+    auto trade = trades();
+    assert(std::addressof(trade.buy()) == std::addressof(buy));
+    assert(std::addressof(trade.sell()) == std::addressof(sell));
+    assert(scob::price_of(trade) == price);
+    assert(scob::quantity_of(trade) == quantity);
+}
+
+template<typename OrderType>
+void test_uncross()
+{
+    scob::OrderBook<OrderType> book;
+    book.set_trading_phase(scob::TradingPhase::Auction);
+
+    // 1. Orders rest without matching, and book is crossed
+    OrderType b1{scob::Side::Buy, scob::OrderType::Limit, 102, 5};
+    OrderType b2{scob::Side::Buy, scob::OrderType::Limit, 101, 5};
+    OrderType b3{scob::Side::Buy, scob::OrderType::Limit, 100, 10};
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 99, 4};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 6};
+    OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 101, 8};
+    for (auto *order : {&b1, &b2, &b3, &a1, &a2, &a3})
+    {
+        assert(!book.accept_order(*order));
+    }
+    assert(book.bid().size() == 3);
+    assert(book.ask().size() == 3);
+    assert(book.bid().top().price() > book.ask().top().price());
+
+    // Orders that can't rest are dropped
+    OrderType ioc{scob::Side::Buy, scob::OrderType::IOC, 105, 50};
+    assert(!book.accept_order(ioc));
+    assert(book.bid().size() == 3);
+
+    // 2. Volume is 10 at both 100 and 101, and surplus is smaller at 101
+    //
+    //      price   demand  supply  volume  surplus
+    //      99      20      4       4       16
+    //      100     20      10      10      10
+    //      101     10      18      10      -8
+    //      102     5       18      5       -13
+    //
+    auto equilibrium = book.auction_equilibrium();
+    assert(equilibrium);
+    assert(equilibrium.price == 101);
+    assert(equilibrium.volume == 10);
+    assert(equilibrium.surplus == -8);
+
+    // 3. Everything crossing executes at single price in price-time priority
+    auto trades = book.uncross();
+    assert_trade(trades, b1, a1, 101, 4);
+    assert_trade(trades, b1, a2, 101, 1);
+    assert_trade(trades, b2, a2, 101, 5);
+    assert(!trades);
+
+    assert(book.trading_phase() == scob::TradingPhase::Continuous);
+    assert(book.last_trade_price() == 101);
+    assert(book.bid().size() == 1);
+    assert(book.bid().top().price() == 100);
+    assert(book.bid().top().total_quantity() == 10);
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().price() == 101);
+    assert(book.ask().top().total_quantity() == 8);
+
+    // 4. Book is back to continuous trading
+    OrderType s1{scob::Side::Sell, scob::OrderType::IOC, 100, 3};
+    auto ex = book.accept_order(s1);
+    assert(ex);
+    assert(std::addressof(ex().order()) == std::addressof(b3));
+    assert(!ex);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_tie_breaks()
+{
+    typedef scob::Order<int, int> OrderType;
+    scob::AuctionCalculator<int, int> calculator;
+
+    // 1. Buy surplus at every candidate pushes price up
+    {
+        scob::OrderBook<OrderType> book;
+        book.set_trading_phase(scob::TradingPhase::Auction);
+        OrderType b{scob::Side::Buy, scob::OrderType::Limit, 101, 10};
+        OrderType a{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+        assert(!book.accept_order(b));
+        assert(!book.accept_order(a));
+
+        auto res = calculator.compute(book.bid(), book.ask());
+        assert(res.price == 101 && res.volume == 5 && res.surplus == 5);
+    }
+
+    // 2. Sell surplus pushes price down
+    {
+        scob::OrderBook<OrderType> book;
+        book.set_trading_phase(scob::TradingPhase::Auction);
+        OrderType b{scob::Side::Buy, scob::OrderType::Limit, 101, 5};
+        OrderType a{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+        assert(!book.accept_order(b));
+        assert(!book.accept_order(a));
+
+        auto res = calculator.compute(book.bid(), book.ask());
+        assert(res.price == 100 && res.volume == 5 && res.surplus == -5);
+    }
+
+    // 3. Balanced book takes price closest to reference
+    {
+        scob::OrderBook<OrderType> book;
+        book.set_trading_phase(scob::TradingPhase::Auction);
+        OrderType b{scob::Side::Buy, scob::OrderType::Limit, 103, 5};
+        OrderType a{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+        assert(!book.accept_order(b));
+        assert(!book.accept_order(a));
+
+        assert(calculator.compute(book.bid(), book.ask()).price == 100);
+        assert(calculator.compute(book.bid(), book.ask(), 102).price == 103);
+        assert(calculator.compute(book.bid(), book.ask(), 90).price == 100);
+        assert(calculator.compute(book.bid(), book.ask(), 110).price == 103);
+    }
+
+    // 4. Book that isn't crossed doesn't trade
+    {
+        scob::OrderBook<OrderType> book;
+        book.set_trading_phase(scob::TradingPhase::Auction);
+        OrderType b{scob::Side::Buy, scob::OrderType::Limit, 99, 5};
+        OrderType a{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+        assert(!book.accept_order(b));
+        assert(!book.accept_order(a));
+
+        assert(!book.auction_equilibrium());
+        assert(!book.uncross());
+        assert(book.trading_phase() == scob::TradingPhase::Continuous);
+        assert(book.bid().size() == 1 && book.ask().size() == 1);
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+// Iceberg reserve counts in depth, and is executed at uncross
+template<typename OrderType>
+void test_iceberg_uncross()
+{
+    scob::OrderBook<OrderType> book;
+    book.set_trading_phase(scob::TradingPhase::Auction);
+
+    OrderType i1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 10, .display_quantity = 2};
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 3, .display_quantity = 0};
+    OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 8, .display_quantity = 0};
+    for (auto *order : {&i1, &a1, &b1})
+    {
+        assert(!book.accept_order(*order));
+    }
+
+    auto equilibrium = book.auction_equilibrium();
+    assert(equilibrium.price == 100);
+    assert(equilibrium.volume == 8);
+
+    auto trades = book.uncross();
+    assert_trade(trades, b1, i1, 100, 2);
+    assert_trade(trades, b1, a1, 100, 3);
+    assert_trade(trades, b1, i1, 100, 2);
+    assert_trade(trades, b1, i1, 100, 1);
+    assert(!trades);
+
+    assert(book.bid().empty());
+    assert(book.ask().top().total_quantity() == 1);
+    assert(book.ask().top().hidden_quantity() == 4);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_uncross<scob::Order<int, int>>();
+    test_uncross<scob::Order<double, long>>();
+    test_tie_breaks();
+    test_iceberg_uncross<IcebergOrder<int, int>>();
+    test_iceberg_uncross<IcebergOrder<long, double>>();
+
+    return 0;
+}
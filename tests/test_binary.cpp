@@ -0,0 +1,292 @@
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+#include "codec/binary.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scc = sadhbhcraft::codec;
+namespace scu = sadhbhcraft::util;
+
+
+struct FullOrder
+{
+    typedef double PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    PriceType stop_price;
+    QuantityType display_quantity;
+    unsigned owner;
+};
+
+// Decode single message, and expect it to be of given view type
+template<typename View>
+std::optional<View> decode_as(std::string_view buffer, scc::BinaryDecodeResult &res)
+{
+    std::optional<View> result;
+    res = scc::decode_binary_message(buffer, [&](auto view)
+    {
+        if constexpr (std::is_same_v<decltype(view), View>)
+        {
+            result.emplace(view);
+        }
+    });
+    return result;
+}
+
+template<typename OrderType>
+void test_new_order_round_trip()
+{
+    std::vector<char> buffer(64);
+    OrderType order{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 25};
+
+    size_t size = scc::encode_new_order(order, 7, buffer);
+    assert(size == 56);
+    assert(scc::encode_new_order(order, 7, std::span<char>(buffer.data(), 55)) == 0);
+
+    scc::BinaryDecodeResult res;
+    auto view = decode_as<scc::NewOrderView>(std::string_view(buffer.data(), size), res);
+    assert(res);
+    assert(res.consumed == size);
+    assert(view);
+    assert(view->order_id() == 7);
+
+    OrderType decoded{};
+    assert(view->to_order(decoded) == scc::BinaryError::None);
+    assert(decoded.side == order.side);
+    assert(decoded.order_type == order.order_type);
+    assert(decoded.price == order.price);
+    assert(decoded.quantity == order.quantity);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_optional_fields_round_trip()
+{
+    std::vector<char> buffer(256);
+    FullOrder order{scob::Side::Buy, scob::OrderType::StopLimit, 100.25, 500, 100.5, 50, 42};
+
+    // 1. New order with prices in hundredths
+    size_t size = scc::encode_new_order(order, 1, buffer, 100);
+    scc::BinaryDecodeResult res;
+    auto view = decode_as<scc::NewOrderView>(std::string_view(buffer.data(), size), res);
+    assert(res && view);
+    assert(view->price() == 10025);
+    assert(view->stop_price() == 10050);
+
+    FullOrder decoded{};
+    assert(view->to_order(decoded, 100) == scc::BinaryError::None);
+    assert(decoded.side == scob::Side::Buy);
+    assert(decoded.order_type == scob::OrderType::StopLimit);
+    assert(decoded.price == 100.25);
+    assert(decoded.stop_price == 100.5);
+    assert(decoded.quantity == 500);
+    assert(decoded.display_quantity == 50);
+    assert(decoded.owner == 42);
+
+    // 2. Cancel and amend
+    size = scc::encode_cancel(9, 42, scob::Side::Sell, buffer);
+    auto cancel = decode_as<scc::CancelView>(std::string_view(buffer.data(), size), res);
+    assert(res && cancel);
+    assert(cancel->order_id() == 9);
+    assert(cancel->account() == 42);
+    assert(cancel->side() == scob::Side::Sell);
+
+    size = scc::encode_amend(9, 99.75, 300, 42, scob::Side::Buy, buffer, 100);
+    auto amend = decode_as<scc::AmendView>(std::string_view(buffer.data(), size), res);
+    assert(res && amend);
+    assert(amend->order_id() == 9);
+    assert(amend->price_as<double>(100) == 99.75);
+    assert(amend->quantity() == 300);
+    assert(amend->side() == scob::Side::Buy);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_feed_order_book()
+{
+    typedef scob::Order<int, int> OrderType;
+    std::vector<OrderType> orders{
+        {scob::Side::Sell, scob::OrderType::Limit, 101, 10},
+        {scob::Side::Sell, scob::OrderType::Limit, 100, 20},
+        {scob::Side::Buy, scob::OrderType::Limit, 98, 30},
+        {scob::Side::Buy, scob::OrderType::IOC, 101, 25}};
+
+    // 1. Encode all orders into one stream
+    std::vector<char> stream(1024);
+    size_t size = 0;
+    for (size_t i = 0; i != orders.size(); ++i)
+    {
+        size += scc::encode_new_order(orders[i], i, std::span<char>(stream).subspan(size));
+    }
+
+    // 2. Decode orders, and feed them to the book while encoding execution
+    // reports for every execution
+    std::deque<OrderType> decoded;
+    scob::OrderBook<OrderType> book;
+    std::vector<char> reports(1024);
+    size_t reports_size = 0;
+    uint64_t exec_id = 0;
+
+    std::string_view view(stream.data(), size);
+    while (!view.empty())
+    {
+        auto res = scc::decode_binary_message(view, [&](auto message)
+        {
+            if constexpr (std::is_same_v<decltype(message), scc::NewOrderView>)
+            {
+                auto &order = decoded.emplace_back();
+                assert(message.to_order(order) == scc::BinaryError::None);
+                for (auto executions = book.accept_order(order); executions;)
+                {
+                    reports_size += scc::encode_execution(
+                        executions(), ++exec_id, std::span<char>(reports).subspan(reports_size));
+                }
+            }
+        });
+        assert(res);
+        view.remove_prefix(res.consumed);
+    }
+
+    assert(decoded.size() == orders.size());
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().price() == 101);
+    assert(book.ask().top().total_quantity() == 5);
+    assert(book.bid().top().price() == 98);
+
+    // 3. Execution reports tell resting order's side, price and quantity
+    std::vector<std::pair<int64_t, int64_t>> expected{{100, 20}, {101, 5}};
+    std::string_view reports_view(reports.data(), reports_size);
+    for (auto [price, quantity] : expected)
+    {
+        scc::BinaryDecodeResult res;
+        auto execution = decode_as<scc::ExecutionView>(reports_view, res);
+        assert(res && execution);
+        assert(execution->side() == scob::Side::Sell);
+        assert(execution->price() == price);
+        assert(execution->quantity() == quantity);
+        reports_view.remove_prefix(res.consumed);
+    }
+    assert(reports_view.empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_decode_errors()
+{
+    std::vector<char> buffer(128);
+    scob::Order<int, int> order{scob::Side::Buy, scob::OrderType::Limit, 10, 1};
+    const size_t size = scc::encode_new_order(order, 1, buffer);
+    auto ignore = [](auto) {};
+
+    // 1. Truncated header and block
+    assert(scc::decode_binary_message(std::string_view(buffer.data(), 4), ignore).error == scc::BinaryError::Incomplete);
+    assert(scc::decode_binary_message(std::string_view(buffer.data(), size - 1), ignore).error == scc::BinaryError::Incomplete);
+
+    // 2. Bad side is rejected, but message can be skipped
+    auto bad = buffer;
+    bad[8 + 44] = 7;
+    auto res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+    assert(res.error == scc::BinaryError::BadValue);
+    assert(res.consumed == size);
+
+    // 3. Unknown template is skipped using block length
+    bad = buffer;
+    bad[2] = 99;
+    res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+    assert(res.error == scc::BinaryError::UnknownTemplate);
+    assert(res.consumed == size);
+
+    // 4. Block shorter than schema
+    bad = buffer;
+    bad[0] = 16;
+    res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+    assert(res.error == scc::BinaryError::BadBlockLength);
+
+    // 5. Block longer than schema (newer version) is accepted
+    bad = buffer;
+    bad[0] = 56;
+    res = scc::decode_binary_message(std::string_view(bad.data(), size + 8), ignore);
+    assert(res);
+    assert(res.consumed == size + 8);
+
+    // 6. Quantity must be positive, and display quantity within it
+    for (std::int64_t quantity : {0, -5})
+    {
+        bad = buffer;
+        scc::encode_new_order(scob::Order<int, long>{scob::Side::Buy, scob::OrderType::Limit, 10, quantity}, 1, bad);
+        res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+        assert(res.error == scc::BinaryError::BadValue);
+        assert(res.consumed == size);
+    }
+    bad = buffer;
+    bad[8 + 32] = 2;
+    res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+    assert(res.error == scc::BinaryError::BadValue);
+
+    // 7. Other schema, or older version, is skipped
+    bad = buffer;
+    bad[4] = 2;
+    res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+    assert(res.error == scc::BinaryError::UnsupportedSchema);
+    assert(res.consumed == size);
+    bad = buffer;
+    bad[6] = 0;
+    res = scc::decode_binary_message(std::string_view(bad.data(), size), ignore);
+    assert(res.error == scc::BinaryError::UnsupportedSchema);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_to_order_errors()
+{
+    std::vector<char> buffer(128);
+    FullOrder stop_limit{scob::Side::Buy, scob::OrderType::StopLimit, 101, 5, 100, 0, 1};
+    const size_t size = scc::encode_new_order(stop_limit, 1, buffer);
+
+    scc::BinaryDecodeResult res;
+    auto view = decode_as<scc::NewOrderView>(std::string_view(buffer.data(), size), res);
+    assert(res && view);
+
+    // 1. Ticks per unit must be positive
+    FullOrder decoded{};
+    assert(view->to_order(decoded, 0) == scc::BinaryError::BadValue);
+    assert(view->to_order(decoded, -1) == scc::BinaryError::BadValue);
+    assert(decoded.quantity == 0);
+
+    // 2. Stop price of StopLimit has nowhere to go
+    scob::Order<int, int> order{};
+    assert(view->to_order(order) == scc::BinaryError::BadValue);
+    assert(order.quantity == 0);
+    assert(view->to_order(decoded) == scc::BinaryError::None);
+    assert(decoded.stop_price == 100);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_new_order_round_trip<scob::Order<int, int>>();
+    test_new_order_round_trip<scob::Order<double, long>>();
+    test_new_order_round_trip<scob::Order<long, double>>();
+    test_optional_fields_round_trip();
+    test_feed_order_book();
+    test_decode_errors();
+    test_to_order_errors();
+
+    return 0;
+}
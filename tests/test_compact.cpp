@@ -0,0 +1,169 @@
+#include "test_util.hpp"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+
+#include "lib.hpp"
+#include "orderbook/compact.hpp"
+#include "util/hugepages.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+// Every allocation from global heap is counted
+static std::size_t heap_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++heap_allocations;
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    ++heap_allocations;
+    const std::size_t a = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+
+template<scu::NumberConcept _PriceType = int, scu::NumberConcept _QuantityType = int>
+struct StopOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    PriceType stop_price;
+};
+
+typedef scob::OrderBook<StopOrder<>, scob::CompactBookSidePolicy<>> BookType;
+
+// Resource that counts what goes through it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocations = 0;
+    std::size_t allocated = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++allocations;
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+        allocated -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+void test_empty_books()
+{
+    CountingResource resource;
+    scu::ScopedDefaultResource scope(&resource);
+
+    // 1. Books that never see an order don't allocate at all
+    const std::size_t before = heap_allocations;
+    {
+        BookType books[100];
+        assert(books[0].bid().empty() && books[99].stops().empty());
+    }
+    assert(heap_allocations == before);
+    assert(resource.allocations == 0);
+
+    // 2. Order that doesn't rest doesn't take any memory from resource
+    // (only matching coroutine frame, which is gone once it's done)
+    BookType book;
+    StopOrder<> ioc{scob::Side::Buy, scob::OrderType::IOC, 100, 5, 0};
+    assert(!book.accept_order(ioc));
+    assert(resource.allocations == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Levels and stops of all books come from one pool
+void test_shared_pool()
+{
+    CountingResource upstream;
+    std::pmr::unsynchronized_pool_resource pool(&upstream);
+    scu::ScopedDefaultResource scope(&pool);
+
+    std::deque<BookType> books(1000);
+    std::deque<StopOrder<>> orders;
+
+    for (std::size_t i = 0; i != books.size(); ++i)
+    {
+        auto &order = orders.emplace_back(StopOrder<>{scob::Side::Sell, scob::OrderType::Limit, 101, 5, 0});
+        assert(!books[i].accept_order(order));
+    }
+
+    // 1. Pool has few large blocks, and single order levels are inline
+    assert(upstream.allocations < 20);
+
+    // 2. Compact books match and trigger stops as any other book
+    auto &book = books[0];
+    StopOrder<> stop{scob::Side::Buy, scob::OrderType::Stop, 0, 2, 101};
+    assert(!book.accept_order(stop));
+    assert(book.stops().buy_stops().size() == 1);
+
+    StopOrder<> buy{scob::Side::Buy, scob::OrderType::IOC, 101, 1, 0};
+    int executed = 0;
+    for (auto ex = book.accept_order(buy); ex; )
+    {
+        executed += ex().quantity;
+    }
+    assert(executed == 1 + 2);
+    assert(book.stops().empty());
+    assert(book.ask().top().total_quantity() == 2);
+
+    // 3. Levels of books that are gone are reused by other books
+    const std::size_t pooled = upstream.allocated;
+    books.resize(books.size() / 2);
+    for (std::size_t i = 0; i != books.size(); ++i)
+    {
+        auto &order = orders.emplace_back(StopOrder<>{scob::Side::Buy, scob::OrderType::Limit, 99, 5, 0});
+        assert(!books[i].accept_order(order));
+    }
+    assert(upstream.allocated == pooled);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_empty_books();
+    test_shared_pool();
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include "test_util.hpp"
+
+#include "util/concepts.hpp"
+#include "util/smallqueue.hpp"
+#include "util/flatmap.hpp"
+#include "util/fenwick.hpp"
+#include "util/fixedcapacity.hpp"
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace scu = sadhbhcraft::util;
+
+
+// Element type that cannot be default constructed, same as OrderQuantity
+struct Item
+{
+    Item(int &ref, int value): ref(ref), value(value) {}
+
+    std::reference_wrapper<int> ref;
+    int value;
+};
+
+template<typename Queue>
+std::vector<int> values_of(const Queue &q)
+{
+    std::vector<int> result;
+    for (const auto &x : q)
+    {
+        result.push_back(x.value);
+    }
+    return result;
+}
+
+void test_small_queue_inline()
+{
+    static_assert(scu::QueueConcept<scu::SmallQueue<Item, 3>, Item>);
+    static_assert(scu::IsQueue<scu::SmallQueue, Item>::value);
+
+    int dummy = 0;
+    scu::SmallQueue<Item, 3> q;
+
+    // 1. Up to N elements stay inline
+    q.emplace_back(dummy, 1);
+    q.emplace_back(dummy, 2);
+    q.emplace_back(dummy, 3);
+    assert(q.is_inline());
+    assert(q.size() == 3);
+    assert(q.front().value == 1);
+
+    // 2. Removing from the front keeps the rest in order
+    q.erase(q.begin(), q.begin() + 2);
+    assert(q.size() == 1);
+    assert(q.front().value == 3);
+
+    // 3. Space at the front is reclaimed before spilling to heap
+    q.emplace_back(dummy, 4);
+    q.emplace_back(dummy, 5);
+    assert(q.is_inline());
+    assert((values_of(q) == std::vector<int>{3, 4, 5}));
+
+    // 4. Draining the queue resets it
+    q.pop_front();
+    q.pop_front();
+    q.pop_front();
+    assert(q.empty());
+    assert(q.begin() == q.end());
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_small_queue_spill()
+{
+    int dummy = 0;
+    scu::SmallQueue<Item, 2> q;
+
+    // 1. Deeper queue spills to heap and keeps FIFO order
+    for (int i = 0; i != 10; ++i)
+    {
+        q.emplace_back(dummy, i);
+    }
+    assert(!q.is_inline());
+    assert(q.size() == 10);
+    assert((values_of(q) == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    // 2. Erase in the middle
+    q.erase(q.begin() + 3, q.begin() + 5);
+    assert((values_of(q) == std::vector<int>{0, 1, 2, 5, 6, 7, 8, 9}));
+
+    // 3. Move keeps elements, and leaves source empty
+    auto q2 = std::move(q);
+    assert(q.empty());
+    assert(q.is_inline());
+    assert((values_of(q2) == std::vector<int>{0, 1, 2, 5, 6, 7, 8, 9}));
+
+    // 4. Copy of inline queue
+    scu::SmallQueue<Item, 2> q3;
+    q3.emplace_back(dummy, 42);
+    auto q4 = q3;
+    auto q5 = std::move(q3);
+    assert((values_of(q4) == std::vector<int>{42}));
+    assert((values_of(q5) == std::vector<int>{42}));
+    assert(q5.is_inline());
+
+    // 5. Steady push/pop at capacity does not grow unbounded
+    scu::SmallQueue<std::string, 4> s;
+    for (int i = 0; i != 1000; ++i)
+    {
+        s.emplace_back(std::to_string(i));
+        if (s.size() > 3)
+        {
+            s.pop_front();
+        }
+    }
+    assert(s.size() == 3);
+    assert(s.front() == "997");
+    assert(s.capacity() <= 8);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_flat_hash_map()
+{
+    scu::FlatHashMap<unsigned, int> m{4};
+
+    // 1. Insert grows table and keeps all keys
+    for (unsigned i = 0; i != 100; ++i)
+    {
+        auto [value, inserted] = m.try_emplace(i * 7, static_cast<int>(i));
+        assert(inserted);
+        assert(*value == static_cast<int>(i));
+    }
+    assert(m.size() == 100);
+    assert(m.capacity() >= 200);
+    assert(!m.try_emplace(7, 42).second);
+    assert(*m.find(7) == 1);
+
+    // 2. Erase keeps other keys reachable
+    for (unsigned i = 0; i != 100; i += 2)
+    {
+        assert(m.erase(i * 7));
+    }
+    assert(!m.erase(0));
+    assert(m.size() == 50);
+    for (unsigned i = 0; i != 100; ++i)
+    {
+        auto *value = m.find(i * 7);
+        assert((i % 2) ? (value && *value == static_cast<int>(i)) : !value);
+    }
+
+    // 3. Default constructed value via operator[]
+    m[1000] += 5;
+    assert(*m.find(1000) == 5);
+
+    // 4. Reserved key is never stored, nor found in an empty slot
+    const unsigned reserved = scu::FlatHashMap<unsigned, int>::empty_key;
+    assert(!m.find(reserved));
+    assert(!m.try_emplace(reserved, 1).first);
+    assert(!m.erase(reserved));
+    assert(m.size() == 51);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_fenwick_tree()
+{
+    scu::FenwickTree<long> tree;
+    std::vector<long> values;
+
+    // 1. Appended values sum up at every prefix
+    for (long i = 0; i != 100; ++i)
+    {
+        tree.push_back(i % 7 + 1);
+        values.push_back(i % 7 + 1);
+    }
+    for (std::size_t i = 0; i <= values.size(); ++i)
+    {
+        long sum = 0;
+        for (std::size_t j = 0; j != i; ++j)
+        {
+            sum += values[j];
+        }
+        assert(tree.prefix(i) == sum);
+    }
+
+    // 2. Updates are seen by prefixes after them only
+    tree.add(10, -3);
+    assert(tree.prefix(10) == 28 + 1 + 2 + 3);
+    assert(tree.prefix(11) == 28 + 1 + 2 + 3 + 1);
+    assert(tree.total() == 14 * 28 + 1 + 2 - 3);
+
+    // 3. Rebuild gives the same tree as appending
+    scu::FenwickTree<unsigned> rebuilt;
+    std::vector<unsigned> ones(37, 1);
+    rebuilt.assign(ones.begin(), ones.end());
+    rebuilt.add(5, ~0u);
+    assert(rebuilt.size() == 37 && rebuilt.prefix(5) == 5 && rebuilt.prefix(6) == 5 && rebuilt.total() == 36);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_fixed_stack()
+{
+    static_assert(scu::RandomStackConcept<scu::FixedStack<Item, 4>, Item>);
+    static_assert(scu::IsRandomStack<scu::FixedStackOf<4>::type, Item>::value);
+
+    int dummy = 0;
+    scu::FixedStack<Item, 4> s;
+
+    // 1. Inserting in the middle moves elements behind it
+    s.emplace(s.end(), dummy, 1);
+    s.emplace(s.end(), dummy, 4);
+    s.emplace(s.begin() + 1, dummy, 2);
+    auto it = s.emplace(s.begin() + 2, dummy, 3);
+    assert(it->value == 3);
+    assert(s.full());
+    assert((values_of(s) == std::vector<int>{1, 2, 3, 4}));
+
+    // 2. Erasing a range keeps the rest in order
+    s.erase(s.begin(), s.begin() + 2);
+    assert((values_of(s) == std::vector<int>{3, 4}));
+    assert(s.front().value == 3 && s.back().value == 4);
+
+    // 3. Copy is independent of the original
+    scu::FixedStack<Item, 4> copy = s;
+    copy.erase(copy.begin());
+    assert(s.size() == 2 && copy.size() == 1);
+
+    // 4. Size of object is all the storage there is
+    static_assert(sizeof(scu::FixedStack<Item, 4>) == 4 * sizeof(Item) + sizeof(std::size_t));
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_fixed_queue()
+{
+    static_assert(scu::QueueConcept<scu::FixedQueue<Item, 3>, Item>);
+    static_assert(scu::IsQueue<scu::FixedQueueOf<3>::type, Item>::value);
+
+    int dummy = 0;
+    scu::FixedQueue<Item, 3> q;
+
+    // 1. Popping from the front only moves head
+    q.emplace_back(dummy, 1);
+    q.emplace_back(dummy, 2);
+    q.emplace_back(dummy, 3);
+    assert(q.full());
+    q.erase(q.begin());
+    assert(q.front().value == 2 && q.size() == 2);
+
+    // 2. Space at the front is reclaimed once tail reaches capacity
+    q.emplace_back(dummy, 4);
+    assert(q.full());
+    assert((values_of(q) == std::vector<int>{2, 3, 4}));
+
+    // 3. Erasing in the middle keeps the rest in order
+    q.erase(q.begin() + 1);
+    assert((values_of(q) == std::vector<int>{2, 4}));
+
+    // 4. Draining the queue resets it
+    q.pop_front();
+    q.pop_front();
+    assert(q.empty());
+    assert(q.begin() == q.end());
+
+    std::cout << "OK" << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+    test_small_queue_inline();
+    test_small_queue_spill();
+    test_flat_hash_map();
+    test_fenwick_tree();
+    test_fixed_stack();
+    test_fixed_queue();
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "lib.hpp"
+#include "util/timerwheel.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<scu::NumberConcept _PriceType = int, scu::NumberConcept _QuantityType = int>
+struct TimedOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    std::uint64_t expire_time;
+    scob::ExpiryHook<TimedOrder> expiry_hook;
+};
+
+struct Job
+{
+    std::uint64_t deadline;
+    bool cancelled = false;
+    bool fired = false;
+    scu::TimerWheelHook<Job> hook;
+};
+
+// Timers fire exactly when time reaches them, whatever steps time takes,
+// including timers beyond the top level
+template<std::size_t LevelCount>
+void test_timer_wheel()
+{
+    scu::HierarchicalTimerWheel<Job, LevelCount> wheel(1000);
+    std::deque<Job> jobs;
+    std::mt19937_64 rng(42);
+
+    const std::uint64_t range = std::uint64_t(1) << (LevelCount * 6 + 2);
+    for (int i = 0; i != 5000; ++i)
+    {
+        auto &job = jobs.emplace_back(Job{1001 + rng() % range});
+        wheel.schedule(job, job.hook, job.deadline);
+        assert(job.hook.is_linked());
+    }
+    for (std::size_t i = 0; i < jobs.size(); i += 7)
+    {
+        jobs[i].hook.unlink();
+        jobs[i].cancelled = true;
+    }
+
+    std::uint64_t now = 1000;
+    std::uint64_t last_deadline = 0;
+    while (!wheel.empty())
+    {
+        now += 1 + rng() % (rng() % 2 ? 50 : range / 16);
+        wheel.advance(now, [&](Job &job)
+        {
+            assert(!job.cancelled && !job.fired);
+            assert(job.deadline <= now);
+            assert(job.deadline >= last_deadline);
+            assert(!job.hook.is_linked());
+            last_deadline = job.deadline;
+            job.fired = true;
+        });
+        assert(wheel.now() == now);
+        last_deadline = 0;
+
+        for (const auto &job : jobs)
+        {
+            assert(job.fired == (!job.cancelled && job.deadline <= now));
+        }
+    }
+
+    // Deadline that has passed fires on the next tick
+    Job late{10};
+    wheel.schedule(late, late.hook, late.deadline);
+    assert(wheel.advance(now, [](Job &) {}) == 0);
+    assert(wheel.advance(now + 1, [](Job &job) { job.fired = true; }) == 1);
+    assert(late.fired);
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_expire_orders()
+{
+    scob::OrderBook<OrderType> book;
+    scob::ManualClock clock(100);
+    book.expire_orders(clock);
+
+    OrderType b1{scob::Side::Buy, scob::OrderType::Limit, 99, 5, 200};
+    OrderType b2{scob::Side::Buy, scob::OrderType::Limit, 99, 5, 0};
+    OrderType b3{scob::Side::Buy, scob::OrderType::Limit, 98, 5, 300};
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 101, 5, 200};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 102, 5, 250};
+    for (auto *order : {&b1, &b2, &b3, &a1, &a2})
+    {
+        assert(!book.accept_order(*order));
+        assert(order->expiry_hook.is_linked() == (order->expire_time != 0));
+    }
+
+    // 1. Partially filled order expires with quantity left
+    OrderType hit{scob::Side::Sell, scob::OrderType::IOC, 99, 2, 0};
+    for (auto ex = book.accept_order(hit); ex; ex())
+    {}
+    assert(!hit.expiry_hook.is_linked());
+
+    // 2. Nothing is due yet
+    clock.advance(99);
+    assert(book.expire_orders(clock) == 0);
+    assert(book.expired_orders().empty());
+
+    // 3. Orders due at 200 on both sides, and GTC order stays
+    clock.advance(1);
+    assert(book.expire_orders(clock) == 2);
+    assert(book.expired_orders().size() == 2);
+    for (const auto &oq : book.expired_orders())
+    {
+        assert(oq.order().expire_time == 200);
+        assert(!oq.order().expiry_hook.is_linked());
+        if (std::addressof(oq.order()) == std::addressof(b1))
+        {
+            assert(oq.quantity == 3);
+        }
+        else
+        {
+            assert(std::addressof(oq.order()) == std::addressof(a1));
+            assert(oq.quantity == 5);
+        }
+    }
+    assert(book.bid().size() == 2);
+    assert(book.bid().top().size() == 1);
+    assert(std::addressof(book.bid().top().first().order()) == std::addressof(b2));
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().price() == 102);
+
+    // 4. Filled order leaves the wheel
+    OrderType lift{scob::Side::Buy, scob::OrderType::IOC, 102, 5, 0};
+    for (auto ex = book.accept_order(lift); ex; ex())
+    {}
+    assert(!a2.expiry_hook.is_linked());
+    assert(book.ask().empty());
+
+    // 5. Big step expires everything due, and levels left empty are erased
+    clock.advance(1000000);
+    assert(book.expire_orders(clock) == 1);
+    assert(std::addressof(book.expired_orders()[0].order()) == std::addressof(b3));
+    assert(book.bid().size() == 1);
+    assert(book.bid().top().price() == 99);
+
+    // 6. Time doesn't go back
+    assert(book.expire_orders(100) == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_expired_on_arrival()
+{
+    typedef TimedOrder<int, int> OrderType;
+    scob::OrderBook<OrderType> book;
+    assert(book.expire_orders(500) == 0);
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5, 0};
+    assert(!book.accept_order(a1));
+
+    // Order that has expired doesn't match, and doesn't rest
+    OrderType b1{scob::Side::Buy, scob::OrderType::Limit, 100, 5, 500};
+    assert(!book.accept_order(b1));
+    assert(!b1.expiry_hook.is_linked());
+    assert(book.bid().empty());
+    assert(book.ask().top().total_quantity() == 5);
+    assert(book.expired_orders().size() == 1);
+    assert(std::addressof(book.expired_orders()[0].order()) == std::addressof(b1));
+    assert(book.expired_orders()[0].quantity == 5);
+
+    // Copy of resting order isn't in the wheel
+    OrderType b2{scob::Side::Buy, scob::OrderType::Limit, 99, 5, 501};
+    assert(!book.accept_order(b2));
+    assert(b2.expiry_hook.is_linked());
+    assert(book.expired_orders().empty());
+    OrderType copy = b2;
+    assert(!copy.expiry_hook.is_linked());
+
+    assert(book.expire_orders(501) == 1);
+    assert(book.bid().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Many orders on few levels, and each expires at its time
+void test_expire_many()
+{
+    typedef TimedOrder<int, int> OrderType;
+    scob::OrderBook<OrderType> book;
+    std::deque<OrderType> orders;
+    std::mt19937 rng(7);
+
+    for (int i = 0; i != 3000; ++i)
+    {
+        auto side = (i % 2 ? scob::Side::Buy : scob::Side::Sell);
+        int price = (side == scob::Side::Buy ? 99 - i % 10 : 101 + i % 10);
+        auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Limit, price, 1, 1 + rng() % 100000});
+        assert(!book.accept_order(order));
+    }
+
+    std::size_t total = 0;
+    for (std::uint64_t now = 0; now <= 100000; now += 1 + rng() % 5000)
+    {
+        const auto count = book.expire_orders(now);
+        total += count;
+        assert(book.expired_orders().size() == count);
+        for (const auto &oq : book.expired_orders())
+        {
+            assert(oq.order().expire_time <= now);
+        }
+        for (const auto &level : book.bid())
+        {
+            for (const auto &oq : level)
+            {
+                assert(oq.order().expire_time > now);
+            }
+        }
+    }
+    total += book.expire_orders(100000);
+    assert(total == orders.size());
+    assert(book.bid().empty() && book.ask().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_timer_wheel<2>();
+    test_timer_wheel<4>();
+    test_expire_orders<TimedOrder<int, int>>();
+    test_expire_orders<TimedOrder<double, long>>();
+    test_expired_on_arrival();
+    test_expire_many();
+
+    return 0;
+}
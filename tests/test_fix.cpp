@@ -0,0 +1,296 @@
+#include "test_util.hpp"
+
+#include <array>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+#include "codec/fix.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scc = sadhbhcraft::codec;
+namespace scu = sadhbhcraft::util;
+
+
+struct FullOrder
+{
+    typedef double PriceType;
+    typedef long QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    PriceType stop_price;
+    QuantityType display_quantity;
+    unsigned owner;
+};
+
+// Build message with correct BodyLength and CheckSum from body fields
+// written with '|' instead of SOH
+std::string make_fix(std::string_view body)
+{
+    std::string b(body);
+    for (auto &c : b)
+    {
+        c = (c == '|' ? scc::FIX_SOH : c);
+    }
+    std::string msg = "8=FIX.4.4\x01" "9=" + std::to_string(b.size()) + "\x01" + b;
+    unsigned sum = 0;
+    for (unsigned char c : msg)
+    {
+        sum += c;
+    }
+    std::array<char, 8> trailer;
+    std::snprintf(trailer.data(), trailer.size(), "10=%03u\x01", sum & 0xFF);
+    return msg + trailer.data();
+}
+
+template<bool Vectorised>
+void test_delimiter_scanner()
+{
+    // Delimiters in first block, across block boundary, and in short tail
+    std::string s = "ab=c|defghijklmnopq=r|stuvwxyz0123456789=|x";
+    std::vector<size_t> expected;
+    for (size_t i = 0; i != s.size(); ++i)
+    {
+        if (s[i] == '=' || s[i] == '|')
+        {
+            expected.push_back(i);
+        }
+    }
+
+    scu::BasicDelimiterScanner<Vectorised, '=', '|'> scanner(s.data(), s.data() + s.size());
+    for (size_t pos : expected)
+    {
+        assert(scanner.next() == s.data() + pos);
+    }
+    assert(scanner.next() == s.data() + s.size());
+    assert(scanner.next() == s.data() + s.size());
+
+    scu::BasicDelimiterScanner<Vectorised, '='> empty(s.data(), s.data());
+    assert(empty.next() == s.data());
+
+    assert(scu::byte_sum<Vectorised>(s.data(), s.data() + s.size()) == scu::byte_sum<false>(s.data(), s.data() + s.size()));
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_parse_limit_order()
+{
+    auto msg = make_fix("35=D|11=ORDER-1|55=ABC|54=2|40=2|38=100|44=101.00|60=20240101-00:00:00|");
+
+    OrderType order{};
+    auto res = scc::parse_new_order_single(msg, order);
+    assert(res);
+    assert(res.consumed == msg.size());
+    assert(order.side == scob::Side::Sell);
+    assert(order.order_type == scob::OrderType::Limit);
+    assert(order.price == 101);
+    assert(order.quantity == 100);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_parse_optional_fields()
+{
+    // 1. Stop limit with iceberg and account
+    auto msg = make_fix("35=D|1=42|54=1|40=4|38=50|44=10.5|99=10.25|111=5|");
+    FullOrder order{};
+    auto res = scc::parse_new_order_single(msg, order);
+    assert(res);
+    assert(order.side == scob::Side::Buy);
+    assert(order.order_type == scob::OrderType::StopLimit);
+    assert(order.price == 10.5);
+    assert(order.stop_price == 10.25);
+    assert(order.quantity == 50);
+    assert(order.display_quantity == 5);
+    assert(order.owner == 42);
+
+    // 2. Time in force maps Limit to IOC and FOC
+    scob::Order<int, int> o{};
+    assert(scc::parse_new_order_single(make_fix("35=D|54=1|40=2|59=3|38=1|44=7|"), o));
+    assert(o.order_type == scob::OrderType::IOC);
+    assert(scc::parse_new_order_single(make_fix("35=D|54=1|40=2|59=4|38=1|44=7|"), o));
+    assert(o.order_type == scob::OrderType::FOC);
+
+    // 3. Stop order without stop_price member uses price
+    assert(scc::parse_new_order_single(make_fix("35=D|54=2|40=3|38=1|99=9|"), o));
+    assert(o.order_type == scob::OrderType::Stop);
+    assert(o.price == 9);
+    assert(scc::parse_new_order_single(make_fix("35=D|54=2|40=4|38=1|44=8|99=9|"), o).error == scc::FixError::BadValue);
+
+    // 4. Value with '=' in it is skipped as a whole
+    assert(scc::parse_new_order_single(make_fix("35=D|58=a=b==c|54=1|40=1|38=3|"), o));
+    assert(o.order_type == scob::OrderType::Market);
+    assert(o.quantity == 3);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_parse_errors()
+{
+    scob::Order<int, int> order{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit, .price = 1, .quantity = 1};
+    auto parse = [&](const std::string &msg) { return scc::parse_new_order_single(msg, order).error; };
+
+    auto good = make_fix("35=D|54=1|40=2|38=10|44=100|");
+    assert(parse(good) == scc::FixError::None);
+
+    // 1. Framing
+    assert(parse(good.substr(0, good.size() - 1)) == scc::FixError::Incomplete);
+    assert(parse(good.substr(0, 12)) == scc::FixError::Incomplete);
+    assert(parse("") == scc::FixError::Incomplete);
+    assert(parse("9=5\x01") == scc::FixError::Malformed);
+    assert(parse("8=XYZ.4.4\x01" "9=5\x01") == scc::FixError::Malformed);
+    assert(parse("8=\x01" "9=5\x01") == scc::FixError::Malformed);
+    assert(parse("8=FIX.4.4\x01" "9=x\x01") == scc::FixError::Malformed);
+    assert(parse("8=FIX.4.4\x01" "09=1\x01") == scc::FixError::Malformed);
+
+    auto bad_checksum = good;
+    bad_checksum[bad_checksum.size() - 2] = (bad_checksum[bad_checksum.size() - 2] == '0' ? '1' : '0');
+    assert(parse(bad_checksum) == scc::FixError::BadChecksum);
+
+    // Integer fields of framing don't take decimal point, as prices do
+    auto dotted_checksum = good;
+    dotted_checksum.replace(dotted_checksum.size() - 4, 3, "1.0");
+    assert(parse(dotted_checksum) == scc::FixError::Malformed);
+    auto dotted_length = good;
+    dotted_length.insert(dotted_length.find("\x01" "35="), ".0");
+    assert(parse(dotted_length) == scc::FixError::Malformed);
+    unsigned integer = 0;
+    assert(scc::parse_fix_integer("042", integer) && integer == 42);
+    assert(!scc::parse_fix_integer("42.0", integer) && !scc::parse_fix_integer("-1", integer) && !scc::parse_fix_integer("", integer));
+
+    // 2. Content
+    assert(parse(make_fix("35=8|54=1|")) == scc::FixError::UnsupportedMsgType);
+    assert(parse(make_fix("54=1|35=D|")) == scc::FixError::Malformed);
+    assert(parse(make_fix("35=D|54=1|40=2|38=10|")) == scc::FixError::MissingField);
+    assert(parse(make_fix("35=D|54=1|40=2|44=10|")) == scc::FixError::MissingField);
+    assert(parse(make_fix("35=D|54=3|40=2|38=10|44=100|")) == scc::FixError::BadValue);
+    assert(parse(make_fix("35=D|54=1|40=2|38=-10|44=100|")) == scc::FixError::BadValue);
+    assert(parse(make_fix("35=D|54=1|40=2|38=10|44=100.5|")) == scc::FixError::BadValue);
+    assert(parse(make_fix("35=D|54=1|40=2|38=10|44=|")) == scc::FixError::BadValue);
+    assert(parse(make_fix("35=D|54=1|40=9|38=10|44=100|")) == scc::FixError::BadValue);
+
+    // 3. Order is not touched on error
+    assert(order.side == scob::Side::Buy);
+    assert(order.quantity == 10);
+    assert(order.price == 100);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_stream_round_trip()
+{
+    std::vector<FullOrder> orders{
+        {scob::Side::Buy, scob::OrderType::Limit, 100.25, 10, 0, 0, 1},
+        {scob::Side::Sell, scob::OrderType::IOC, 99.5, 20, 0, 0, 2},
+        {scob::Side::Buy, scob::OrderType::Stop, 0, 30, 101, 0, 3},
+        {scob::Side::Sell, scob::OrderType::StopLimit, 98, 40, 98.5, 0, 4},
+        {scob::Side::Buy, scob::OrderType::Limit, 100, 500, 0, 50, 5},
+        {scob::Side::Sell, scob::OrderType::Market, 0, 60, 0, 0, 6}};
+
+    // 1. Write all orders into one stream
+    std::vector<char> stream(4096);
+    size_t size = 0;
+    for (const auto &order : orders)
+    {
+        size_t n = scc::write_new_order_single(order, std::span<char>(stream).subspan(size));
+        assert(n);
+        size += n;
+    }
+    assert(scc::write_new_order_single(orders[0], std::span<char>(stream.data(), 10)) == 0);
+
+    // 2. Read them back one by one
+    std::string_view view(stream.data(), size);
+    for (const auto &expected : orders)
+    {
+        FullOrder order{};
+        auto res = scc::parse_new_order_single(view, order);
+        assert(res);
+        assert(order.side == expected.side);
+        assert(order.order_type == expected.order_type);
+        assert(order.price == expected.price);
+        assert(order.quantity == expected.quantity);
+        assert(order.stop_price == expected.stop_price);
+        assert(order.display_quantity == expected.display_quantity);
+        assert(order.owner == expected.owner);
+        view.remove_prefix(res.consumed);
+    }
+    assert(view.empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Mutate valid messages at random, and make sure parser neither crashes nor
+// reads outside of the buffer (run under sanitizer to catch that), and that
+// whatever it accepts is sane.
+template<bool Vectorised>
+void test_fuzz()
+{
+    std::mt19937 rng(12345);
+    const std::vector<std::string> seeds{
+        make_fix("35=D|54=1|40=2|38=10|44=100|"),
+        make_fix("35=D|1=7|54=2|40=4|38=50|44=10.5|99=10.25|111=5|"),
+        make_fix("35=D|11=abc|58=x=y|54=1|40=1|59=3|38=1|")};
+    const char alphabet[] = {'=', scc::FIX_SOH, '0', '1', '9', '.', '-', 'D', '8', '\0', '\xff'};
+
+    size_t accepted = 0;
+    for (int i = 0; i != 20000; ++i)
+    {
+        std::string msg = seeds[rng() % seeds.size()];
+        const int mutations = 1 + rng() % 4;
+        for (int m = 0; m != mutations && !msg.empty(); ++m)
+        {
+            const size_t pos = rng() % msg.size();
+            switch (rng() % 4)
+            {
+            case 0: msg[pos] = alphabet[rng() % sizeof(alphabet)]; break;
+            case 1: msg.erase(pos, 1 + rng() % 8); break;
+            case 2: msg.insert(pos, 1, alphabet[rng() % sizeof(alphabet)]); break;
+            case 3: msg.resize(pos); break;
+            }
+        }
+
+        // Exact size heap buffer, so that any over-read is caught
+        std::vector<char> buffer(msg.begin(), msg.end());
+        FullOrder order{};
+        auto res = scc::parse_new_order_single<FullOrder, Vectorised>(
+            std::string_view(buffer.data(), buffer.size()), order);
+
+        assert(res.consumed <= buffer.size());
+        if (res)
+        {
+            assert(res.consumed > 0);
+            assert(order.quantity > 0);
+            assert(order.display_quantity <= order.quantity);
+            ++accepted;
+        }
+    }
+    // Mutations landing in fields we ignore keep the message valid
+    assert(accepted > 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_delimiter_scanner<false>();
+    test_delimiter_scanner<scu::simd_available>();
+    test_parse_limit_order<scob::Order<int, int>>();
+    test_parse_limit_order<scob::Order<double, long>>();
+    test_parse_limit_order<scob::Order<long, double>>();
+    test_parse_optional_fields();
+    test_parse_errors();
+    test_stream_round_trip();
+    test_fuzz<false>();
+    test_fuzz<scu::simd_available>();
+
+    return 0;
+}
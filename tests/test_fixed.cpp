@@ -0,0 +1,237 @@
+#include "test_util.hpp"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <new>
+
+#include "lib.hpp"
+#include "orderbook/fixedbook.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+// Every allocation from global heap is counted
+static std::size_t heap_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++heap_allocations;
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    ++heap_allocations;
+    const std::size_t a = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+
+struct IndexedOrder
+{
+    typedef int PriceType;
+    typedef int QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    int owner;
+    scob::OwnerIndexHook<IndexedOrder> owner_hook;
+};
+
+struct RankedOrder
+{
+    typedef int PriceType;
+    typedef int QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    std::uint64_t queue_ticket = 0;
+};
+
+template<scob::CapacityOverflow Overflow>
+using BookType = scob::OrderBook<IndexedOrder, scob::FixedBookSidePolicy<2, 2, Overflow>>;
+
+template<typename BookSide>
+int total_quantity(const BookSide &book_side)
+{
+    int total = 0;
+    for (auto &level : book_side)
+    {
+        total += level.total_quantity();
+    }
+    return total;
+}
+
+void test_reject()
+{
+    BookType<scob::CapacityOverflow::Reject> book;
+    std::deque<IndexedOrder> orders;
+    auto add = [&](int price, int quantity) -> IndexedOrder &
+    {
+        auto &order = orders.emplace_back(IndexedOrder{scob::Side::Buy, scob::OrderType::Limit, price, quantity, 1});
+        assert(!book.accept_order(order));
+        return order;
+    };
+
+    add(100, 1);
+    add(100, 2);
+    add(99, 3);
+
+    // 1. Full level doesn't take more orders
+    auto &rejected = add(100, 4);
+    assert(book.bid().overflow().size() == 1);
+    assert(&book.bid().overflow().front().order() == &rejected);
+    assert(book.bid().overflow().front().quantity == 4);
+    assert(!rejected.owner_hook.is_linked());
+    assert(book.bid().top().size() == 2);
+
+    // 2. Nor does full side take new level, even at better price
+    add(101, 5);
+    assert(book.bid().overflow().size() == 1 && book.bid().overflow_count() == 2);
+    assert(book.bid().size() == 2 && book.bid().top().price() == 100);
+    assert(total_quantity(book.bid()) == 6);
+
+    // 3. Order that fits clears overflow of the last add
+    book.cancel_orders({.min_price = 99, .max_price = 99});
+    add(98, 6);
+    assert(book.bid().overflow().empty() && book.bid().overflow_count() == 2);
+
+    // 4. Rejected orders are not in owner index
+    assert(book.cancel_owner_orders(1) == 3);
+    assert(book.bid().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_evict_worst()
+{
+    BookType<scob::CapacityOverflow::EvictWorst> book;
+    std::deque<IndexedOrder> orders;
+    auto add = [&](int price, int quantity) -> IndexedOrder &
+    {
+        auto &order = orders.emplace_back(IndexedOrder{scob::Side::Sell, scob::OrderType::Limit, price, quantity, 1});
+        assert(!book.accept_order(order));
+        return order;
+    };
+
+    add(105, 1);
+    auto &worst1 = add(106, 2);
+    auto &worst2 = add(106, 3);
+
+    // 1. Better price takes place of the worst level
+    add(104, 4);
+    assert(book.ask().size() == 2);
+    assert(book.ask().top().price() == 104);
+    assert(book.ask().overflow().size() == 2 && book.ask().overflow_count() == 2);
+    assert(&book.ask().overflow()[0].order() == &worst1 && book.ask().overflow()[1].quantity == 3);
+    assert(!worst1.owner_hook.is_linked() && !worst2.owner_hook.is_linked());
+
+    // 2. Worse price is still rejected
+    auto &rejected = add(107, 5);
+    assert(book.ask().overflow().size() == 1 && &book.ask().overflow().front().order() == &rejected);
+    assert(total_quantity(book.ask()) == 5);
+
+    // 3. Matching frees room for new levels
+    IndexedOrder buy{scob::Side::Buy, scob::OrderType::IOC, 104, 4, 2};
+    for (auto ex = book.accept_order(buy); ex; ex())
+    {}
+    add(107, 5);
+    assert(book.ask().overflow().empty());
+    assert(book.ask().size() == 2);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Adding, filling and cancelling orders on the side never touch the heap
+void test_no_heap()
+{
+    typedef scob::Order<int, int> OrderType;
+    typedef scob::FixedBookSide<scob::Side::Buy, OrderType, 16, 8, scob::CapacityOverflow::EvictWorst> SideType;
+    typedef scob::OrderQuantity<OrderType> OrderQuantityType;
+
+    // All storage is in the object
+    static_assert(16 * 8 * sizeof(OrderQuantityType) < sizeof(SideType));
+
+    SideType side;
+    std::deque<OrderType> orders;
+    for (int i = 0; i != 1000; ++i)
+    {
+        orders.emplace_back(OrderType{scob::Side::Buy, scob::OrderType::Limit, 100 + i % 20, 1 + i % 5});
+    }
+    scu::FixedQueue<OrderQuantityType, 64> out;
+
+    const std::size_t allocations = heap_allocations;
+    for (int round = 0; round != 10; ++round)
+    {
+        for (int i = 0; i != 100; ++i)
+        {
+            auto &order = orders[round * 100 + i];
+            side.add_order(order, order.quantity);
+        }
+        assert(side.size() <= 16);
+
+        out.clear();
+        side.fill_orders(105, 20, out);
+        out.clear();
+        side.cancel_orders_if(100, 110, [](const OrderType &order) { return order.quantity == 3; }, out);
+    }
+    assert(heap_allocations == allocations);
+    assert(0 < side.overflow_count());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Partial fill of the top level keeps queue ranks of its orders
+void test_queue_position()
+{
+    scob::OrderBook<RankedOrder, scob::FixedBookSidePolicy<4, 8>> book;
+    std::deque<RankedOrder> orders;
+    for (int quantity : {5, 3, 4})
+    {
+        auto &order = orders.emplace_back(RankedOrder{scob::Side::Sell, scob::OrderType::Limit, 101, quantity});
+        assert(!book.accept_order(order));
+    }
+
+    RankedOrder buy{scob::Side::Buy, scob::OrderType::IOC, 101, 2};
+    for (auto ex = book.accept_order(buy); ex; ex())
+    {}
+    assert(book.ask().top().total_quantity() == 10);
+
+    auto position = book.queue_position(orders[2]);
+    assert(position && position->orders_ahead == 2 && position->quantity_ahead == 6);
+    position = book.queue_position(orders[0]);
+    assert(position && position->orders_ahead == 0 && position->quantity_ahead == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_reject();
+    test_evict_worst();
+    test_no_heap();
+    test_queue_position();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory_resource>
+
+#include "lib.hpp"
+#include "util/hugepages.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+// Resource that counts what goes through it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocated = 0;
+    std::size_t deallocated = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+        deallocated += bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+void test_arena()
+{
+    CountingResource upstream;
+    scu::HugePageResource arena(1, &upstream);
+
+    // 1. Region is whole huge pages, and it's mapped one way or another
+    assert(arena.capacity() == scu::HugePageResource::huge_page_size);
+    assert(arena.backing() != scu::HugePageBacking::None);
+    assert(arena.used() == 0);
+
+    // 2. Allocations are aligned, and come from region
+    void *p1 = arena.allocate(10, 1);
+    void *p2 = arena.allocate(100, 64);
+    assert(arena.owns(p1) && arena.owns(p2));
+    assert(reinterpret_cast<std::uintptr_t>(p2) % 64 == 0);
+    assert(static_cast<char *>(p2) >= static_cast<char *>(p1) + 10);
+    assert(arena.used() <= 10 + 63 + 100);
+    arena.deallocate(p1, 10, 1);
+    assert(upstream.deallocated == 0);
+
+    // 3. Once region is used up, upstream takes over
+    void *big = arena.allocate(arena.capacity(), 8);
+    assert(!arena.owns(big));
+    assert(upstream.allocated == arena.capacity());
+    assert(arena.overflow() == arena.capacity());
+    arena.deallocate(big, arena.capacity(), 8);
+    assert(upstream.deallocated == arena.capacity());
+    assert(arena.overflow() == 0);
+
+    // 4. Empty arena passes everything to upstream
+    scu::HugePageResource empty(0, &upstream);
+    assert(empty.backing() == scu::HugePageBacking::None);
+    void *p3 = empty.allocate(16, 8);
+    assert(!empty.owns(p3));
+    empty.deallocate(p3, 16, 8);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Levels and queues of the book are allocated from the arena via pool
+template<typename BookSidePolicy>
+void test_book_in_arena()
+{
+    typedef scob::Order<int, int> OrderType;
+
+    CountingResource upstream;
+    scu::HugePageResource arena(std::size_t(8) << 20, &upstream);
+    std::pmr::unsynchronized_pool_resource pool(&arena);
+
+    {
+        scu::ScopedDefaultResource scope(&pool);
+        scob::OrderBook<OrderType, BookSidePolicy> book;
+        std::pmr::deque<OrderType> orders;
+
+        for (int i = 0; i != 5000; ++i)
+        {
+            auto side = (i % 2 ? scob::Side::Buy : scob::Side::Sell);
+            int price = (side == scob::Side::Buy ? 99 - (i / 2) % 50 : 101 + (i / 2) % 50);
+            auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Limit, price, 1 + i % 10});
+            assert(!book.accept_order(order));
+        }
+        assert(book.bid().size() == 50 && book.ask().size() == 50);
+        assert(arena.used() > 0);
+
+        OrderType sweep{scob::Side::Buy, scob::OrderType::IOC, 150, 3000};
+        int executed = 0;
+        for (auto ex = book.accept_order(sweep); ex; )
+        {
+            executed += ex().quantity;
+        }
+        assert(executed == 3000);
+    }
+
+    assert(std::pmr::get_default_resource() == std::pmr::new_delete_resource());
+    assert(upstream.allocated == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Book sides of default policy never touch default memory resource, even
+// with pro-rata levels
+void test_default_policy_not_in_arena()
+{
+    typedef scob::Order<int, int> OrderType;
+
+    CountingResource counting;
+    std::deque<OrderType> orders;
+    {
+        scu::ScopedDefaultResource scope(&counting);
+        scob::OrderBook<OrderType, scob::ProRataBookSidePolicy<>> book;
+
+        for (int i = 0; i != 100; ++i)
+        {
+            auto &order = orders.emplace_back(OrderType{scob::Side::Sell, scob::OrderType::Limit, 100 + i % 5, 1 + i % 10});
+            assert(!book.accept_order(order));
+        }
+        OrderType sweep{scob::Side::Buy, scob::OrderType::IOC, 102, 100};
+        for (auto ex = book.accept_order(sweep); ex; ex())
+        {}
+        assert(!book.ask().empty());
+    }
+    assert(counting.allocated == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_arena();
+    test_book_in_arena<scob::PmrBookSidePolicy<>>();
+    test_book_in_arena<scob::PmrBookSidePolicy<scob::ProRataPriceLevel>>();
+    test_default_policy_not_in_arena();
+
+    return 0;
+}
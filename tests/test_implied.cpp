@@ -0,0 +1,195 @@
+#include "test_util.hpp"
+
+#include <deque>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/implied.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+typedef scob::Order<int, int> OrderType;
+typedef scob::OrderBook<OrderType> BookType;
+typedef scob::ImpliedMatcher<BookType> MatcherType;
+typedef MatcherType::TopType TopType;
+typedef std::vector<MatcherType::FillType> FillsType;
+
+// Instrument and order of every execution
+struct ExecutionLog
+{
+    std::vector<std::pair<std::size_t, const OrderType *>> orders;
+    std::vector<int> quantities;
+
+    void operator()(std::size_t instrument, const scob::OrderQuantity<OrderType> &executed)
+    {
+        orders.emplace_back(instrument, &executed.order());
+        quantities.push_back(executed.quantity);
+    }
+};
+
+struct CalendarSpread
+{
+    BookType near_book;
+    BookType far_book;
+    BookType spread_book;
+    MatcherType implied;
+    std::size_t near;
+    std::size_t far;
+    std::size_t spread;
+    std::deque<OrderType> orders;
+
+    CalendarSpread()
+    {
+        near = implied.add_instrument(near_book);
+        far = implied.add_instrument(far_book);
+        spread = implied.add_spread(spread_book, near, far);
+    }
+
+    OrderType &add(std::size_t instrument, scob::Side side, int price, int quantity)
+    {
+        auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Limit, price, quantity});
+        ExecutionLog log;
+        implied.accept_order(instrument, order, log);
+        assert(log.orders.empty());
+        return order;
+    }
+};
+
+void test_implied_in()
+{
+    CalendarSpread cs;
+    auto &near_ask = cs.add(cs.near, scob::Side::Sell, 105, 10);
+    auto &far_bid = cs.add(cs.far, scob::Side::Buy, 100, 4);
+
+    // 1. Legs imply spread ask, and nothing else
+    assert((cs.implied.implied_top(cs.spread, scob::Side::Sell) == TopType{5, 4}));
+    assert(!cs.implied.implied_top(cs.spread, scob::Side::Buy));
+    assert(!cs.implied.implied_top(cs.near, scob::Side::Sell));
+    assert(!cs.implied.implied_top(cs.far, scob::Side::Buy));
+
+    // 2. Spread buyer takes implied quantity from both legs, and rests the rest
+    auto &buy = cs.orders.emplace_back(OrderType{scob::Side::Buy, scob::OrderType::Limit, 5, 6});
+    ExecutionLog log;
+    FillsType fills;
+    assert(cs.implied.accept_order(cs.spread, buy, log, &fills) == 4);
+    assert((fills == FillsType{{5, 4}}));
+    assert((log.orders == std::vector<std::pair<std::size_t, const OrderType *>>{{cs.near, &near_ask}, {cs.far, &far_bid}}));
+    assert((log.quantities == std::vector<int>{4, 4}));
+    assert(cs.near_book.ask().top().total_quantity() == 6);
+    assert(cs.far_book.bid().empty());
+    assert(cs.spread_book.bid().top().price() == 5 && cs.spread_book.bid().top().total_quantity() == 2);
+    assert(!cs.implied.implied_top(cs.spread, scob::Side::Sell));
+
+    // 3. Spread bid now implies far ask out of near ask
+    assert((cs.implied.implied_top(cs.far, scob::Side::Sell) == TopType{100, 2}));
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_implied_out()
+{
+    CalendarSpread cs;
+    auto &spread_ask = cs.add(cs.spread, scob::Side::Sell, 3, 5);
+    auto &far_ask = cs.add(cs.far, scob::Side::Sell, 100, 2);
+    auto &far_ask_deep = cs.add(cs.far, scob::Side::Sell, 101, 10);
+
+    // 1. Near ask is implied by spread ask and far ask
+    assert((cs.implied.implied_top(cs.near, scob::Side::Sell) == TopType{103, 2}));
+
+    // 2. Near buyer walks implied levels as far ask is taken
+    OrderType buy{scob::Side::Buy, scob::OrderType::IOC, 104, 4};
+    ExecutionLog log;
+    FillsType fills;
+    assert(cs.implied.accept_order(cs.near, buy, log, &fills) == 4);
+    assert((fills == FillsType{{103, 2}, {104, 2}}));
+    assert((log.orders == std::vector<std::pair<std::size_t, const OrderType *>>{
+        {cs.spread, &spread_ask}, {cs.far, &far_ask}, {cs.spread, &spread_ask}, {cs.far, &far_ask_deep}}));
+    assert((log.quantities == std::vector<int>{2, 2, 2, 2}));
+    assert((cs.implied.implied_top(cs.near, scob::Side::Sell) == TopType{104, 1}));
+
+    // 3. Outright order at the same price goes first
+    auto &near_ask = cs.add(cs.near, scob::Side::Sell, 104, 1);
+    OrderType buy_more{scob::Side::Buy, scob::OrderType::IOC, 104, 5};
+    ExecutionLog more_log;
+    fills.clear();
+    assert(cs.implied.accept_order(cs.near, buy_more, more_log, &fills) == 2);
+    assert((fills == FillsType{{104, 1}})); //< Outright fill is not implied
+    assert((more_log.orders == std::vector<std::pair<std::size_t, const OrderType *>>{
+        {cs.near, &near_ask}, {cs.spread, &spread_ask}, {cs.far, &far_ask_deep}}));
+    assert(cs.spread_book.ask().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+// First leg executes less than the top it was priced from, and the second
+// leg takes only as much
+void test_short_leg()
+{
+    CalendarSpread cs;
+    auto &near_ask = cs.add(cs.near, scob::Side::Sell, 105, 10);
+    auto &far_bid = cs.add(cs.far, scob::Side::Buy, 100, 4);
+    assert((cs.implied.implied_top(cs.spread, scob::Side::Sell) == TopType{5, 4}));
+
+    // 1. Near ask is taken outside of matcher, which isn't refreshed
+    OrderType near_buy{scob::Side::Buy, scob::OrderType::IOC, 105, 8};
+    for (auto ex = cs.near_book.accept_order(near_buy); ex; ex())
+    {}
+    assert(cs.near_book.ask().top().total_quantity() == 2);
+
+    // 2. Spread buyer gets only 2 from near leg, and far leg is sized by that
+    auto &buy = cs.orders.emplace_back(OrderType{scob::Side::Buy, scob::OrderType::Limit, 5, 4});
+    ExecutionLog log;
+    FillsType fills;
+    assert(cs.implied.accept_order(cs.spread, buy, log, &fills) == 2);
+    assert((fills == FillsType{{5, 2}}));
+    assert((log.orders == std::vector<std::pair<std::size_t, const OrderType *>>{{cs.near, &near_ask}, {cs.far, &far_bid}}));
+    assert((log.quantities == std::vector<int>{2, 2}));
+    assert(cs.near_book.ask().empty());
+    assert(cs.far_book.bid().top().total_quantity() == 2);
+    assert(cs.spread_book.bid().top().total_quantity() == 2);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Only the changes of top recompute routes, and only those depending on it
+void test_incremental()
+{
+    CalendarSpread cs;
+    cs.add(cs.near, scob::Side::Sell, 105, 10);
+    cs.add(cs.far, scob::Side::Buy, 100, 4);
+    const auto updates = cs.implied.route_updates();
+
+    // 1. Orders behind the top don't change anything
+    cs.add(cs.near, scob::Side::Sell, 106, 10);
+    cs.add(cs.far, scob::Side::Buy, 99, 10);
+    assert(cs.implied.route_updates() == updates);
+
+    // 2. New top of near ask changes the two routes that use it
+    cs.add(cs.near, scob::Side::Sell, 104, 1);
+    assert(cs.implied.route_updates() == updates + 2);
+    assert((cs.implied.implied_top(cs.spread, scob::Side::Sell) == TopType{4, 1}));
+
+    // 3. Cancels are seen after refresh
+    cs.near_book.cancel_orders({.side = scob::Side::Sell, .max_price = 104});
+    cs.implied.refresh(cs.near);
+    assert(cs.implied.route_updates() == updates + 4);
+    assert((cs.implied.implied_top(cs.spread, scob::Side::Sell) == TopType{5, 4}));
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_implied_in();
+    test_implied_out();
+    test_short_leg();
+    test_incremental();
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "test_util.hpp"
+
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/ingress.hpp"
+#include "util/mpscqueue.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<scu::NumberConcept _PriceType = int, scu::NumberConcept _QuantityType = int>
+struct SequencedOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    std::uint64_t sequence = ~0ull;
+};
+
+void test_queue()
+{
+    scu::MpscQueue<std::shared_ptr<int>, 4> queue;
+    auto counted = std::make_shared<int>(0);
+
+    // 1. Sequence numbers are given in order of push, until queue is full
+    for (int i = 0; i != 4; ++i)
+    {
+        auto sequence = queue.try_push(std::make_shared<int>(i));
+        assert(sequence && *sequence == std::uint64_t(i));
+    }
+    assert(!queue.try_push(counted));
+    assert(queue.size() == 4);
+
+    // 2. Drain takes messages in order, at most as many as asked
+    std::vector<int> seen;
+    auto collect = [&](std::uint64_t sequence, std::shared_ptr<int> &value)
+    {
+        assert(sequence == std::uint64_t(*value));
+        seen.push_back(*value);
+    };
+    assert(queue.drain(collect, 3) == 3);
+    assert((seen == std::vector<int>{0, 1, 2}));
+    assert(queue.head() == 3);
+
+    // 3. Slots drained are reused by the next lap
+    assert(*queue.try_emplace(std::make_shared<int>(4)) == 4);
+    assert(*queue.try_emplace(std::make_shared<int>(5)) == 5);
+    assert(queue.drain(collect) == 3);
+    assert((seen == std::vector<int>{0, 1, 2, 3, 4, 5}));
+    assert(queue.drain(collect) == 0);
+
+    // 4. Messages left in queue are destroyed with it
+    {
+        scu::MpscQueue<std::shared_ptr<int>, 4> other;
+        assert(other.try_push(counted));
+        assert(counted.use_count() == 2);
+    }
+    assert(counted.use_count() == 1);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Each producer's messages come out in its order, and sequence numbers are dense
+void test_producers()
+{
+    constexpr int producer_count = 4;
+    constexpr int message_count = 20000;
+    typedef std::pair<int, int> Message;    //< Producer, and its counter
+
+    scu::MpscQueue<Message, 64> queue;
+    std::atomic<int> done{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p != producer_count; ++p)
+    {
+        producers.emplace_back([&, p]
+        {
+            for (int i = 0; i != message_count; ++i)
+            {
+                while (!queue.try_push(Message{p, i}))
+                {
+                    std::this_thread::yield();
+                }
+                assert(queue.size() <= std::size_t(producer_count) * message_count); //< Producers may read it too
+            }
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    std::vector<int> next(producer_count, 0);
+    std::uint64_t expected_sequence = 0;
+    auto check = [&](std::uint64_t sequence, const Message &message)
+    {
+        assert(sequence == expected_sequence++);
+        assert(next[message.first]++ == message.second);
+    };
+    while (done.load(std::memory_order_acquire) != producer_count)
+    {
+        if (!queue.drain(check))
+        {
+            std::this_thread::yield();
+        }
+    }
+    queue.drain(check);
+
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+    assert(expected_sequence == std::uint64_t(producer_count) * message_count);
+    assert(queue.size() == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_ingress()
+{
+    typedef SequencedOrder<> OrderType;
+    scob::OrderBook<OrderType> book;
+    scob::OrderIngress<scob::OrderBook<OrderType>, 8> ingress;
+
+    std::deque<OrderType> orders{
+        {scob::Side::Sell, scob::OrderType::Limit, 101, 5},
+        {scob::Side::Sell, scob::OrderType::Limit, 102, 5},
+        {scob::Side::Buy, scob::OrderType::Limit, 101, 2},
+        {scob::Side::Buy, scob::OrderType::Limit, 102, 6}
+    };
+    const std::deque<OrderType> submitted = orders;
+
+    std::vector<std::thread> gateways;
+    for (int g = 0; g != 2; ++g)
+    {
+        gateways.emplace_back([&, g]
+        {
+            assert(ingress.submit(orders[2 * g]));
+            assert(ingress.submit(orders[2 * g + 1]));
+        });
+    }
+    for (auto &gateway : gateways)
+    {
+        gateway.join();
+    }
+    assert(ingress.size() == 4);
+
+    // 1. Orders are accepted with sequence they were given at submit
+    std::vector<std::pair<std::uint64_t, int>> executions;
+    assert(ingress.drain(book, [&](std::uint64_t sequence, auto executed)
+    {
+        executions.emplace_back(sequence, executed.quantity);
+    }, 4) == 4);
+    assert(ingress.sequence() == 4);
+    assert(ingress.size() == 0);
+
+    std::vector<int> journal(4, -1);
+    for (int i = 0; i != 4; ++i)
+    {
+        assert(orders[i].sequence < 4 && journal[orders[i].sequence] == -1);
+        journal[orders[i].sequence] = i;
+    }
+
+    // 2. Replaying orders in order of sequence gives the same executions
+    scob::OrderBook<OrderType> replayed;
+    std::deque<OrderType> copies;
+    std::vector<std::pair<std::uint64_t, int>> replayed_executions;
+    for (std::uint64_t sequence = 0; sequence != 4; ++sequence)
+    {
+        auto &order = copies.emplace_back(submitted[journal[sequence]]);
+        for (auto ex = replayed.accept_order(order); ex; )
+        {
+            replayed_executions.emplace_back(sequence, ex().quantity);
+        }
+    }
+    assert(executions == replayed_executions);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_queue();
+    test_producers();
+    test_ingress();
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "lib.hpp"
+#include "orderbook/fixedbook.hpp"
 
 
 template<sadhbhcraft::orderbook::PriceLevelOrderBookConcept OrderBookType>
@@ -279,6 +280,24 @@ int main(int argc, const char** argv)
     test_orderbook<scob::OrderBook<scob::Order<long, short>>>();
     test_orderbook<scob::OrderBook<scob::Order<double, long>>>();
     test_orderbook<scob::OrderBook<scob::Order<long, double>>>();
+
+    // Price levels with small-buffer inline queues
+    using SmallQueueSidePolicy = scob::PriceLevelStackBookSidePolicy<std::deque, scu::SmallQueueOf<1>::type>;
+    test_orderbook<scob::OrderBook<scob::Order<int, int>, SmallQueueSidePolicy>>();
+    test_orderbook<scob::OrderBook<scob::Order<double, long>,
+        scob::PriceLevelStackBookSidePolicy<std::deque, scu::SmallQueue>>>();
+
+    // Levels in vectors, allocated only once book has orders
+    test_orderbook<scob::OrderBook<scob::Order<int, int>, scob::CompactBookSidePolicy<>>>();
+    test_orderbook<scob::OrderBook<scob::Order<long, double>, scob::CompactBookSidePolicy<scob::OrderPriceLevel, 2>>>();
+
+    // Book sides keeping depth, and forwarding to instrumentation
+    test_orderbook<scob::OrderBook<scob::Order<int, int>, scob::AnalyticsBookSidePolicy<0, 3>, scob::HotPathStats>>();
+
+    // Levels and queues inline, with capacity to spare
+    test_orderbook<scob::OrderBook<scob::Order<int, int>, scob::FixedBookSidePolicy<8, 4>>>();
+    test_orderbook<scob::OrderBook<scob::Order<double, long>,
+        scob::FixedBookSidePolicy<8, 4, scob::CapacityOverflow::EvictWorst>, scob::HotPathStats>>();
     
     return 0;
 }
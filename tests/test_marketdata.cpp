@@ -0,0 +1,354 @@
+#include "test_util.hpp"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lib.hpp"
+#include "orderbook/marketdata.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<std::size_t Capacity>
+using PublishingBook = scob::OrderBook<OwnedOrder<>, scob::PriceLevelStackBookSidePolicy<>, scob::MarketDataPublisher<Capacity, 4>>;
+
+std::string shm_name(const std::string &name)
+{
+    return "/" + name + "." + std::to_string(::getpid());
+}
+
+struct Update
+{
+    scob::MarketDataType type;
+    scob::Side side;
+    int price;
+    int quantity;
+    bool auction = false;
+
+    bool operator==(const Update &) const = default;
+};
+
+template<typename Subscriber>
+std::vector<Update> read_updates(Subscriber &feed)
+{
+    std::vector<Update> updates;
+    scob::MarketDataMessage msg;
+    while (feed.next(msg) == scu::ShmReadStatus::Ok)
+    {
+        assert(!(msg.flags & ~scob::MarketDataAuction));
+        const bool auction = (msg.flags & scob::MarketDataAuction);
+        updates.push_back(Update{msg.type, scob::Side(msg.side), int(msg.price), int(msg.quantity), auction});
+    }
+    return updates;
+}
+
+void test_ring()
+{
+    typedef scu::ShmRing<int, 4> RingType;
+    auto memory = std::make_unique<std::byte[]>(sizeof(RingType));
+    auto &ring = RingType::create(memory.get());
+
+    // 1. Only ring of the same type can be attached
+    assert(RingType::attach(memory.get(), sizeof(RingType)) == &ring);
+    assert(!RingType::attach(memory.get(), sizeof(RingType) - 1));
+    assert((!scu::ShmRing<int, 8>::attach(memory.get(), sizeof(RingType))));
+    assert((!scu::ShmRing<long, 4>::attach(memory.get(), sizeof(RingType))));
+
+    // 2. Reader starts from the next message
+    ring.push(100);
+    scu::ShmRingReader<int, 4> reader(ring);
+    int x = 0;
+    assert(reader.sequence() == 1);
+    assert(reader.read(x) == scu::ShmReadStatus::Empty);
+
+    for (int i = 1; i != 4; ++i)
+    {
+        ring.push(100 + i);
+    }
+    assert(reader.lag() == 3);
+    for (int i = 1; i != 4; ++i)
+    {
+        assert(reader.read(x) == scu::ShmReadStatus::Ok);
+        assert(x == 100 + i);
+    }
+    assert(reader.read(x) == scu::ShmReadStatus::Empty);
+
+    // 3. Writer that has lapped reader overruns it, and reader can skip
+    for (int i = 4; i != 9; ++i)
+    {
+        ring.push(100 + i);
+    }
+    assert(reader.read(x) == scu::ShmReadStatus::Overrun);
+    reader.seek(7);
+    assert(reader.read(x) == scu::ShmReadStatus::Ok && x == 107);
+
+    // 4. Seqlock cell is empty until first store
+    scu::SeqlockCell<scob::MarketDataLevel> cell;
+    scob::MarketDataLevel value;
+    assert(!cell.load(value));
+    cell.store({1, 2});
+    cell.store({3, 4});
+    assert(cell.load(value) && value.price == 3 && value.quantity == 4);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_publish()
+{
+    typedef scob::MarketDataType Type;
+    const auto name = shm_name("scob_md_publish");
+
+    PublishingBook<64> book;
+    assert(book.instrumentation().open(name.c_str()));
+    scob::MarketDataSubscriber<64, 4> feed(name.c_str());
+    assert(feed.is_open());
+
+    // 1. Subscriber with different layout cannot attach
+    scob::MarketDataSubscriber<128, 4> wrong_feed(name.c_str());
+    assert(!wrong_feed.is_open());
+    scob::MarketDataMessage message;
+    scob::MarketDataSubscriber<128, 4>::SnapshotType snapshot;
+    assert(wrong_feed.next(message) == scu::ShmReadStatus::Empty);
+    assert(wrong_feed.sequence() == 0 && wrong_feed.lag() == 0);
+    assert(!wrong_feed.recover(snapshot));
+
+    // 2. Resting orders update their levels
+    std::deque<OwnedOrder<>> orders{
+        {scob::Side::Sell, scob::OrderType::Limit, 101, 5, 1},
+        {scob::Side::Sell, scob::OrderType::Limit, 101, 3, 2},
+        {scob::Side::Sell, scob::OrderType::Limit, 102, 7, 1},
+        {scob::Side::Buy, scob::OrderType::Limit, 99, 4, 1}
+    };
+    for (auto &order : orders)
+    {
+        assert(!book.accept_order(order));
+    }
+    assert((read_updates(feed) == std::vector<Update>{
+        {Type::LevelUpdate, scob::Side::Sell, 101, 5},
+        {Type::LevelUpdate, scob::Side::Sell, 101, 8},
+        {Type::LevelUpdate, scob::Side::Sell, 102, 7},
+        {Type::LevelUpdate, scob::Side::Buy, 99, 4}}));
+
+    // 3. Aggressor publishes trades, then levels it has taken and the one
+    // it has left partially filled
+    OwnedOrder<> buy{scob::Side::Buy, scob::OrderType::IOC, 102, 10, 3};
+    for (auto ex = book.accept_order(buy); ex; )
+    {
+        ex();
+    }
+    assert((read_updates(feed) == std::vector<Update>{
+        {Type::Trade, scob::Side::Buy, 101, 5},
+        {Type::Trade, scob::Side::Buy, 101, 3},
+        {Type::Trade, scob::Side::Buy, 102, 2},
+        {Type::LevelUpdate, scob::Side::Sell, 101, 0},
+        {Type::LevelUpdate, scob::Side::Sell, 102, 5}}));
+
+    // 4. Cancels update levels, and remove those left empty
+    orders.push_back({scob::Side::Buy, scob::OrderType::Limit, 99, 6, 2});
+    assert(!book.accept_order(orders.back()));
+    assert(book.cancel_owner_orders(1) == 2);
+    assert((read_updates(feed) == std::vector<Update>{
+        {Type::LevelUpdate, scob::Side::Buy, 99, 10},
+        {Type::LevelUpdate, scob::Side::Buy, 99, 6},
+        {Type::LevelUpdate, scob::Side::Sell, 102, 0}}));
+
+    assert(feed.sequence() == book.instrumentation().sequence());
+    book.instrumentation().close();
+    assert((!scob::MarketDataSubscriber<64, 4>(name.c_str()).is_open()));
+
+    std::cout << "OK" << std::endl;
+}
+
+// Uncross publishes levels it has taken, and then trades flagged as auction
+void test_publish_auction()
+{
+    typedef scob::MarketDataType Type;
+    const auto name = shm_name("scob_md_auction");
+
+    PublishingBook<64> book;
+    assert(book.instrumentation().open(name.c_str()));
+    scob::MarketDataSubscriber<64, 4> feed(name.c_str());
+    assert(feed.is_open());
+
+    book.set_trading_phase(scob::TradingPhase::Auction);
+    std::deque<OwnedOrder<>> orders{
+        {scob::Side::Sell, scob::OrderType::Limit, 100, 5, 1},
+        {scob::Side::Sell, scob::OrderType::Limit, 100, 3, 2},
+        {scob::Side::Buy, scob::OrderType::Limit, 100, 6, 3}
+    };
+    for (auto &order : orders)
+    {
+        assert(!book.accept_order(order));
+    }
+    assert((read_updates(feed) == std::vector<Update>{
+        {Type::LevelUpdate, scob::Side::Sell, 100, 5},
+        {Type::LevelUpdate, scob::Side::Sell, 100, 8},
+        {Type::LevelUpdate, scob::Side::Buy, 100, 6}}));
+
+    std::size_t trades = 0;
+    for (auto uncross = book.uncross(); uncross; uncross())
+    {
+        ++trades;
+    }
+    assert(trades == 2);
+    assert((read_updates(feed) == std::vector<Update>{
+        {Type::LevelUpdate, scob::Side::Buy, 100, 0},
+        {Type::LevelUpdate, scob::Side::Sell, 100, 2},
+        {Type::Trade, scob::Side::Buy, 100, 5, true},
+        {Type::Trade, scob::Side::Buy, 100, 1, true}}));
+
+    book.instrumentation().close();
+
+    std::cout << "OK" << std::endl;
+}
+
+// Publisher removes the object by its own copy of the name
+void test_close_after_name()
+{
+    const auto name = shm_name("scob_md_close");
+
+    PublishingBook<16> book;
+    {
+        std::string temporary = name;
+        assert(book.instrumentation().open(temporary.c_str()));
+        temporary.assign(temporary.size(), 'x');
+    }
+    assert((scob::MarketDataSubscriber<16, 4>(name.c_str()).is_open()));
+
+    book.instrumentation().close();
+    assert((!scob::MarketDataSubscriber<16, 4>(name.c_str()).is_open()));
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_overrun_recovery()
+{
+    const auto name = shm_name("scob_md_recovery");
+
+    PublishingBook<16> book;
+    assert(book.instrumentation().open(name.c_str()));
+    scob::MarketDataSubscriber<16, 4> feed(name.c_str());
+    assert(feed.is_open());
+
+    std::deque<OwnedOrder<>> orders;
+    for (int i = 0; i != 20; ++i)
+    {
+        orders.push_back({scob::Side::Buy, scob::OrderType::Limit, 100 - i % 6, 1, 1});
+        assert(!book.accept_order(orders.back()));
+    }
+
+    // 1. Reader which is too slow is overrun, and cannot recover without snapshot
+    scob::MarketDataMessage msg;
+    decltype(feed)::SnapshotType snapshot;
+    assert(feed.next(msg) == scu::ShmReadStatus::Overrun);
+    assert(!feed.recover(snapshot));
+
+    // 2. Snapshot has top levels, and deeper bids are flagged as unknown, and
+    // reader continues after it
+    book.instrumentation().publish_snapshot(book);
+    assert(feed.recover(snapshot));
+    assert(snapshot.sequence == 20);
+    assert(snapshot.bid_count == 4 && snapshot.ask_count == 0);
+    assert(snapshot.bids[0].price == 100 && snapshot.bids[0].quantity == 4);
+    assert(snapshot.bids[3].price == 97 && snapshot.bids[3].quantity == 3);
+    assert(snapshot.flags & scob::MarketDataBidsTruncated);
+    assert(!(snapshot.flags & scob::MarketDataAsksTruncated));
+    assert(feed.next(msg) == scu::ShmReadStatus::Empty);
+
+    OwnedOrder<> sell{scob::Side::Sell, scob::OrderType::IOC, 100, 2, 2};
+    for (auto ex = book.accept_order(sell); ex; )
+    {
+        ex();
+    }
+    assert((read_updates(feed) == std::vector<Update>{
+        {scob::MarketDataType::Trade, scob::Side::Sell, 100, 1},
+        {scob::MarketDataType::Trade, scob::Side::Sell, 100, 1},
+        {scob::MarketDataType::LevelUpdate, scob::Side::Buy, 100, 2}}));
+
+    // 3. Snapshot that is itself a lap behind is no good either
+    for (int i = 0; i != 20; ++i)
+    {
+        orders.push_back({scob::Side::Sell, scob::OrderType::Limit, 110, 1, 1});
+        assert(!book.accept_order(orders.back()));
+    }
+    assert(feed.next(msg) == scu::ShmReadStatus::Overrun);
+    assert(!feed.recover(snapshot));
+
+    book.instrumentation().close();
+
+    std::cout << "OK" << std::endl;
+}
+
+// Book updates are seen by another process
+void test_other_process()
+{
+    const auto name = shm_name("scob_md_process");
+
+    PublishingBook<1024> book;
+    assert(book.instrumentation().open(name.c_str()));
+
+    std::deque<OwnedOrder<>> orders;
+    for (int i = 0; i != 10; ++i)
+    {
+        orders.push_back({scob::Side::Sell, scob::OrderType::Limit, 101 + i, 10, 1});
+        assert(!book.accept_order(orders.back()));
+    }
+    book.instrumentation().publish_snapshot(book);
+
+    pid_t child = ::fork();
+    if (!child)
+    {
+        scob::MarketDataSubscriber<1024, 4> feed(name.c_str());
+        decltype(feed)::SnapshotType snapshot;
+        if (!feed.is_open() || !feed.recover(snapshot) || snapshot.ask_count != 4)
+        {
+            ::_exit(1);
+        }
+        // Follow book until parent sweeps the best level
+        scob::MarketDataMessage msg;
+        for (;;)
+        {
+            if (feed.next(msg) == scu::ShmReadStatus::Ok
+                    && msg.type == scob::MarketDataType::LevelUpdate && msg.price == 101 && msg.quantity == 0)
+            {
+                ::_exit(0);
+            }
+        }
+    }
+
+    OwnedOrder<> buy{scob::Side::Buy, scob::OrderType::IOC, 101, 10, 2};
+    for (auto ex = book.accept_order(buy); ex; )
+    {
+        ex();
+    }
+
+    int status = 0;
+    assert(::waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    book.instrumentation().close();
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_ring();
+    test_publish();
+    test_publish_auction();
+    test_close_after_name();
+    test_overrun_recovery();
+    test_other_process();
+
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include "test_util.hpp"
+
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "lib.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<scu::NumberConcept _PriceType = int, scu::NumberConcept _QuantityType = int>
+struct IndexedOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    int owner;
+    scob::OwnerIndexHook<IndexedOrder> owner_hook;
+};
+
+template<typename BookType>
+typename BookType::OrderType::QuantityType total_cancelled(const BookType &book)
+{
+    typename BookType::OrderType::QuantityType total = 0;
+    for (const auto &oq : book.mass_cancels())
+    {
+        total += oq.quantity;
+    }
+    return total;
+}
+
+template<typename OrderType>
+void test_cancel_by_side_and_price()
+{
+    scob::OrderBook<OrderType> book;
+
+    OrderType b1{scob::Side::Buy, scob::OrderType::Limit, 98, 5};
+    OrderType b2{scob::Side::Buy, scob::OrderType::Limit, 99, 5};
+    OrderType b3{scob::Side::Buy, scob::OrderType::Limit, 99, 3};
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 101, 5};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 102, 5};
+    for (auto *order : {&b1, &b2, &b3, &a1, &a2})
+    {
+        assert(!book.accept_order(*order));
+    }
+
+    // 1. Price range on one side
+    assert(book.cancel_orders({.side = scob::Side::Buy, .min_price = 99}) == 2);
+    assert(book.mass_cancels().size() == 2);
+    assert(std::addressof(book.mass_cancels()[0].order()) == std::addressof(b2));
+    assert(std::addressof(book.mass_cancels()[1].order()) == std::addressof(b3));
+    assert(total_cancelled(book) == 8);
+    assert(book.bid().size() == 1);
+    assert(book.bid().top().price() == 98);
+    assert(book.ask().size() == 2);
+
+    // 2. Range with no levels
+    assert(book.cancel_orders({.min_price = 103, .max_price = 110}) == 0);
+    assert(book.mass_cancels().empty());
+
+    // 3. Everything
+    assert(book.cancel_orders() == 3);
+    assert(book.bid().empty() && book.ask().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_cancel_by_owner()
+{
+    scob::OrderBook<OrderType> book;
+    std::deque<OrderType> orders;
+
+    // Owners 1, 2 and 3 interleaved on three levels each side
+    for (int i = 0; i != 18; ++i)
+    {
+        auto side = (i % 2 ? scob::Side::Buy : scob::Side::Sell);
+        int price = (side == scob::Side::Buy ? 99 - i % 3 : 101 + i % 3);
+        auto &order = orders.emplace_back(OrderType{side, scob::OrderType::Limit, price, 1 + i, 1 + (i / 2) % 3});
+        assert(!book.accept_order(order));
+    }
+
+    // 1. Owner 2 on sell side only
+    const size_t sell_orders = book.ask().begin()->size() + (book.ask().begin() + 1)->size() + (book.ask().begin() + 2)->size();
+    assert(book.cancel_owner_orders(2, {.side = scob::Side::Sell}) == 3);
+    for (const auto &oq : book.mass_cancels())
+    {
+        assert(oq.order().owner == 2 && oq.order().side == scob::Side::Sell);
+        assert(oq.quantity == oq.order().quantity);
+    }
+    size_t sell_orders_left = 0;
+    for (const auto &level : book.ask())
+    {
+        sell_orders_left += level.size();
+        for (const auto &oq : level)
+        {
+            assert(oq.order().owner != 2);
+        }
+    }
+    assert(sell_orders_left == sell_orders - 3);
+
+    // 2. Partially filled order is cancelled with quantity left
+    OrderType hit{scob::Side::Sell, scob::OrderType::IOC, 99, 1, 9};
+    for (auto ex = book.accept_order(hit); ex; ex())
+    {}
+    const auto &first_bid = book.bid().top().first();
+    const int partial_owner = first_bid.order().owner;
+    const auto partial_left = first_bid.quantity;
+    const auto *partial_order = std::addressof(first_bid.order());
+
+    assert(book.cancel_owner_orders(partial_owner) > 0);
+    bool found = false;
+    for (const auto &oq : book.mass_cancels())
+    {
+        if (std::addressof(oq.order()) == partial_order)
+        {
+            assert(oq.quantity == partial_left);
+            found = true;
+        }
+    }
+    assert(found);
+
+    // 3. Owner without orders
+    assert(book.cancel_owner_orders(7) == 0);
+
+    // 4. Levels left empty are erased
+    for (int owner : {1, 2, 3})
+    {
+        book.cancel_owner_orders(owner);
+    }
+    assert(book.bid().empty() && book.ask().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Orders leave owner index when filled, and copies are not indexed
+void test_owner_index()
+{
+    typedef IndexedOrder<int, int> OrderType;
+    scob::OrderBook<OrderType> book;
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5, 1};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 5, 1};
+    OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 101, 5, 2};
+    for (auto *order : {&a1, &a2, &a3})
+    {
+        assert(!book.accept_order(*order));
+        assert(order->owner_hook.is_linked());
+    }
+
+    OrderType copy = a1;
+    assert(!copy.owner_hook.is_linked());
+
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 100, 7, 3};
+    for (auto ex = book.accept_order(b1); ex; ex())
+    {}
+    assert(!b1.owner_hook.is_linked());
+    assert(!a1.owner_hook.is_linked()); //< Filled
+    assert(a2.owner_hook.is_linked());  //< Partially filled
+
+    assert(book.cancel_owner_orders(1) == 1);
+    assert(std::addressof(book.mass_cancels()[0].order()) == std::addressof(a2));
+    assert(book.mass_cancels()[0].quantity == 3);
+    assert(!a2.owner_hook.is_linked());
+    assert(a3.owner_hook.is_linked());
+
+    // Price range narrows orders of the owner
+    assert(book.cancel_owner_orders(2, {.max_price = 100}) == 0);
+    assert(book.cancel_owner_orders(2, {.min_price = 101}) == 1);
+    assert(!a3.owner_hook.is_linked());
+    assert(book.ask().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Levels of the owner are swept once on each side, and only levels left
+// empty between others are erased
+void test_owner_levels_erased()
+{
+    typedef IndexedOrder<int, int> OrderType;
+    scob::OrderBook<OrderType> book;
+
+    std::deque<OrderType> orders{
+        {scob::Side::Buy, scob::OrderType::Limit, 100, 5, 1},
+        {scob::Side::Buy, scob::OrderType::Limit, 99, 5, 2},
+        {scob::Side::Buy, scob::OrderType::Limit, 98, 5, 1},
+        {scob::Side::Buy, scob::OrderType::Limit, 97, 5, 1},
+        {scob::Side::Buy, scob::OrderType::Limit, 97, 3, 2},
+        {scob::Side::Buy, scob::OrderType::Limit, 96, 5, 1},
+        {scob::Side::Sell, scob::OrderType::Limit, 101, 5, 1},
+        {scob::Side::Sell, scob::OrderType::Limit, 102, 5, 2},
+        {scob::Side::Sell, scob::OrderType::Limit, 103, 5, 1}};
+    for (auto &order : orders)
+    {
+        assert(!book.accept_order(order));
+    }
+
+    assert(book.cancel_owner_orders(1) == 6);
+    assert(total_cancelled(book) == 30);
+
+    std::vector<std::pair<int, int>> bids;
+    for (const auto &level : book.bid())
+    {
+        bids.emplace_back(level.price(), level.total_quantity());
+    }
+    assert((bids == std::vector<std::pair<int, int>>{{99, 5}, {97, 3}}));
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().price() == 102);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Many owners and orders, index and scan must cancel the same orders
+// Owner -1 is reserved by the index, and its orders are found by scanning
+void test_reserved_owner()
+{
+    typedef IndexedOrder<int, int> OrderType;
+    scob::OrderBook<OrderType> book;
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5, -1};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 101, 5, 1};
+    assert(!book.accept_order(a1));
+    assert(!book.accept_order(a2));
+    assert(!a1.owner_hook.is_linked());
+    assert(a2.owner_hook.is_linked());
+
+    assert(book.cancel_owner_orders(-1) == 1);
+    assert(std::addressof(book.mass_cancels()[0].order()) == std::addressof(a1));
+    assert(book.ask().size() == 1 && book.ask().top().price() == 101);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_owner_index_matches_scan()
+{
+    scob::OrderBook<OwnedOrder<int, int>> scanned;
+    scob::OrderBook<IndexedOrder<int, int>> indexed;
+    std::deque<OwnedOrder<int, int>> scanned_orders;
+    std::deque<IndexedOrder<int, int>> indexed_orders;
+
+    for (int i = 0; i != 2000; ++i)
+    {
+        auto side = (i % 2 ? scob::Side::Buy : scob::Side::Sell);
+        int price = (side == scob::Side::Buy ? 100 - (i * 7) % 20 : 101 + (i * 11) % 20);
+        auto &o1 = scanned_orders.emplace_back(OwnedOrder<int, int>{side, scob::OrderType::Limit, price, 1 + i % 5, i % 37});
+        auto &o2 = indexed_orders.emplace_back(IndexedOrder<int, int>{side, scob::OrderType::Limit, price, 1 + i % 5, i % 37});
+        assert(!scanned.accept_order(o1));
+        assert(!indexed.accept_order(o2));
+    }
+
+    for (int owner = 0; owner < 37; owner += 3)
+    {
+        scob::MassCancelFilter<OwnedOrder<int, int>> f1{.min_price = 95, .max_price = 115};
+        scob::MassCancelFilter<IndexedOrder<int, int>> f2{.min_price = 95, .max_price = 115};
+        const auto n = scanned.cancel_owner_orders(owner, f1);
+        assert(n == indexed.cancel_owner_orders(owner, f2));
+        assert(total_cancelled(scanned) == total_cancelled(indexed));
+    }
+
+    assert(scanned.bid().size() == indexed.bid().size());
+    assert(scanned.ask().size() == indexed.ask().size());
+    auto it2 = indexed.bid().begin();
+    for (auto it1 = scanned.bid().begin(); it1 != scanned.bid().end(); ++it1, ++it2)
+    {
+        assert(it1->price() == it2->price());
+        assert(it1->total_quantity() == it2->total_quantity());
+        assert(it1->size() == it2->size());
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_cancel_by_side_and_price<scob::Order<int, int>>();
+    test_cancel_by_side_and_price<scob::Order<double, long>>();
+    test_cancel_by_owner<OwnedOrder<int, int>>();
+    test_cancel_by_owner<IndexedOrder<int, int>>();
+    test_owner_index();
+    test_owner_levels_erased();
+    test_reserved_owner();
+    test_owner_index_matches_scan();
+
+    return 0;
+}
@@ -0,0 +1,298 @@
+#include "test_util.hpp"
+
+#include <iostream>
+#include <memory>
+
+#include "lib.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<scu::NumberConcept _PriceType = int, scu::NumberConcept _QuantityType = int>
+struct StopOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    PriceType stop_price;
+};
+
+template<typename OrderType>
+void test_stop_orders()
+{
+    scob::OrderBook<OrderType> book;
+
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 5, .stop_price = 0};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 102, .quantity = 5, .stop_price = 0};
+    OrderType a3{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 103, .quantity = 5, .stop_price = 0};
+    assert(!book.accept_order(a1));
+    assert(!book.accept_order(a2));
+    assert(!book.accept_order(a3));
+
+    // 1. Stop orders rest in trigger book, and don't touch order book
+    OrderType s1{.side = scob::Side::Buy, .order_type = scob::OrderType::Stop,
+        .price = 0, .quantity = 5, .stop_price = 101};
+    OrderType s2{.side = scob::Side::Buy, .order_type = scob::OrderType::StopLimit,
+        .price = 102, .quantity = 10, .stop_price = 102};
+    assert(!book.accept_order(s1));
+    assert(!book.accept_order(s2));
+
+    assert(book.bid().empty());
+    assert(book.ask().size() == 3);
+    assert(book.stops().buy_stops().size() == 2);
+    assert(book.stops().buy_stops().top().price() == 101);
+
+    // 2. Trade at 101 triggers s1, which executes as Market order, and its
+    // trade at 102 triggers s2, which executes as Limit order and rests
+    OrderType o1{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 101, .quantity = 2, .stop_price = 0};
+    auto ex1 = book.accept_order(o1);
+
+    assert_execution(ex1, a1, 2);
+    assert(book.aggressor() == std::addressof(o1));
+    assert_execution(ex1, a1, 3);
+    assert(book.aggressor() == std::addressof(s1));
+    assert_execution(ex1, a2, 2);
+    assert_execution(ex1, a2, 3);
+    assert(book.aggressor() == std::addressof(s2));
+    assert(!ex1);
+    assert(!book.aggressor());
+
+    assert(s1.order_type == scob::OrderType::Market);
+    assert(s2.order_type == scob::OrderType::Limit);
+    assert(book.stops().empty());
+    assert(*book.last_trade_price() == 102);
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().price() == 103);
+    assert(book.bid().size() == 1);
+    assert(std::addressof(book.bid().top().first().order()) == std::addressof(s2));
+    assert(book.bid().top().total_quantity() == 7);
+
+    // 3. Stop order whose stop price was already crossed is activated immediately
+    OrderType s3{.side = scob::Side::Sell, .order_type = scob::OrderType::Stop,
+        .price = 0, .quantity = 3, .stop_price = 102};
+    auto ex3 = book.accept_order(s3);
+    assert_execution(ex3, s2, 3);
+    assert(!ex3);
+    assert(book.bid().top().total_quantity() == 4);
+
+    // 4. Sell stops trigger when price falls, and stops at same price are
+    // triggered in order of arrival
+    OrderType s4{.side = scob::Side::Sell, .order_type = scob::OrderType::Stop,
+        .price = 0, .quantity = 1, .stop_price = 101};
+    OrderType s5{.side = scob::Side::Sell, .order_type = scob::OrderType::Stop,
+        .price = 0, .quantity = 1, .stop_price = 101};
+    OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 5, .stop_price = 0};
+    assert(!book.accept_order(s4));
+    assert(!book.accept_order(s5));
+    assert(!book.accept_order(b1));
+    assert(book.stops().sell_stops().size() == 1);
+    assert(book.stops().sell_stops().top().size() == 2);
+
+    OrderType o2{.side = scob::Side::Sell, .order_type = scob::OrderType::IOC, .price = 101, .quantity = 5, .stop_price = 0};
+    auto ex2 = book.accept_order(o2);
+    assert_execution(ex2, s2, 4);
+    assert_execution(ex2, b1, 1);
+    assert(book.aggressor() == std::addressof(o2));
+    assert_execution(ex2, b1, 1);
+    assert(book.aggressor() == std::addressof(s4));
+    assert_execution(ex2, b1, 1);
+    assert(book.aggressor() == std::addressof(s5));
+    assert(!ex2);
+    assert(book.stops().empty());
+    assert(book.bid().top().total_quantity() == 2);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_stop_order_without_stop_price()
+{
+    // Order without stop_price uses price as its stop price
+    scob::OrderBook<scob::Order<>> book;
+
+    scob::Order<> s1{.side = scob::Side::Sell, .order_type = scob::OrderType::Stop, .price = 99, .quantity = 5};
+    assert(!book.accept_order(s1));
+    assert(book.stops().sell_stops().size() == 1);
+    assert(book.stops().sell_stops().top().price() == 99);
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_iceberg_orders()
+{
+    scob::OrderBook<OrderType> book;
+
+    // 1. Only display quantity is visible on the level
+    OrderType i1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 10, .display_quantity = 3};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 2, .display_quantity = 0};
+    assert(!book.accept_order(i1));
+    assert(!book.accept_order(a2));
+
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().size() == 2);
+    assert(book.ask().top().total_quantity() == 5);
+    assert(book.ask().top().hidden_quantity() == 7);
+    assert(scob::quantity_of(book.ask().top().first()) == 3);
+
+    // 2. Once display quantity is filled, it is refreshed from reserve, and
+    // iceberg order goes to the back of the queue
+    OrderType o1{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 6, .display_quantity = 0};
+    auto ex1 = book.accept_order(o1);
+    assert_execution(ex1, i1, 3);
+    assert_execution(ex1, a2, 2);
+    assert_execution(ex1, i1, 1);
+    assert(!ex1);
+
+    assert(book.ask().top().size() == 1);
+    assert(book.ask().top().total_quantity() == 2);
+    assert(book.ask().top().hidden_quantity() == 4);
+
+    // 3. When it's the only order, iceberg keeps refreshing until reserve is
+    // used up, and last slice may be smaller than display quantity
+    OrderType o2{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 10, .display_quantity = 0};
+    auto ex2 = book.accept_order(o2);
+    assert_execution(ex2, i1, 2);
+    assert_execution(ex2, i1, 3);
+    assert_execution(ex2, i1, 1);
+    assert(!ex2);
+    assert(book.ask().empty());
+
+    // 4. Aggressive iceberg rests with display quantity of its remainder
+    OrderType a3{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 4, .display_quantity = 0};
+    OrderType i2{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit,
+        .price = 100, .quantity = 10, .display_quantity = 5};
+    assert(!book.accept_order(a3));
+    auto ex3 = book.accept_order(i2);
+    assert_execution(ex3, a3, 4);
+    assert(!ex3);
+    assert(book.bid().top().total_quantity() == 5);
+    assert(book.bid().top().hidden_quantity() == 1);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_trimmed_execution()
+{
+    // Execution policy trimming execution cancels rest of resting order
+    using OrderType = scob::Order<int, int>;
+    scob::OrderBook<OrderType> book;
+
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 7};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 3};
+    OrderType a3{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 4};
+    assert(!book.accept_order(a1));
+    assert(!book.accept_order(a2));
+    assert(!book.accept_order(a3));
+
+    OrderType o1{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 8};
+    scu::AsyncImmediate<scob::OrderSizeLimit<OrderType>> limit{5};
+    auto ex1 = book.accept_order(o1, limit);
+    assert_execution(ex1, a1, 5);
+    assert_execution(ex1, a2, 3);
+    assert(!ex1);
+
+    assert(book.ask().top().size() == 1);
+    assert(book.ask().top().total_quantity() == 4);
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_self_trade_prevention()
+{
+    using STP = scob::SelfTradePrevention;
+
+    // Book: Ask [(100, 5, owner 1), (100, 5, owner 2), (101, 5, owner 1)]
+    // Incoming: Buy Limit (101, 12, owner 1)
+    auto run = [](STP mode, auto &&check)
+    {
+        scob::OrderBook<OrderType> book;
+        book.set_self_trade_prevention(mode);
+
+        OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 5, .owner = 1};
+        OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 5, .owner = 2};
+        OrderType a3{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 5, .owner = 1};
+        OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 12, .owner = 1};
+        assert(!book.accept_order(a1));
+        assert(!book.accept_order(a2));
+        assert(!book.accept_order(a3));
+
+        auto ex = book.accept_order(b1);
+        check(book, ex, a1, a2, a3, b1);
+    };
+
+    // 1. Without prevention orders of same owner match
+    run(STP::None, [](auto &book, auto &ex, auto &a1, auto &a2, auto &a3, auto &)
+    {
+        assert_execution(ex, a1, 5);
+        assert_execution(ex, a2, 5);
+        assert_execution(ex, a3, 2);
+        assert(!ex);
+        assert(book.self_trade_cancels().empty());
+    });
+
+    // 2. Resting orders of same owner are cancelled, and the rest of incoming
+    // order rests on the book
+    run(STP::CancelResting, [](auto &book, auto &ex, auto &a1, auto &a2, auto &a3, auto &)
+    {
+        assert_execution(ex, a2, 5);
+        assert(!ex);
+        assert(book.ask().empty());
+        assert(book.bid().top().total_quantity() == 7);
+        assert(book.self_trade_cancels().size() == 2);
+        assert(std::addressof(book.self_trade_cancels()[0].order()) == std::addressof(a1));
+        assert(book.self_trade_cancels()[0].quantity == 5);
+        assert(std::addressof(book.self_trade_cancels()[1].order()) == std::addressof(a3));
+    });
+
+    // 3. Incoming order is cancelled, and resting order stays on the book
+    run(STP::CancelAggressor, [](auto &book, auto &ex, auto &, auto &, auto &, auto &b1)
+    {
+        assert(!ex);
+        assert(book.bid().empty());
+        assert(book.ask().size() == 2);
+        assert(book.ask().top().total_quantity() == 10);
+        assert(book.self_trade_cancels().size() == 1);
+        assert(std::addressof(book.self_trade_cancels()[0].order()) == std::addressof(b1));
+        assert(book.self_trade_cancels()[0].quantity == 12);
+    });
+
+    // 4. Both orders are cancelled
+    run(STP::CancelBoth, [](auto &book, auto &ex, auto &a1, auto &a2, auto &, auto &b1)
+    {
+        assert(!ex);
+        assert(book.bid().empty());
+        assert(book.ask().size() == 2);
+        assert(book.ask().top().total_quantity() == 5);
+        assert(std::addressof(book.ask().top().first().order()) == std::addressof(a2));
+        assert(book.self_trade_cancels().size() == 2);
+        assert(std::addressof(book.self_trade_cancels()[0].order()) == std::addressof(a1));
+        assert(std::addressof(book.self_trade_cancels()[1].order()) == std::addressof(b1));
+    });
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char** argv)
+{
+    test_stop_orders<StopOrder<int, int>>();
+    test_stop_orders<StopOrder<double, long>>();
+    test_stop_order_without_stop_price();
+    test_iceberg_orders<IcebergOrder<int, int>>();
+    test_iceberg_orders<IcebergOrder<long, double>>();
+    test_trimmed_execution();
+    test_self_trade_prevention<OwnedOrder<int, int>>();
+    test_self_trade_prevention<OwnedOrder<double, long>>();
+
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include "test_util.hpp"
+
+#include <deque>
+#include <iostream>
+#include <memory>
+
+#include "lib.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<typename OrderType>
+using ProRataBook = scob::OrderBook<OrderType, scob::ProRataBookSidePolicy<>>;
+
+template<typename OrderType>
+void test_allocation()
+{
+    ProRataBook<OrderType> book;
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 20};
+    OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 100, 30};
+    OrderType a4{scob::Side::Sell, scob::OrderType::Limit, 100, 50};
+    for (auto *order : {&a1, &a2, &a3, &a4})
+    {
+        assert(!book.accept_order(*order));
+    }
+
+    // 1. Top order is filled first, and the rest is split 20:30:50
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 100, 40};
+    auto ex1 = book.accept_order(b1);
+    assert_execution(ex1, a1, 10);
+    assert_execution(ex1, a2, 6);
+    assert_execution(ex1, a3, 9);
+    assert_execution(ex1, a4, 15);
+    assert(!ex1);
+
+    assert(book.ask().top().size() == 3);
+    assert(book.ask().top().total_quantity() == 70);
+
+    // 2. There is no top order any more, and 7 of 70 split 14:21:35 is 1.4,
+    // 2.1 and 3.5 rounded down, and one lot left over goes to a2
+    OrderType b2{scob::Side::Buy, scob::OrderType::IOC, 100, 7};
+    auto ex2 = book.accept_order(b2);
+    assert_execution(ex2, a2, 2);
+    assert_execution(ex2, a3, 2);
+    assert_execution(ex2, a4, 3);
+    assert(!ex2);
+    assert(book.ask().top().total_quantity() == 63);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Lots left over by rounding down go in time priority
+void test_rounding()
+{
+    typedef scob::Order<int, int> OrderType;
+    ProRataBook<OrderType> book;
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    OrderType a4{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    for (auto *order : {&a1, &a2, &a3, &a4})
+    {
+        assert(!book.accept_order(*order));
+    }
+
+    // 7 of 30 is 2.33 each, and one lot left over goes to a2
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 100, 12};
+    auto ex = book.accept_order(b1);
+    assert_execution(ex, a1, 5);
+    assert_execution(ex, a2, 3);
+    assert_execution(ex, a3, 2);
+    assert_execution(ex, a4, 2);
+    assert(!ex);
+
+    // Single lot goes to the first order
+    OrderType b2{scob::Side::Buy, scob::OrderType::IOC, 100, 1};
+    auto ex2 = book.accept_order(b2);
+    assert_execution(ex2, a2, 1);
+    assert(!ex2);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Levels are swept in price priority, with pro-rata on each
+template<typename OrderType>
+void test_sweep_levels()
+{
+    ProRataBook<OrderType> book;
+    std::deque<OrderType> orders;
+
+    for (int i = 0; i != 30; ++i)
+    {
+        auto &order = orders.emplace_back(OrderType{scob::Side::Buy, scob::OrderType::Limit,
+            static_cast<typename OrderType::PriceType>(100 - i % 3), static_cast<typename OrderType::QuantityType>(1 + i % 7)});
+        assert(!book.accept_order(order));
+    }
+    const auto top_quantity = book.bid().top().total_quantity();
+    const auto total_quantity = top_quantity + (book.bid().begin() + 1)->total_quantity() + (book.bid().begin() + 2)->total_quantity();
+
+    OrderType s1{scob::Side::Sell, scob::OrderType::Limit, 99, top_quantity + 5};
+    typename OrderType::QuantityType executed = 0;
+    for (auto ex = book.accept_order(s1); ex; )
+    {
+        auto e = ex();
+        assert(scob::price_of(e) >= 99);
+        executed += e.quantity;
+    }
+    assert(executed == top_quantity + 5);
+    assert(book.bid().top().price() == 99);
+
+    // Levels left and quantities agree
+    typename OrderType::QuantityType left = 0;
+    for (const auto &level : book.bid())
+    {
+        typename OrderType::QuantityType level_quantity = 0;
+        for (const auto &oq : level)
+        {
+            assert(oq.quantity > 0);
+            level_quantity += oq.quantity;
+        }
+        assert(level_quantity == level.total_quantity());
+        left += level_quantity;
+    }
+    assert(left == total_quantity - executed);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Order trimmed by execution policy is cancelled, and matching continues
+void test_execution_policy()
+{
+    typedef scob::Order<int, int> OrderType;
+    ProRataBook<OrderType> book;
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    for (auto *order : {&a1, &a2, &a3})
+    {
+        assert(!book.accept_order(*order));
+    }
+
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 100, 16};
+    scu::AsyncImmediate<scob::OrderSizeLimit<OrderType>> limit{4};
+    auto ex = book.accept_order(b1, limit);
+    assert_execution(ex, a1, 4);    //< Top order trimmed from 10, and cancelled
+    assert_execution(ex, a2, 3);    //< 6 of 20
+    assert_execution(ex, a3, 3);
+    assert_execution(ex, a2, 3);    //< 6 trimmed off a1 in another round
+    assert_execution(ex, a3, 3);
+    assert(!ex);
+
+    assert(book.ask().top().size() == 2);
+    assert(book.ask().top().total_quantity() == 8);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Iceberg is allocated by its display quantity, and refreshed in place
+template<typename OrderType>
+void test_iceberg()
+{
+    ProRataBook<OrderType> book;
+
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 10, .display_quantity = 0};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 30, .display_quantity = 10};
+    OrderType a3{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 10, .display_quantity = 0};
+    for (auto *order : {&a1, &a2, &a3})
+    {
+        assert(!book.accept_order(*order));
+    }
+    assert(book.ask().top().total_quantity() == 30);
+    assert(book.ask().top().hidden_quantity() == 20);
+
+    OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 20, .display_quantity = 0};
+    auto ex = book.accept_order(b1);
+    assert_execution(ex, a1, 10);
+    assert_execution(ex, a2, 5);
+    assert_execution(ex, a3, 5);
+    assert(!ex);
+
+    // Fully filled display is refreshed from reserve, and keeps its place
+    OrderType b2{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 10, .display_quantity = 0};
+    auto ex2 = book.accept_order(b2);
+    assert_execution(ex2, a2, 5);
+    assert_execution(ex2, a3, 5);
+    assert(!ex2);
+
+    assert(book.ask().top().size() == 1);
+    assert(std::addressof(book.ask().top().first().order()) == std::addressof(a2));
+    assert(book.ask().top().total_quantity() == 10);
+    assert(book.ask().top().hidden_quantity() == 10);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_self_trade_prevention()
+{
+    typedef OwnedOrder<int, int> OrderType;
+    using STP = scob::SelfTradePrevention;
+
+    // 1. Resting orders of the same owner are cancelled, and the rest is
+    // allocated to the others
+    {
+        ProRataBook<OrderType> book;
+        book.set_self_trade_prevention(STP::CancelResting);
+        OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 10, 1};
+        OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 10, 2};
+        OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 100, 30, 3};
+        for (auto *order : {&a1, &a2, &a3})
+        {
+            assert(!book.accept_order(*order));
+        }
+
+        OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 100, 8, 1};
+        auto ex = book.accept_order(b1);
+        assert_execution(ex, a2, 2);
+        assert_execution(ex, a3, 6);
+        assert(!ex);
+        assert(book.self_trade_cancels().size() == 1);
+        assert(std::addressof(book.self_trade_cancels()[0].order()) == std::addressof(a1));
+    }
+
+    // 2. Aggressor is cancelled before matching the level
+    {
+        ProRataBook<OrderType> book;
+        book.set_self_trade_prevention(STP::CancelAggressor);
+        OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 10, 2};
+        OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 10, 1};
+        assert(!book.accept_order(a1));
+        assert(!book.accept_order(a2));
+
+        OrderType b1{scob::Side::Buy, scob::OrderType::Limit, 100, 8, 1};
+        assert(!book.accept_order(b1));
+        assert(book.bid().empty());
+        assert(book.ask().top().total_quantity() == 20);
+        assert(book.self_trade_cancels().size() == 1);
+        assert(book.self_trade_cancels()[0].quantity == 8);
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+// Auction uncross allocates pro-rata too
+void test_uncross()
+{
+    typedef scob::Order<int, int> OrderType;
+    ProRataBook<OrderType> book;
+    book.set_trading_phase(scob::TradingPhase::Auction);
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 10};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 30};
+    OrderType b1{scob::Side::Buy, scob::OrderType::Limit, 100, 18};
+    for (auto *order : {&a1, &a2, &b1})
+    {
+        assert(!book.accept_order(*order));
+    }
+
+    int a1_filled = 0;
+    int a2_filled = 0;
+    for (auto trades = book.uncross(); trades; )
+    {
+        auto trade = trades();
+        (std::addressof(trade.sell()) == std::addressof(a1) ? a1_filled : a2_filled) += trade.quantity;
+    }
+    assert(a1_filled == 10); //< Top order
+    assert(a2_filled == 8);
+    assert(book.ask().top().total_quantity() == 22);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_allocation<scob::Order<int, int>>();
+    test_allocation<scob::Order<double, long>>();
+    test_rounding();
+    test_sweep_levels<scob::Order<int, int>>();
+    test_sweep_levels<scob::Order<double, long>>();
+    test_execution_policy();
+    test_iceberg<IcebergOrder<int, int>>();
+    test_iceberg<IcebergOrder<long, double>>();
+    test_self_trade_prevention();
+    test_uncross();
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/queuerank.hpp"
+#include "orderbook/replica.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+
+
+struct RankedOrder
+{
+    typedef int PriceType;
+    typedef int QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    std::uint64_t queue_ticket = 0;
+    bool cancel = false;
+};
+
+struct RankedIceberg
+{
+    typedef int PriceType;
+    typedef int QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    QuantityType display_quantity;
+    std::uint64_t queue_ticket = 0;
+};
+
+typedef scob::OrderPriceLevel<RankedOrder, std::deque> LevelType;
+
+// What queue position is by walking the queue
+template<typename Level, typename OrderType>
+scob::QueuePosition<int> walk(const Level &level, const OrderType &order)
+{
+    scob::QueuePosition<int> position;
+    for (auto &oq : level)
+    {
+        if (&oq.order() == &order)
+        {
+            break;
+        }
+        ++position.orders_ahead;
+        position.quantity_ahead += oq.quantity;
+    }
+    return position;
+}
+
+template<typename Level>
+void assert_positions(const Level &level)
+{
+    for (auto &oq : level)
+    {
+        auto expected = walk(level, oq.order());
+        auto position = level.queue_position(oq.order());
+        assert(position.orders_ahead == expected.orders_ahead);
+        assert(position.quantity_ahead == expected.quantity_ahead);
+    }
+}
+
+void test_queue_position()
+{
+    scob::OrderBook<RankedOrder> book;
+    std::deque<RankedOrder> orders;
+    for (int quantity : {5, 3, 7, 2})
+    {
+        auto &order = orders.emplace_back(RankedOrder{scob::Side::Sell, scob::OrderType::Limit, 101, quantity});
+        assert(!book.accept_order(order));
+    }
+    auto &other = orders.emplace_back(RankedOrder{scob::Side::Sell, scob::OrderType::Limit, 102, 4});
+    assert(!book.accept_order(other));
+
+    // 1. Each level counts its own queue
+    assert(book.queue_position(orders[0])->orders_ahead == 0);
+    assert(book.queue_position(orders[2])->orders_ahead == 2 && book.queue_position(orders[2])->quantity_ahead == 8);
+    assert(book.queue_position(orders[3])->quantity_ahead == 15);
+    assert(book.queue_position(other)->orders_ahead == 0);
+
+    // 2. Fills move orders up
+    RankedOrder buy{scob::Side::Buy, scob::OrderType::IOC, 101, 6};
+    for (auto ex = book.accept_order(buy); ex; ex())
+    {}
+    assert(book.queue_position(orders[1])->orders_ahead == 0);
+    assert(book.queue_position(orders[2])->orders_ahead == 1 && book.queue_position(orders[2])->quantity_ahead == 2);
+    assert(book.queue_position(orders[3])->quantity_ahead == 9);
+
+    // 3. No level at price of the order
+    assert(book.cancel_orders({.min_price = 102}) == 1);
+    assert(!book.queue_position(other));
+
+    std::cout << "OK" << std::endl;
+}
+
+// Random fills, cancels and amends, enough to rebuild trees many times
+void test_against_walk()
+{
+    LevelType level(100);
+    std::deque<RankedOrder> orders;
+    std::vector<scob::OrderQuantity<RankedOrder>> out;
+    std::mt19937 rng(7);
+
+    for (int round = 0; round != 200; ++round)
+    {
+        for (int i = 0; i != 20; ++i)
+        {
+            auto &order = orders.emplace_back(RankedOrder{scob::Side::Sell, scob::OrderType::Limit, 100, 1 + static_cast<int>(rng() % 50)});
+            level.add_order(order, order.quantity);
+        }
+
+        // Fill from the front
+        out.clear();
+        level.fill_orders(static_cast<int>(rng() % 200), out);
+        assert_positions(level);
+
+        // Cancel some from anywhere
+        for (auto &order : orders)
+        {
+            order.cancel = (rng() % 3 == 0);
+        }
+        level.cancel_orders_if([](const RankedOrder &order) { return order.cancel; }, out);
+        assert_positions(level);
+
+        // Amend quantity down, or to nothing
+        for (int i = 0; i != 5 && !level.empty(); ++i)
+        {
+            auto position = level.begin() + rng() % level.size();
+            level.reduce_order(position, 1 + static_cast<int>(rng() % 10));
+        }
+        assert_positions(level);
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_iceberg()
+{
+    scob::OrderPriceLevel<RankedIceberg, std::deque> level(100);
+    std::vector<scob::OrderQuantity<RankedIceberg>> fills;
+    RankedIceberg iceberg{scob::Side::Sell, scob::OrderType::Limit, 100, 6, 2};
+    RankedIceberg order{scob::Side::Sell, scob::OrderType::Limit, 100, 3, 0};
+    level.add_order(iceberg, 6);
+    level.add_order(order, 3);
+
+    // 1. Only displayed quantity is ahead
+    assert(level.queue_position(order).quantity_ahead == 2);
+
+    // 2. Refreshed iceberg goes to the back
+    level.fill_orders(2, fills);
+    assert(level.queue_position(order).orders_ahead == 0);
+    assert(level.queue_position(iceberg).orders_ahead == 1 && level.queue_position(iceberg).quantity_ahead == 3);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Replica keeps place of order amended down, as venues do
+void test_replica()
+{
+    scob::ReplicaBook<RankedOrder> book;
+    book.add_order(1, scob::Side::Buy, 100, 10);
+    book.add_order(2, scob::Side::Buy, 100, 5);
+    book.add_order(3, scob::Side::Buy, 100, 1);
+
+    book.reduce_order(1, 4);
+    assert(book.queue_position(2)->orders_ahead == 1 && book.queue_position(2)->quantity_ahead == 6);
+    book.execute_order(1, 6);
+    assert(book.queue_position(3)->orders_ahead == 1 && book.queue_position(3)->quantity_ahead == 5);
+    assert(!book.queue_position(1));
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_queue_position();
+    test_against_walk();
+    test_iceberg();
+    test_replica();
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/replica.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+
+
+typedef scob::Order<int, int> OrderType;
+typedef scob::ReplicaBook<OrderType> BookType;
+
+// Level updates and trades as market data would see them
+struct LevelLog : scob::InstrumentationHooks
+{
+    std::vector<std::tuple<scob::Side, int, int>> levels;
+    std::vector<std::pair<int, int>> trades;
+
+    template<typename PriceType, typename QuantityType>
+    void on_level_update(scob::Side side, PriceType price, QuantityType quantity)
+    {
+        levels.emplace_back(side, price, quantity);
+    }
+
+    template<typename PriceType>
+    void on_level_erased(scob::Side side, PriceType price)
+    {
+        levels.emplace_back(side, price, 0);
+    }
+
+    template<typename ExecutionType>
+    void on_execution(const ExecutionType &executed)
+    {
+        trades.emplace_back(price_of(executed), executed.quantity);
+    }
+};
+
+template<typename BookSide>
+std::vector<std::pair<int, int>> levels_of(const BookSide &book_side)
+{
+    std::vector<std::pair<int, int>> levels;
+    for (auto &level : book_side)
+    {
+        levels.emplace_back(level.price(), level.total_quantity());
+    }
+    return levels;
+}
+
+void test_replica_events()
+{
+    BookType book;
+
+    // 1. Adds build levels, and ids are unique
+    assert(book.add_order(1, scob::Side::Buy, 100, 5));
+    assert(book.add_order(2, scob::Side::Buy, 100, 7));
+    assert(book.add_order(3, scob::Side::Buy, 99, 4));
+    assert(book.add_order(4, scob::Side::Sell, 101, 3));
+    assert(!book.add_order(1, scob::Side::Sell, 102, 1));
+    assert(!book.add_order(5, scob::Side::Sell, 102, 0));
+    assert(book.size() == 4);
+    assert((levels_of(book.bid()) == std::vector<std::pair<int, int>>{{100, 12}, {99, 4}}));
+    assert((levels_of(book.ask()) == std::vector<std::pair<int, int>>{{101, 3}}));
+
+    // 2. Book may be crossed, as nothing is matched
+    assert(book.add_order(5, scob::Side::Sell, 100, 2));
+    assert(book.ask().top().price() == 100 && book.bid().top().total_quantity() == 12);
+
+    // 3. Reduce and execute take from order and its level
+    assert(book.reduce_order(2, 3));
+    assert(book.execute_order(1, 2));
+    assert(book.find_order(1)->quantity == 3 && book.find_order(2)->quantity == 4);
+    assert((levels_of(book.bid()) == std::vector<std::pair<int, int>>{{100, 7}, {99, 4}}));
+
+    // 4. Order that has nothing left is gone, and so is its level
+    assert(book.execute_order(3, 10));
+    assert(!book.find_order(3));
+    assert(book.delete_order(5));
+    assert((levels_of(book.bid()) == std::vector<std::pair<int, int>>{{100, 7}}));
+    assert((levels_of(book.ask()) == std::vector<std::pair<int, int>>{{101, 3}}));
+
+    // 5. Unknown ids are reported
+    assert(!book.reduce_order(3, 1));
+    assert(!book.execute_order(42, 1));
+    assert(!book.delete_order(5));
+    assert(book.size() == 3);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Orders keep their place in the queue when others around them leave
+void test_replica_queue()
+{
+    BookType book;
+    for (int id = 1; id <= 5; ++id)
+    {
+        assert(book.add_order(id, scob::Side::Sell, 101, id));
+    }
+
+    // 1. Delete from the middle and from the back
+    assert(book.delete_order(3));
+    assert(book.delete_order(5));
+    std::vector<int> queue;
+    for (auto &oq : book.ask().top())
+    {
+        queue.push_back(oq.quantity);
+    }
+    assert((queue == std::vector<int>{1, 2, 4}));
+
+    // 2. Storage of orders gone is reused, and ids can come back
+    assert(book.add_order(3, scob::Side::Sell, 101, 6));
+    assert(&book.ask().top().first().order() == book.find_order(1));
+    assert(book.ask().top().total_quantity() == 1 + 2 + 4 + 6);
+
+    // 3. Clear removes everything
+    book.clear();
+    assert(book.size() == 0 && book.ask().empty() && !book.find_order(1));
+    assert(book.add_order(1, scob::Side::Buy, 99, 1));
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_replica_instrumentation()
+{
+    scob::ReplicaBook<OrderType, scob::ReplicaBookSidePolicy<>, LevelLog> book;
+    auto &log = book.instrumentation();
+
+    book.add_order(1, scob::Side::Sell, 101, 5);
+    book.add_order(2, scob::Side::Sell, 101, 2);
+    book.execute_order(1, 5);
+    book.reduce_order(2, 2);
+
+    assert((log.levels == std::vector<std::tuple<scob::Side, int, int>>{
+        {scob::Side::Sell, 101, 5}, {scob::Side::Sell, 101, 7}, {scob::Side::Sell, 101, 2}, {scob::Side::Sell, 101, 0}}));
+    assert((log.trades == std::vector<std::pair<int, int>>{{101, 5}}));
+
+    std::cout << "OK" << std::endl;
+}
+
+// Id with all bits set is reserved by the index, and events for it are
+// ignored instead of reaching an empty slot
+void test_replica_reserved_id()
+{
+    BookType book;
+    const std::uint64_t reserved = ~std::uint64_t{0};
+    book.add_order(1, scob::Side::Buy, 100, 5);
+
+    assert(!book.reduce_order(reserved, 1));
+    assert(!book.execute_order(reserved, 1));
+    assert(!book.delete_order(reserved));
+    assert(!book.find_order(reserved));
+    assert(!book.add_order(reserved, scob::Side::Buy, 100, 5));
+    assert(book.size() == 1 && book.bid().top().total_quantity() == 5);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_replica_events();
+    test_replica_queue();
+    test_replica_instrumentation();
+    test_replica_reserved_id();
+
+    return 0;
+}
@@ -0,0 +1,370 @@
+#include "test_util.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "lib.hpp"
+#include "orderbook/risk.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+using namespace std::chrono_literals;
+
+
+template<scu::NumberConcept _PriceType = int, scu::NumberConcept _QuantityType = int, typename _OwnerType = unsigned>
+struct AccountOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    scob::Side side;
+    scob::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    _OwnerType owner;
+};
+
+template<typename OrderType>
+void test_position_and_notional_limits()
+{
+    using RiskType = scob::PreTradeRisk<OrderType>;
+    RiskType risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}};
+    risk.set_limits(2, {.max_position = 100, .max_notional = 1000, .max_orders = 1000});
+    risk.set_limits(3, {.max_position = 10, .max_notional = 1e9, .max_orders = 1000});
+
+    scob::OrderBook<OrderType> book;
+    auto risk_check = risk.check(book);
+
+    // 1. Seller (account 3) can only sell up to position of 10, so second
+    // order is trimmed, and the rest of it is cancelled
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 8, .owner = 3};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 8, .owner = 3};
+    OrderType a3{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 20, .owner = 4};
+    assert(!book.accept_order(a1));
+    assert(!book.accept_order(a2));
+    assert(!book.accept_order(a3));
+
+    OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 12, .owner = 1};
+    assert(risk.max_quantity(b1) == 12);
+    auto ex1 = book.accept_order(b1, risk_check);
+    assert(ex1);
+    auto ex = ex1();
+    assert(std::addressof(ex.order()) == std::addressof(a1));
+    assert(ex.quantity == 8);
+    ex = ex1();
+    assert(std::addressof(ex.order()) == std::addressof(a2));
+    assert(ex.quantity == 2);
+    assert(!ex1);
+
+    assert(risk.account(1)->position == 10);
+    assert(risk.account(3)->position == -10);
+    assert(risk.account(3)->notional == 1000);
+    assert(book.ask().size() == 1);
+    assert(book.bid().size() == 1);
+    assert(book.bid().top().total_quantity() == 2);
+
+    // 2. Buyer (account 2) can only trade notional of 1000, which is less
+    // than 10 at price of 101, and we size the order before matching
+    OrderType b2{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 101, .quantity = 20, .owner = 2};
+    b2.quantity = risk.max_quantity(b2);
+    assert(b2.quantity == 9);
+    auto ex2 = book.accept_order(b2, risk_check);
+    assert(ex2);
+    ex = ex2();
+    assert(std::addressof(ex.order()) == std::addressof(a3));
+    assert(ex.quantity == 9);
+    assert(!ex2);
+    assert(risk.account(2)->notional == 909);
+    assert(risk.account(4)->position == -9);
+    assert(book.ask().top().total_quantity() == 11);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_rate_limit()
+{
+    using OrderType = AccountOrder<int, int>;
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 1000, .max_notional = 1e9, .max_orders = 2}, 1ms};
+    risk.set_time(0ms);
+
+    std::vector<OrderType> buys(4, OrderType{scob::Side::Buy, scob::OrderType::IOC, 10, 5, 1});
+
+    // 1. Only two orders are admitted within the window
+    for (size_t i = 0; i != buys.size(); ++i)
+    {
+        assert(risk.admit_order(buys[i]) == (i < 2 ? 5 : 0));
+    }
+    assert(risk.account(1)->orders == 2);
+    assert(risk.max_quantity(buys[0]) == 0);
+
+    // 2. Executions of orders admitted don't count against the rate
+    OrderType sell{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 10, .quantity = 10, .owner = 2};
+    scob::OrderQuantity<OrderType> executed{sell, 5};
+    assert(risk.check_execution(buys[0], executed));
+    assert(executed.quantity == 5);
+    assert(risk.account(1)->orders == 2);
+
+    // 3. New window resets the rate
+    risk.set_time(1ms);
+    assert(risk.max_quantity(buys[0]) == 5);
+    assert(risk.admit_order(buys[0]) == 5);
+    assert(risk.account(1)->orders == 1);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_batch_check()
+{
+    using OrderType = AccountOrder<long, double>;
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}};
+    risk.set_limits(1, {.max_position = 12, .max_notional = 1e9, .max_orders = 1000});
+    risk.set_limits(5, {.max_position = 3, .max_notional = 1e9, .max_orders = 1000});
+
+    OrderType buy{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 50, .quantity = 20, .owner = 1};
+    std::vector<OrderType> sells{
+        {scob::Side::Sell, scob::OrderType::Limit, 50, 5, 4},
+        {scob::Side::Sell, scob::OrderType::Limit, 50, 5, 5},
+        {scob::Side::Sell, scob::OrderType::Limit, 50, 5, 6},
+        {scob::Side::Sell, scob::OrderType::Limit, 50, 5, 7}};
+
+    std::vector<scob::OrderQuantity<OrderType>> fills;
+    for (auto &sell : sells)
+    {
+        fills.emplace_back(sell, sell.quantity);
+    }
+
+    // Account 5 can sell only 3, and buyer can buy only 12 in total, and so
+    // buyer runs out on the third fill
+    assert(risk.check_batch(buy, fills) == 2);
+    assert(fills[0].quantity == 5);
+    assert(fills[1].quantity == 3);
+    assert(fills[2].quantity == 4);
+    assert(fills[3].quantity == 0);
+    assert(risk.account(1)->position == 12);
+    assert(risk.account(1)->notional == 600);
+    assert(risk.account(5)->position == -3);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Resting order is hit by many aggressors of other accounts, and its own
+// account's order rate doesn't cancel it
+template<typename OrderType>
+void test_resting_order_rate()
+{
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}, 1ms};
+    risk.set_limits(2, {.max_position = 100, .max_notional = 1e9, .max_orders = 1});
+    risk.set_time(0ms);
+
+    scob::OrderBook<OrderType> book;
+    auto risk_check = risk.check(book);
+    auto batch_check = risk.check_batches(book);
+
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 10, .owner = 2};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 10, .owner = 2};
+    assert(risk.admit_order(a1) == 10);
+    assert(!book.accept_order(a1));
+    assert(risk.admit_order(a2) == 0);
+
+    // 1. Each aggressor takes one from the resting order, one by one and in
+    // batches, and resting order is never cancelled
+    std::vector<OrderType> buys;
+    for (unsigned owner = 3; owner != 11; ++owner)
+    {
+        buys.push_back({scob::Side::Buy, scob::OrderType::IOC, 100, 1, owner});
+    }
+    for (std::size_t i = 0; i != buys.size(); ++i)
+    {
+        assert(risk.admit_order(buys[i]) == 1);
+        auto executions = (i % 2 ? book.accept_order(buys[i], risk_check) : book.accept_order(buys[i], batch_check));
+        assert(executions);
+        auto ex = executions();
+        assert(std::addressof(ex.order()) == std::addressof(a1));
+        assert(ex.quantity == 1);
+        assert(!executions);
+        assert(book.self_trade_cancels().empty());
+        assert(book.stopped_aggressors().empty());
+    }
+
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().size() == 1);
+    assert(book.ask().top().total_quantity() == 2);
+    assert(risk.account(2)->position == -8);
+    assert(risk.account(2)->orders == 1);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Owner -1 casts to the key reserved by the account table
+void test_reserved_account()
+{
+    using OrderType = AccountOrder<int, int, int>;
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}};
+    assert(!risk.set_limits(~std::uint64_t{0}, {.max_position = 1, .max_notional = 1, .max_orders = 1}));
+
+    OrderType buy{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 10, .quantity = 5, .owner = -1};
+    OrderType sell{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 10, .quantity = 5, .owner = 2};
+    assert(risk.max_quantity(buy) == 0);
+
+    // 1. Executions of reserved account are rejected either way round
+    scob::OrderQuantity<OrderType> executed{sell, 5};
+    assert(!risk.check_execution(buy, executed));
+    assert(executed.quantity == 0);
+
+    scob::OrderQuantity<OrderType> reversed{buy, 5};
+    assert(risk.check_execution(sell, reversed));
+    assert(reversed.quantity == 0);
+
+    std::vector<scob::OrderQuantity<OrderType>> fills{{sell, 5}};
+    assert(risk.check_batch(buy, fills) == 0);
+    assert(!risk.account(~std::uint64_t{0}));
+    assert(!risk.account(2) || risk.account(2)->position == 0);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Aggressor at its own limit is stopped, and resting order of another
+// account keeps what wasn't executed
+template<typename OrderType>
+void test_aggressor_limit()
+{
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}};
+    risk.set_limits(1, {.max_position = 2, .max_notional = 1e9, .max_orders = 1000});
+
+    scob::OrderBook<OrderType> book;
+    auto risk_check = risk.check(book);
+
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 10, .owner = 2};
+    assert(!book.accept_order(a1));
+
+    // 1. Limit order isn't left resting, and its rest is cancelled
+    OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 10, .owner = 1};
+    auto ex1 = book.accept_order(b1, risk_check);
+    assert(ex1);
+    auto ex = ex1();
+    assert(std::addressof(ex.order()) == std::addressof(a1));
+    assert(ex.quantity == 2);
+    assert(!ex1);
+
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().total_quantity() == 8);
+    assert(book.bid().empty());
+    assert(book.stopped_aggressors().size() == 1);
+    assert(std::addressof(book.stopped_aggressors()[0].order()) == std::addressof(b1));
+    assert(book.stopped_aggressors()[0].quantity == 8);
+    assert(book.self_trade_cancels().empty());
+
+    // 2. Aggressor with no headroom left doesn't touch the book at all
+    OrderType b2{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 10, .owner = 1};
+    assert(!book.accept_order(b2, risk_check));
+    assert(book.ask().top().total_quantity() == 8);
+    assert(book.stopped_aggressors().size() == 1);
+    assert(book.stopped_aggressors()[0].quantity == 10);
+
+    // 3. Other account still trades with the rest
+    OrderType b3{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 100, .quantity = 8, .owner = 3};
+    auto ex3 = book.accept_order(b3, risk_check);
+    assert(ex3);
+    assert(ex3().quantity == 8);
+    assert(!ex3);
+    assert(book.ask().empty());
+    assert(book.stopped_aggressors().empty());
+    assert(risk.account(2)->position == -10);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Account trading with itself counts its notional once
+void test_same_account()
+{
+    using OrderType = AccountOrder<int, int>;
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}};
+
+    OrderType buy{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 10, .quantity = 5, .owner = 1};
+    OrderType sell{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 10, .quantity = 5, .owner = 1};
+
+    scob::OrderQuantity<OrderType> executed{sell, 5};
+    assert(risk.check_execution(buy, executed));
+    assert(executed.quantity == 5);
+    assert(risk.account(1)->position == 0);
+    assert(risk.account(1)->notional == 50);
+
+    std::vector<scob::OrderQuantity<OrderType>> fills{{sell, 5}};
+    assert(risk.check_batch(buy, fills) == 1);
+    assert(risk.account(1)->position == 0);
+    assert(risk.account(1)->notional == 100);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Fills of each level are checked at once before they're applied
+template<typename OrderType>
+void test_batch_matching()
+{
+    scob::PreTradeRisk<OrderType> risk{{.max_position = 100, .max_notional = 1e9, .max_orders = 1000}};
+    risk.set_limits(1, {.max_position = 100, .max_notional = 1900, .max_orders = 1000});
+    risk.set_limits(5, {.max_position = 3, .max_notional = 1e9, .max_orders = 1000});
+
+    scob::OrderBook<OrderType> book;
+    auto risk_check = risk.check_batches(book);
+
+    std::vector<OrderType> sells{
+        {scob::Side::Sell, scob::OrderType::Limit, 100, 5, 4},
+        {scob::Side::Sell, scob::OrderType::Limit, 100, 5, 5},
+        {scob::Side::Sell, scob::OrderType::Limit, 100, 5, 6},
+        {scob::Side::Sell, scob::OrderType::Limit, 200, 5, 7},
+        {scob::Side::Sell, scob::OrderType::Limit, 200, 5, 8}};
+    for (auto &sell : sells)
+    {
+        assert(!book.accept_order(sell));
+    }
+
+    // 1. Account 5 can sell only 3, and the rest of its order is cancelled.
+    // Buyer takes 13 at 100, and has notional of 600 left, which is 3 at 200.
+    OrderType b1{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 200, .quantity = 30, .owner = 1};
+    auto ex1 = book.accept_order(b1, risk_check);
+    std::vector<int> quantities;
+    while (ex1)
+    {
+        quantities.push_back(static_cast<int>(ex1().quantity));
+    }
+    assert((quantities == std::vector<int>{5, 3, 5, 3}));
+
+    assert(book.ask().size() == 1);
+    assert(book.ask().top().price() == 200);
+    assert(book.ask().top().total_quantity() == 7);
+    assert(book.ask().top().size() == 2);
+    assert(book.stopped_aggressors().size() == 1);
+    assert(book.stopped_aggressors()[0].quantity == 14);
+
+    assert(risk.account(1)->position == 16);
+    assert(risk.account(1)->notional == 1900);
+    assert(risk.account(5)->position == -3);
+    assert(risk.account(7)->position == -3);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char** argv)
+{
+    test_position_and_notional_limits<AccountOrder<int, int>>();
+    test_position_and_notional_limits<AccountOrder<double, long>>();
+    test_rate_limit();
+    test_batch_check();
+    test_resting_order_rate<AccountOrder<int, int>>();
+    test_resting_order_rate<AccountOrder<long, double>>();
+    test_reserved_account();
+    test_aggressor_limit<AccountOrder<int, int>>();
+    test_aggressor_limit<AccountOrder<double, long>>();
+    test_same_account();
+    test_batch_matching<AccountOrder<int, int>>();
+    test_batch_matching<AccountOrder<long, double>>();
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "lib.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+using namespace std::chrono_literals;
+
+
+template<typename OrderType>
+struct Event
+{
+    size_t book_index;
+    const OrderType *order;
+    typename OrderType::QuantityType quantity;
+};
+
+void test_deferred_matching()
+{
+    using OrderType = scob::Order<int, int>;
+    using OrderBookType = scob::OrderBook<OrderType>;
+    using ExecutionPolicy = scu::AsyncDeferred<scob::OrderSizeLimit<OrderType>>;
+
+    scu::EventLoop loop;
+    ExecutionPolicy limit{loop, scob::OrderSizeLimit<OrderType>{4}, 100us};
+
+    OrderBookType book_a;
+    OrderBookType book_b;
+    scob::OrderBookScheduler<OrderBookType, ExecutionPolicy> scheduler{loop, limit};
+    size_t a = scheduler.add_book(book_a);
+    size_t b = scheduler.add_book(book_b);
+
+    OrderType a1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 100, .quantity = 3};
+    OrderType a2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 5};
+    OrderType b1{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 200, .quantity = 2};
+    OrderType b2{.side = scob::Side::Sell, .order_type = scob::OrderType::Limit, .price = 200, .quantity = 2};
+
+    OrderType o1{.side = scob::Side::Buy, .order_type = scob::OrderType::Limit, .price = 101, .quantity = 6};
+    OrderType o2{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 101, .quantity = 10};
+    OrderType o3{.side = scob::Side::Buy, .order_type = scob::OrderType::IOC, .price = 200, .quantity = 4};
+
+    scheduler.submit(a, a1);
+    scheduler.submit(a, a2);
+    scheduler.submit(a, o1);
+    scheduler.submit(a, o2);
+    scheduler.submit(b, b1);
+    scheduler.submit(b, b2);
+    scheduler.submit(b, o3);
+
+    std::vector<Event<OrderType>> events;
+    scheduler.run([&](size_t book_index, const auto &executed) {
+        events.push_back({book_index, std::addressof(executed.order()), executed.quantity});
+    });
+
+    // 1. Both books had their first check in flight at the same time, so
+    // matching of book B didn't wait for book A to finish
+    assert(events.size() == 5);
+    assert(events[0].book_index == a && events[0].order == &a1 && events[0].quantity == 3);
+    assert(events[1].book_index == b && events[1].order == &b1 && events[1].quantity == 2);
+    assert(events[2].book_index == a && events[2].order == &a2 && events[2].quantity == 3);
+    assert(events[3].book_index == b && events[3].order == &b2 && events[3].quantity == 2);
+
+    // 2. Orders of the same book are matched in order of submission: o2 sees
+    // book A only after o1 is done, and policy has limited execution to 4
+    assert(events[4].book_index == a && events[4].order == &a2 && events[4].quantity == 2);
+    assert(book_a.ask().empty());
+    assert(book_a.bid().empty());
+    assert(book_b.ask().empty());
+    assert(scheduler.idle());
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_pipelined_throughput()
+{
+    // Many books each with one check in flight. Total time is close to
+    // latency of checks that have to run one after another on the same
+    // book, and not to sum of latencies of all checks.
+    using OrderType = scob::Order<int, int>;
+    using OrderBookType = scob::OrderBook<OrderType>;
+
+    constexpr size_t num_books = 64;
+    constexpr size_t num_orders = 8;
+    constexpr auto latency = 200us;
+
+    // Check sees how many checks were in flight when it completes, itself
+    // included, which is what tells that books wait for their checks
+    // together, whatever the timing
+    scu::EventLoop loop;
+    size_t max_in_flight = 0;
+    auto count_in_flight = [&](const scob::OrderQuantity<OrderType> &)
+    {
+        max_in_flight = std::max(max_in_flight, loop.size() + 1);
+    };
+    using ExecutionPolicy = scu::AsyncDeferred<decltype(count_in_flight)>;
+
+    ExecutionPolicy check{loop, count_in_flight, latency};
+    std::vector<OrderBookType> books(num_books);
+    std::vector<OrderType> orders;
+    orders.reserve(num_books * num_orders * 2);
+
+    scob::OrderBookScheduler<OrderBookType, ExecutionPolicy> scheduler{loop, check};
+    for (auto &book : books)
+    {
+        size_t index = scheduler.add_book(book);
+        for (size_t i = 0; i != num_orders; ++i)
+        {
+            auto &ask = orders.emplace_back(OrderType{scob::Side::Sell, scob::OrderType::Limit, 100, 1});
+            auto &bid = orders.emplace_back(OrderType{scob::Side::Buy, scob::OrderType::IOC, 100, 1});
+            scheduler.submit(index, ask);
+            scheduler.submit(index, bid);
+        }
+    }
+
+    size_t num_executions = 0;
+    auto start = std::chrono::steady_clock::now();
+    scheduler.run([&](size_t, const auto &) { ++num_executions; });
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    assert(num_executions == num_books * num_orders);
+    assert(max_in_flight == num_books);
+
+    // Time is for information only, as it depends on the machine
+    std::cout << "OK " << num_executions << " executions in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us, "
+              << max_in_flight << " checks in flight (serial would be "
+              << std::chrono::duration_cast<std::chrono::microseconds>(latency * num_books * num_orders).count() << "us)" << std::endl;
+}
+
+int main(int argc, const char** argv)
+{
+    test_deferred_matching();
+    test_pipelined_throughput();
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "test_util.hpp"
+
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <type_traits>
+
+#include "lib.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<typename OrderType>
+using InstrumentedBook = scob::OrderBook<OrderType, scob::PriceLevelStackBookSidePolicy<>, scob::HotPathStats>;
+
+void test_no_stats_compiled_out()
+{
+    typedef scob::Order<int, int> OrderType;
+    static_assert(std::is_empty_v<scob::NoStats>);
+    static_assert(sizeof(scob::OrderBook<OrderType>) == sizeof(scob::OrderBook<OrderType, scob::PriceLevelStackBookSidePolicy<>, scob::NoStats>));
+    static_assert(sizeof(scob::OrderBook<OrderType>) < sizeof(InstrumentedBook<OrderType>));
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_hot_path_counters()
+{
+    using Stats = scob::HotPathStats;
+    InstrumentedBook<OrderType> book;
+    const auto &stats = book.instrumentation();
+
+    // 1. Four orders on three levels
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+    OrderType a3{scob::Side::Sell, scob::OrderType::Limit, 101, 5};
+    OrderType a4{scob::Side::Sell, scob::OrderType::Limit, 102, 5};
+    for (auto *order : {&a1, &a2, &a3, &a4})
+    {
+        assert(!book.accept_order(*order));
+    }
+    assert(stats.counter(Stats::AcceptOrder) == 4);
+    assert(stats.counter(Stats::LevelsCreated) == 3);
+    assert(stats.histogram(Stats::AddOrderCycles).count() == 4);
+    assert(stats.counter(Stats::Executions) == 0);
+
+    // 2. Sweep two levels and part of the third one
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 102, 12};
+    int executions = 0;
+    for (auto ex = book.accept_order(b1); ex; ex())
+    {
+        ++executions;
+    }
+    assert(executions == 3);
+    assert(stats.counter(Stats::AcceptOrder) == 5);
+    assert(stats.counter(Stats::Executions) == 3);
+    assert(stats.counter(Stats::LevelsTouched) == 2);
+    assert(stats.counter(Stats::OrdersTouched) == 3);
+    assert(stats.counter(Stats::LevelsErased) == 1);
+    assert(stats.histogram(Stats::MatchOrderCycles).count() == 5); //< One for each order
+
+    // Executions per order: four orders had none, and one had three
+    const auto &per_order = stats.histogram(Stats::ExecutionsPerOrder);
+    assert(per_order.count() == 5);
+    assert(per_order.sum() == 3);
+    assert(per_order.bucket(0) == 4);
+    assert(per_order.bucket(2) == 1);
+    assert(per_order.quantile_upper_bound(0.5) == 0);
+    assert(per_order.quantile_upper_bound(0.99) == 3);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Another thread reads counters while the book is being matched
+void test_concurrent_reader()
+{
+    using Stats = scob::HotPathStats;
+    typedef scob::Order<int, int> OrderType;
+    InstrumentedBook<OrderType> book;
+    const auto &stats = book.instrumentation();
+
+    constexpr int order_count = 100000;
+    std::atomic<bool> done{false};
+    uint64_t reads = 0;
+
+    std::thread reader([&]
+    {
+        uint64_t last = 0;
+        do
+        {
+            uint64_t value = stats.counter(Stats::AcceptOrder);
+            assert(last <= value);
+            last = value;
+            ++reads;
+        }
+        while (!done.load(std::memory_order_acquire));
+    });
+
+    std::deque<OrderType> orders;
+    for (int i = 0; i != order_count; ++i)
+    {
+        auto &order = orders.emplace_back(OrderType{
+            (i % 2 ? scob::Side::Buy : scob::Side::Sell), scob::OrderType::Limit, 100 + (i * 7) % 5 - 2, 1 + i % 3});
+        for (auto ex = book.accept_order(order); ex; ex())
+        {}
+    }
+
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    assert(reads > 0);
+    assert(stats.counter(Stats::AcceptOrder) == order_count);
+    assert(stats.histogram(Stats::ExecutionsPerOrder).count() == order_count);
+    assert(stats.counter(Stats::Executions) == stats.histogram(Stats::ExecutionsPerOrder).sum());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Sub-buckets keep quantiles within a few percent of the value
+void test_log_linear_histogram()
+{
+    typedef scu::LogLinearHistogram<4> HistogramType;
+
+    // 1. Buckets are contiguous, and cover every value
+    for (std::size_t i = 1; i != HistogramType::bucket_count; ++i)
+    {
+        assert(HistogramType::bucket_lower_bound(i) == HistogramType::bucket_upper_bound(i - 1) + 1);
+    }
+    assert(HistogramType::bucket_upper_bound(HistogramType::bucket_count - 1) == ~std::uint64_t(0));
+    for (std::uint64_t value : {0ul, 15ul, 16ul, 17ul, 1000ul, 123456789ul, ~0ul})
+    {
+        const std::size_t i = HistogramType::bucket_of(value);
+        assert(HistogramType::bucket_lower_bound(i) <= value && value <= HistogramType::bucket_upper_bound(i));
+    }
+
+    // 2. Tail of 1000 values is told apart from its neighbours
+    HistogramType histogram;
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.record(value * 100);
+    }
+    assert(histogram.count() == 1000);
+    const std::uint64_t p99 = histogram.quantile_upper_bound(0.99);
+    const std::uint64_t p999 = histogram.quantile_upper_bound(0.999);
+    assert(99000 < p99 && p99 < 99000 * 17 / 16);
+    assert(99900 < p999 && p999 < 99900 * 17 / 16);
+
+    // 3. Power of two buckets only know it is below 2^17
+    scu::Log2Histogram coarse;
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+    {
+        coarse.record(value * 100);
+    }
+    assert(coarse.quantile_upper_bound(0.99) == (1 << 17) - 1);
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_no_stats_compiled_out();
+    test_hot_path_counters<scob::Order<int, int>>();
+    test_hot_path_counters<scob::Order<double, long>>();
+    test_concurrent_reader();
+    test_log_linear_histogram();
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include "test_util.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "lib.hpp"
+#include "codec/stream.hpp"
+#include "util/filesource.hpp"
+#include "util/istream.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scc = sadhbhcraft::codec;
+namespace scu = sadhbhcraft::util;
+
+
+typedef scob::Order<long, long> OrderType;
+
+// Temporary file removed at the end of the test
+struct TempFile
+{
+    std::filesystem::path path;
+
+    TempFile(const std::string &name, const std::vector<char> &content)
+        : path(std::filesystem::temp_directory_path() / (name + "." + std::to_string(::getpid())))
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(content.data(), content.size());
+    }
+
+    ~TempFile() { std::filesystem::remove(path); }
+
+    const char *c_str() const { return path.c_str(); }
+};
+
+std::vector<OrderType> make_orders(size_t count)
+{
+    std::vector<OrderType> orders;
+    for (size_t i = 0; i != count; ++i)
+    {
+        orders.push_back({
+            (i % 2 ? scob::Side::Buy : scob::Side::Sell),
+            (i % 5 ? scob::OrderType::Limit : scob::OrderType::IOC),
+            static_cast<long>(100 + (i * 7) % 11),
+            static_cast<long>(1 + (i * 13) % 50)});
+    }
+    return orders;
+}
+
+template<typename Encode>
+std::vector<char> encode_all(const std::vector<OrderType> &orders, Encode encode)
+{
+    std::vector<char> buffer(orders.size() * 128);
+    size_t size = 0;
+    for (size_t i = 0; i != orders.size(); ++i)
+    {
+        size += encode(orders[i], i, std::span<char>(buffer).subspan(size));
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+void assert_same_orders(const std::vector<OrderType> &expected, const std::vector<OrderType> &actual)
+{
+    assert(expected.size() == actual.size());
+    for (size_t i = 0; i != expected.size(); ++i)
+    {
+        assert(expected[i].side == actual[i].side);
+        assert(expected[i].order_type == actual[i].order_type);
+        assert(expected[i].price == actual[i].price);
+        assert(expected[i].quantity == actual[i].quantity);
+    }
+}
+
+template<typename Source, typename Decoder>
+std::vector<OrderType> read_all(Source &source, Decoder decoder)
+{
+    std::vector<OrderType> result;
+    for (auto orders = scc::read_orders<OrderType>(source, decoder); orders;)
+    {
+        result.push_back(orders());
+    }
+    return result;
+}
+
+void test_read_fix_file()
+{
+    const auto orders = make_orders(5000);
+    TempFile file("test_stream.fix", encode_all(orders, [](const OrderType &o, size_t, std::span<char> out)
+    {
+        return scc::write_new_order_single(o, out);
+    }));
+
+    // 1. Small chunks, so that many messages are split by chunk boundary,
+    // and memory used stays the same
+    scu::ChunkedFileSource chunked(file.c_str(), 4096);
+    assert(chunked.is_open());
+    assert_same_orders(orders, read_all(chunked, scc::FixOrderDecoder{}));
+    assert(chunked.data().empty());
+    assert(chunked.eof() && !chunked.error());
+    assert(chunked.buffer_size() == 2 * 4096);
+
+    // 2. Mapped file
+    scu::MappedFileSource mapped(file.c_str());
+    assert(mapped.is_open());
+    assert_same_orders(orders, read_all(mapped, scc::FixOrderDecoder{}));
+    assert(mapped.data().empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+// Each corrupted record is skipped, and the rest of the file is read
+void test_read_corrupted_fix_file()
+{
+    const auto orders = make_orders(3000);
+    std::vector<std::string> messages;
+    for (const auto &order : orders)
+    {
+        std::string message(128, '\0');
+        message.resize(scc::write_new_order_single(order, std::span<char>(message)));
+        messages.push_back(message);
+    }
+
+    // Bad BodyLength, missing trailer, bad BeginString, and garbage
+    // between messages
+    messages[100].replace(messages[100].find("9=") + 2, 1, "x");
+    messages[1000].replace(messages[1000].rfind("10="), 3, "11=");
+    messages[2000].replace(messages[2000].find("FIX"), 3, "XYZ");
+    messages[2500].insert(0, "8=FIX.4.4\x01" "9=garbage\x01");
+
+    std::vector<char> content;
+    std::vector<OrderType> expected;
+    for (size_t i = 0; i != messages.size(); ++i)
+    {
+        content.insert(content.end(), messages[i].begin(), messages[i].end());
+        if (i != 100 && i != 1000 && i != 2000)
+        {
+            expected.push_back(orders[i]);
+        }
+    }
+    TempFile file("test_stream_corrupted.fix", content);
+
+    scu::ChunkedFileSource chunked(file.c_str(), 4096);
+    assert_same_orders(expected, read_all(chunked, scc::FixOrderDecoder{}));
+    assert(chunked.data().empty());
+
+    scu::MappedFileSource mapped(file.c_str());
+    assert_same_orders(expected, read_all(mapped, scc::FixOrderDecoder{}));
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_read_binary_file()
+{
+    const auto orders = make_orders(5000);
+    TempFile file("test_stream.bin", encode_all(orders, [](const OrderType &o, size_t id, std::span<char> out)
+    {
+        return scc::encode_new_order(o, id, out);
+    }));
+
+    scu::ChunkedFileSource chunked(file.c_str(), 4096);
+    assert_same_orders(orders, read_all(chunked, scc::BinaryOrderDecoder{}));
+
+    scu::MappedFileSource mapped(file.c_str());
+    assert_same_orders(orders, read_all(mapped, scc::BinaryOrderDecoder{}));
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_truncated_and_missing_files()
+{
+    auto content = encode_all(make_orders(3), [](const OrderType &o, size_t id, std::span<char> out)
+    {
+        return scc::encode_new_order(o, id, out);
+    });
+    content.resize(content.size() - 5);
+    TempFile file("test_stream.trunc", content);
+
+    // Last record is incomplete, and is left in the source
+    scu::ChunkedFileSource chunked(file.c_str(), 4096);
+    assert(read_all(chunked, scc::BinaryOrderDecoder{}).size() == 2);
+    assert(chunked.data().size() == 56 - 5);
+
+    scu::ChunkedFileSource missing("/nonexistent/orders.bin");
+    assert(!missing.is_open());
+    assert(read_all(missing, scc::BinaryOrderDecoder{}).empty());
+
+    scu::MappedFileSource missing_mapped("/nonexistent/orders.bin");
+    assert(!missing_mapped.is_open());
+    assert(read_all(missing_mapped, scc::BinaryOrderDecoder{}).empty());
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_generator_istream()
+{
+    std::string text;
+    for (int i = 0; i != 2000; ++i)
+    {
+        text += "line " + std::to_string(i) + "\n";
+    }
+    TempFile file("test_stream.txt", std::vector<char>(text.begin(), text.end()));
+
+    scu::ChunkedFileSource source(file.c_str(), 4096);
+    scu::GeneratorStreamBuf buf(scu::read_chunks(source));
+    std::istream in(&buf);
+
+    int count = 0;
+    for (std::string line; std::getline(in, line); ++count)
+    {
+        assert(line == "line " + std::to_string(count));
+    }
+    assert(count == 2000);
+
+    std::cout << "OK" << std::endl;
+}
+
+void test_replay_into_book()
+{
+    const auto orders = make_orders(2000);
+    TempFile file("test_stream.replay", encode_all(orders, [](const OrderType &o, size_t id, std::span<char> out)
+    {
+        return scc::encode_new_order(o, id, out);
+    }));
+
+    // 1. Book fed directly
+    std::vector<OrderType> direct_orders = orders;
+    scob::OrderBook<OrderType> direct;
+    long direct_executed = 0;
+    for (auto &order : direct_orders)
+    {
+        for (auto executions = direct.accept_order(order); executions;)
+        {
+            direct_executed += executions().quantity;
+        }
+    }
+
+    // 2. Book fed lazily from file, and orders must outlive the book
+    scu::ChunkedFileSource source(file.c_str(), 4096);
+    std::deque<OrderType> replayed_orders;
+    scob::OrderBook<OrderType> replayed;
+    long replayed_executed = 0;
+    for (auto orders = scc::read_orders<OrderType>(source, scc::BinaryOrderDecoder{}); orders;)
+    {
+        auto &order = replayed_orders.emplace_back(orders());
+        for (auto executions = replayed.accept_order(order); executions;)
+        {
+            replayed_executed += executions().quantity;
+        }
+    }
+
+    assert(direct_executed > 0);
+    assert(direct_executed == replayed_executed);
+    assert(direct.bid().size() == replayed.bid().size());
+    assert(direct.ask().size() == replayed.ask().size());
+    assert(direct.bid().top().total_quantity() == replayed.bid().top().total_quantity());
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_read_fix_file();
+    test_read_corrupted_fix_file();
+    test_read_binary_file();
+    test_truncated_and_missing_files();
+    test_generator_istream();
+    test_replay_into_book();
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "test_util.hpp"
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lib.hpp"
+#include "orderbook/flightrecorder.hpp"
+
+
+namespace scob = sadhbhcraft::orderbook;
+namespace scu = sadhbhcraft::util;
+
+
+template<typename OrderType, std::size_t Capacity = 64>
+using TracedBook = scob::OrderBook<OrderType, scob::PriceLevelStackBookSidePolicy<>, scob::FlightRecorder<Capacity>>;
+
+std::filesystem::path temp_path(const std::string &name)
+{
+    return std::filesystem::temp_directory_path() / (name + "." + std::to_string(::getpid()));
+}
+
+std::string read_file(const std::filesystem::path &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::vector<scob::TraceEvent> read_events(const std::string &data)
+{
+    std::vector<scob::TraceEvent> events;
+    auto error = scu::read_trace_dump<scob::TraceEvent>(data, [&](const scob::TraceEvent &event)
+    {
+        events.push_back(event);
+    });
+    assert(error == scu::TraceDumpError::None);
+    return events;
+}
+
+void test_trace_ring()
+{
+    scu::TraceRing<int, 8> ring;
+    assert(ring.size() == 0);
+
+    for (int i = 0; i != 5; ++i)
+    {
+        ring.push(i);
+    }
+    std::vector<int> seen;
+    ring.for_each([&](int x) { seen.push_back(x); });
+    assert((seen == std::vector<int>{0, 1, 2, 3, 4}));
+
+    // Oldest are overwritten
+    for (int i = 5; i != 13; ++i)
+    {
+        ring.push(i);
+    }
+    assert(ring.size() == 8);
+    assert(ring.total_count() == 13);
+    seen.clear();
+    ring.for_each([&](int x) { seen.push_back(x); });
+    assert((seen == std::vector<int>{5, 6, 7, 8, 9, 10, 11, 12}));
+
+    // Dump keeps the order across the wrap
+    auto path = temp_path("test_trace.ring");
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(ring.dump(fd));
+    ::close(fd);
+
+    const auto data = read_file(path);
+    std::filesystem::remove(path);
+    assert(data.size() == sizeof(scu::TraceDumpHeader) + 8 * sizeof(int));
+
+    seen.clear();
+    scu::TraceDumpHeader header{};
+    assert(scu::read_trace_dump<int>(data, [&](int x) { seen.push_back(x); }, &header) == scu::TraceDumpError::None);
+    assert((seen == std::vector<int>{5, 6, 7, 8, 9, 10, 11, 12}));
+    assert(header.count == 8 && header.total_count == 13);
+
+    // Damaged dumps
+    assert(scu::read_trace_dump<int>(data.substr(0, data.size() - 1), [](int) {}) == scu::TraceDumpError::Truncated);
+    assert(scu::read_trace_dump<long>(data, [](long) {}) == scu::TraceDumpError::BadEventSize);
+    assert(scu::read_trace_dump<int>("not a trace dump at all, but long enough", [](int) {}) == scu::TraceDumpError::BadMagic);
+
+    std::cout << "OK" << std::endl;
+}
+
+template<typename OrderType>
+void test_book_timeline()
+{
+    TracedBook<OrderType> book;
+    const auto &trace = book.instrumentation().trace();
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+    OrderType a2{scob::Side::Sell, scob::OrderType::Limit, 101, 5};
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 101, 7};
+
+    assert(!book.accept_order(a1));
+    assert(!book.accept_order(a2));
+    for (auto ex = book.accept_order(b1); ex; ex())
+    {}
+
+    std::vector<scob::TraceEvent> events;
+    trace.for_each([&](const scob::TraceEvent &event) { events.push_back(event); });
+
+    using T = scob::TraceEventType;
+    std::vector<T> types;
+    for (auto &event : events)
+    {
+        types.push_back(event.type);
+    }
+    assert((types == std::vector<T>{
+        T::AcceptOrder, T::LevelCreated, T::AcceptOrderDone,
+        T::AcceptOrder, T::LevelCreated, T::AcceptOrderDone,
+        T::AcceptOrder, T::Execution, T::Execution, T::LevelErased, T::AcceptOrderDone}));
+
+    // Timestamps never go back
+    for (size_t i = 1; i != events.size(); ++i)
+    {
+        assert(events[i - 1].tsc <= events[i].tsc);
+    }
+
+    auto &exec = events[7];
+    assert(exec.order == reinterpret_cast<std::uintptr_t>(&a1));
+    assert(exec.side == static_cast<std::uint8_t>(scob::Side::Sell));
+    assert(events.back().order == reinterpret_cast<std::uintptr_t>(&b1));
+    assert(events.back().aux == 2);
+
+    std::ostringstream line;
+    scob::format_trace_event(line, events[6], events[6].tsc);
+    assert(line.str().starts_with("+0 ACCEPT order=0x"));
+    assert(line.str().ends_with(" Buy IOC 101 x 7"));
+
+    line.str("");
+    scob::format_trace_event(line, events[9], events[6].tsc);
+    assert(line.str().ends_with(" LEVEL- Sell 100"));
+
+    std::cout << "OK" << std::endl;
+}
+
+// Dump on demand keeps only the last events
+void test_dump_on_demand()
+{
+    typedef scob::Order<int, int> OrderType;
+    TracedBook<OrderType, 16> book;
+
+    std::vector<OrderType> orders(20, OrderType{scob::Side::Buy, scob::OrderType::Limit, 100, 1});
+    for (auto &order : orders)
+    {
+        assert(!book.accept_order(order));
+    }
+
+    auto path = temp_path("test_trace.dump");
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(book.instrumentation().dump(fd));
+    ::close(fd);
+
+    auto events = read_events(read_file(path));
+    std::filesystem::remove(path);
+
+    assert(events.size() == 16);
+    assert(events.back().type == scob::TraceEventType::AcceptOrderDone);
+    assert(events.back().order == reinterpret_cast<std::uintptr_t>(&orders.back()));
+
+    std::cout << "OK" << std::endl;
+}
+
+// Recorder sees the same events next to another policy
+void test_composite()
+{
+    typedef scob::Order<int, int> OrderType;
+    typedef scob::CompositeInstrumentation<scob::HotPathStats, scob::NoStats, scob::FlightRecorder<64>> InstrumentationType;
+    scob::OrderBook<OrderType, scob::PriceLevelStackBookSidePolicy<>, InstrumentationType> book;
+
+    OrderType a1{scob::Side::Sell, scob::OrderType::Limit, 100, 5};
+    OrderType b1{scob::Side::Buy, scob::OrderType::IOC, 100, 7};
+    assert(!book.accept_order(a1));
+    for (auto ex = book.accept_order(b1); ex; ex())
+    {}
+
+    using T = scob::TraceEventType;
+    std::vector<T> types;
+    book.instrumentation().get<2>().trace().for_each([&](const scob::TraceEvent &event) { types.push_back(event.type); });
+    assert((types == std::vector<T>{
+        T::AcceptOrder, T::LevelCreated, T::AcceptOrderDone,
+        T::AcceptOrder, T::Execution, T::LevelErased, T::AcceptOrderDone}));
+
+    const auto &stats = book.instrumentation().get<scob::HotPathStats>();
+    assert(stats.counter(scob::HotPathStats::AcceptOrder) == 2);
+    assert(stats.counter(scob::HotPathStats::Executions) == 1);
+    assert(stats.counter(scob::HotPathStats::LevelsErased) == 1);
+
+    std::cout << "OK" << std::endl;
+}
+
+// Child process records some events and crashes, and then we read the dump
+void test_crash_dump()
+{
+    auto path = temp_path("test_trace.crash");
+    std::filesystem::remove(path);
+
+    pid_t pid = ::fork();
+    assert(pid >= 0);
+    if (pid == 0)
+    {
+        typedef scob::Order<double, long> OrderType;
+        TracedBook<OrderType> book;
+        if (!book.instrumentation().install_crash_dump(path.c_str()))
+        {
+            ::_exit(2);
+        }
+        OrderType order{scob::Side::Buy, scob::OrderType::Limit, 99.5, 10};
+        for (auto ex = book.accept_order(order); ex; ex())
+        {}
+        ::raise(SIGABRT);
+        ::_exit(3);
+    }
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+
+    auto events = read_events(read_file(path));
+    std::filesystem::remove(path);
+
+    assert(events.size() == 3);
+    assert(events[0].type == scob::TraceEventType::AcceptOrder);
+    assert(events[0].flags == (scob::TracePriceIsFloat));
+
+    std::ostringstream line;
+    scob::format_trace_event(line, events[1], events[0].tsc);
+    assert(line.str().ends_with(" LEVEL+ Buy 99.5"));
+
+    std::cout << "OK" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    test_trace_ring();
+    test_book_timeline<scob::Order<int, int>>();
+    test_book_timeline<scob::Order<double, long>>();
+    test_dump_on_demand();
+    test_composite();
+    test_crash_dump();
+
+    return 0;
+}
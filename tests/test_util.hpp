@@ -7,6 +7,51 @@
 #undef NDEBUG
 #include <cassert>
 
+#include <memory>
 
+#include "orderbook/enums.hpp"
+#include "orderbook/concepts.hpp"
+#include "orderbook/traits.hpp"
+#include "util/concepts.hpp"
 
-#endif//INCLUDED_TEST_UTIL_HPP
\ No newline at end of file
+
+// Order types shared by tests of features, which order types opt in for by
+// having extra members
+
+template<sadhbhcraft::util::NumberConcept _PriceType = int, sadhbhcraft::util::NumberConcept _QuantityType = int>
+struct IcebergOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    sadhbhcraft::orderbook::Side side;
+    sadhbhcraft::orderbook::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    QuantityType display_quantity;
+};
+
+template<sadhbhcraft::util::NumberConcept _PriceType = int, sadhbhcraft::util::NumberConcept _QuantityType = int>
+struct OwnedOrder
+{
+    typedef _PriceType PriceType;
+    typedef _QuantityType QuantityType;
+
+    sadhbhcraft::orderbook::Side side;
+    sadhbhcraft::orderbook::OrderType order_type;
+    PriceType price;
+    QuantityType quantity;
+    int owner;
+};
+
+// Next execution yielded is of given resting order, and of given quantity
+template<typename GeneratorType, typename OrderType>
+void assert_execution(GeneratorType &executions, const OrderType &order, auto quantity)
+{
+    assert(executions);
+    auto executed = executions();
+    assert(std::addressof(executed.order()) == std::addressof(order));
+    assert(sadhbhcraft::orderbook::quantity_of(executed) == quantity);
+}
+
+#endif//INCLUDED_TEST_UTIL_HPP